@@ -50,7 +50,7 @@ void main()
     vec3 albedo = pow(texture(albedo_map, uv).rgb, vec3(2.2));
     vec3 w_normal = normalize(in_w_normal);
     float roughness = clamp(texture(roughness_map, uv).g, 0.0, 1.0);
-    float metalness = clamp(texture(metalness_map, uv).r, 0.0, 1.0);
+    float metalness = clamp(texture(metalness_map, uv).b, 0.0, 1.0); // blue, where glTF packs it next to roughness
 
     vec3 w_view = normalize(w_cam_position - w_frag_position);
     vec3 w_reflection = normalize(reflect(-w_view, w_normal));
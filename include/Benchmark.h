@@ -0,0 +1,114 @@
+#ifndef VIRTUALVISTA_BENCHMARK_H
+#define VIRTUALVISTA_BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "GpuProfiler.h"
+
+namespace vv
+{
+    /*
+     * Summary of a series of frame times in milliseconds. Percentiles use the nearest rank method.
+     */
+    struct FrameTimeStats
+    {
+        std::size_t count = 0;
+        double average    = 0.0;
+        double min        = 0.0;
+        double max        = 0.0;
+        double p50        = 0.0;
+        double p95        = 0.0;
+        double p99        = 0.0;
+    };
+
+	/*
+	 * Collects per frame CPU and GPU times of a benchmark run and reports them as JSON.
+	 */
+	class Benchmark
+	{
+	public:
+		Benchmark() = default;
+		~Benchmark() = default;
+
+        /*
+         * Prepares storage for frame_count frames. name identifies the run in the report, e.g. the camera path used.
+         * Heap allocations of the first warmup_frames frames don't count towards the steady state.
+         */
+        void create(const std::string &name, uint32_t frame_count, uint32_t warmup_frames = 0);
+
+        /*
+         * Records the timings of one frame. A negative gpu_ms marks the GPU time as unavailable for this frame.
+         */
+        void addFrame(double cpu_ms, double gpu_ms);
+
+        /*
+         * Accumulates one frame's per pass GPU results. Passes are reported as averages over the frames they appeared in.
+         */
+        void addGPUZones(const std::vector<GpuZoneResult> &zones);
+
+        /*
+         * Records the number of heap allocations made during one frame.
+         */
+        void addHeapAllocations(uint64_t count);
+
+        /*
+         * Sets counter name of group, e.g. the command buffers a renderer subsystem re-recorded during the run. The report
+         * lists counters by group, both in alphabetical order.
+         */
+        void setCounter(const std::string &group, const std::string &name, double value);
+
+        /*
+         * Adds an entry called name to the array section, e.g. the statistics of one loaded asset. Entries are reported in
+         * the order they were added, their values in alphabetical order.
+         */
+        void addEntry(const std::string &section, const std::string &name, const std::map<std::string, double> &values);
+
+        /*
+         * Total heap allocations of every frame after the warmup frames.
+         */
+        uint64_t getSteadyStateHeapAllocations() const;
+
+        /*
+         * Computes statistics over every CPU frame time added so far.
+         */
+        FrameTimeStats getCPUStats() const;
+
+        /*
+         * Computes statistics over every valid GPU frame time added so far. count is 0 if none were available.
+         */
+        FrameTimeStats getGPUStats() const;
+
+        /*
+         * Writes the run's statistics to file_name as JSON.
+         */
+        void writeReport(const std::string &file_name) const;
+
+	private:
+        std::string m_name;
+        std::vector<double> m_cpu_times;
+        std::vector<double> m_gpu_times;
+        std::vector<uint64_t> m_heap_allocations;
+        uint32_t m_warmup_frames = 0;
+
+        struct ZoneTotals
+        {
+            GpuZoneResult sum;
+            uint64_t frames = 0;
+        };
+        std::map<std::string, ZoneTotals> m_gpu_zones;
+        std::map<std::string, std::map<std::string, double> > m_counters;
+
+        struct Entry
+        {
+            std::string name;
+            std::map<std::string, double> values;
+        };
+        std::map<std::string, std::vector<Entry> > m_sections;
+
+        static FrameTimeStats computeStats(std::vector<double> samples);
+	};
+}
+
+#endif // VIRTUALVISTA_BENCHMARK_H
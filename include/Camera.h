@@ -46,6 +46,16 @@ namespace vv
          */
         void rotate(float yaw, float pitch);
 
+        /*
+         * Places the camera at position looking towards look_at_point. Used to replay recorded camera paths exactly.
+         */
+        void setView(glm::vec3 position, glm::vec3 look_at_point);
+
+        /*
+         * Returns the point the camera is currently looking at.
+         */
+        glm::vec3 getLookAtPoint() const;
+
         /*
          * Used for updating descriptor data during main loop.
          */
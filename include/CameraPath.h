@@ -0,0 +1,64 @@
+#ifndef VIRTUALVISTA_CAMERAPATH_H
+#define VIRTUALVISTA_CAMERAPATH_H
+
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+namespace vv
+{
+    class Camera;
+
+    struct CameraKeyframe
+    {
+        float time;                 // seconds from the start of the path
+        glm::vec3 position;
+        glm::vec3 look_at_point;
+    };
+
+	/*
+	 * Timed list of camera poses that can be recorded from a live session and replayed later.
+	 *
+	 * Paths are stored as plain text with one keyframe per line: "time px py pz lx ly lz". Lines starting with # are ignored.
+	 */
+	class CameraPath
+	{
+	public:
+		CameraPath() = default;
+		~CameraPath() = default;
+
+        /*
+         * Replaces the current keyframes with the ones stored in file_name.
+         */
+        void load(const std::string &file_name);
+
+        /*
+         * Writes all keyframes to file_name.
+         */
+        void save(const std::string &file_name) const;
+
+        /*
+         * Appends the current pose of camera at time. Keyframes must be added in increasing time.
+         */
+        void addKeyframe(float time, const Camera *camera);
+
+        /*
+         * Moves camera to the pose along the path at time, linearly interpolating between the surrounding keyframes.
+         * Times outside of the path are clamped to its ends.
+         */
+        void apply(float time, Camera *camera) const;
+
+        /*
+         * Returns the time of the last keyframe.
+         */
+        float getDuration() const;
+
+        bool empty() const { return m_keyframes.empty(); }
+
+	private:
+        std::vector<CameraKeyframe> m_keyframes;
+	};
+}
+
+#endif // VIRTUALVISTA_CAMERAPATH_H
@@ -4,8 +4,13 @@
 
 #include <vector>
 #include <array>
+#include <unordered_map>
 
 #include "Scene.h"
+#include "ThreadPool.h"
+#include "GpuProfiler.h"
+#include "FrameArena.h"
+#include "RenderGraph.h"
 #include "GLFWWindow.h"
 #include "Utils.h"
 
@@ -21,6 +26,42 @@ namespace vv
             const char *msg,
             void *usr_data);
 
+    /*
+     * Recorded secondary command buffers of a single draw bucket, one per frame in flight. A command buffer is replayed
+     * as long as the bucket's version matches the one it was recorded from.
+     */
+    struct BucketCommandCache
+    {
+        VkCommandPool command_pool = VK_NULL_HANDLE; // only ever used by one recording thread at a time
+        std::vector<VkCommandBuffer> command_buffers;
+        std::vector<uint64_t> recorded_versions;     // 0 when nothing has been recorded yet
+        uint64_t last_used_frame = 0;
+        uint32_t gpu_zone = UINT32_MAX;              // GpuProfiler zone wrapping the bucket's commands
+        std::string gpu_zone_name;                   // chunks of the same material template share a name
+    };
+
+    /*
+     * Counts how often a bucket's cached commands could be replayed (hit) or had to be re-recorded (miss).
+     */
+    struct RecordingStats
+    {
+        uint64_t bucket_hits   = 0;
+        uint64_t bucket_misses = 0;
+    };
+
+    /*
+     * Synchronization objects and command storage owned by a single frame in flight.
+     */
+    struct FrameData
+    {
+        VkSemaphore image_ready_semaphore        = VK_NULL_HANDLE;
+        VkSemaphore rendering_complete_semaphore = VK_NULL_HANDLE;
+        VkFence in_flight_fence                  = VK_NULL_HANDLE;
+
+        VkCommandPool command_pool               = VK_NULL_HANDLE;
+        VkCommandBuffer command_buffer           = VK_NULL_HANDLE; // primary, re-recorded every frame
+    };
+
     class DeferredRenderer
     {
     public:
@@ -29,6 +70,9 @@ namespace vv
 
         /*
          * Initialize all necessary Vulkan internals.
+         *
+         * note: passing a null window renders headless into offscreen images instead of a swap chain. No surface or
+         *       presentation support is required from the device in that case.
          */
         void create(GLFWWindow *window);
 
@@ -42,11 +86,14 @@ namespace vv
 
         /*
          * Submits all command buffers to the various vulkan queues for execution.
+         *
+         * note: up to Settings::getMaxFramesInFlight() frames can be queued on the GPU at once. This only blocks
+         *       when the oldest of those frames hasn't finished, so CPU work for the next frame overlaps the GPU.
          */
         void run(float delta_time);
 
         /*
-         * Signals the renderer to start recording vulkan command buffers once the scene has been properly populated.
+         * Signals the renderer that the scene has been properly populated. Command buffers are recorded every frame from then on.
          */
         void recordCommandBuffers();
 
@@ -60,6 +107,47 @@ namespace vv
          */
         bool shouldStop();
 
+        /*
+         * Returns the bucket cache hits and misses accumulated since creation.
+         */
+        RecordingStats getRecordingStats() const;
+
+        /*
+         * Returns the passes, barriers and transient attachment memory of the compiled render graph.
+         */
+        RenderGraphStats getRenderGraphStats() const;
+
+        /*
+         * Returns how many descriptor sets and descriptors the device's pools hold and how many of them are in use.
+         */
+        DescriptorAllocatorStats getDescriptorAllocatorStats() const;
+
+        /*
+         * Returns the GPU time in milliseconds of the most recently retired frame, or a negative value if the graphics
+         * queue doesn't support timestamps or no frame has retired yet.
+         *
+         * note: frames retire Settings::getMaxFramesInFlight() calls to run() after they were submitted.
+         */
+        double getLastGPUFrameTime() const;
+
+        /*
+         * Returns per pass GPU times and pipeline statistics of the most recently retired frame: the whole frame,
+         * the skybox and one entry per material template.
+         */
+        const std::vector<GpuZoneResult>& getGPUZoneResults() const;
+
+        /*
+         * Returns the accounting of every device memory allocation, including the driver's budgets where supported.
+         */
+        MemoryTracker* getMemoryTracker() const;
+
+        /*
+         * Copies the color output of the most recently submitted frame into pixels as tightly packed RGBA8 rows.
+         *
+         * note: only available when rendering headless. Waits for the graphics queue to go idle.
+         */
+        void readbackFrame(std::vector<unsigned char> &pixels);
+
     protected:
         VkDebugReportCallbackEXT _debug_callback = VK_NULL_HANDLE;
 
@@ -71,18 +159,42 @@ namespace vv
         VulkanDevice m_physical_device;
     
         VulkanSwapChain m_swap_chain;
-        std::vector<VkFramebuffer> m_frame_buffers;
+        VkExtent2D m_extent = {};
+
+        // headless render targets, one color image per frame in flight takes the place of the swap chain images
+        bool m_headless = false;
+        std::vector<VulkanImage*> m_offscreen_color_images;
+        std::vector<VulkanImageView*> m_offscreen_color_image_views;
+        uint32_t m_last_image_index = 0;
+
+        std::vector<FrameData> m_frames;
+        std::vector<VkFence> m_images_in_flight; // fence of the frame currently rendering into each swap chain image
+        uint32_t m_current_frame = 0;
+        uint64_t m_frame_number = 0; // total frames submitted, used to retire deferred deletions
+        FrameArena m_frame_arena;    // transient CPU data of the frame being recorded, reset at the start of run()
+
+        GpuProfiler m_gpu_profiler;
+
+        // the frame's passes and attachments. depth is transient and owned by the graph.
+        RenderGraph m_render_graph;
+        uint32_t m_scene_pass = 0;
+        RenderResourceID m_color_target = 0;
+        RenderResourceID m_depth_target = 0;
+
+        // secondary command buffers of the draw buckets, allocated from the frame arena while the frame is recorded
+        VkCommandBuffer *m_bucket_command_buffers = nullptr;
+        uint32_t m_bucket_command_buffer_count = 0;
 
-        VkSemaphore m_image_ready_semaphore          = VK_NULL_HANDLE;
-        VkSemaphore m_rendering_complete_semaphore   = VK_NULL_HANDLE;
+        ThreadPool m_recording_threads;
 
-        VulkanRenderPass m_render_pass;
-        std::vector<VkCommandBuffer> m_command_buffers;
+        std::unordered_map<std::string, BucketCommandCache> m_bucket_caches; // keyed by DrawBucket::key
+        RecordingStats m_recording_stats;
 
         Scene m_scene;
 
         std::vector<const char*> m_used_validation_layers = { "VK_LAYER_LUNARG_standard_validation" };
         const std::vector<const char*> m_used_instance_extensions = { VK_EXT_DEBUG_REPORT_EXTENSION_NAME };
+        bool m_has_physical_device_properties2 = false; // optional, needed for VK_EXT_memory_budget queries
 
         /*
          * Creates the main Vulkan instance upon which the renderer rests.
@@ -104,6 +216,16 @@ namespace vv
          */
         bool checkInstanceExtensionSupport();
 
+        /*
+         * Returns whether a single instance extension is available on the current system.
+         */
+        bool isInstanceExtensionAvailable(const char *extension);
+
+        /*
+         * Hands the driver's memory budget query to the device's MemoryTracker when instance and device support it.
+         */
+        void enableMemoryBudgetQueries();
+
         /* 
          * Checks to see if the validation layers that were requested are available on the current system
          * FOR DEBUGGING PURPOSES ONLY 
@@ -120,6 +242,32 @@ namespace vv
          */
         void createFullscreenQuad();
 
+        /*
+         * Creates the color images rendered into when running headless.
+         */
+        void createOffscreenTargets();
+
+        /*
+         * Declares the frame's passes and attachments and compiles the render graph.
+         */
+        void createRenderGraph();
+
+        /*
+         * Records the primary command buffer of the current frame in flight. Each of the scene's draw buckets is replayed
+         * from its cached secondary command buffer, or re-recorded by a worker thread if it has changed.
+         */
+        void recordFrame(FrameData &frame, uint32_t image_index);
+
+        /*
+         * Returns the command cache of the given bucket, creating its command pool and buffers on first use.
+         */
+        BucketCommandCache& getBucketCache(const std::string &key);
+
+        /*
+         * Releases the caches of buckets that no longer exist through the device's DeletionQueue.
+         */
+        void evictUnusedBucketCaches();
+
     };
 }
 
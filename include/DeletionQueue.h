@@ -0,0 +1,73 @@
+#ifndef VIRTUALVISTA_DELETIONQUEUE_H
+#define VIRTUALVISTA_DELETIONQUEUE_H
+
+#include <deque>
+#include <functional>
+
+#include "Utils.h"
+
+namespace vv
+{
+	/*
+	 * Defers destruction of Vulkan objects until every frame that could still reference them has been retired by the GPU.
+	 * Deleters pushed while frame N is being built run once frame N + Settings::getMaxFramesInFlight() begins, at which
+	 * point the renderer has already waited on frame N's fence.
+	 *
+	 * note: this only covers frames in flight. Objects referenced by command buffers that are replayed every frame must be
+	 *       removed from those command buffers (i.e. they have to be re-recorded) before being pushed here.
+	 */
+	class DeletionQueue
+	{
+	public:
+		DeletionQueue() = default;
+		~DeletionQueue() = default;
+
+        /*
+         *
+         */
+		void create();
+
+        /*
+         * Runs every remaining deleter immediately.
+         *
+         * note: the caller has to make sure the device is idle.
+         */
+		void shutDown();
+
+        /*
+         * Queues a deleter to run once the frame currently being built has been retired.
+         */
+        void push(std::function<void()> deleter);
+
+        /*
+         * Marks the start of frame_number and runs the deleters of every frame the GPU is known to have finished.
+         * Must be called after waiting on the fence guarding this frame's resources.
+         */
+        void beginFrame(uint64_t frame_number);
+
+        /*
+         * Runs every queued deleter regardless of the frame it was pushed in.
+         *
+         * note: the caller has to make sure the device is idle.
+         */
+        void flush();
+
+        /*
+         * Returns the number of deleters still waiting on the GPU.
+         */
+        std::size_t size() const { return m_entries.size(); }
+
+	private:
+        struct Entry
+        {
+            uint64_t frame_number;
+            std::function<void()> deleter;
+        };
+
+        std::deque<Entry> m_entries; // pushed in frame order, oldest first
+        uint64_t m_frame_number     = 0;
+        uint32_t m_frames_in_flight = 1;
+	};
+}
+
+#endif // VIRTUALVISTA_DELETIONQUEUE_H
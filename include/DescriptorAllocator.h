@@ -0,0 +1,148 @@
+#ifndef VIRTUALVISTA_DESCRIPTORALLOCATOR_H
+#define VIRTUALVISTA_DESCRIPTORALLOCATOR_H
+
+#include <vector>
+#include <array>
+#include <unordered_map>
+
+#include "Utils.h"
+
+namespace vv
+{
+    class VulkanDevice;
+
+    /*
+     * A descriptor set plus what is needed to return it to its pool.
+     */
+    struct DescriptorAllocation
+    {
+        VkDescriptorSet set          = VK_NULL_HANDLE;
+        VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+        uint32_t pool                = UINT32_MAX;
+    };
+
+    struct DescriptorAllocatorStats
+    {
+        uint32_t pool_count            = 0;
+        uint32_t set_capacity          = 0; // maxSets summed over the pools
+        uint32_t allocated_sets        = 0;
+        uint64_t descriptor_capacity   = 0; // descriptors of every type summed over the pools
+        uint64_t allocated_descriptors = 0;
+        uint32_t pool_growths          = 0; // pools created because the existing ones ran out
+        uint32_t frame_pool_count      = 0; // pools of every frame in flight, not part of the numbers above
+        uint32_t peak_frame_sets       = 0; // most sets a single frame allocated
+    };
+
+	/*
+	 * Hands out descriptor sets from chains of pools that grow on demand instead of failing once a fixed size is
+	 * exceeded. Long lived sets come from one chain and are freed individually. Every frame in flight has a chain of
+	 * its own for sets that are only used by that frame, which is reset as a whole when the frame comes around again.
+	 * Pools live until shutDown().
+	 *
+	 * Pools are sized from the layouts in use rather than a fixed ratio of descriptor types: every layout is registered
+	 * with its bindings, and a new pool reserves each type in proportion to how often it was asked for so far. Sets and
+	 * descriptors left in every pool are tracked per type, so the allocator moves on to the next pool before the driver
+	 * would run out. Running out of a single descriptor type is only reported as an error with VK_KHR_maintenance1 or
+	 * Vulkan 1.1, before that it is invalid usage.
+	 */
+	class DescriptorAllocator
+	{
+	public:
+		DescriptorAllocator() = default;
+		~DescriptorAllocator() = default;
+
+        /*
+         * The first pool of every chain has room for sets_per_pool sets, later ones grow geometrically. Pools are created
+         * on demand. frame_count is the number of frames in flight.
+         */
+		void create(VulkanDevice *device, uint32_t sets_per_pool, uint32_t frame_count);
+
+        /*
+         * Destroys every pool, which frees all sets still allocated.
+         */
+		void shutDown();
+
+        /*
+         * Records the descriptors a set of layout consumes. Every layout has to be registered before sets are allocated
+         * with it. Registering a handle again, e.g. one the driver reused, replaces its bindings.
+         */
+        void registerLayout(VkDescriptorSetLayout layout, const std::vector<VkDescriptorSetLayoutBinding> &bindings);
+
+        /*
+         * Resets the pools of frame_index, which frees every set allocateFrame() returned the last time that frame was
+         * recorded, and makes it the frame allocateFrame() allocates for. Call once the frame's fence has been waited on.
+         */
+        void beginFrame(uint32_t frame_index);
+
+        /*
+         * Allocates a set that lives until free() is called.
+         */
+        DescriptorAllocation allocate(VkDescriptorSetLayout layout);
+
+        /*
+         * Allocates a set that lives until beginFrame() is called for the current frame index again. Command buffers
+         * binding it must not be submitted past that point.
+         */
+        VkDescriptorSet allocateFrame(VkDescriptorSetLayout layout);
+
+        /*
+         * Returns a set to its pool right away. The GPU must no longer use it; go through the device's DeletionQueue otherwise.
+         */
+        void free(const DescriptorAllocation &allocation);
+
+        /*
+         * Pool utilization, by sets and by descriptors.
+         */
+        DescriptorAllocatorStats getStats() const;
+
+	private:
+        // every core descriptor type, VK_DESCRIPTOR_TYPE_SAMPLER through VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT
+        static const uint32_t m_type_count = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT + 1;
+        typedef std::array<uint32_t, m_type_count> DescriptorCounts;
+
+        struct Pool
+        {
+            VkDescriptorPool pool   = VK_NULL_HANDLE;
+            uint32_t max_sets       = 0;
+            uint32_t allocated_sets = 0;
+            DescriptorCounts capacity;
+            DescriptorCounts allocated;
+            bool fragmented         = false; // the driver failed an allocation that fit, until the next free
+        };
+
+		VulkanDevice *m_device      = nullptr;
+        uint32_t m_sets_per_pool    = 0;
+        std::vector<Pool> m_pools;
+        std::vector<std::vector<Pool> > m_frame_pools; // one chain per frame in flight
+        uint32_t m_current_frame    = 0;
+        uint32_t m_frame_sets       = 0;               // allocated from the current frame's chain
+        uint32_t m_peak_frame_sets  = 0;
+        std::unordered_map<VkDescriptorSetLayout, DescriptorCounts> m_layouts;
+        std::array<uint64_t, m_type_count> m_type_demand; // descriptors asked for by registered layouts and allocations
+        uint64_t m_set_demand       = 0;
+        uint32_t m_pool_growths     = 0;
+
+        /*
+         * Descriptors per type of a registered layout.
+         */
+        const DescriptorCounts& getLayoutCounts(VkDescriptorSetLayout layout) const;
+
+        /*
+         * Allocates from the first pool of chain that has room, newest first, and appends a pool if none has. Frame
+         * chains are only reset as a whole, so their pools don't allow freeing individual sets.
+         */
+        uint32_t allocateFromChain(std::vector<Pool> &chain, bool frame_chain, VkDescriptorSetLayout layout, VkDescriptorSet &set);
+
+        /*
+         * Creates the existing_pools + 1th pool of a chain. It holds at least one set of counts.
+         */
+        Pool createPool(std::size_t existing_pools, const DescriptorCounts &counts, VkDescriptorPoolCreateFlags flags);
+
+        /*
+         * Allocates from pool if it has room for a set of counts. Returns false otherwise.
+         */
+        bool tryAllocate(Pool &pool, VkDescriptorSetLayout layout, const DescriptorCounts &counts, VkDescriptorSet &set);
+	};
+}
+
+#endif // VIRTUALVISTA_DESCRIPTORALLOCATOR_H
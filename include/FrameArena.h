@@ -0,0 +1,134 @@
+#ifndef VIRTUALVISTA_FRAMEARENA_H
+#define VIRTUALVISTA_FRAMEARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vv
+{
+    struct FrameArenaStats
+    {
+        std::size_t capacity    = 0; // over all blocks
+        std::size_t used        = 0; // since the last reset
+        std::size_t peak_used   = 0; // highest use of any frame so far
+        uint32_t block_count    = 0;
+    };
+
+	/*
+	 * Bump allocator for CPU data that only lives for the duration of a frame. Allocations are never freed individually;
+	 * reset() at the start of the next frame releases all of them at once.
+	 *
+	 * When a frame needs more than the current block, further blocks are allocated from the heap. The next reset()
+	 * replaces them with a single block large enough for that frame, so the arena settles after a few frames and the
+	 * frame loop stops touching the heap.
+	 */
+	class FrameArena
+	{
+	public:
+		FrameArena() = default;
+		~FrameArena() = default;
+
+        /*
+         * Allocates the first block of block_size bytes.
+         */
+		void create(std::size_t block_size);
+
+        /*
+         *
+         */
+		void shutDown();
+
+        /*
+         * Returns size bytes aligned to alignment, which has to be a power of two. Valid until the next reset().
+         */
+        void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+
+        /*
+         * Uninitialized storage for count objects of type T.
+         */
+        template <typename T>
+        T* allocateArray(std::size_t count)
+        {
+            return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        }
+
+        /*
+         * Invalidates every allocation made since the last reset.
+         */
+        void reset();
+
+        /*
+         *
+         */
+        FrameArenaStats getStats() const;
+
+	private:
+        struct Block
+        {
+            unsigned char *memory = nullptr;
+            std::size_t size      = 0;
+        };
+
+        std::vector<Block> m_blocks;
+        std::size_t m_current_block = 0;
+        std::size_t m_offset        = 0; // into the current block
+        std::size_t m_used          = 0; // over all blocks, including padding
+        std::size_t m_peak_used     = 0;
+
+        /*
+         * Appends a block of at least size bytes and makes it current.
+         */
+        void addBlock(std::size_t size);
+	};
+
+
+    /*
+     * Standard allocator drawing from a FrameArena, so containers built during a frame don't hit the heap. deallocate()
+     * is a no-op; the memory is reclaimed by the arena's reset().
+     *
+     * note: containers using it must not outlive the frame.
+     */
+    template <typename T>
+    class FrameArenaAllocator
+    {
+    public:
+        typedef T value_type;
+
+        explicit FrameArenaAllocator(FrameArena *arena) : m_arena(arena) {}
+
+        template <typename U>
+        FrameArenaAllocator(const FrameArenaAllocator<U> &other) : m_arena(other.getArena()) {}
+
+        T* allocate(std::size_t count)
+        {
+            return m_arena->allocateArray<T>(count);
+        }
+
+        void deallocate(T *, std::size_t)
+        {
+        }
+
+        FrameArena* getArena() const { return m_arena; }
+
+    private:
+        FrameArena *m_arena;
+    };
+
+    template <typename T, typename U>
+    bool operator==(const FrameArenaAllocator<T> &a, const FrameArenaAllocator<U> &b)
+    {
+        return a.getArena() == b.getArena();
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const FrameArenaAllocator<T> &a, const FrameArenaAllocator<U> &b)
+    {
+        return !(a == b);
+    }
+
+    template <typename T>
+    using FrameVector = std::vector<T, FrameArenaAllocator<T> >;
+}
+
+#endif // VIRTUALVISTA_FRAMEARENA_H
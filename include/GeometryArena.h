@@ -0,0 +1,195 @@
+#ifndef VIRTUALVISTA_GEOMETRYARENA_H
+#define VIRTUALVISTA_GEOMETRYARENA_H
+
+#include <vulkan\vulkan.h>
+#include <vector>
+
+#include "Utils.h"
+#include "RangeAllocator.h"
+#include "VulkanMemoryAllocator.h"
+#include "UploadQueue.h"
+
+namespace vv
+{
+    class VulkanDevice;
+
+    /*
+     * Location of one mesh inside the arena. Everything needed to issue its draw once the page has been bound.
+     */
+    struct GeometryRange
+    {
+        uint32_t page         = 0;
+        int32_t vertex_offset = 0;
+        uint32_t vertex_count = 0;
+        uint32_t first_index  = 0;
+        uint32_t index_count  = 0;
+    };
+
+    struct GeometryArenaStats
+    {
+        uint32_t page_count         = 0;
+        uint32_t allocation_count   = 0;
+        uint64_t vertex_capacity    = 0; // in vertices
+        uint64_t vertices_used      = 0;
+        uint64_t index_capacity     = 0; // in indices
+        uint64_t indices_used       = 0;
+        uint32_t free_range_count   = 0; // vertex and index free ranges combined. > 2 per page means fragmentation
+    };
+
+	/*
+	 * Stores the vertex and index data of every mesh in a few large device local buffers ("pages"). Meshes only keep a
+	 * handle to a GeometryRange, so all draws sharing a page bind their geometry once and draw with offsets.
+	 *
+	 * Ranges are sub-allocated in units of vertices and indices with a RangeAllocator. A mesh larger than a page gets a
+	 * page of its own.
+	 *
+	 * note: ranges move when compact() runs. Command buffers recorded with an older getGeneration() have to be re-recorded.
+	 */
+	class GeometryArena
+	{
+	public:
+        typedef uint32_t Handle;
+        static const Handle invalid_handle = UINT32_MAX;
+
+		GeometryArena() = default;
+		~GeometryArena() = default;
+
+        /*
+         * page_size is the size in bytes of each vertex buffer and each index buffer. Pages are created on demand.
+         */
+		void create(VulkanDevice *device, VkDeviceSize page_size);
+
+        /*
+         * Destroys every page, whether or not ranges are still allocated from it.
+         *
+         * note: the caller has to make sure the device is idle.
+         */
+		void shutDown();
+
+        /*
+         * Reserves space for the geometry and records its upload into the device's UploadQueue.
+         */
+        Handle allocate(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices);
+
+        /*
+         * Same as above for geometry that doesn't live in vectors, e.g. a mapped file. The data is copied into staging
+         * memory before returning.
+         */
+        Handle allocate(const Vertex *vertices, uint32_t vertex_count, const uint32_t *indices, uint32_t index_count);
+
+        /*
+         * Returns the ranges of handle to the arena immediately.
+         *
+         * note: the caller has to make sure no pending frame draws from them.
+         */
+        void free(Handle handle);
+
+        /*
+         * Returns the ranges of handle to the arena once every frame in flight that could draw from them has retired.
+         */
+        void freeDeferred(Handle handle);
+
+        /*
+         * Current location of handle's geometry.
+         */
+        const GeometryRange& get(Handle handle) const;
+
+        /*
+         * Returns whether the upload recorded by allocate() has finished, after which the caller's copy of the geometry
+         * is no longer needed. Does not block.
+         */
+        bool isUploaded(Handle handle) const;
+
+        /*
+         * Binds the vertex and index buffers of page.
+         */
+        void bindPage(VkCommandBuffer command_buffer, uint32_t page) const;
+
+        /*
+         * Moves the live ranges of every fragmented page into a fresh, tightly packed page. The old page is released
+         * through the DeletionQueue and the generation is bumped.
+         *
+         * note: this blocks until the copies have finished so the next recorded frame can draw from the new pages.
+         */
+        void compact();
+
+        /*
+         * Runs compact() once Settings::getGeometryCompactionThreshold() meshes have been freed since the last compaction.
+         * Called at the start of every frame, before its draws are recorded.
+         */
+        void compactIfFragmented();
+
+        /*
+         * Incremented whenever existing ranges move.
+         */
+        uint64_t getGeneration() const { return m_generation; }
+
+        /*
+         *
+         */
+        GeometryArenaStats getStats() const;
+
+	private:
+        struct Page
+        {
+            VkBuffer vertex_buffer = VK_NULL_HANDLE;
+            MemoryAllocation vertex_memory;
+            VkBuffer index_buffer = VK_NULL_HANDLE;
+            MemoryAllocation index_memory;
+            RangeAllocator vertices;
+            RangeAllocator indices;
+            uint32_t allocation_count = 0;
+        };
+
+        struct Entry
+        {
+            GeometryRange range;
+            RangeAllocator::Handle vertex_range = RangeAllocator::invalid_handle;
+            RangeAllocator::Handle index_range  = RangeAllocator::invalid_handle;
+            UploadID upload_id = 0;
+            bool live = false;
+        };
+
+        VulkanDevice *m_device = nullptr;
+        VkDeviceSize m_page_size = 0;
+        std::vector<Page *> m_pages; // nullptr once a page has been compacted away and its slot not yet reused
+        std::vector<Entry> m_entries;
+        std::vector<Handle> m_free_entries;
+        uint64_t m_generation = 0;
+        uint32_t m_frees_since_compaction = 0;
+
+        /*
+         * Creates a page holding at least vertex_count vertices and index_count indices and returns its index.
+         */
+        uint32_t createPage(uint64_t vertex_count, uint64_t index_count);
+
+        /*
+         * Destroys the buffers of page and deletes it.
+         */
+        void destroyPage(Page *page);
+
+        /*
+         * Tries to reserve the ranges of entry in page_index. Returns false if it doesn't fit.
+         */
+        bool allocateRanges(uint32_t page_index, uint32_t vertex_count, uint32_t index_count, Entry &entry);
+
+        /*
+         * Gives back the ranges of the entry and recycles its handle.
+         */
+        void releaseEntry(Handle handle);
+
+        /*
+         * Creates a device local buffer bound to memory sub-allocated from the device's VulkanMemoryAllocator.
+         */
+        void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_properties, const MemoryTag &tag,
+                          VkBuffer &buffer, MemoryAllocation &memory);
+
+        /*
+         * Copies size bytes of data into dst_buffer at dst_offset through the UploadQueue's staging ring.
+         * Returns the id of the batch the copy was recorded into.
+         */
+        UploadID upload(VkBuffer dst_buffer, VkDeviceSize dst_offset, const void *data, VkDeviceSize size);
+	};
+}
+
+#endif // VIRTUALVISTA_GEOMETRYARENA_H
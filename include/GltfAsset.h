@@ -0,0 +1,107 @@
+#ifndef VIRTUALVISTA_GLTFASSET_H
+#define VIRTUALVISTA_GLTFASSET_H
+
+#include <string>
+#include <vector>
+
+#include "JsonParser.h"
+#include "MappedFile.h"
+
+namespace vv
+{
+    // accessor component types, as the OpenGL enums glTF uses
+    enum GltfComponentType
+    {
+        GLTF_BYTE           = 5120,
+        GLTF_UNSIGNED_BYTE  = 5121,
+        GLTF_SHORT          = 5122,
+        GLTF_UNSIGNED_SHORT = 5123,
+        GLTF_UNSIGNED_INT   = 5125,
+        GLTF_FLOAT          = 5126
+    };
+
+    /*
+     * Where the elements of an accessor are found. Element i starts at data + i * stride and points into a mapped or
+     * decoded buffer that stays valid until the GltfAsset is shut down.
+     */
+    struct GltfAccessor
+    {
+        const unsigned char *data = nullptr;
+        std::size_t count         = 0;
+        std::size_t stride        = 0;  // in bytes
+        int component_type        = 0;  // GltfComponentType
+        int component_count       = 0;  // 1 for SCALAR up to 16 for MAT4
+        bool normalized           = false;
+    };
+
+	/*
+	 * A glTF 2.0 asset, either a .gltf file with external or embedded (base64) buffers or a binary .glb. The JSON is
+	 * parsed into a document tree, and every buffer held in a file, including the binary chunk of a .glb, is mapped
+	 * rather than read, so accessor data can be copied straight from the file into staging memory.
+	 *
+	 * note: sparse accessors and the quantization / compression extensions are not supported.
+	 */
+	class GltfAsset
+	{
+	public:
+		GltfAsset() = default;
+		~GltfAsset() = default;
+
+        /*
+         * Opens the asset at path. External buffers are looked up relative to it. On failure err describes the problem
+         * and false is returned.
+         */
+		bool create(const std::string &path, std::string &err);
+
+        /*
+         * Unmaps all buffers. Accessor data is invalid afterwards.
+         */
+		void shutDown();
+
+        /*
+         * The document tree.
+         */
+        const JsonValue& getJson() const { return m_json; }
+
+        /*
+         * Resolves accessor index to its data and checks that every element lies within its buffer view.
+         */
+        bool getAccessor(int index, GltfAccessor &accessor, std::string &err) const;
+
+        /*
+         * Resolves buffer view index, e.g. for images embedded in a .glb.
+         */
+        bool getBufferView(int index, const unsigned char *&data, std::size_t &size, std::string &err) const;
+
+        /*
+         * Decodes a base64 data URI such as "data:application/octet-stream;base64,...". Returns false for anything else.
+         */
+        static bool decodeDataURI(const std::string &uri, std::vector<unsigned char> &data);
+
+        /*
+         * Decodes the percent escapes of a relative URI into a file name.
+         */
+        static std::string decodeURI(const std::string &uri);
+
+	private:
+        struct Buffer
+        {
+            const unsigned char *data = nullptr;
+            std::size_t size          = 0;
+        };
+
+        JsonValue m_json;
+        MappedFile m_file;
+        std::vector<MappedFile> m_buffer_files;                 // sized once, external .bin files
+        std::vector<std::vector<unsigned char> > m_decoded_buffers; // data URIs
+        std::vector<Buffer> m_buffers;
+
+        /*
+         * Splits a .glb into its JSON and binary chunks.
+         */
+        bool readGLB(const unsigned char *data, std::size_t size, const char *&json_begin, const char *&json_end, Buffer &binary_chunk,
+                     std::string &err) const;
+	};
+}
+
+#endif // VIRTUALVISTA_GLTFASSET_H
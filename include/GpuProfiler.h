@@ -0,0 +1,155 @@
+#ifndef VIRTUALVISTA_GPUPROFILER_H
+#define VIRTUALVISTA_GPUPROFILER_H
+
+#include <string>
+#include <vector>
+
+#include "VulkanDevice.h"
+
+namespace vv
+{
+    /*
+     * GPU time and pipeline statistics of every zone sharing a name within one frame.
+     * Statistics are 0 if the device doesn't support pipeline statistics queries.
+     */
+    struct GpuZoneResult
+    {
+        std::string name;
+        double milliseconds                = 0.0;
+        uint64_t input_assembly_vertices   = 0;
+        uint64_t input_assembly_primitives = 0;
+        uint64_t vertex_invocations        = 0;
+        uint64_t clipping_invocations      = 0;
+        uint64_t clipping_primitives       = 0;
+        uint64_t fragment_invocations      = 0;
+    };
+
+	/*
+	 * Measures GPU work with timestamp and pipeline statistics queries. Every frame in flight owns its own query pools,
+	 * which are read back right after the frame's fence has been waited on, so reading results never stalls.
+	 *
+	 * Zones are slots in those pools. A zone may be written from a secondary command buffer that is replayed across
+	 * frames, as long as it is always recorded for the same frame in flight.
+	 */
+	class GpuProfiler
+	{
+	public:
+        static const uint32_t frame_zone = 0; // whole frame, written by beginFrame/endFrame
+
+		GpuProfiler() = default;
+		~GpuProfiler() = default;
+
+        /*
+         * Creates query pools with room for max_zones zones for each frame in flight.
+         */
+        void create(VulkanDevice *device, uint32_t frames_in_flight, uint32_t max_zones);
+
+        /*
+         *
+         */
+        void shutDown();
+
+        /*
+         * Returns whether the graphics queue supports timestamps. Nothing is recorded otherwise.
+         */
+        bool isSupported() const { return m_supported; }
+
+        /*
+         * Returns whether vertex/fragment invocation counts and clipping stats are gathered.
+         */
+        bool hasPipelineStatistics() const { return m_pipeline_statistics_supported; }
+
+        /*
+         * Reserves a zone slot. Returns UINT32_MAX once all slots are in use.
+         */
+        uint32_t allocateZone();
+
+        /*
+         * Returns a zone slot to the pool. Must not be called before every frame that wrote to it has retired.
+         */
+        void releaseZone(uint32_t zone);
+
+        /*
+         * Reads back the results of the last frame recorded for frame_index. Call right after waiting on its fence and
+         * before recording the next frame for frame_index.
+         *
+         * note: doesn't allocate once every zone name has been seen, so it can run in the steady state frame loop.
+         */
+        void collect(uint32_t frame_index);
+
+        /*
+         * Resets frame_index's queries and starts the frame zone. Must be recorded outside of a render pass.
+         */
+        void beginFrame(VkCommandBuffer command_buffer, uint32_t frame_index);
+
+        /*
+         * Ends the frame zone.
+         */
+        void endFrame(VkCommandBuffer command_buffer, uint32_t frame_index);
+
+        /*
+         * Declares that zone is executed in the frame being recorded for frame_index and reports under name. Can be
+         * called before beginFrame().
+         */
+        void useZone(uint32_t frame_index, uint32_t zone, const std::string &name);
+
+        /*
+         * Records the start and end of zone. Thread safe as long as each command buffer is recorded by a single thread.
+         */
+        void beginZone(VkCommandBuffer command_buffer, uint32_t frame_index, uint32_t zone) const;
+        void endZone(VkCommandBuffer command_buffer, uint32_t frame_index, uint32_t zone) const;
+
+        /*
+         * Returns the results of the most recently collected frame, one entry per zone name sorted by name, or none if
+         * its timings weren't available. The first entry is always the whole frame, named "Frame". Its statistics are
+         * the sum of all other zones.
+         */
+        const std::vector<GpuZoneResult>& getResults() const;
+
+        /*
+         * Returns the GPU time of the most recently collected frame in milliseconds, or a negative value if none is available.
+         */
+        double getFrameTime() const;
+
+	private:
+        struct FrameQueries
+        {
+            VkQueryPool timestamp_pool  = VK_NULL_HANDLE; // two queries per zone
+            VkQueryPool statistics_pool = VK_NULL_HANDLE; // one query per zone
+            std::vector<uint32_t> used_zones; // reserved for every zone up front
+            uint32_t highest_zone = 0;
+            bool recorded = false;
+        };
+
+        static const uint32_t m_statistic_count = 6;
+
+        VulkanDevice *m_device = nullptr;
+        bool m_supported = false;
+        bool m_pipeline_statistics_supported = false;
+        double m_timestamp_period = 1.0;    // nanoseconds per tick
+        uint64_t m_timestamp_mask = ~0ull;  // only timestampValidBits of each value are meaningful
+        uint32_t m_max_zones = 0;
+
+        std::vector<FrameQueries> m_frames;
+        std::vector<uint32_t> m_free_zones;
+        std::vector<std::string> m_zone_names;  // per zone, set by useZone()
+        std::vector<GpuZoneResult> m_results;   // entries are reused across frames to keep their names' storage
+        bool m_has_results = false;             // whether m_results belong to the most recently collected frame
+
+        // query results read back by collect(), sized for every zone up front
+        std::vector<uint64_t> m_timestamps;
+        std::vector<uint64_t> m_statistics;
+
+        /*
+         * Computes m_results from the queries of frame. Returns false if the frame's timings aren't available.
+         */
+        bool readResults(const FrameQueries &frame);
+
+        /*
+         * Returns the entry of m_results for name among the first count entries, appending one if there is none.
+         */
+        GpuZoneResult& findResult(const std::string &name, std::size_t &count);
+	};
+}
+
+#endif // VIRTUALVISTA_GPUPROFILER_H
@@ -0,0 +1,27 @@
+#ifndef VIRTUALVISTA_HEAPALLOCATIONCOUNTER_H
+#define VIRTUALVISTA_HEAPALLOCATIONCOUNTER_H
+
+#include <cstdint>
+
+// debug builds always count. release builds only with the VV_COUNT_HEAP_ALLOCATIONS CMake option
+#if defined(_DEBUG) && !defined(VV_COUNT_HEAP_ALLOCATIONS)
+    #define VV_COUNT_HEAP_ALLOCATIONS
+#endif
+
+namespace vv
+{
+    /*
+     * Number of calls to the global operator new made so far by any thread. The counter replaces operator new/delete
+     * when VV_COUNT_HEAP_ALLOCATIONS is defined and always returns 0 otherwise.
+     *
+     * note: allocations made directly through malloc, e.g. by the Vulkan driver, aren't counted.
+     */
+    uint64_t getHeapAllocationCount();
+
+    /*
+     * Returns whether getHeapAllocationCount() reports anything.
+     */
+    bool isHeapAllocationCountingEnabled();
+}
+
+#endif // VIRTUALVISTA_HEAPALLOCATIONCOUNTER_H
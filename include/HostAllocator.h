@@ -0,0 +1,183 @@
+#ifndef VIRTUALVISTA_HOSTALLOCATOR_H
+#define VIRTUALVISTA_HOSTALLOCATOR_H
+
+#include <vulkan\vulkan.h>
+#include <array>
+#include <atomic>
+#include <string>
+
+namespace vv
+{
+    /*
+     * Kinds of Vulkan objects host allocations are attributed to. Every create/destroy pair passes the callbacks of
+     * its object type, which is how driver side memory ends up attributed to e.g. pipelines rather than just a scope.
+     */
+    enum class HostObjectType : uint32_t
+    {
+        Instance,
+        Device,
+        Surface,
+        SwapChain,
+        DebugCallback,
+        DeviceMemory,
+        Buffer,
+        Image,
+        ImageView,
+        Sampler,
+        ShaderModule,
+        Pipeline,
+        PipelineLayout,
+        RenderPass,
+        Framebuffer,
+        DescriptorSetLayout,
+        DescriptorPool,
+        CommandPool,
+        QueryPool,
+        Fence,
+        Semaphore,
+        Count
+    };
+
+    /*
+     * Returns the name used for type in reports.
+     */
+    const char* getHostObjectTypeName(HostObjectType type);
+
+    struct HostAllocationStats
+    {
+        uint64_t current_bytes   = 0;
+        uint64_t peak_bytes      = 0;
+        uint64_t allocations     = 0; // every successful allocation and reallocation
+        uint64_t frees           = 0;
+        uint64_t live            = 0; // allocations - frees
+        uint64_t internal_bytes  = 0; // driver allocations reported through the internal notifications
+    };
+
+	/*
+	 * VkAllocationCallbacks implementation that forwards to the C heap and counts bytes and allocations per
+	 * VkSystemAllocationScope and per HostObjectType. Allocations are also counted per frame so churn during loading can
+	 * be told apart from churn while rendering.
+	 *
+	 * Tracking is opt-in: callbacks() returns nullptr, i.e. the driver's own allocator, until setEnabled(true) is called.
+	 * This has to happen before the VkInstance is created and can't be undone, since objects must be destroyed with
+	 * callbacks compatible to the ones they were created with.
+	 */
+	class HostAllocator
+	{
+	public:
+        static HostAllocator* inst();
+
+        /*
+         * Only takes effect before the first call to callbacks().
+         */
+        void setEnabled(bool enabled);
+
+        bool isEnabled() const { return m_enabled; }
+
+        /*
+         * Callbacks to pass to every vkCreate*, vkDestroy*, vkAllocateMemory and vkFreeMemory for objects of type.
+         * nullptr when tracking is disabled.
+         */
+        const VkAllocationCallbacks* callbacks(HostObjectType type);
+
+        /*
+         * Closes the allocation count of the previous frame. Everything before the first call counts as loading.
+         */
+        void beginFrame(uint64_t frame_number);
+
+        /*
+         * Totals of objects of type over all scopes.
+         */
+        HostAllocationStats getTypeStats(HostObjectType type) const;
+
+        /*
+         * Totals of scope over all object types.
+         */
+        HostAllocationStats getScopeStats(VkSystemAllocationScope scope) const;
+
+        /*
+         * Writes the per type and per scope totals and the loading and per frame allocation counts as JSON to path.
+         * Throws if the file can't be written.
+         */
+        void writeReport(const std::string &path) const;
+
+	private:
+        static const std::size_t type_count  = static_cast<std::size_t>(HostObjectType::Count);
+        static const std::size_t scope_count = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+        struct Counters
+        {
+            std::atomic<uint64_t> current_bytes;
+            std::atomic<uint64_t> peak_bytes;
+            std::atomic<uint64_t> allocations;
+            std::atomic<uint64_t> frees;
+            std::atomic<uint64_t> internal_bytes;
+        };
+
+        // placed in front of every allocation handed to the driver
+        struct Header
+        {
+            void *block;
+            std::size_t size;
+            HostObjectType type;
+            VkSystemAllocationScope scope;
+        };
+
+        // what each type's callbacks get as pUserData
+        struct CallbackData
+        {
+            HostAllocator *allocator;
+            HostObjectType type;
+        };
+
+        static HostAllocator* m_instance;
+
+        bool m_enabled = false;
+        bool m_locked  = false; // set by the first callbacks() call
+        std::array<VkAllocationCallbacks, type_count> m_callbacks;
+        std::array<CallbackData, type_count> m_callback_data;
+        std::array<std::array<Counters, scope_count>, type_count> m_counters;
+        std::array<Counters, type_count> m_type_totals;   // peaks over all scopes aren't the sum of the per scope peaks
+        std::array<Counters, scope_count> m_scope_totals;
+
+        std::atomic<uint64_t> m_total_allocations;
+        uint64_t m_frame_start_allocations = 0;
+        uint64_t m_loading_allocations     = 0;
+        uint64_t m_max_frame_allocations   = 0;
+        uint64_t m_frame_allocations_sum   = 0;
+        uint64_t m_frame_count             = 0;
+        bool m_in_frames                   = false;
+
+		HostAllocator();
+		~HostAllocator() = default;
+
+        void* allocate(HostObjectType type, std::size_t size, std::size_t alignment, VkSystemAllocationScope scope);
+
+        void free(void *memory);
+
+        void addAllocation(HostObjectType type, VkSystemAllocationScope scope, std::size_t size);
+
+        void addFree(HostObjectType type, VkSystemAllocationScope scope, std::size_t size);
+
+        static void addToCounters(Counters &counters, std::size_t size);
+
+        static void removeFromCounters(Counters &counters, std::size_t size);
+
+        static HostAllocationStats readCounters(const Counters &counters);
+
+        static void* VKAPI_PTR allocationCallback(void *user_data, std::size_t size, std::size_t alignment, VkSystemAllocationScope scope);
+
+        static void* VKAPI_PTR reallocationCallback(void *user_data, void *original, std::size_t size, std::size_t alignment,
+                                                    VkSystemAllocationScope scope);
+
+        static void VKAPI_PTR freeCallback(void *user_data, void *memory);
+
+        static void VKAPI_PTR internalAllocationCallback(void *user_data, std::size_t size, VkInternalAllocationType allocation_type,
+                                                         VkSystemAllocationScope scope);
+
+        static void VKAPI_PTR internalFreeCallback(void *user_data, std::size_t size, VkInternalAllocationType allocation_type,
+                                                   VkSystemAllocationScope scope);
+	};
+}
+
+#endif // VIRTUALVISTA_HOSTALLOCATOR_H
@@ -0,0 +1,95 @@
+#ifndef VIRTUALVISTA_JSONPARSER_H
+#define VIRTUALVISTA_JSONPARSER_H
+
+#include <string>
+#include <vector>
+
+namespace vv
+{
+	/*
+	 * Read only JSON document tree, as much of JSON as asset formats such as glTF need. Lookups never fail: asking an
+	 * array for a missing element or an object for a missing member returns a null value, and the as*() accessors
+	 * return their fallback for values of another type. Chains like json["nodes"][i]["mesh"].asInt(-1) need no checks.
+	 */
+	class JsonValue
+	{
+	public:
+        enum class Type
+        {
+            Null,
+            Bool,
+            Number,
+            String,
+            Array,
+            Object
+        };
+
+		JsonValue() = default;
+		~JsonValue() = default;
+
+        /*
+         * Parses the document in [begin, end), which does not have to be null terminated. On failure err describes the
+         * problem and its byte offset, root is left null and false is returned.
+         */
+        static bool parse(const char *begin, const char *end, JsonValue &root, std::string &err);
+
+        /*
+         *
+         */
+        Type getType() const { return m_type; }
+
+        bool isNull() const { return m_type == Type::Null; }
+        bool isBool() const { return m_type == Type::Bool; }
+        bool isNumber() const { return m_type == Type::Number; }
+        bool isString() const { return m_type == Type::String; }
+        bool isArray() const { return m_type == Type::Array; }
+        bool isObject() const { return m_type == Type::Object; }
+
+        bool asBool(bool fallback = false) const { return isBool() ? m_bool : fallback; }
+        double asNumber(double fallback = 0.0) const { return isNumber() ? m_number : fallback; }
+        int asInt(int fallback = 0) const { return isNumber() ? static_cast<int>(m_number) : fallback; }
+
+        /*
+         * Empty for anything but a string.
+         */
+        const std::string& asString() const { return m_string; }
+
+        /*
+         * Number of elements of an array or members of an object, zero otherwise.
+         */
+        std::size_t size() const { return m_values.size(); }
+
+        /*
+         * Element i of an array.
+         */
+        const JsonValue& operator[](std::size_t i) const;
+
+        /*
+         * Member key of an object. Members are searched linearly, which is faster than hashing for the handful of members
+         * asset formats put into an object.
+         */
+        const JsonValue& operator[](const std::string &key) const;
+
+        /*
+         * True if an object has member key, even if its value is null.
+         */
+        bool has(const std::string &key) const;
+
+        /*
+         * Name of member i of an object, in document order.
+         */
+        const std::string& getKey(std::size_t i) const { return m_keys[i]; }
+
+	private:
+        class Reader;
+
+        Type m_type     = Type::Null;
+        bool m_bool     = false;
+        double m_number = 0.0;
+        std::string m_string;
+        std::vector<std::string> m_keys;  // of object members, parallel to m_values
+        std::vector<JsonValue> m_values;  // array elements or object member values
+	};
+}
+
+#endif // VIRTUALVISTA_JSONPARSER_H
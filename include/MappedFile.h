@@ -0,0 +1,50 @@
+#ifndef VIRTUALVISTA_MAPPEDFILE_H
+#define VIRTUALVISTA_MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace vv
+{
+	/*
+	 * Read only view of a whole file mapped into the address space. Pages are faulted in by the OS as they are touched,
+	 * so reading from the mapping costs I/O but no intermediate copy through a stream buffer.
+	 */
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile() = default;
+
+        /*
+         * Maps the file at path. Returns false if it can't be opened or is empty.
+         */
+		bool create(const std::string &path);
+
+        /*
+         * Unmaps the file. Pointers into the mapping are invalid afterwards.
+         */
+		void shutDown();
+
+        /*
+         *
+         */
+        const unsigned char* getData() const { return static_cast<const unsigned char *>(m_data); }
+
+        /*
+         *
+         */
+        std::size_t getSize() const { return m_size; }
+
+	private:
+        void *m_data       = nullptr;
+        std::size_t m_size = 0;
+#ifdef _WIN32
+        void *m_file       = nullptr;
+        void *m_mapping    = nullptr;
+#endif
+	};
+}
+
+#endif // VIRTUALVISTA_MAPPEDFILE_H
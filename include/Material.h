@@ -11,6 +11,7 @@
 #include "VulkanImageView.h"
 #include "VulkanPipeline.h"
 #include "VulkanShaderModule.h"
+#include "DescriptorAllocator.h"
 
 namespace vv
 {
@@ -50,12 +51,18 @@ namespace vv
          *
          * note: this should only be called from within MaterialTemplate, which manages all such material instances.
 		 */
-        void create(VulkanDevice *device, MaterialTemplate *material_template, VkDescriptorPool descriptor_pool);
+        void create(VulkanDevice *device, MaterialTemplate *material_template);
 
 		/*
 		 *
 		 */
 		void shutDown();
+
+        /*
+         * Releases the uniform buffers and descriptor set through the device's DeletionQueue instead of destroying them
+         * immediately. Textures are owned by the TextureManager and are left untouched.
+         */
+        void shutDownDeferred();
 		
         /*
          * Instructs this instance to support a uniform buffer binding and maintains ownership over the data.
@@ -77,10 +84,22 @@ namespace vv
          */
         void bindDescriptorSets(VkCommandBuffer command_buffer, VkPipelineBindPoint pipeline_bind_point) const;
 
+        /*
+         * Records that this instance's textures are bound in frame, which keeps them from being evicted.
+         */
+        void markTexturesUsed(uint64_t frame) const;
+
+        /*
+         * Points the descriptor set at the current image views of its textures, after the TextureManager replaced some.
+         * Frames in flight may still use the old set, so a new one is allocated and the old one freed through the device's
+         * DeletionQueue. Returns whether anything changed; command buffers binding this instance must be re-recorded if so.
+         */
+        bool refreshTextureDescriptors();
+
 	private:
         VulkanDevice *m_device;
         std::vector<VkWriteDescriptorSet> m_write_sets;
-        VkDescriptorSet m_descriptor_set;
+        DescriptorAllocation m_descriptor_set;
 
         std::vector<UBOStore *> m_uniform_buffers;
         std::vector<TextureStore *> m_textures;
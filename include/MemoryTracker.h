@@ -0,0 +1,207 @@
+#ifndef VIRTUALVISTA_MEMORYTRACKER_H
+#define VIRTUALVISTA_MEMORYTRACKER_H
+
+#include <vulkan\vulkan.h>
+#include <array>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <unordered_map>
+
+#include "Utils.h"
+
+namespace vv
+{
+    enum class MemoryCategory : uint32_t
+    {
+        Geometry,
+        Texture,
+        Uniform,
+        Attachment,
+        Staging,
+        Other,
+        Count
+    };
+
+    /*
+     * Returns the lower case name used for category in reports.
+     */
+    const char* getMemoryCategoryName(MemoryCategory category);
+
+    /*
+     * Inverse of getMemoryCategoryName(). Returns false for unknown names.
+     */
+    bool findMemoryCategory(const std::string &name, MemoryCategory &category);
+
+    /*
+     * What an allocation is used for and which asset owns it, e.g. { Texture, "textures/brick.png" }.
+     */
+    struct MemoryTag
+    {
+        MemoryCategory category = MemoryCategory::Other;
+        std::string owner;
+
+        MemoryTag() = default;
+        MemoryTag(MemoryCategory category, const std::string &owner = "") : category(category), owner(owner) {}
+    };
+
+    struct MemoryUsage
+    {
+        VkDeviceSize current      = 0;
+        VkDeviceSize peak         = 0;
+        uint32_t allocation_count = 0;
+    };
+
+    /*
+     * Host memory held by CPU side copies of uploaded assets. released counts what the residency policy dropped after
+     * upload, i.e. what keeping every copy around would have cost on top of current.
+     */
+    struct CPUCopyUsage
+    {
+        MemoryUsage resident;
+        VkDeviceSize released  = 0;
+        uint32_t release_count = 0;
+    };
+
+    struct MemoryRecord
+    {
+        MemoryTag tag;
+        uint32_t heap     = 0;
+        VkDeviceSize size = 0;
+    };
+
+    struct HeapMemoryReport
+    {
+        uint32_t heap           = 0;
+        VkDeviceSize heap_size  = 0;
+        bool device_local       = false;
+        MemoryUsage total;
+        std::array<MemoryUsage, static_cast<std::size_t>(MemoryCategory::Count)> categories;
+        bool has_budget         = false;   // VK_EXT_memory_budget values below are valid
+        VkDeviceSize budget     = 0;       // how much the process can allocate from the heap before running into trouble
+        VkDeviceSize usage      = 0;       // process wide usage as seen by the driver, includes memory not made through the tracker
+        std::vector<MemoryRecord> largest; // live allocations, largest first
+    };
+
+	/*
+	 * Accounts every device memory allocation by heap, category and owner. Current and peak usage are kept per heap and
+	 * category; the live allocations are kept individually so reports can list the largest ones.
+	 *
+	 * Where VK_EXT_memory_budget is available the driver's budget and usage per heap are reported alongside. Budgets
+	 * per category can be set by the application, e.g. per scene, and checked against the current usage.
+	 */
+	class MemoryTracker
+	{
+	public:
+        typedef uint64_t TrackingID;
+        static const TrackingID invalid_id = 0;
+
+		MemoryTracker() = default;
+		~MemoryTracker() = default;
+
+        /*
+         *
+         */
+		void create(const VkPhysicalDeviceMemoryProperties &memory_properties);
+
+        /*
+         * Forgets every record. Allocations still alive are reported in debug builds.
+         */
+		void shutDown();
+
+        /*
+         * Records size bytes allocated from heap. Returns the id to remove it with.
+         */
+        TrackingID add(const MemoryTag &tag, uint32_t heap, VkDeviceSize size);
+
+        /*
+         * Removes a record made with add(). invalid_id is ignored.
+         */
+        void remove(TrackingID id);
+
+#ifdef VK_EXT_memory_budget
+        /*
+         * Enables budget queries. The logical device has to have been created with VK_EXT_memory_budget and the instance
+         * with VK_KHR_get_physical_device_properties2.
+         */
+        void setBudgetQuery(VkPhysicalDevice physical_device, PFN_vkGetPhysicalDeviceMemoryProperties2KHR get_memory_properties);
+#endif
+
+        /*
+         * Returns whether the driver's budgets are part of the reports.
+         */
+        bool hasBudgetQuery() const;
+
+        /*
+         * Sets the number of bytes category may use across all heaps. 0 removes the budget.
+         */
+        void setCategoryBudget(MemoryCategory category, VkDeviceSize budget);
+
+        /*
+         * Returns a message for every category above its budget and every heap above the driver's budget.
+         */
+        std::vector<std::string> checkBudgets() const;
+
+        /*
+         * Current state of every heap. largest_count limits the number of allocations listed per heap.
+         */
+        std::vector<HeapMemoryReport> getReport(uint32_t largest_count = 8) const;
+
+        /*
+         * Current and peak usage of category summed over all heaps.
+         */
+        MemoryUsage getCategoryUsage(MemoryCategory category) const;
+
+        /*
+         * Records a CPU side copy of size bytes kept for an asset of category.
+         */
+        void addCPUCopy(MemoryCategory category, VkDeviceSize size);
+
+        /*
+         * Removes a copy recorded with addCPUCopy(). released marks copies dropped by the residency policy rather than
+         * because their asset was unloaded, which is what the report lists as savings.
+         */
+        void removeCPUCopy(MemoryCategory category, VkDeviceSize size, bool released);
+
+        /*
+         *
+         */
+        CPUCopyUsage getCPUCopyUsage(MemoryCategory category) const;
+
+        /*
+         * Writes the report, the category totals and the owners using the most memory as JSON to path. Throws if the file
+         * can't be written.
+         */
+        void writeReport(const std::string &path, uint32_t largest_count = 16) const;
+
+	private:
+        typedef std::array<MemoryUsage, static_cast<std::size_t>(MemoryCategory::Count)> CategoryUsage;
+
+        VkPhysicalDeviceMemoryProperties m_memory_properties;
+        mutable std::mutex m_mutex;
+
+        TrackingID m_next_id = 1;
+        std::unordered_map<TrackingID, MemoryRecord> m_records;
+        std::vector<MemoryUsage> m_heap_usage;      // per heap
+        std::vector<CategoryUsage> m_category_usage; // per heap
+        CategoryUsage m_total_category_usage;        // over all heaps. peaks differ from the sum of the per heap peaks
+        std::array<VkDeviceSize, static_cast<std::size_t>(MemoryCategory::Count)> m_category_budgets;
+        std::array<CPUCopyUsage, static_cast<std::size_t>(MemoryCategory::Count)> m_cpu_copies;
+
+        VkPhysicalDevice m_physical_device = VK_NULL_HANDLE;
+#ifdef VK_EXT_memory_budget
+        PFN_vkGetPhysicalDeviceMemoryProperties2KHR m_get_memory_properties = nullptr;
+#endif
+
+        /*
+         * Fills in the driver's budget and usage of every heap, if supported.
+         */
+        void queryBudgets(std::vector<HeapMemoryReport> &reports) const;
+
+        static void addUsage(MemoryUsage &usage, VkDeviceSize size);
+
+        static void removeUsage(MemoryUsage &usage, VkDeviceSize size);
+	};
+}
+
+#endif // VIRTUALVISTA_MEMORYTRACKER_H
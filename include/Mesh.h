@@ -4,25 +4,45 @@
 
 #include <vector>
 #include <string>
+#include <functional>
 
 #include "VulkanDevice.h"
-#include "VulkanBuffer.h"
+#include "GeometryArena.h"
+#include "Settings.h"
 
 namespace vv
 {
 	class Mesh
 	{
 	public:
+        // re-reads the geometry of a mesh whose CPU copy has been released, e.g. from the model file
+        typedef std::function<void(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)> GeometrySource;
+
         int material_id;
+        glm::vec3 bounds_min; // object space bounding box
+        glm::vec3 bounds_max;
 
 		Mesh();
 		~Mesh();
 
 		/*
-		 * Stores all geometry information for a submesh within a model hierarchy.
-         * Called from Model wrapper class. Should not be called outside of this context.
+		 * Stores all geometry information for a submesh within a model hierarchy. The vertex and index data are placed in
+         * the device's GeometryArena. Called from Model wrapper class. Should not be called outside of this context.
+         *
+         * With CPUResidency::ReleaseAfterUpload the CPU copy is dropped by updateResidency() once the upload has
+         * finished. source is required in that case so the geometry can be re-read on demand.
 		 */
-		void create(VulkanDevice *device, std::string name, std::vector<Vertex> vertices, std::vector<uint32_t> indices, int material_id);
+		void create(VulkanDevice *device, std::string name, std::vector<Vertex> vertices, std::vector<uint32_t> indices, int material_id,
+                    CPUResidency residency = CPUResidency::Keep, GeometrySource source = GeometrySource());
+
+        /*
+         * Same as above for geometry read straight from memory the caller owns, e.g. a mapped mesh cache, with bounds that
+         * are already known. The data only has to stay valid for the duration of the call. A CPU copy is only made for
+         * CPUResidency::Keep; otherwise the copy starts out released.
+         */
+        void create(VulkanDevice *device, std::string name, const Vertex *vertices, uint32_t vertex_count, const uint32_t *indices,
+                    uint32_t index_count, int material_id, const glm::vec3 &bounds_min, const glm::vec3 &bounds_max,
+                    CPUResidency residency = CPUResidency::Keep, GeometrySource source = GeometrySource());
 
 		/*
 		 * 
@@ -30,24 +50,77 @@ namespace vv
 		void shutDown();
 
         /*
-         * Binds all geometry data in preparation for rendering.
+         * Returns the geometry ranges to the arena through the device's DeletionQueue instead of immediately.
+         */
+        void shutDownDeferred();
+
+        /*
+         * Binds the arena page holding this mesh. Meshes sharing a page only need to bind it once.
+         */
+        void bindBuffers(VkCommandBuffer command_buffer) const;
+
+        /*
+         * Index of the arena page holding this mesh.
+         */
+        uint32_t getGeometryPage() const;
+
+        /*
+         * Draws the mesh from its offsets within the bound arena page.
+         */
+        void render(VkCommandBuffer command_buffer) const;
+
+        /*
+         * Releases the CPU copy if the residency policy asks for it and the upload has finished. Returns true once
+         * nothing is left to release.
+         */
+        bool updateResidency();
+
+        /*
+         * CPU copy of the geometry for consumers such as picking. Re-read from the GeometrySource if it has been
+         * released; a re-read copy stays until releaseCPUData() is called.
          */
-        void bindBuffers(VkCommandBuffer command_buffer);
+        const std::vector<Vertex>& getVertices();
 
+        /*
+         * See getVertices().
+         */
+        const std::vector<uint32_t>& getIndices();
 
         /*
-         * Per mesh rendering using private vertex + index vulkan buffers.
+         * Drops the CPU copy right away. Only allowed for meshes with a GeometrySource.
          */
-        void render(VkCommandBuffer command_buffer);
+        void releaseCPUData();
+
+        /*
+         *
+         */
+        bool isCPUDataResident() const;
 
 	private:
         std::string m_name;
-
-		VulkanBuffer m_vertex_buffer;
-		VulkanBuffer m_index_buffer;
+        VulkanDevice *m_device = nullptr;
+        GeometryArena::Handle m_geometry = GeometryArena::invalid_handle;
 
 		std::vector<Vertex> m_vertices;
 		std::vector<uint32_t> m_indices;
+        bool m_cpu_data_resident = false;
+        bool m_release_pending = false; // released by updateResidency() once the upload has finished
+        GeometrySource m_source;
+
+        /*
+         * Re-reads the CPU copy from m_source if it has been released.
+         */
+        void makeCPUDataResident();
+
+        /*
+         * Frees the CPU copy and takes it off the memory tracker. released marks drops made by the residency policy.
+         */
+        void freeCPUData(bool released);
+
+        /*
+         *
+         */
+        VkDeviceSize getCPUDataSize() const;
 
 	};
 }
@@ -0,0 +1,98 @@
+#ifndef VIRTUALVISTA_MESHCACHE_H
+#define VIRTUALVISTA_MESHCACHE_H
+
+#include <string>
+#include <vector>
+
+#include "Utils.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+
+namespace vv
+{
+    /*
+     * One submesh as it is handed to the GeometryArena. When read from a cache, vertices and indices point into the
+     * mapped file and stay valid until the MeshCache is shut down.
+     */
+    struct MeshCacheSubmesh
+    {
+        std::string name;
+        int material_id          = 0;
+        const Vertex *vertices   = nullptr;
+        uint32_t vertex_count    = 0;
+        const uint32_t *indices  = nullptr;
+        uint32_t index_count     = 0;
+        glm::vec3 bounds_min;
+        glm::vec3 bounds_max;
+    };
+
+	/*
+	 * Binary .vvmesh files holding the final output of a model importer: welded vertices, indices, submesh ranges,
+	 * material ids and bounds, plus the material libraries the source referenced and how much optimizing the geometry
+	 * gained. A cache is stored per source file in Settings::getMeshCacheDirectory() and is only used while the source
+	 * path, the size and modification time of the source and its material libraries, and the importer version all still
+	 * match what it was written from.
+	 *
+	 * Reading maps the file and hands out pointers into it, so a warm load never parses or copies geometry on the CPU
+	 * before it is written to staging memory.
+	 */
+	class MeshCache
+	{
+	public:
+		MeshCache() = default;
+		~MeshCache() = default;
+
+        /*
+         * Maps the cache of source_path. Returns false, leaving nothing mapped, if caching is disabled or there is no
+         * cache that is current for the source and importer_version.
+         */
+		bool create(const std::string &source_path, uint32_t importer_version);
+
+        /*
+         * Unmaps the cache. The geometry pointers of getSubmeshes() are invalid afterwards.
+         */
+		void shutDown();
+
+        /*
+         *
+         */
+        const std::vector<MeshCacheSubmesh>& getSubmeshes() const { return m_submeshes; }
+
+        /*
+         * Material library file names, relative to the directory of the source, in the order the importer read them.
+         */
+        const std::vector<std::string>& getMaterialLibraries() const { return m_material_libraries; }
+
+        /*
+         * Vertex cache statistics of the import the cache was written from, marked as cached. mesh_count is 0 if it
+         * wasn't optimized. import_ms isn't stored.
+         */
+        const MeshOptimizationStats& getOptimizationStats() const { return m_optimization_stats; }
+
+        /*
+         * Writes the cache of source_path. Failing to write only costs the next start a cold import, so errors are
+         * reported but not thrown.
+         */
+        static void write(const std::string &source_path, uint32_t importer_version, const std::vector<MeshCacheSubmesh> &submeshes,
+                          const std::vector<std::string> &material_libraries, const MeshOptimizationStats &optimization_stats);
+
+        /*
+         * Location of the cache of source_path. Empty if caching is disabled.
+         */
+        static std::string getCachePath(const std::string &source_path);
+
+	private:
+        MappedFile m_file;
+        std::vector<MeshCacheSubmesh> m_submeshes;
+        std::vector<std::string> m_material_libraries;
+        MeshOptimizationStats m_optimization_stats;
+
+        /*
+         * Checks the header and every range in the mapped file and fills in the submeshes. Returns false for stale or
+         * malformed caches.
+         */
+        bool readMappedFile(const std::string &source_path, uint32_t importer_version);
+	};
+}
+
+#endif // VIRTUALVISTA_MESHCACHE_H
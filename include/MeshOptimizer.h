@@ -0,0 +1,86 @@
+#ifndef VIRTUALVISTA_MESHOPTIMIZER_H
+#define VIRTUALVISTA_MESHOPTIMIZER_H
+
+#include <vector>
+
+#include "Utils.h"
+
+namespace vv
+{
+    // entries of the FIFO post-transform cache the optimizer targets and the statistics simulate
+    const uint32_t vertex_cache_size = 16;
+
+    /*
+     * Post-transform cache behaviour of an index buffer. Counts rather than ratios, so the stats of several meshes can
+     * be summed up.
+     */
+    struct VertexCacheStats
+    {
+        uint64_t misses         = 0; // vertices the simulated cache had to transform
+        uint64_t triangle_count = 0;
+        uint64_t vertex_count   = 0; // vertices referenced by the indices
+
+        /*
+         * Average cache miss ratio, misses per triangle. 0.5 is the best a regular grid allows, 3 the worst.
+         */
+        double getACMR() const { return triangle_count ? static_cast<double>(misses) / triangle_count : 0.0; }
+
+        /*
+         * Average transform to vertex ratio, misses per referenced vertex. 1 is optimal.
+         */
+        double getATVR() const { return vertex_count ? static_cast<double>(misses) / vertex_count : 0.0; }
+
+        VertexCacheStats& operator+=(const VertexCacheStats &other)
+        {
+            misses += other.misses;
+            triangle_count += other.triangle_count;
+            vertex_count += other.vertex_count;
+            return *this;
+        }
+    };
+
+    /*
+     * Vertex cache behaviour of the meshes of one asset before and after they were optimized on import.
+     */
+    struct MeshOptimizationStats
+    {
+        uint32_t mesh_count = 0;
+        VertexCacheStats before;
+        VertexCacheStats after;
+        double import_ms    = 0.0;   // building and optimizing the geometry of those meshes, 0 if cached
+        bool cached         = false; // read back from the mesh cache the import was written to
+    };
+
+    /*
+     * Simulates a FIFO post-transform cache of vertex_cache_size entries over a triangle list.
+     */
+    VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, std::size_t vertex_count);
+
+    /*
+     * Reorders triangles for the post-transform cache with Tipsify (Sander et al., "Fast Triangle Reordering for Vertex
+     * Locality and Reduced Overdraw", 2007), linear in the size of the mesh. If clusters is given, it receives the first
+     * index of every run of triangles that began at a dead end, i.e. with a cold cache.
+     */
+    void optimizeVertexCache(std::vector<uint32_t> &indices, std::size_t vertex_count, std::vector<std::size_t> *clusters = nullptr);
+
+    /*
+     * Reorders the clusters of a cache optimized triangle list so that outward facing ones, which tend to occlude the
+     * rest, are drawn first. Clusters are split further wherever that keeps the ACMR within threshold times that of
+     * the whole mesh, so the cache efficiency gained before is mostly preserved.
+     */
+    void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices, const std::vector<std::size_t> &clusters,
+                          float threshold = 1.05f);
+
+    /*
+     * Reorders vertices in the order the triangles first reference them and remaps the indices, so vertex fetch walks
+     * memory mostly sequentially. Unreferenced vertices are dropped.
+     */
+    void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+    /*
+     * All of the above, in order. Deterministic, so a mesh re-read from its source comes out the same as when imported.
+     */
+    void optimizeMesh(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+}
+
+#endif // VIRTUALVISTA_MESHOPTIMIZER_H
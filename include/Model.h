@@ -42,9 +42,19 @@ namespace vv
 		void shutDown();
 
         /*
-         * Used for update of model + normal matrix at render time.
+         * Used for update of model + normal matrix at render time. The Scene copies the result into its uniform ring.
          */
         void updateModelUBO();
+
+        /*
+         * Hidden models are left out of the scene's draw buckets. Changing visibility re-records only the buckets this model is in.
+         */
+        void setVisible(bool visible);
+
+        /*
+         *
+         */
+        bool isVisible() const;
 		
 	private:
         // note: acts as hash key for ModelManager's data caches. this is used by scene during render-time.
@@ -53,7 +63,11 @@ namespace vv
         std::string m_material_id_set;
 
         ModelUBO m_model_ubo;
-		VulkanBuffer *m_model_uniform_buffer = nullptr;
+
+        // draw bucket bookkeeping, consumed by Scene::updateDrawBuckets()
+        bool m_visible = true;
+        bool m_draws_dirty = true;
+        MaterialTemplate *m_bucketed_template = nullptr;
 
 	};
 }
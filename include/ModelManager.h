@@ -3,6 +3,7 @@
 #define VIRTUALVISTA_ASSETMANAGER_H
 
 #include <unordered_map>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -12,6 +13,9 @@
 #include "Model.h"
 #include "Mesh.h"
 #include "Material.h"
+#include "ObjParser.h"
+#include "GltfAsset.h"
+#include "MeshOptimizer.h"
 
 namespace vv
 {
@@ -28,7 +32,7 @@ namespace vv
 		/*
 		 * High level class that handles all asset loading, initialization, and management.
 		 */
-		void create(VulkanDevice *device, TextureManager *texture_manager, VkDescriptorPool descriptor_pool);
+		void create(VulkanDevice *device, TextureManager *texture_manager);
 
 		/*
 		 *
@@ -41,19 +45,33 @@ namespace vv
          */
         bool loadModel(std::string path, std::string name, MaterialTemplate *material_template, Model *model);
 
+        /*
+         * Releases the CPU copies of meshes whose upload has finished, as far as their CPUResidency allows.
+         */
+        void updateResidency();
+
         /*
          * Returns a pointer to the sphere primitive geometry data.
          */
         Mesh* getSphereMesh() const;
 
+        /*
+         * Returns how much the meshes of every asset loaded so far gained from optimization, by full path. Assets loaded
+         * without optimization are left out.
+         */
+        const std::map<std::string, MeshOptimizationStats>& getOptimizationStats() const;
+
     private:
 		VulkanDevice *m_device;
-        VkDescriptorPool m_descriptor_pool;
         TextureManager *m_texture_manager;
+        ThreadPool m_import_threads; // parsing and welding imported models
+        ObjParser m_obj_parser;
 
-        // todo: can have global array of geometry and material data that constantly updates.
+        // geometry of every mesh lives in the device's GeometryArena. todo: material data could be pooled the same way.
         std::unordered_map<std::string, std::vector<Mesh *> > m_loaded_meshes;
         std::unordered_map<std::string, std::unordered_map<std::string, std::vector<Material *> > > m_loaded_materials;
+        std::vector<Mesh *> m_residency_pending; // meshes that may still hold a CPU copy to release
+        std::map<std::string, MeshOptimizationStats> m_optimization_stats;
 
         /*
          * Loads obj + mtl files for a single model. Returns a model abstraction with references to raw loaded geometry + material data.
@@ -61,9 +79,23 @@ namespace vv
         bool loadOBJ(std::string path, std::string name, MaterialTemplate *material_template, Model *model);
 
         /*
-         * todo: add support for glTF
+         * Loads a glTF 2.0 asset, .gltf or .glb. Every triangle primitive instanced by the default scene becomes a mesh,
+         * with its node transform baked into the vertices. Metallic-roughness materials are mapped onto the template's
+         * bindings; constant factors stand in for missing textures but don't scale textures that are present.
+         */
+        bool loadGLTF(std::string path, std::string name, MaterialTemplate *material_template, Model *model);
+
+        /*
+         * Creates the material for a glTF material, or for the default material if json is null.
+         */
+        Material* createGLTFMaterial(const GltfAsset &asset, const std::string &path, const std::string &full_path, const JsonValue &json,
+                                     MaterialTemplate *material_template, bool &success);
+
+        /*
+         * Loads the texture a glTF textureInfo refers to. Returns nullptr if there is none.
          */
-        bool loadGLTF();
+        SampledTexture* loadGLTFTexture(const GltfAsset &asset, const std::string &path, const std::string &full_path,
+                                        const JsonValue &texture_info);
 	};
 }
 
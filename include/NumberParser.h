@@ -0,0 +1,34 @@
+#ifndef VIRTUALVISTA_NUMBERPARSER_H
+#define VIRTUALVISTA_NUMBERPARSER_H
+
+#include <cstdint>
+
+namespace vv
+{
+    /*
+     * Locale independent parsers for numbers in text assets. Each one reads the longest number at the start of
+     * [begin, end) and returns a pointer past it, or begin if there is no number, in which case value is left untouched.
+     * None of them skip leading whitespace or need the text to be null terminated.
+     *
+     * Accepted: [+-] digits [. digits] [(e|E) [+-] digits], where either the integer or the fractional digits may be empty.
+     */
+
+    /*
+     * Correctly rounded. Numbers with up to 19 significant digits and a small exponent, which is nearly everything
+     * found in model files, are converted with a couple of exact floating point operations (Clinger's fast path).
+     * Only the rest go through the standard library.
+     */
+    const char* parseFloat(const char *begin, const char *end, float &value);
+
+    /*
+     * See parseFloat().
+     */
+    const char* parseDouble(const char *begin, const char *end, double &value);
+
+    /*
+     * Integer part only. Saturates instead of overflowing.
+     */
+    const char* parseInt(const char *begin, const char *end, int64_t &value);
+}
+
+#endif // VIRTUALVISTA_NUMBERPARSER_H
@@ -0,0 +1,131 @@
+#ifndef VIRTUALVISTA_OBJPARSER_H
+#define VIRTUALVISTA_OBJPARSER_H
+
+#include <string>
+#include <vector>
+
+#include "tiny_obj_loader.h"
+#include "ThreadPool.h"
+
+namespace vv
+{
+    struct ObjParseStats
+    {
+        uint64_t file_size   = 0; // in bytes
+        uint32_t chunk_count = 0;
+        double parse_ms      = 0.0; // tokenizing every chunk, in parallel
+        double merge_ms      = 0.0; // concatenating the chunks and building shapes
+    };
+
+	/*
+	 * Drop-in replacement for tinyobj::LoadObj that produces the same attrib, shapes and materials.
+	 *
+	 * The file is mapped and split into line aligned chunks that are tokenized in parallel, each into its own attribute
+	 * and index arrays. Statements whose meaning depends on what came before (g, o, usemtl, mtllib) are only recorded
+	 * by the chunks and replayed in file order afterwards. Attribute arrays are concatenated at offsets given by prefix
+	 * sums over the chunk sizes, which also turns relative (negative) face indices into absolute ones.
+	 *
+	 * Floats are parsed with parseFloat(), which is exact and ignores the locale. Material libraries are still read
+	 * through a tinyobj::MaterialReader; they are small enough not to matter.
+	 *
+	 * Unlike tinyobj, faces before a usemtl that is directly followed by g or o are kept instead of dropped.
+	 */
+	class ObjParser
+	{
+	public:
+		ObjParser() = default;
+		~ObjParser() = default;
+
+        /*
+         * Chunks are tokenized on threads, which has to outlive the parser.
+         */
+		void create(ThreadPool *threads);
+
+        /*
+         *
+         */
+		void shutDown();
+
+        /*
+         * Parses the obj file at path. Materials are only read if material_reader is given. On failure err describes
+         * the problem and false is returned.
+         */
+        bool load(const std::string &path, tinyobj::attrib_t &attrib, std::vector<tinyobj::shape_t> &shapes,
+                  std::vector<tinyobj::material_t> &materials, std::string &err, tinyobj::MaterialReader *material_reader = nullptr,
+                  bool triangulate = true);
+
+        /*
+         * Statistics of the last load().
+         */
+        const ObjParseStats& getStats() const { return m_stats; }
+
+	private:
+        /*
+         * A statement that has to be replayed in file order. The faces of the chunk before it end at face_count.
+         */
+        struct Statement
+        {
+            enum Type
+            {
+                Group,
+                Object,
+                UseMaterial,
+                MaterialLibrary
+            };
+
+            Type type;
+            std::string name;
+            std::size_t face_count;
+            std::size_t index_count;
+        };
+
+        struct Chunk
+        {
+            const char *begin = nullptr;
+            const char *end   = nullptr;
+
+            std::vector<float> vertices;
+            std::vector<float> normals;
+            std::vector<float> texcoords;
+            std::vector<tinyobj::index_t> indices;
+            std::vector<unsigned char> num_face_vertices;
+            std::vector<Statement> statements;
+
+            // slots of indices that were relative to the chunk's attribute counts and still lack the preceding chunks'
+            std::vector<std::size_t> relative_vertices;
+            std::vector<std::size_t> relative_normals;
+            std::vector<std::size_t> relative_texcoords;
+
+            // where the chunk's attributes start in the merged arrays
+            std::size_t first_vertex   = 0;
+            std::size_t first_normal   = 0;
+            std::size_t first_texcoord = 0;
+        };
+
+        ThreadPool *m_threads = nullptr;
+        ObjParseStats m_stats;
+
+        /*
+         * Splits [begin, end) into line aligned chunks of roughly equal size.
+         */
+        void splitChunks(const char *begin, const char *end, std::vector<Chunk> &chunks) const;
+
+        /*
+         * Tokenizes the lines of chunk.
+         */
+        static void parseChunk(Chunk &chunk, bool triangulate);
+
+        /*
+         * Copies the attributes of chunk into attrib at its offsets and makes its relative indices absolute.
+         */
+        static void mergeAttributes(Chunk &chunk, tinyobj::attrib_t &attrib);
+
+        /*
+         * Replays the statements of every chunk in order to group faces into shapes and assign materials.
+         */
+        static bool buildShapes(const std::vector<Chunk> &chunks, std::vector<tinyobj::shape_t> &shapes, std::vector<tinyobj::material_t> &materials,
+                                std::string &err, tinyobj::MaterialReader *material_reader);
+	};
+}
+
+#endif // VIRTUALVISTA_OBJPARSER_H
@@ -0,0 +1,138 @@
+#ifndef VIRTUALVISTA_PROFILER_H
+#define VIRTUALVISTA_PROFILER_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Scoped CPU zones. Compiled out entirely unless the VV_ENABLE_PROFILER CMake option is on.
+ *
+ * note: zone names have to be string literals, only the pointer is stored.
+ */
+#ifdef VV_ENABLE_PROFILER
+    #define VV_PROFILE_CONCAT_IMPL(a, b) a##b
+    #define VV_PROFILE_CONCAT(a, b) VV_PROFILE_CONCAT_IMPL(a, b)
+    #define VV_PROFILE_SCOPE(name) vv::ProfileScope VV_PROFILE_CONCAT(_vv_profile_scope_, __LINE__)(name)
+    #define VV_PROFILE_FUNCTION() VV_PROFILE_SCOPE(__FUNCTION__)
+#else
+    #define VV_PROFILE_SCOPE(name) ((void)0)
+    #define VV_PROFILE_FUNCTION() ((void)0)
+#endif
+
+namespace vv
+{
+    struct ProfileEvent
+    {
+        const char *name;
+        uint64_t start_ns;
+        uint64_t duration_ns;
+    };
+
+    /*
+     * Events recorded by a single thread. Only the owning thread appends to it, so no locking is needed while recording.
+     */
+    struct ProfileThreadBuffer
+    {
+        uint32_t thread_index;
+        std::vector<ProfileEvent> events;
+    };
+
+	/*
+	 * Collects scoped zones from every thread into thread local buffers while a capture is active and writes them out
+	 * as Chrome trace JSON, which can be opened in chrome://tracing or Perfetto.
+	 *
+	 * A capture covers a range of frames, marked by the renderer through beginFrame(). Zones recorded before the first
+	 * frame (i.e. scene loading) belong to frame 0.
+	 */
+	class Profiler
+	{
+	public:
+        static Profiler* inst();
+
+        /*
+         * Captures every zone from first_frame through last_frame and writes them to file_name once last_frame has ended.
+         */
+        void setCapture(const std::string &file_name, uint64_t first_frame, uint64_t last_frame);
+
+        /*
+         * Marks the start of frame_number. Starts or finishes the capture when its frame range is entered or left.
+         *
+         * note: must be called while no other thread is recording zones.
+         */
+        void beginFrame(uint64_t frame_number);
+
+        /*
+         * Writes an unfinished capture out. Called at shutdown so captures extending past the last frame aren't lost.
+         */
+        void flush();
+
+        /*
+         * Returns whether zones are currently being recorded.
+         */
+        bool isCapturing() const { return m_capturing.load(std::memory_order_relaxed); }
+
+        /*
+         * Appends a finished zone to the calling thread's buffer.
+         */
+        void addEvent(const char *name, uint64_t start_ns, uint64_t end_ns);
+
+        /*
+         * Returns a monotonic timestamp in nanoseconds.
+         */
+        static uint64_t now();
+
+	private:
+        static Profiler *m_instance;
+
+        std::mutex m_mutex; // guards m_thread_buffers, only taken when a thread records its first zone
+        std::vector<ProfileThreadBuffer*> m_thread_buffers;
+        std::atomic<bool> m_capturing;
+
+        std::string m_file_name;
+        uint64_t m_first_frame = 0;
+        uint64_t m_last_frame  = 0;
+        bool m_capture_pending = false;
+
+        Profiler();
+        Profiler(const Profiler&) = delete;
+        Profiler& operator=(const Profiler&) = delete;
+
+        /*
+         * Returns the calling thread's buffer, registering it on first use.
+         */
+        ProfileThreadBuffer* getThreadBuffer();
+
+        /*
+         * Writes every buffered event to m_file_name and clears the buffers.
+         */
+        void writeTrace();
+	};
+
+
+    /*
+     * Records a zone spanning its own lifetime. Use through VV_PROFILE_SCOPE.
+     */
+    class ProfileScope
+    {
+    public:
+        explicit ProfileScope(const char *name)
+            : m_name(name), m_start_ns(Profiler::inst()->isCapturing() ? Profiler::now() : 0)
+        {
+        }
+
+        ~ProfileScope()
+        {
+            if (m_start_ns != 0 && Profiler::inst()->isCapturing())
+                Profiler::inst()->addEvent(m_name, m_start_ns, Profiler::now());
+        }
+
+    private:
+        const char *m_name;
+        uint64_t m_start_ns;
+    };
+}
+
+#endif // VIRTUALVISTA_PROFILER_H
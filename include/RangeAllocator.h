@@ -0,0 +1,115 @@
+#ifndef VIRTUALVISTA_RANGEALLOCATOR_H
+#define VIRTUALVISTA_RANGEALLOCATOR_H
+
+#include <vector>
+#include <cstdint>
+
+namespace vv
+{
+	/*
+	 * Two level segregated fit (TLSF) allocator handing out aligned sub ranges of [0, size). It never touches the memory
+	 * it manages, so it's used for device memory blocks as well as any other offset based sub-allocation.
+	 *
+	 * Allocation and freeing are O(1): free ranges are binned by size class, the first level being the power of two and
+	 * the second level splitting each power of two into 16 linear steps. Freed ranges are merged with their neighbours
+	 * immediately. Only a request no bin is guaranteed to satisfy falls back to checking the ranges just below its size class.
+	 */
+	class RangeAllocator
+	{
+	public:
+        typedef uint32_t Handle;
+        static const Handle invalid_handle = UINT32_MAX;
+
+		RangeAllocator() = default;
+		~RangeAllocator() = default;
+
+        /*
+         * Manages a range of size units, all initially free.
+         */
+        void create(uint64_t size);
+
+        /*
+         * Forgets every allocation.
+         */
+        void shutDown();
+
+        /*
+         * Reserves size units whose offset is a multiple of alignment. alignment must be a power of two.
+         * Returns false if no free range is large enough.
+         */
+        bool allocate(uint64_t size, uint64_t alignment, uint64_t &offset, Handle &handle);
+
+        /*
+         * Returns a range obtained from allocate().
+         */
+        void free(Handle handle);
+
+        uint64_t getSize() const { return m_size; }
+        uint64_t getUsedSize() const { return m_used_size; }
+        uint32_t getAllocationCount() const { return m_allocation_count; }
+        bool isEmpty() const { return m_allocation_count == 0; }
+
+        /*
+         * Returns the number of separate free ranges and the size of the largest one. Walks every range, meant for stats only.
+         */
+        uint32_t getFreeRangeCount() const;
+        uint64_t getLargestFreeRange() const;
+
+	private:
+        static const uint32_t m_sl_bits  = 4;
+        static const uint32_t m_sl_count = 1 << m_sl_bits;
+        static const uint32_t m_fl_count = 64 - m_sl_bits + 1;
+
+        struct Range
+        {
+            uint64_t offset       = 0;
+            uint64_t size         = 0;
+            Handle prev_physical  = invalid_handle;
+            Handle next_physical  = invalid_handle;
+            Handle prev_free      = invalid_handle;
+            Handle next_free      = invalid_handle;
+            bool is_free          = false;
+        };
+
+        std::vector<Range> m_ranges;
+        std::vector<Handle> m_unused_ranges;
+        Handle m_first_range = invalid_handle;
+
+        uint64_t m_fl_bitmap = 0;
+        uint32_t m_sl_bitmap[m_fl_count];
+        Handle m_free_heads[m_fl_count][m_sl_count];
+
+        uint64_t m_size             = 0;
+        uint64_t m_used_size        = 0;
+        uint32_t m_allocation_count = 0;
+
+        /*
+         * Maps a size to the bin holding free ranges of that size.
+         */
+        static void mapping(uint64_t size, uint32_t &fl, uint32_t &sl);
+
+        /*
+         * Finds a free range of at least size units. Returns invalid_handle if there is none.
+         */
+        Handle findFreeRange(uint64_t size) const;
+
+        /*
+         * Checks the free ranges too small for findFreeRange() to consider one by one, for one that fits size units at
+         * alignment. Returns invalid_handle if there is none.
+         */
+        Handle findFittingRange(uint64_t size, uint64_t alignment) const;
+
+        void insertFreeRange(Handle handle);
+        void removeFreeRange(Handle handle);
+
+        Handle createRange(uint64_t offset, uint64_t size);
+        void destroyRange(Handle handle);
+
+        /*
+         * Splits the tail of handle starting at size units off into a new free range.
+         */
+        void splitTail(Handle handle, uint64_t size);
+	};
+}
+
+#endif // VIRTUALVISTA_RANGEALLOCATOR_H
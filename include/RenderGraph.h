@@ -0,0 +1,214 @@
+#ifndef VIRTUALVISTA_RENDERGRAPH_H
+#define VIRTUALVISTA_RENDERGRAPH_H
+
+#include <vector>
+#include <string>
+#include <functional>
+
+#include "VulkanDevice.h"
+#include "VulkanImage.h"
+#include "VulkanImageView.h"
+#include "VulkanRenderPass.h"
+#include "VulkanMemoryAllocator.h"
+
+namespace vv
+{
+    typedef uint32_t RenderResourceID;
+
+    /*
+     * How a pass uses one of the graph's resources. Determines the layout, stages and access masks barriers are derived from.
+     */
+    enum class RenderAccess
+    {
+        ColorOutput,    // color attachment
+        DepthOutput,    // depth/stencil attachment, tested and written
+        TextureInput    // sampled in fragment shaders
+    };
+
+    struct RenderGraphStats
+    {
+        uint32_t pass_count         = 0; // declared
+        uint32_t culled_pass_count  = 0; // contribute nothing to an imported image
+        uint32_t barrier_count      = 0; // image barriers recorded per frame
+        uint32_t transient_count    = 0;
+        VkDeviceSize transient_size = 0; // sum of the transient attachments' sizes
+        VkDeviceSize aliased_size   = 0; // memory actually allocated for them
+    };
+
+	/*
+	 * Declares a frame as a list of passes and the attachments they read and write, and derives everything that is
+	 * otherwise set up by hand: render passes, framebuffers, layout transitions and pipeline barriers.
+	 *
+	 * Passes execute in the order they were added. compile() culls passes whose results never reach an imported image,
+	 * merges consecutive reads so only real hazards get a barrier, and places transient attachments whose lifetimes
+	 * don't overlap in the same memory. The compiled graph is re-executed every frame without further allocations.
+	 *
+	 * note: imported images, e.g. the swap chain's, are assumed to hold nothing worth keeping at the start of a frame.
+	 */
+	class RenderGraph
+	{
+	public:
+        typedef std::function<void(VkCommandBuffer command_buffer)> RecordFunction;
+
+		RenderGraph() = default;
+		~RenderGraph() = default;
+
+        /*
+         * Every attachment of the graph has the size of extent.
+         */
+		void create(VulkanDevice *device, VkExtent2D extent);
+
+        /*
+         *
+         */
+		void shutDown();
+
+        /*
+         * Declares an attachment that only lives during the frame. Its image and memory are created by compile().
+         */
+        RenderResourceID createAttachment(const std::string &name, VkFormat format, VkSampleCountFlagBits sample_count = VK_SAMPLE_COUNT_1_BIT);
+
+        /*
+         * Declares images owned elsewhere, one per image index passed to execute(). They're left in final_layout at the
+         * end of the frame.
+         */
+        RenderResourceID importImages(const std::string &name, const std::vector<VulkanImage*> &images,
+                                      const std::vector<VulkanImageView*> &image_views, VkImageLayout final_layout);
+
+        /*
+         * Adds a pass executing record inside a render pass over its attachments. contents tells whether record
+         * executes secondary command buffers.
+         */
+        uint32_t addPass(const std::string &name, RecordFunction record, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+
+        /*
+         * Declares that pass renders into resource. load_op decides what the attachment starts with, clear_value is
+         * used for VK_ATTACHMENT_LOAD_OP_CLEAR.
+         */
+        void addColorOutput(uint32_t pass, RenderResourceID resource, VkAttachmentLoadOp load_op, VkClearColorValue clear_value = {});
+
+        void addDepthOutput(uint32_t pass, RenderResourceID resource, VkAttachmentLoadOp load_op, VkClearDepthStencilValue clear_value = {});
+
+        /*
+         * Declares that pass samples resource, which has to be written by an earlier pass.
+         */
+        void addTextureInput(uint32_t pass, RenderResourceID resource);
+
+        /*
+         * Culls, orders barriers, allocates transient attachments and creates the render passes and framebuffers.
+         */
+        void compile();
+
+        /*
+         * Records every pass that survived culling into command_buffer. image_index selects the image of each imported resource.
+         */
+        void execute(VkCommandBuffer command_buffer, uint32_t image_index);
+
+        /*
+         * Returns the render pass pipelines used by pass have to be compatible with, or null if pass was culled.
+         */
+        VulkanRenderPass* getRenderPass(uint32_t pass) const;
+
+        /*
+         * Returns the view of resource's image, e.g. for descriptors of a pass sampling it.
+         */
+        VkImageView getImageView(RenderResourceID resource, uint32_t image_index = 0) const;
+
+        /*
+         *
+         */
+        RenderGraphStats getStats() const;
+
+	private:
+        struct Access
+        {
+            RenderResourceID resource;
+            RenderAccess type;
+            VkAttachmentLoadOp load_op;
+            VkClearValue clear_value;
+        };
+
+        struct Pass
+        {
+            std::string name;
+            RecordFunction record;
+            VkSubpassContents contents;
+            std::vector<Access> accesses;
+            bool culled = false;
+
+            // filled by compile()
+            VulkanRenderPass *render_pass = nullptr;
+            std::vector<VkFramebuffer> framebuffers;         // one per image index if an imported image is attached
+            std::vector<VkClearValue> clear_values;          // per attachment
+            std::vector<VkImageMemoryBarrier> barriers;      // recorded before the render pass begins
+            std::vector<RenderResourceID> barrier_resources; // images of imported resources are filled in per frame
+            VkPipelineStageFlags src_stages = 0;
+            VkPipelineStageFlags dst_stages = 0;
+        };
+
+        struct Resource
+        {
+            std::string name;
+            VkFormat format;
+            VkSampleCountFlagBits sample_count;
+            VkImageAspectFlags aspect_flags;
+            bool imported;
+            VkImageLayout final_layout;
+            std::vector<VkImage> images;                     // one per image index if imported
+            std::vector<VkImageView> image_views;
+
+            // filled by compile() for transient attachments
+            VkImageUsageFlags usage = 0;
+            VkMemoryRequirements memory_requirements = {};
+            VkDeviceSize memory_offset = 0;
+            uint32_t first_pass = UINT32_MAX;                // lifetime over the passes that weren't culled
+            uint32_t last_pass = 0;
+        };
+
+        VulkanDevice *m_device = nullptr;
+        VkExtent2D m_extent = {};
+        bool m_compiled = false;
+
+        std::vector<Pass> m_passes;
+        std::vector<Resource> m_resources;
+        MemoryAllocation m_transient_memory;                 // shared by every transient attachment
+
+        // transitions of imported images into their final layouts at the end of the frame
+        std::vector<VkImageMemoryBarrier> m_final_barriers;
+        std::vector<RenderResourceID> m_final_barrier_resources;
+        VkPipelineStageFlags m_final_src_stages = 0;
+        VkPipelineStageFlags m_final_dst_stages = 0;
+
+        RenderGraphStats m_stats;
+
+        /*
+         * Marks passes that don't contribute to any imported image as culled.
+         */
+        void cullPasses();
+
+        /*
+         * Creates the images of transient attachments and binds them to one allocation, overlapping those whose lifetimes don't.
+         */
+        void allocateTransientAttachments();
+
+        /*
+         * Creates the render pass and framebuffers of every pass that survived culling.
+         */
+        void createRenderPasses();
+
+        /*
+         * Walks the passes in execution order and records a barrier wherever a resource's layout changes or a write has
+         * to be made visible.
+         */
+        void computeBarriers();
+
+        /*
+         * Records barriers, patching in the images of imported resources for image_index.
+         */
+        void recordBarriers(VkCommandBuffer command_buffer, std::vector<VkImageMemoryBarrier> &barriers,
+                            const std::vector<RenderResourceID> &resources, VkPipelineStageFlags src_stages,
+                            VkPipelineStageFlags dst_stages, uint32_t image_index);
+	};
+}
+
+#endif // VIRTUALVISTA_RENDERGRAPH_H
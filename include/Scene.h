@@ -5,11 +5,14 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <map>
 
 #include "VulkanDevice.h"
 #include "SkyBox.h"
 #include "VulkanRenderPass.h"
 #include "VulkanSampler.h"
+#include "VulkanRingBuffer.h"
+#include "DescriptorAllocator.h"
 #include "ModelManager.h"
 #include "TextureManager.h"
 #include "Model.h"
@@ -19,6 +22,35 @@
 
 namespace vv
 {
+    /*
+     * A single submesh draw with everything needed to record it independently of any other draw.
+     */
+    struct DrawItem
+    {
+        MaterialTemplate *material_template;
+        Material *material;
+        Mesh *mesh;
+        uint32_t model_index;
+
+        bool operator==(const DrawItem &other) const
+        {
+            return material_template == other.material_template && material == other.material &&
+                   mesh == other.mesh && model_index == other.model_index;
+        }
+    };
+
+    /*
+     * A group of draws sharing a MaterialTemplate, small enough to be recorded into one secondary command buffer.
+     * Renderers cache the recorded commands per bucket and only re-record when version changes.
+     */
+    struct DrawBucket
+    {
+        std::string key;            // stable identity of the bucket across frames: template name + chunk index
+        bool is_skybox;
+        std::vector<DrawItem> draws;
+        uint64_t version;           // changes whenever the contents of draws change
+    };
+
     class Scene
     {
         friend class DeferredRenderer;
@@ -84,15 +116,47 @@ namespace vv
 
         /*
          * Updates the global scene descriptor sets with newly updates data.
+         *
+         * note: only the uniform storage belonging to frame_index is written. The caller must make sure the GPU
+         *       is no longer reading from that frame.
          */
-        void updateUniformData(VkExtent2D extent, float time);
+        void updateUniformData(VkExtent2D extent, float time, uint32_t frame_index);
 
         /*
-         * Recursively renders each model.
+         * Partitions the visible submeshes into draw buckets of at most Settings::getDrawsPerChunk() draws per MaterialTemplate.
+         * Buckets are only rebuilt when a model was added, hidden, shown or switched MaterialTemplate; a rebuilt bucket keeps
+         * its version if its draws didn't change.
+         *
+         * note: must be called from the render thread before any recording for the frame starts.
+         */
+        const std::vector<DrawBucket>& updateDrawBuckets();
+
+        /*
+         * Records every draw of the bucket. All pipeline and descriptor state is bound within the call, so buckets can be
+         * recorded into separate secondary command buffers from different threads.
          *
          * note: This will be automatically called within one of the Renderer classes. There is no need in calling manually.
          */
-        void render(VkCommandBuffer command_buffer);
+        void recordBucket(VkCommandBuffer command_buffer, uint32_t frame_index, const DrawBucket &bucket) const;
+
+        /*
+         * Drops CPU copies of meshes and textures whose uploads have finished, following Settings::getCPUResidency(), and
+         * lets the TextureManager evict or reload textures based on which materials the draw buckets bind in frame_number.
+         * Buckets whose materials had their descriptors refreshed get a new version.
+         *
+         * note: must be called from the render thread before any recording for the frame starts.
+         */
+        void updateResidency(uint64_t frame_number);
+
+        /*
+         *
+         */
+        TextureResidencyStats getTextureResidencyStats() const;
+
+        /*
+         * Returns the vertex cache statistics of every asset optimized on import, by full path.
+         */
+        const std::map<std::string, MeshOptimizationStats>& getMeshOptimizationStats() const;
 
     private:
         VulkanDevice *m_device                       = nullptr;
@@ -102,7 +166,6 @@ namespace vv
         bool m_initialized                           = false;
 
         VulkanSampler *m_sampler                     = nullptr;
-        VkDescriptorPool m_descriptor_pool           = VK_NULL_HANDLE;
 
         // General scene uniform
         struct SceneUBO
@@ -113,9 +176,23 @@ namespace vv
         };
 
         VkDescriptorSetLayout m_scene_descriptor_set_layout;
-        std::vector<VkDescriptorSet> m_scene_descriptor_sets;
+        DescriptorAllocation m_scene_descriptor_set; // bound with dynamic offsets into m_uniform_ring
+        std::vector<VkDescriptorSet> m_frame_scene_descriptor_sets; // same bindings, reallocated every frame for the skybox
         SceneUBO m_scene_ubo;
-        VulkanBuffer *m_scene_uniform_buffer = nullptr;
+
+        // All per-frame uniform data lives in one persistently mapped buffer with a region per frame in flight.
+        VulkanRingBuffer m_uniform_ring;
+
+        // Dynamic offsets of each uniform within its frame's ring region.
+        struct FrameUniformOffsets
+        {
+            uint32_t scene;
+            uint32_t lights;
+            uint32_t skybox_model;
+            std::vector<uint32_t> models;
+        };
+
+        std::vector<FrameUniformOffsets> m_uniform_offsets; // one per frame in flight
 
         // Light uniforms
         struct LightData
@@ -130,12 +207,11 @@ namespace vv
         };
 
         LightUBO m_lights_ubo;
-        VulkanBuffer *m_lights_uniform_buffer = nullptr;
 
         VkDescriptorSetLayout m_environment_descriptor_set_layout;
         VkDescriptorSetLayout m_radiance_descriptor_set_layout;
-        VkDescriptorSet m_environment_descriptor_set = VK_NULL_HANDLE; // used for IBL calculations
-        VkDescriptorSet m_radiance_descriptor_set    = VK_NULL_HANDLE; // applied to skybox model
+        DescriptorAllocation m_environment_descriptor_set; // used for IBL calculations
+        DescriptorAllocation m_radiance_descriptor_set;    // applied to skybox model
 
         // todo: think of better data structure. maybe something to help with culling
         std::vector<Light> m_lights;
@@ -143,6 +219,14 @@ namespace vv
         std::vector<Camera> m_cameras;
         std::vector<SkyBox> m_skyboxes;
 
+        std::vector<DrawBucket> m_draw_buckets;
+        bool m_draw_buckets_dirty = true;
+        uint64_t m_next_bucket_version = 1;
+        uint64_t m_geometry_generation = 0;
+        uint64_t m_texture_generation = 0;
+        std::vector<Material *> m_refreshed_materials; // scratch for updateResidency()
+        MaterialTemplate *m_skybox_template = nullptr;
+
         Camera *m_active_camera;
         SkyBox *m_active_skybox;
         bool m_has_active_camera = false;
@@ -154,22 +238,39 @@ namespace vv
          */
         void createMaterialTemplates();
 
-        /*
-         * Creates global descriptor pool from which all descriptor sets will be allocated from.
-         */
-        void createDescriptorPool();
-
         /*
          * Scene descriptor set layout manages all matrices + analytic light data + camera info.
          */
         void createSceneDescriptorSetLayout();
 
         /*
-         * This dynamically allocates a number of scene related descriptor sets depending on the number of
-         * models specified through the scene interface.
+         * Allocates the scene descriptor set and reserves a slot in every frame's uniform ring region for the
+         * scene, light and per model uniforms specified through the scene interface.
          */
         void allocateSceneDescriptorSets();
 
+        /*
+         * Allocates the skybox's scene set for frame_index from the descriptor allocator's frame pools. Call after the
+         * allocator's beginFrame() and before recording.
+         */
+        void allocateFrameDescriptorSets(uint32_t frame_index);
+
+        /*
+         * Points the scene, model and light bindings of set at m_uniform_ring.
+         */
+        void writeSceneDescriptorSet(VkDescriptorSet set);
+
+        /*
+         * Reserves uniform ring slots for any model added since the last call. Slot assignment is deterministic, so existing
+         * models keep their offsets and previously recorded command buffers stay valid.
+         */
+        void reserveUniformSlots();
+
+        /*
+         * Records the active skybox, if there is one.
+         */
+        void recordSkyBox(VkCommandBuffer command_buffer, uint32_t frame_index) const;
+
         /*
          * Creates everything necessary for scene global uniforms.
          */
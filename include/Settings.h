@@ -3,11 +3,21 @@
 #define VIRTUALVISTA_SETTINGS_H
 
 #include <string>
+#include <map>
 
 #define VV_MAX_LIGHTS 5
 
 namespace vv 
 {
+    /*
+     * What happens to the CPU side copy of an asset once it has been uploaded to the GPU.
+     */
+    enum class CPUResidency
+    {
+        Keep,               // stays in host memory until the asset is unloaded
+        ReleaseAfterUpload  // dropped once the upload has finished, re-read from disk when a CPU consumer asks for it
+    };
+
 	// todo: offload default settings to file. Read at application start.
     class Settings 
     {
@@ -26,14 +36,83 @@ namespace vv
         std::string getModelDirectory() const;
         std::string getTextureDirectory() const;
 
+        /*
+         * Where imported models are cached as .vvmesh files. Empty disables the cache.
+         */
+        std::string getMeshCacheDirectory() const;
+
+        /*
+         * Whether imported meshes are reordered for the post-transform cache, overdraw and vertex fetch before upload.
+         */
+        bool isMeshOptimizationEnabled() const;
+
         bool isComputeRequired() const;
 
-        uint32_t getMaxDescriptorSets() const;
-        uint32_t getMaxUniformBuffers() const;
-        uint32_t getMaxCombinedImageSamplers() const;
+        uint32_t getMaxFramesInFlight() const;
+        uint32_t getUniformRingFrameSize() const;
+        uint32_t getUploadBatchSize() const;
+        uint64_t getStagingRingSize() const;
+        uint64_t getMemoryBlockSize() const;
+        uint64_t getGeometryPageSize() const;
+        uint32_t getGeometryCompactionThreshold() const;
+        uint32_t getRecordingThreadCount() const;
+        uint32_t getImportThreadCount() const;
+        uint32_t getDrawsPerChunk() const;
+        uint32_t getFrameArenaSize() const;
+        uint32_t getAllocationWarmupFrames() const;
+
+        bool isHeadless() const;
+        uint32_t getFrameCount() const;
+        std::string getReadbackPath() const;
+        std::string getBenchmarkPath() const;
+        std::string getBenchmarkReportPath() const;
+        std::string getCameraRecordPath() const;
+        std::string getTracePath() const;
+        uint64_t getTraceFirstFrame() const;
+        uint64_t getTraceLastFrame() const;
+        std::string getMemoryReportPath() const;
+        const std::map<std::string, uint64_t>& getMemoryBudgets() const;
+        std::string getHostAllocationReportPath() const;
+        std::string getParseBenchmarkPath() const;
+
+        /*
+         * Residency of the asset at path, i.e. directory + file name. Falls back to the global policy.
+         */
+        CPUResidency getCPUResidency(const std::string &path) const;
+
+        /*
+         * Device memory textures may occupy before the least recently used ones are evicted to their mip tail. 0 uses
+         * three quarters of the largest device local heap.
+         */
+        uint64_t getTextureBudget() const;
+        uint32_t getTextureMipTailSize() const;
+
+        /*
+         * Sets the first descriptor pool holds. Pools created when it runs out grow geometrically.
+         */
+        uint32_t getDescriptorSetsPerPool() const;
 
         void setWindowWidth(int width);
         void setWindowHeight(int height);
+        void setMaxFramesInFlight(uint32_t frames);
+        void setRecordingThreadCount(uint32_t thread_count);
+        void setHeadless(bool headless);
+        void setFrameCount(uint32_t frame_count);
+        void setReadbackPath(const std::string &path);
+        void setBenchmarkPath(const std::string &path);
+        void setBenchmarkReportPath(const std::string &path);
+        void setCameraRecordPath(const std::string &path);
+        void setTracePath(const std::string &path);
+        void setTraceFrames(uint64_t first_frame, uint64_t last_frame);
+        void setMemoryReportPath(const std::string &path);
+        void setMemoryBudget(const std::string &category, uint64_t bytes);
+        void setHostAllocationReportPath(const std::string &path);
+        void setParseBenchmarkPath(const std::string &path);
+        void setCPUResidency(CPUResidency residency);
+        void setCPUResidency(const std::string &path, CPUResidency residency);
+        void setTextureBudget(uint64_t bytes);
+        void setMeshCacheDirectory(const std::string &directory);
+        void setMeshOptimization(bool enabled);
 
     private:
         static Settings* m_instance;
@@ -48,12 +127,43 @@ namespace vv
         std::string m_asset_directory;
         std::string m_model_directory;
         std::string m_texture_directory;
+        std::string m_mesh_cache_directory;
+        bool m_mesh_optimization;
 
         bool m_compute_required;
 
-        uint32_t m_max_descriptor_sets;
-        uint32_t m_max_uniform_buffers;
-        uint32_t m_max_combined_image_samplers;
+        uint32_t m_max_frames_in_flight;
+        uint32_t m_uniform_ring_frame_size;
+        uint32_t m_upload_batch_size;
+        uint64_t m_staging_ring_size;        // room for about two batches in flight
+        uint64_t m_memory_block_size;
+        uint64_t m_geometry_page_size;
+        uint32_t m_geometry_compaction_threshold; // meshes freed from the geometry arena before it compacts
+        uint32_t m_recording_thread_count;
+        uint32_t m_import_thread_count;      // workers parsing and welding model files
+        uint32_t m_draws_per_chunk;
+        uint32_t m_frame_arena_size;
+        uint32_t m_allocation_warmup_frames; // frames before the benchmark expects the frame loop to stop allocating
+
+        bool m_headless;
+        uint32_t m_frame_count;
+        std::string m_readback_path;
+        std::string m_benchmark_path;
+        std::string m_benchmark_report_path;
+        std::string m_camera_record_path;
+        std::string m_trace_path;
+        uint64_t m_trace_first_frame;
+        uint64_t m_trace_last_frame;
+        std::string m_memory_report_path;
+        std::map<std::string, uint64_t> m_memory_budgets; // category name -> bytes
+        std::string m_host_allocation_report_path; // host allocation tracking is enabled when set
+        std::string m_parse_benchmark_path;
+        CPUResidency m_cpu_residency;
+        std::map<std::string, CPUResidency> m_asset_cpu_residency; // per asset overrides of m_cpu_residency
+        uint64_t m_texture_budget;
+        uint32_t m_texture_mip_tail_size;    // largest dimension of the mip levels evicted textures keep
+
+        uint32_t m_descriptor_sets_per_pool;
 
         Settings() {};
         Settings(const Settings& s) {};
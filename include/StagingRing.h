@@ -0,0 +1,73 @@
+#ifndef VIRTUALVISTA_STAGINGRING_H
+#define VIRTUALVISTA_STAGINGRING_H
+
+#include "Utils.h"
+#include "VulkanMemoryAllocator.h"
+
+namespace vv
+{
+    class VulkanDevice;
+
+	/*
+	 * One persistently mapped, host coherent buffer that staging data for uploads is written into back to back. Space is
+	 * handed out at the head and given back at the tail in the same order, once the copies reading it have executed.
+	 *
+	 * The ring itself knows nothing about fences. Its owner remembers getHead() with every submission and passes it to
+	 * release() when that submission has completed.
+	 */
+	class StagingRing
+	{
+	public:
+        VkBuffer buffer = VK_NULL_HANDLE;
+
+		StagingRing() = default;
+		~StagingRing() = default;
+
+        /*
+         * Creates and maps a buffer of size bytes usable as a transfer source.
+         */
+		void create(VulkanDevice *device, VkDeviceSize size);
+
+        /*
+         *
+         */
+		void shutDown();
+
+        /*
+         * Reserves size bytes at an offset that is a multiple of alignment. Returns false if the space between head and tail
+         * is too small, in which case the caller has to wait for earlier copies and release() their space.
+         */
+        bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset);
+
+        /*
+         * Returns a position marking everything allocated so far.
+         */
+        VkDeviceSize getHead() const { return m_head; }
+
+        /*
+         * Frees all space allocated before head, a value previously returned by getHead().
+         */
+        void release(VkDeviceSize head);
+
+        /*
+         * Returns a host pointer to offset, as returned by allocate().
+         */
+        void* getMappedData(VkDeviceSize offset) const;
+
+        /*
+         *
+         */
+        VkDeviceSize getSize() const { return m_size; }
+
+	private:
+		VulkanDevice *m_device    = nullptr;
+        MemoryAllocation m_memory;
+        VkDeviceSize m_size       = 0;
+
+        // monotonically increasing byte positions. the buffer offset of a position is position % m_size.
+        VkDeviceSize m_head       = 0;
+        VkDeviceSize m_tail       = 0;
+	};
+}
+
+#endif // VIRTUALVISTA_STAGINGRING_H
@@ -4,20 +4,40 @@
 
 #include <vector>
 #include <string>
+#include <atomic>
+#include <functional>
 
 #include "gli/gli.hpp"
 
 #include "VulkanSampler.h"
 #include "VulkanDevice.h"
 #include "VulkanImageView.h"
+#include "ThreadPool.h"
 
 namespace vv
 {
+    /*
+     * Produces the texels of an upload right in its staging memory, laid out the way VulkanImage::beginTransfer()
+     * expects them.
+     */
+    typedef std::function<void(void *texels)> TexelWriter;
+
     struct SampledTexture
     {
         VulkanImage *image = nullptr;
         VulkanImageView * image_view = nullptr;
         VulkanSampler *sampler = nullptr;
+        uint64_t last_used_frame = 0; // last frame a material bound this texture, see Material::markTexturesUsed()
+    };
+
+    struct TextureResidencyStats
+    {
+        VkDeviceSize resident_bytes = 0; // device memory of every texture once pending replacements have completed
+        VkDeviceSize budget         = 0;
+        uint64_t evictions          = 0; // textures dropped to their mip tail
+        uint64_t reloads            = 0; // evicted textures restored to full resolution
+        uint32_t evicted_count      = 0; // textures currently at their mip tail
+        uint32_t pending_count      = 0; // reloads or evictions waiting on a decode or an upload
     };
 
 	class TextureManager
@@ -45,6 +65,18 @@ namespace vv
         SampledTexture* load2DImage(std::string path, std::string name, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM,
                                     bool create_mip_levels = true);
 
+        /*
+         * Loads a png or jpeg texture already held in memory, e.g. embedded in a model file. name identifies it for later
+         * loads. The texels aren't kept after the upload, and the texture is not evicted since it can't be re-read.
+         */
+        SampledTexture* load2DImage(const std::string &name, const unsigned char *data, std::size_t size,
+                                    VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
+
+        /*
+         * Returns a 1x1 RGBA8 texture of color, for materials that specify a constant instead of a texture.
+         */
+        SampledTexture* loadConstantImage(const glm::vec4 &color);
+
         /*
          * Loads a provided cube map from file.
          *
@@ -53,16 +85,111 @@ namespace vv
         SampledTexture* loadCubeMap(std::string path, std::string name, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM,
                                     bool create_mip_levels = true);
 
+        /*
+         * Releases the decoded texels of textures whose upload has finished, as far as their CPUResidency allows, and
+         * keeps texture memory within Settings::getTextureBudget().
+         *
+         * While over budget, the textures not used in this or the previous frame are evicted in least recently used order:
+         * their image is replaced by one holding only the mip levels no larger than Settings::getTextureMipTailSize(). An
+         * evicted texture that gets used again is decoded from disk on a loader thread and swapped back in once its
+         * upload has finished. Swaps change SampledTexture::image_view, which getGeneration() reports.
+         *
+         * note: only 2D textures with a mip chain, or RGBA8 png/jpeg textures, are evicted.
+         */
+        void updateResidency(uint64_t frame);
+
+        /*
+         * Excludes texture from eviction. Needed for textures bound through descriptor sets not owned by a Material.
+         */
+        void pin(SampledTexture *texture);
+
+        /*
+         * Incremented whenever the image view of a texture has been replaced.
+         */
+        uint64_t getGeneration() const { return m_generation; }
+
+        /*
+         *
+         */
+        TextureResidencyStats getResidencyStats() const;
+
+        /*
+         * Decoded texels of a png/jpeg texture loaded with load2DImage(), e.g. for CPU side sampling. Re-read from disk if
+         * they have been released; re-read texels stay until releaseTexels() is called. nullptr for unknown textures.
+         */
+        const unsigned char* getTexels(const std::string &path, const std::string &name);
+
+        /*
+         * Drops the decoded texels of a texture right away.
+         */
+        void releaseTexels(const std::string &path, const std::string &name);
+
 	private:
+        // decoded png/jpeg data kept on host memory after its upload
+        struct HostTexels
+        {
+            unsigned char *data    = nullptr; // owned by stb_image, nullptr once released
+            VkDeviceSize size      = 0;
+            int stb_format         = 0;
+            bool release_pending   = false;   // released by updateResidency() once the image upload has finished
+            SampledTexture *texture = nullptr;
+        };
+
+        enum class ResidencyState
+        {
+            Resident,   // image is complete or, if evicted, holds the mip tail
+            Loading,    // full resolution texels are being decoded on a loader thread
+            Replacing   // pending_image is uploading and replaces the current image once ready
+        };
+
+        // eviction bookkeeping of a texture that can be dropped to its mip tail
+        struct ResidentTexture
+        {
+            SampledTexture *texture = nullptr;
+            std::string file;
+            bool ldr                = false;            // decoded through stb_image rather than gli
+            VkFormat format         = VK_FORMAT_UNDEFINED;
+            VkExtent3D extent       = {};
+            uint32_t mip_levels     = 1;
+            VkDeviceSize full_size  = 0;                // device memory at full resolution
+
+            VkExtent3D tail_extent  = {};
+            uint32_t tail_levels    = 1;
+            std::vector<unsigned char> tail_texels;     // kept on host so evicting never touches the disk
+
+            ResidencyState state    = ResidencyState::Resident;
+            bool evicted            = false;            // the current or pending image is the mip tail
+            bool pinned             = false;
+            VulkanImage *pending_image          = nullptr;
+            VulkanImageView *pending_image_view = nullptr;
+
+            // decoder output written by the loader thread until reload_done is set, uploaded straight from there
+            unsigned char *reload_ldr_texels = nullptr; // owned by stb_image
+            gli::texture_cube reload_texels;
+            std::atomic<bool> reload_done;
+            bool reload_failed      = false;
+
+            ResidentTexture() : reload_done(false) {}
+        };
+
 		VulkanDevice *m_device;
         std::string m_texture_directory;
 
         // Stores constructed textures/cube maps this class creates and is in current use.
         std::unordered_map<std::string, SampledTexture *> m_loaded_textures;
 
-        // Stores raw texture data on host memory.
-        std::unordered_map<std::string, unsigned char *> m_ldr_texture_array_data_cache;
-        std::unordered_map<std::string, float *> m_hdr_texture_array_data_cache;
+        // Stores raw texture data on host memory. dds/ktx data is owned by gli and freed as soon as it has been staged.
+        std::unordered_map<std::string, HostTexels> m_ldr_texture_array_data_cache;
+        std::vector<HostTexels *> m_residency_pending; // entries of the cache above, whose nodes don't move
+
+        // textures that can be evicted, keyed by their SampledTexture. nodes don't move, so loader tasks can point into them.
+        std::unordered_map<SampledTexture *, ResidentTexture> m_resident_textures;
+        ThreadPool m_loader_threads;
+        VkDeviceSize m_texture_budget = 0;
+        VkDeviceSize m_resident_bytes = 0;
+        uint64_t m_generation         = 0;
+        uint64_t m_eviction_count     = 0;
+        uint64_t m_reload_count       = 0;
 
         std::unordered_map<gli::format, VkFormat> m_gli_to_vulkan_format_map =
 		{
@@ -74,10 +201,51 @@ namespace vv
 		};
 
         /*
-         * Generalized function to abstract loading of different texture types.
+         * Generalized function to abstract loading of different texture types. The image memory is accounted to owner.
+         */
+        SampledTexture* loadTexture(const std::string &owner, VkDeviceSize size_in_bytes, const TexelWriter &write_texels, VkExtent3D extent,
+            VkFormat format, VkImageCreateFlags flags, uint32_t mip_levels, uint32_t array_layers, VkImageViewType image_view_type);
+
+        /*
+         * Creates an image plus a view over all of its mip levels and records the upload of the size_in_bytes texels
+         * write_texels puts into staging memory.
+         */
+        void createImage(const std::string &owner, VkDeviceSize size_in_bytes, const TexelWriter &write_texels, VkExtent3D extent, VkFormat format,
+            VkImageCreateFlags flags, uint32_t mip_levels, uint32_t array_layers, VkImageViewType image_view_type,
+            VulkanImage *&image, VulkanImageView *&image_view);
+
+        /*
+         * Starts managing the residency of a freshly loaded 2D texture. tail_texels hold the mip levels evictions keep,
+         * tail_extent being the size of the first one.
+         */
+        void trackResidency(SampledTexture *texture, const std::string &file, bool ldr, VkFormat format, VkExtent3D extent,
+            uint32_t mip_levels, VkExtent3D tail_extent, uint32_t tail_levels, const unsigned char *tail_texels, VkDeviceSize tail_size);
+
+        /*
+         * Replaces the texture's image by its mip tail.
+         */
+        void evict(ResidentTexture &resident);
+
+        /*
+         * Starts bringing an evicted texture back to full resolution.
+         */
+        void reload(ResidentTexture &resident);
+
+        /*
+         * Evicts least recently used textures that weren't used since frame - 1 until required more bytes fit into the
+         * budget. Returns whether they do.
+         */
+        bool makeRoom(VkDeviceSize required, uint64_t frame);
+
+        /*
+         * Destroys the current image and view of resident's texture, deferred, and puts the pending ones in their place.
+         */
+        void swapPendingImage(ResidentTexture &resident);
+
+        /*
+         * Frees the texels and takes them off the memory tracker. released marks drops made by the residency policy.
          */
-        SampledTexture* loadTexture(void *data, VkDeviceSize size_in_bytes, VkExtent3D extent, VkFormat format,
-            VkImageCreateFlags flags, uint32_t mip_levels, uint32_t array_layers, VkImageViewType image_view_type);
+        void freeTexels(HostTexels &texels, bool released);
 	};
 }
 
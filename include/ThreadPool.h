@@ -0,0 +1,69 @@
+#ifndef VIRTUALVISTA_THREADPOOL_H
+#define VIRTUALVISTA_THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+namespace vv
+{
+	/*
+	 * Fixed set of worker threads consuming a shared FIFO of tasks. Every task receives the index of the worker running it,
+	 * which callers use to look up per-thread resources such as command pools.
+	 */
+	class ThreadPool
+	{
+	public:
+        typedef std::function<void(uint32_t thread_index)> Task;
+
+		ThreadPool() = default;
+		~ThreadPool() = default;
+
+        /*
+         * Spawns thread_count workers.
+         */
+		void create(uint32_t thread_count);
+
+        /*
+         * Finishes all queued tasks and joins every worker.
+         */
+		void shutDown();
+
+        /*
+         * Queues a task to be run by the next free worker.
+         */
+        void submit(Task task);
+
+        /*
+         * Blocks until every submitted task has finished executing. If any of them threw, the first exception is rethrown
+         * here, on the calling thread, once all of them are done.
+         */
+        void wait();
+
+        /*
+         * Returns the number of worker threads.
+         */
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+	private:
+        std::vector<std::thread> m_workers;
+        std::deque<Task> m_tasks;
+        std::mutex m_mutex;
+        std::condition_variable m_task_available;
+        std::condition_variable m_tasks_finished;
+        uint32_t m_active_tasks = 0;
+        std::exception_ptr m_exception; // first one thrown by a task since the last wait()
+        bool m_stopping = false;
+
+        /*
+         * Worker loop. Runs until shutDown() is called and the queue has drained.
+         */
+        void work(uint32_t thread_index);
+	};
+}
+
+#endif // VIRTUALVISTA_THREADPOOL_H
@@ -0,0 +1,163 @@
+#ifndef VIRTUALVISTA_UPLOADQUEUE_H
+#define VIRTUALVISTA_UPLOADQUEUE_H
+
+#include <vector>
+#include <deque>
+
+#include "Utils.h"
+#include "VulkanMemoryAllocator.h"
+#include "StagingRing.h"
+
+namespace vv
+{
+    class VulkanDevice;
+
+    typedef uint64_t UploadID;
+
+    /*
+     * Host visible memory a copy reads from. data is mapped and can be written to directly until commitStaging().
+     */
+    struct StagingRegion
+    {
+        VkBuffer buffer         = VK_NULL_HANDLE;
+        VkDeviceSize offset     = 0;
+        VkDeviceSize size       = 0;
+        void *data              = nullptr;
+        MemoryAllocation dedicated_memory; // only for regions too large for the staging ring
+    };
+
+	/*
+	 * Batches host to device copies into a small number of submissions on the transfer queue (or the graphics queue
+	 * when the device has no dedicated transfer family). Every recorded copy belongs to a batch identified by a
+	 * monotonically increasing UploadID; a batch is complete once its fence has signaled.
+	 *
+	 * Staging data lives in a StagingRing of Settings::getStagingRingSize() bytes, whose space is handed back as the
+	 * batches reading it complete.
+	 */
+	class UploadQueue
+	{
+	public:
+		UploadQueue() = default;
+		~UploadQueue() = default;
+
+        /*
+         * Creates the command pool used to record batches on the chosen queue and the staging ring.
+         */
+		void create(VulkanDevice *device);
+
+        /*
+         * Waits for every outstanding batch and releases all staging memory.
+         */
+		void shutDown();
+
+        /*
+         * Returns the command buffer of the batch currently being recorded, beginning a new batch if necessary.
+         */
+        VkCommandBuffer getCommandBuffer();
+
+        /*
+         * Returns the id of the batch currently being recorded. Commands recorded through getCommandBuffer()
+         * are complete once isComplete() returns true for this id.
+         */
+        UploadID getCurrentID() const;
+
+        /*
+         * Reserves size bytes of staging memory at an offset that is a multiple of alignment. Waits for earlier batches
+         * if the ring is full; regions larger than the whole ring get a buffer of their own.
+         *
+         * note: call before getCommandBuffer() for the copy, waiting may submit the batch currently being recorded.
+         */
+        StagingRegion allocateStaging(VkDeviceSize size, VkDeviceSize alignment = 4);
+
+        /*
+         * Marks region as read by copies recorded into the current batch.
+         */
+        void commitStaging(const StagingRegion &region);
+
+        /*
+         * Hands ownership of a temporary staging buffer to the queue. It is destroyed once the current batch completes.
+         * size_in_bytes counts towards the automatic flush threshold.
+         */
+        void releaseStagingBuffer(VkBuffer buffer, const MemoryAllocation &memory, VkDeviceSize size_in_bytes);
+
+        /*
+         * Accounts for recorded copies that don't hand over a staging buffer, i.e. copies out of persistent staging memory.
+         */
+        void addRecordedBytes(VkDeviceSize size_in_bytes);
+
+        /*
+         * Submits the batch currently being recorded, if any. Returns its id.
+         */
+        UploadID flush();
+
+        /*
+         * Returns whether the batch with the given id has finished executing. Does not block.
+         */
+        bool isComplete(UploadID id);
+
+        /*
+         * Blocks until the batch with the given id has finished executing, submitting it first if it's still recording.
+         */
+        void waitFor(UploadID id);
+
+        /*
+         * Submits any pending copies and blocks until all of them have finished.
+         */
+        void waitIdle();
+
+        /*
+         * Returns whether batches are submitted to a queue that only supports transfer operations.
+         *
+         * note: such queues can't reference graphics pipeline stages in barriers.
+         */
+        bool isTransferOnly() const { return m_transfer_only; }
+
+	private:
+        struct StagingAllocation
+        {
+            VkBuffer buffer;
+            MemoryAllocation memory;
+        };
+
+        struct Batch
+        {
+            UploadID id                     = 0;
+            VkCommandBuffer command_buffer  = VK_NULL_HANDLE;
+            VkFence fence                   = VK_NULL_HANDLE;
+            VkDeviceSize recorded_bytes     = 0;
+            VkDeviceSize staging_head       = 0; // staging ring space up to here is free once the batch completes
+            std::vector<StagingAllocation> staging;
+        };
+
+		VulkanDevice *m_device          = nullptr;
+        VkQueue m_queue                 = VK_NULL_HANDLE;
+        VkCommandPool m_command_pool    = VK_NULL_HANDLE;
+        bool m_transfer_only            = false;
+        StagingRing m_staging_ring;
+
+        Batch m_recording;
+        bool m_is_recording             = false;
+        std::deque<Batch> m_in_flight;  // submitted batches, oldest first
+        std::vector<Batch> m_free;      // completed batches whose command buffer + fence can be reused
+
+        UploadID m_next_id              = 1;
+        UploadID m_last_completed_id    = 0;
+
+        /*
+         * Polls the fences of submitted batches in order and recycles every batch that has completed.
+         */
+        void collectCompleted();
+
+        /*
+         * Blocks until the oldest submitted batch has completed, submitting the recording one if nothing else is in flight.
+         */
+        void retireOldest();
+
+        /*
+         * Destroys staging memory owned by the batch, releases its staging ring space and returns it to the free list.
+         */
+        void recycle(Batch &batch);
+	};
+}
+
+#endif // VIRTUALVISTA_UPLOADQUEUE_H
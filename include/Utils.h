@@ -8,6 +8,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/hash.hpp>
 
+#include "HostAllocator.h"
+
 #ifndef VIRTUALVISTA_UTILS_H
 #define VIRTUALVISTA_UTILS_H
 
@@ -235,13 +237,29 @@ namespace vv
 			semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
 			VkSemaphore semaphore;
-			VV_CHECK_SUCCESS(vkCreateSemaphore(device, &semaphore_create_info, nullptr, &semaphore));
+			VV_CHECK_SUCCESS(vkCreateSemaphore(device, &semaphore_create_info, HostAllocator::inst()->callbacks(HostObjectType::Semaphore), &semaphore));
 			return semaphore;
 		}
 
 		static void destroyVulkanSemaphore(VkDevice device, VkSemaphore semaphore)
 		{
-			vkDestroySemaphore(device, semaphore, nullptr);
+			vkDestroySemaphore(device, semaphore, HostAllocator::inst()->callbacks(HostObjectType::Semaphore));
+		}
+
+		static VkFence createVulkanFence(VkDevice device, bool signaled)
+		{
+			VkFenceCreateInfo fence_create_info = {};
+			fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			fence_create_info.flags = (signaled) ? VK_FENCE_CREATE_SIGNALED_BIT : 0;
+
+			VkFence fence;
+			VV_CHECK_SUCCESS(vkCreateFence(device, &fence_create_info, HostAllocator::inst()->callbacks(HostObjectType::Fence), &fence));
+			return fence;
+		}
+
+		static void destroyVulkanFence(VkDevice device, VkFence fence)
+		{
+			vkDestroyFence(device, fence, HostAllocator::inst()->callbacks(HostObjectType::Fence));
 		}
 
         static VkDescriptorSetLayout createVulkanDescriptorSetLayout(VkDevice device, std::vector<VkDescriptorSetLayoutBinding> bindings)
@@ -252,7 +270,7 @@ namespace vv
 		    layout_create_info.pBindings    = bindings.data();
 
             VkDescriptorSetLayout layout = {};
-		    VV_CHECK_SUCCESS(vkCreateDescriptorSetLayout(device, &layout_create_info, nullptr, &layout));
+		    VV_CHECK_SUCCESS(vkCreateDescriptorSetLayout(device, &layout_create_info, HostAllocator::inst()->callbacks(HostObjectType::DescriptorSetLayout), &layout));
             return layout;
         }
 
@@ -284,7 +302,7 @@ namespace vv
             create_info.flags         = 0; // can be: VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
 
             VkDescriptorPool descriptor_pool;
-            VV_CHECK_SUCCESS(vkCreateDescriptorPool(device, &create_info, nullptr, &descriptor_pool));
+            VV_CHECK_SUCCESS(vkCreateDescriptorPool(device, &create_info, HostAllocator::inst()->callbacks(HostObjectType::DescriptorPool), &descriptor_pool));
             return descriptor_pool;
         }
 
@@ -293,7 +311,7 @@ namespace vv
             VV_ASSERT(device != VK_NULL_HANDLE, "Trying to destroy invalid descriptor pool");
             VV_ASSERT(pool != VK_NULL_HANDLE, "Trying to destroy invalid descriptor pool");
 
-            vkDestroyDescriptorPool(device, pool, nullptr);
+            vkDestroyDescriptorPool(device, pool, HostAllocator::inst()->callbacks(HostObjectType::DescriptorPool));
         }
 
         static VkPipelineStageFlags determinePipelineStageFlag(VkAccessFlags access_flags)
@@ -0,0 +1,63 @@
+#ifndef VIRTUALVISTA_VERTEXWELDER_H
+#define VIRTUALVISTA_VERTEXWELDER_H
+
+#include <vector>
+
+#include "Utils.h"
+
+namespace vv
+{
+	/*
+	 * Merges equal vertices while they are appended to a vertex array. Vertices are compared with Vertex::operator==,
+	 * so -0.0 and 0.0 weld and a vertex holding NaN never does, exactly like a std::unordered_map<Vertex, int> would.
+	 *
+	 * Open addressing with linear probing over a power of two table. Slots store the full hash next to the vertex
+	 * index, so most probes that don't match are rejected without touching the vertex array. The hash mixes every bit
+	 * of all eight components, unlike std::hash<Vertex> which collides for vertices with permuted components.
+	 *
+	 * Not thread safe; weld separate meshes with separate welders.
+	 */
+	class VertexWelder
+	{
+	public:
+		VertexWelder() = default;
+		~VertexWelder() = default;
+
+        /*
+         * Welds into vertices, which may already hold vertices that are not welded against. Sized for expected_count
+         * distinct vertices, it grows if there are more.
+         */
+		void create(std::vector<Vertex> *vertices, std::size_t expected_count);
+
+        /*
+         *
+         */
+		void shutDown();
+
+        /*
+         * Returns the index of a vertex equal to vertex, appending vertex first if there is none.
+         */
+        uint32_t weld(const Vertex &vertex);
+
+	private:
+        struct Slot
+        {
+            uint32_t hash;
+            uint32_t index; // into the vertex array plus one, zero marks an empty slot
+        };
+
+        std::vector<Vertex> *m_vertices = nullptr;
+        std::vector<Slot> m_slots;
+        std::size_t m_mask  = 0;
+        std::size_t m_count = 0;
+
+        /*
+         * Doubles the table, reusing the stored hashes.
+         */
+        void grow();
+
+        static uint32_t hash(const Vertex &vertex);
+	};
+}
+
+#endif // VIRTUALVISTA_VERTEXWELDER_H
@@ -38,6 +38,12 @@ namespace vv
          */
 		void beginMainLoop();
 
+        /*
+         * True if create() ran a standalone tool such as --parse-benchmark instead of setting up the renderer. The
+         * engine must not be used any further then.
+         */
+        bool isFinished() const { return m_finished; }
+
 	private:
         int m_argc;
         char **m_argv;
@@ -57,8 +63,41 @@ namespace vv
         GLFWWindow m_window;
         DeferredRenderer *m_renderer;
         Scene *m_scene;
+        bool m_finished = false;
 
         void handleInput(float delta_time);
+
+        /*
+         * Applies command line options to Settings.
+         *
+         * --headless                 render offscreen without creating a window
+         * --frames <count>           number of frames rendered by headless and benchmark runs
+         * --frames-in-flight <2|3>   frames the CPU may run ahead of the GPU, 2 by default
+         * --recording-threads <n>    workers recording secondary command buffers, one per hardware thread by default
+         * --readback <path>          writes the last headless frame to path as a binary PPM
+         * --benchmark <path>         replays the camera path stored at path and reports frame times
+         * --benchmark-report <path>  where the benchmark's JSON report is written, benchmark.json by default
+         * --record-camera <path>     records the camera of an interactive session to path for later benchmarks
+         * --trace <path>             writes a Chrome trace of the profiled frames to path
+         * --trace-frames <a> <b>     frames captured by --trace, 0 through 100 by default. Frame 0 includes scene loading
+         */
+        void parseArguments();
+
+        /*
+         * Replays the benchmark camera path over a fixed number of frames with a fixed time step and writes the
+         * frame time statistics as JSON.
+         */
+        void runBenchmark();
+
+        /*
+         * Parses the obj file given to --parse-benchmark with tinyobj and with ObjParser and prints the throughput of both.
+         */
+        void runParseBenchmark();
+
+        /*
+         * Reads back the last rendered headless frame and writes it to path.
+         */
+        void writeReadback(const std::string &path);
 	};
 }
 
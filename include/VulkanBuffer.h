@@ -8,6 +8,8 @@
 
 #include "Utils.h"
 #include "VulkanDevice.h"
+#include "UploadQueue.h"
+#include "VulkanMemoryAllocator.h"
 
 namespace vv
 {
@@ -22,15 +24,22 @@ namespace vv
 
 		/*
 		 * Creates two VkBuffers. One as a transfer buffer located on CPU memory and one as a storage buffer on GPU memory.
-		 * Use along with update() and transferToDevice().
+		 * Use along with update() and transferToDevice(). The device buffer is accounted under tag, the transfer buffer as
+		 * staging memory of the same owner.
 		 */
-		void create(VulkanDevice *device, VkBufferUsageFlags usage_flags, VkDeviceSize size);
+		void create(VulkanDevice *device, VkBufferUsageFlags usage_flags, VkDeviceSize size, const MemoryTag &tag = MemoryTag());
 
         /*
          *
          */
 		void shutDown();
 
+        /*
+         * Hands the buffers over to the device's DeletionQueue so they are destroyed once no frame in flight can use them.
+         * The object can be re-created immediately afterwards.
+         */
+        void shutDownDeferred();
+
 		/*
 		 * Helper function to perform an update and transfer in a single step.
 		 */
@@ -42,21 +51,31 @@ namespace vv
 		void update(void *data);
 		
 		/*
-		 * Copies a buffer allocated on CPU memory to one allocated on GPU memory.
+		 * Records a copy from the staging buffer to the device local buffer into the device's UploadQueue.
+         *
+         * note: this doesn't block. The copy is submitted along with the rest of its batch; use isReady() to check on it.
 		 */
 		void transferToDevice();
+
+        /*
+         * Returns whether the last transfer to the device local buffer has finished executing.
+         */
+        bool isReady() const;
 		
 	private:
 		VulkanDevice *m_device;
+        UploadID m_upload_id = 0;
 		VkBuffer m_staging_buffer = VK_NULL_HANDLE;
-		VkDeviceMemory m_staging_memory = VK_NULL_HANDLE;
-		VkDeviceMemory m_buffer_memory;
+		MemoryAllocation m_staging_memory;
+		MemoryAllocation m_buffer_memory;
 		VkBufferUsageFlags m_usage_flags;
 
 		/*
-		 * Creates the Vulkan abstraction for a data buffer with the given specifications.
+		 * Creates the Vulkan abstraction for a data buffer with the given specifications and binds it to memory
+		 * sub-allocated from the device's VulkanMemoryAllocator.
 		 */
-		void allocateMemory(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_properties, VkBuffer &buffer, VkDeviceMemory &buffer_memory);
+		void allocateMemory(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_properties, const MemoryTag &tag,
+                            VkBuffer &buffer, MemoryAllocation &buffer_memory);
 	};
 }
 
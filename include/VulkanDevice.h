@@ -14,6 +14,13 @@
 
 namespace vv
 {
+    class UploadQueue;
+    class DeletionQueue;
+    class VulkanMemoryAllocator;
+    class GeometryArena;
+    class MemoryTracker;
+    class DescriptorAllocator;
+
     class VulkanDevice
     {
     public:
@@ -37,6 +44,27 @@ namespace vv
 
     	std::unordered_map<std::string, VkCommandPool> command_pools;
 
+        // accounts every allocation made through the memory allocator by heap, category and owner
+        MemoryTracker *memory_tracker = nullptr;
+
+        // sub-allocates the device memory of every VulkanBuffer and VulkanImage
+        VulkanMemoryAllocator *memory_allocator = nullptr;
+
+        // VK_EXT_memory_budget was enabled on the logical device
+        bool memory_budget_supported = false;
+
+        // batches every host to device copy made through VulkanBuffer and VulkanImage
+        UploadQueue *upload_queue = nullptr;
+
+        // releases Vulkan objects once the frames that might reference them have been retired
+        DeletionQueue *deletion_queue = nullptr;
+
+        // shared vertex/index buffers every Mesh is sub-allocated from
+        GeometryArena *geometry_arena = nullptr;
+
+        // growable pools every descriptor set is allocated from
+        DescriptorAllocator *descriptor_allocator = nullptr;
+
     	VulkanDevice() = default;
     	~VulkanDevice() = default;
 
@@ -82,6 +110,11 @@ namespace vv
     	 */
     	uint32_t findMemoryTypeIndex(uint32_t filter_type, VkMemoryPropertyFlags memory_property_flags);
 
+        /*
+         * Returns the first of candidates supporting features with the given tiling, or VK_FORMAT_UNDEFINED if none does.
+         */
+        VkFormat findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features) const;
+
     	/*
     	 * Checks to see if this GPU has swap chain support (creating queues of rendered frames to pass to a window system)
     	 */
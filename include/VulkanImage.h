@@ -9,6 +9,8 @@
 
 #include "Utils.h"
 #include "VulkanDevice.h"
+#include "UploadQueue.h"
+#include "VulkanMemoryAllocator.h"
 
 namespace vv
 {
@@ -37,11 +39,12 @@ namespace vv
 		~VulkanImage();
 
         /*
-         * Allocates device memory for an image buffer with the given specifications.
+         * Allocates device memory for an image buffer with the given specifications, accounted under tag.
          */
         void create(VulkanDevice *device, VkExtent3D extent, VkFormat format, VkImageType type, VkImageCreateFlags flags,
                     VkImageAspectFlags aspect_flags, uint32_t mip_levels, uint32_t array_layers,
-                    VkImageLayout initial_layout, VkSampleCountFlagBits sample_count);
+                    VkImageLayout initial_layout, VkSampleCountFlagBits sample_count,
+                    const MemoryTag &tag = MemoryTag(MemoryCategory::Texture));
 
         /*
 		 * Creates an image from existing image. Mainly for swap chain image support.
@@ -54,15 +57,55 @@ namespace vv
          */
         void createDepthAttachment(VulkanDevice *device, VkExtent2D extent, VkImageTiling tiling, VkFormatFeatureFlags features);
 
+        /*
+         * Creates a 2D image usable as a color attachment that can also be copied back to the host. Used for offscreen rendering.
+         */
+        void createColorAttachment(VulkanDevice *device, VkExtent2D extent, VkFormat format);
+
 		/*
 		 * Removes allocated device memory.
 		 */
 		void shutDown();
+
+        /*
+         * Same as shutDown(), but the image and its memory are destroyed by the device's DeletionQueue once no frame in flight
+         * can reference them.
+         */
+        void shutDownDeferred();
 	
         /*
-         * Performs update and transfer operation in single step.
+         * Performs update and transfer operation in single step. The copy is recorded into the device's UploadQueue
+         * and the staging memory is released once its batch has finished.
+         */
+        void updateAndTransfer(const void *data, VkDeviceSize size_in_bytes);
+
+        /*
+         * Reserves staging memory for an upload of size_in_bytes and returns where to write the texels, laid out the same
+         * way updateAndTransfer() expects them. Lets data be produced in place instead of copied in.
+         */
+        void* beginTransfer(VkDeviceSize size_in_bytes);
+
+        /*
+         * Records the upload of the texels written since beginTransfer().
+         */
+        void endTransfer();
+
+        /*
+         * Returns whether the last upload to this image has finished executing.
+         */
+        bool isReady() const;
+
+        /*
+         * Returns the size of the device memory backing this image.
+         */
+        VkDeviceSize getMemorySize() const;
+
+        /*
+         * Copies mip level 0 of the first layer back into host memory. The image must currently be in layout and is left in it.
+         *
+         * note: this blocks until the copy has completed. Meant for debugging and offscreen captures, not per frame use.
          */
-        void updateAndTransfer(void *data, VkDeviceSize size_in_bytes);
+        void readback(std::vector<unsigned char> &data, VkImageLayout layout);
 
 		/*
 		 * Returns whether this image format supports stencil operations.
@@ -71,10 +114,13 @@ namespace vv
 
 	private:
 		VulkanDevice *m_device;
+        UploadID m_upload_id            = 0;
 		VkImage m_staging_image			= VK_NULL_HANDLE;
         VkBuffer m_staging_buffer       = VK_NULL_HANDLE;
-		VkDeviceMemory m_staging_memory	= VK_NULL_HANDLE;
-		VkDeviceMemory m_image_memory	= VK_NULL_HANDLE;
+		MemoryAllocation m_staging_memory;     // only used by readback()
+		MemoryAllocation m_image_memory;
+        StagingRegion m_upload_staging;        // between beginTransfer() and endTransfer()
+        std::string m_memory_owner; // staging memory is accounted to the same owner as the image
 
         std::unordered_map<VkFormat, FormatInfo> m_format_info_table =
         {
@@ -110,14 +156,14 @@ namespace vv
         /*
          * Allocates a VkBuffer to use during transfer operations between host and device memory.
          */
-        void allocateTransferMemory(VkDeviceSize size_in_bytes);
+        void allocateTransferMemory(VkDeviceSize size_in_bytes, VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
 
 		/*
 		 * Creates the Vulkan abstraction for a data buffer with the given specifications.
 		 */
         void allocateMemory(VkImageTiling tiling, VkImageUsageFlags usage, VkImageCreateFlags flags, VkImageLayout initial_layout,
-                            VkSampleCountFlagBits sample_count, VkMemoryPropertyFlags memory_properties, VkImage &image,
-                            VkDeviceMemory &memory);
+                            VkSampleCountFlagBits sample_count, VkMemoryPropertyFlags memory_properties, const MemoryTag &tag,
+                            VkImage &image, MemoryAllocation &memory);
 	
 		/*
 		 * Move the linearly stored staging image into an optimal texture storage layout.
@@ -29,6 +29,11 @@ namespace vv
 		 */
 		void shutDown();
 
+        /*
+         * Queues the image view for destruction once no frame in flight can reference it.
+         */
+        void shutDownDeferred();
+
 	private:
 		VulkanDevice *m_device;
 		VulkanImage *m_image;
@@ -0,0 +1,134 @@
+#ifndef VIRTUALVISTA_VULKANMEMORYALLOCATOR_H
+#define VIRTUALVISTA_VULKANMEMORYALLOCATOR_H
+
+#include <vector>
+#include <mutex>
+
+#include "Utils.h"
+#include "RangeAllocator.h"
+#include "MemoryTracker.h"
+
+namespace vv
+{
+    /*
+     * Device memory entry points used by the allocator. Defaults to the Vulkan loader's; tests can substitute their own
+     * to run the allocator without a device.
+     */
+    struct DeviceMemoryFunctions
+    {
+        PFN_vkAllocateMemory allocate_memory = vkAllocateMemory;
+        PFN_vkFreeMemory free_memory         = vkFreeMemory;
+        PFN_vkMapMemory map_memory           = vkMapMemory;
+        PFN_vkUnmapMemory unmap_memory       = vkUnmapMemory;
+    };
+
+    /*
+     * A sub range of a VkDeviceMemory object. Bind resources to memory at offset.
+     */
+    struct MemoryAllocation
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset   = 0;
+        VkDeviceSize size     = 0;
+        void *mapped_data     = nullptr;                       // host visible memory stays mapped, already offset
+        uint32_t memory_type  = 0;
+        uint32_t block        = UINT32_MAX;                    // UINT32_MAX for dedicated allocations
+        RangeAllocator::Handle range = RangeAllocator::invalid_handle;
+        MemoryTracker::TrackingID tracking_id = MemoryTracker::invalid_id;
+    };
+
+    struct MemoryBlockStats
+    {
+        uint32_t memory_type;
+        bool linear;                    // holds buffers and linear images, otherwise optimally tiled images
+        bool dedicated;                 // a single allocation too large to share a block
+        VkDeviceSize size;
+        VkDeviceSize used;
+        uint32_t allocation_count;
+        uint32_t free_range_count;
+        VkDeviceSize largest_free_range;
+    };
+
+	/*
+	 * Sub-allocates buffers and images out of large VkDeviceMemory blocks, one set of blocks per memory type, instead of
+	 * calling vkAllocateMemory per resource. Ranges within a block are managed by a RangeAllocator.
+	 *
+	 * Linear resources (buffers, linear images) and optimally tiled images never share a block, so
+	 * bufferImageGranularity can't cause aliasing between neighbours and needs no extra padding. Requests larger than
+	 * half a block get a dedicated allocation.
+	 */
+	class VulkanMemoryAllocator
+	{
+	public:
+		VulkanMemoryAllocator() = default;
+		~VulkanMemoryAllocator() = default;
+
+        /*
+         * block_size is the preferred size of each block. Heaps smaller than 8 blocks use an eighth of the heap instead.
+         * Every allocation is recorded in tracker, if given.
+         */
+        void create(VkDevice device, const VkPhysicalDeviceMemoryProperties &memory_properties, VkDeviceSize block_size,
+                    MemoryTracker *tracker = nullptr, const DeviceMemoryFunctions &functions = DeviceMemoryFunctions());
+
+        /*
+         * Frees every block.
+         *
+         * note: every allocation should have been freed by now. Leaks are reported in debug builds.
+         */
+        void shutDown();
+
+        /*
+         * Returns size bytes from memory_type satisfying requirements.alignment. linear tells whether the resource is a
+         * buffer or linear image, as opposed to an optimally tiled image. tag is what the MemoryTracker accounts the
+         * allocation under. Throws if the device is out of memory.
+         */
+        MemoryAllocation allocate(const VkMemoryRequirements &requirements, uint32_t memory_type, bool linear,
+                                  const MemoryTag &tag = MemoryTag());
+
+        /*
+         * Returns the allocation's range to its block. Empty blocks are released unless they're the last one of their kind.
+         */
+        void free(MemoryAllocation &allocation);
+
+        /*
+         * Returns the usage of every live block.
+         */
+        std::vector<MemoryBlockStats> getStats() const;
+
+        /*
+         * Returns the number of VkDeviceMemory objects currently allocated.
+         */
+        uint32_t getDeviceAllocationCount() const;
+
+	private:
+        struct Block
+        {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            uint32_t memory_type  = 0;
+            bool linear           = true;
+            bool dedicated        = false;
+            VkDeviceSize size     = 0;
+            void *mapped_data     = nullptr;
+            RangeAllocator ranges;
+        };
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        VkPhysicalDeviceMemoryProperties m_memory_properties;
+        DeviceMemoryFunctions m_functions;
+        MemoryTracker *m_tracker = nullptr;
+        std::vector<VkDeviceSize> m_block_sizes; // per memory type
+
+        mutable std::mutex m_mutex;
+        std::vector<Block*> m_blocks;            // null entries are reused
+        std::vector<uint32_t> m_unused_blocks;
+
+        /*
+         * Allocates a new block of size bytes. Returns its index.
+         */
+        uint32_t createBlock(uint32_t memory_type, bool linear, bool dedicated, VkDeviceSize size);
+
+        void destroyBlock(uint32_t index);
+	};
+}
+
+#endif // VIRTUALVISTA_VULKANMEMORYALLOCATOR_H
@@ -18,9 +18,10 @@ namespace vv
 		~VulkanRenderPass() = default;
 
 		/*
-		 * Uses binded attachments to generate a VkRenderPass.
+		 * Uses binded attachments to generate a VkRenderPass. Without external_dependencies synchronization with commands
+		 * outside the render pass is left to the caller's barriers.
 		 */
-		void create(VulkanDevice *device, VkPipelineBindPoint bind_point);
+		void create(VulkanDevice *device, VkPipelineBindPoint bind_point, bool external_dependencies = true);
 
 		/*
 		 *
@@ -31,7 +32,7 @@ namespace vv
 		 * Informs Vulkan to start using this render pass object for drawing.
 		 */
 		void beginRenderPass(VkCommandBuffer command_buffer, VkSubpassContents subpass_contents, VkFramebuffer framebuffer,
-							 VkExtent2D extent, std::vector<VkClearValue> clear_values);
+							 VkExtent2D extent, const std::vector<VkClearValue> &clear_values);
 
 		/*
 		 * Tells Vulkan that this render pass has been successfully used for rendering and should quit.
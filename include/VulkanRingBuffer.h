@@ -0,0 +1,75 @@
+#ifndef VIRTUALVISTA_VULKANRINGBUFFER_H
+#define VIRTUALVISTA_VULKANRINGBUFFER_H
+
+#include <vector>
+
+#include "Utils.h"
+#include "VulkanDevice.h"
+#include "MemoryTracker.h"
+
+namespace vv
+{
+	class VulkanRingBuffer
+	{
+	public:
+		VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize frame_size = 0;
+
+		VulkanRingBuffer() = default;
+		~VulkanRingBuffer() = default;
+
+		/*
+		 * Creates a single host visible buffer split into frame_count equally sized regions, one per frame in flight.
+         * The memory stays mapped for the lifetime of the buffer so writes are plain memcpys.
+         *
+         * note: meant to be bound through VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC descriptors, with the offsets
+         *       returned by allocate() handed to vkCmdBindDescriptorSets.
+		 */
+		void create(VulkanDevice *device, VkBufferUsageFlags usage_flags, VkDeviceSize frame_size, uint32_t frame_count);
+
+        /*
+         *
+         */
+		void shutDown();
+
+        /*
+         * Rewinds the allocation head to the start of the region owned by frame_index.
+         *
+         * note: the caller has to make sure the GPU has finished reading that frame's region.
+         */
+        void beginFrame(uint32_t frame_index);
+
+        /*
+         * Reserves size bytes inside the current frame's region and returns its offset from the start of the buffer.
+         * Offsets are aligned to minUniformBufferOffsetAlignment so they can be used as dynamic offsets directly.
+         */
+        uint32_t allocate(VkDeviceSize size);
+
+        /*
+         * Copies data into the buffer at an offset previously returned by allocate().
+         */
+        void write(uint32_t offset, const void *data, VkDeviceSize size);
+
+        /*
+         * Returns a host pointer into the persistently mapped buffer.
+         */
+        void* getMappedData(uint32_t offset) const;
+
+	private:
+		VulkanDevice *m_device       = nullptr;
+		VkDeviceMemory m_memory      = VK_NULL_HANDLE;
+        MemoryTracker::TrackingID m_tracking_id = MemoryTracker::invalid_id;
+        unsigned char *m_mapped_data = nullptr;
+        VkDeviceSize m_alignment     = 1;
+        uint32_t m_frame_count       = 0;
+        uint32_t m_current_frame     = 0;
+        VkDeviceSize m_head          = 0;
+
+        VkDeviceSize alignUp(VkDeviceSize value) const
+        {
+            return (value + m_alignment - 1) & ~(m_alignment - 1);
+        }
+	};
+}
+
+#endif // VIRTUALVISTA_VULKANRINGBUFFER_H
@@ -38,6 +38,11 @@ namespace vv
 		 */
 		void shutDown();
 
+        /*
+         * Queues the sampler for destruction once no frame in flight can reference it.
+         */
+        void shutDownDeferred();
+
     private:
 		VulkanDevice *m_device;
 	};
@@ -24,8 +24,6 @@ namespace vv
 		VkFormat format;
 		std::vector<VulkanImage*> color_images;
 		std::vector<VulkanImageView*> color_image_views;
-		VulkanImage *depth_image;
-		VulkanImageView *depth_image_view;
 
 		VulkanSwapChain() = default;
 		~VulkanSwapChain() = default;
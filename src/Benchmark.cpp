@@ -0,0 +1,258 @@
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <iomanip>
+
+#include "Benchmark.h"
+
+namespace vv
+{
+    namespace
+    {
+        /*
+         * Names are file paths chosen by the user, escape what JSON requires.
+         */
+        std::string escapeJSON(const std::string &text)
+        {
+            std::string escaped;
+            for (char c : text)
+            {
+                if (c == '"' || c == '\\')
+                    escaped += '\\';
+                escaped += c;
+            }
+            return escaped;
+        }
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Public
+    void Benchmark::create(const std::string &name, uint32_t frame_count, uint32_t warmup_frames)
+    {
+        m_name = name;
+        m_warmup_frames = warmup_frames;
+        m_cpu_times.clear();
+        m_gpu_times.clear();
+        m_heap_allocations.clear();
+        m_gpu_zones.clear();
+        m_counters.clear();
+        m_sections.clear();
+        m_cpu_times.reserve(frame_count);
+        m_gpu_times.reserve(frame_count);
+        m_heap_allocations.reserve(frame_count);
+    }
+
+
+    void Benchmark::addFrame(double cpu_ms, double gpu_ms)
+    {
+        m_cpu_times.push_back(cpu_ms);
+        if (gpu_ms >= 0.0)
+            m_gpu_times.push_back(gpu_ms);
+    }
+
+
+    void Benchmark::addGPUZones(const std::vector<GpuZoneResult> &zones)
+    {
+        for (const auto &zone : zones)
+        {
+            ZoneTotals &totals = m_gpu_zones[zone.name];
+            totals.sum.name = zone.name;
+            totals.sum.milliseconds += zone.milliseconds;
+            totals.sum.input_assembly_vertices += zone.input_assembly_vertices;
+            totals.sum.input_assembly_primitives += zone.input_assembly_primitives;
+            totals.sum.vertex_invocations += zone.vertex_invocations;
+            totals.sum.clipping_invocations += zone.clipping_invocations;
+            totals.sum.clipping_primitives += zone.clipping_primitives;
+            totals.sum.fragment_invocations += zone.fragment_invocations;
+            ++totals.frames;
+        }
+    }
+
+
+    void Benchmark::addHeapAllocations(uint64_t count)
+    {
+        m_heap_allocations.push_back(count);
+    }
+
+
+    void Benchmark::setCounter(const std::string &group, const std::string &name, double value)
+    {
+        m_counters[group][name] = value;
+    }
+
+
+    void Benchmark::addEntry(const std::string &section, const std::string &name, const std::map<std::string, double> &values)
+    {
+        Entry entry;
+        entry.name = name;
+        entry.values = values;
+        m_sections[section].push_back(entry);
+    }
+
+
+    uint64_t Benchmark::getSteadyStateHeapAllocations() const
+    {
+        if (m_heap_allocations.size() <= m_warmup_frames)
+            return 0;
+
+        return std::accumulate(m_heap_allocations.begin() + m_warmup_frames, m_heap_allocations.end(), uint64_t(0));
+    }
+
+
+    FrameTimeStats Benchmark::getCPUStats() const
+    {
+        return computeStats(m_cpu_times);
+    }
+
+
+    FrameTimeStats Benchmark::getGPUStats() const
+    {
+        return computeStats(m_gpu_times);
+    }
+
+
+    void Benchmark::writeReport(const std::string &file_name) const
+    {
+        std::ofstream file(file_name);
+        if (!file.is_open())
+            throw std::runtime_error("Could not open benchmark report " + file_name + " for writing");
+
+        auto write_stats = [&file](const FrameTimeStats &stats)
+        {
+            file << "{ \"frames\": " << stats.count
+                 << ", \"avg\": " << stats.average
+                 << ", \"min\": " << stats.min
+                 << ", \"max\": " << stats.max
+                 << ", \"p50\": " << stats.p50
+                 << ", \"p95\": " << stats.p95
+                 << ", \"p99\": " << stats.p99 << " }";
+        };
+
+        FrameTimeStats cpu_stats = getCPUStats();
+        FrameTimeStats gpu_stats = getGPUStats();
+
+        file << "{" << std::endl;
+        file << "  \"name\": \"" << escapeJSON(m_name) << "\"," << std::endl;
+        file << "  \"unit\": \"ms\"," << std::endl;
+        file << "  \"cpu_frame_time\": ";
+        write_stats(cpu_stats);
+        file << "," << std::endl;
+        file << "  \"gpu_frame_time\": ";
+        if (gpu_stats.count > 0)
+            write_stats(gpu_stats);
+        else
+            file << "null";
+        file << "," << std::endl;
+
+        // close to 1 when GPU bound, well below 1 when the CPU can't keep the GPU busy
+        file << "  \"gpu_utilization\": ";
+        if (gpu_stats.count > 0 && cpu_stats.average > 0.0)
+            file << gpu_stats.average / cpu_stats.average;
+        else
+            file << "null";
+        file << "," << std::endl;
+
+        // per frame averages of every pass, statistics are 0 without pipeline statistics query support
+        file << "  \"gpu_passes\": [";
+        bool first = true;
+        for (const auto &zone : m_gpu_zones)
+        {
+            const GpuZoneResult &sum = zone.second.sum;
+            const double frames = static_cast<double>(zone.second.frames);
+
+            file << (first ? "" : ",") << std::endl;
+            file << "    { \"name\": \"" << escapeJSON(sum.name) << "\""
+                 << ", \"frames\": " << zone.second.frames
+                 << ", \"avg_ms\": " << sum.milliseconds / frames
+                 << ", \"input_assembly_vertices\": " << sum.input_assembly_vertices / frames
+                 << ", \"input_assembly_primitives\": " << sum.input_assembly_primitives / frames
+                 << ", \"vertex_invocations\": " << sum.vertex_invocations / frames
+                 << ", \"clipping_invocations\": " << sum.clipping_invocations / frames
+                 << ", \"clipping_primitives\": " << sum.clipping_primitives / frames
+                 << ", \"fragment_invocations\": " << sum.fragment_invocations / frames << " }";
+            first = false;
+        }
+        file << std::endl << "  ]," << std::endl;
+
+        // calls to operator new per frame, only counted in debug builds or with VV_COUNT_HEAP_ALLOCATIONS
+        uint64_t max_allocations = 0;
+        uint32_t allocating_frames = 0;
+        for (std::size_t i = m_warmup_frames; i < m_heap_allocations.size(); ++i)
+        {
+            max_allocations = std::max(max_allocations, m_heap_allocations[i]);
+            allocating_frames += (m_heap_allocations[i] > 0) ? 1 : 0;
+        }
+
+        file << "  \"heap_allocations\": ";
+        if (m_heap_allocations.empty())
+            file << "null";
+        else
+            file << "{ \"warmup_frames\": " << m_warmup_frames
+                 << ", \"steady_state_frames\": " << m_heap_allocations.size() - std::min<std::size_t>(m_warmup_frames, m_heap_allocations.size())
+                 << ", \"steady_state_total\": " << getSteadyStateHeapAllocations()
+                 << ", \"max_per_frame\": " << max_allocations
+                 << ", \"allocating_frames\": " << allocating_frames << " }";
+        file << "," << std::endl;
+
+        // byte counts exceed the default 6 significant digits
+        file << std::setprecision(15);
+        for (const auto &section : m_sections)
+        {
+            file << "  \"" << escapeJSON(section.first) << "\": [";
+            bool first_entry = true;
+            for (const auto &entry : section.second)
+            {
+                file << (first_entry ? "" : ",") << std::endl << "    { \"name\": \"" << escapeJSON(entry.name) << "\"";
+                for (const auto &value : entry.values)
+                    file << ", \"" << escapeJSON(value.first) << "\": " << value.second;
+                file << " }";
+                first_entry = false;
+            }
+            file << std::endl << "  ]," << std::endl;
+        }
+
+        file << "  \"counters\": {";
+        bool first_group = true;
+        for (const auto &group : m_counters)
+        {
+            file << (first_group ? "" : ",") << std::endl << "    \"" << escapeJSON(group.first) << "\": {";
+            bool first_counter = true;
+            for (const auto &counter : group.second)
+            {
+                file << (first_counter ? " " : ", ") << "\"" << escapeJSON(counter.first) << "\": " << counter.second;
+                first_counter = false;
+            }
+            file << " }";
+            first_group = false;
+        }
+        file << std::endl << "  }" << std::endl << "}" << std::endl;
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Private
+    FrameTimeStats Benchmark::computeStats(std::vector<double> samples)
+    {
+        FrameTimeStats stats;
+        if (samples.empty())
+            return stats;
+
+        std::sort(samples.begin(), samples.end());
+
+        auto percentile = [&samples](double p)
+        {
+            std::size_t rank = static_cast<std::size_t>(std::ceil(p * samples.size()));
+            return samples[std::max<std::size_t>(rank, 1) - 1];
+        };
+
+        stats.count = samples.size();
+        stats.average = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+        stats.min = samples.front();
+        stats.max = samples.back();
+        stats.p50 = percentile(0.50);
+        stats.p95 = percentile(0.95);
+        stats.p99 = percentile(0.99);
+        return stats;
+    }
+}
@@ -69,6 +69,19 @@ namespace vv
     }
 
 
+    void Camera::setView(glm::vec3 position, glm::vec3 look_at_point)
+    {
+        m_pose[3] = glm::vec4(position, 1.0f);
+        m_look_at_point = look_at_point;
+    }
+
+
+    glm::vec3 Camera::getLookAtPoint() const
+    {
+        return m_look_at_point;
+    }
+
+
     glm::mat4 Camera::getProjectionMatrix(float aspect) const
     {
         auto mat = glm::perspective(m_fov_y, aspect, m_near_plane, m_far_plane);
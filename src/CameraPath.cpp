@@ -0,0 +1,98 @@
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+#include "CameraPath.h"
+#include "Camera.h"
+
+namespace vv
+{
+	///////////////////////////////////////////////////////////////////////////////////////////// Public
+    void CameraPath::load(const std::string &file_name)
+    {
+        std::ifstream file(file_name);
+        if (!file.is_open())
+            throw std::runtime_error("Could not open camera path " + file_name);
+
+        m_keyframes.clear();
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            CameraKeyframe keyframe;
+            std::istringstream stream(line);
+            stream >> keyframe.time
+                   >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+                   >> keyframe.look_at_point.x >> keyframe.look_at_point.y >> keyframe.look_at_point.z;
+
+            if (stream.fail())
+                throw std::runtime_error("Malformed keyframe in camera path " + file_name + ": " + line);
+
+            m_keyframes.push_back(keyframe);
+        }
+
+        std::stable_sort(m_keyframes.begin(), m_keyframes.end(),
+            [](const CameraKeyframe &a, const CameraKeyframe &b) { return a.time < b.time; });
+    }
+
+
+    void CameraPath::save(const std::string &file_name) const
+    {
+        std::ofstream file(file_name);
+        if (!file.is_open())
+            throw std::runtime_error("Could not open camera path " + file_name + " for writing");
+
+        // max_digits10 for floats, so a saved path replays bit for bit
+        file.precision(9);
+        file << "# time px py pz lx ly lz" << std::endl;
+        for (const auto &keyframe : m_keyframes)
+        {
+            file << keyframe.time << " "
+                 << keyframe.position.x << " " << keyframe.position.y << " " << keyframe.position.z << " "
+                 << keyframe.look_at_point.x << " " << keyframe.look_at_point.y << " " << keyframe.look_at_point.z << std::endl;
+        }
+    }
+
+
+    void CameraPath::addKeyframe(float time, const Camera *camera)
+    {
+        m_keyframes.push_back({ time, camera->getPosition(), camera->getLookAtPoint() });
+    }
+
+
+    void CameraPath::apply(float time, Camera *camera) const
+    {
+        if (m_keyframes.empty())
+            return;
+
+        if (time <= m_keyframes.front().time)
+        {
+            camera->setView(m_keyframes.front().position, m_keyframes.front().look_at_point);
+            return;
+        }
+
+        if (time >= m_keyframes.back().time)
+        {
+            camera->setView(m_keyframes.back().position, m_keyframes.back().look_at_point);
+            return;
+        }
+
+        auto next = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), time,
+            [](float t, const CameraKeyframe &keyframe) { return t < keyframe.time; });
+        auto prev = next - 1;
+
+        float span = next->time - prev->time;
+        float alpha = (span > 0.0f) ? (time - prev->time) / span : 0.0f;
+        camera->setView(glm::mix(prev->position, next->position, alpha), glm::mix(prev->look_at_point, next->look_at_point, alpha));
+    }
+
+
+    float CameraPath::getDuration() const
+    {
+        return m_keyframes.empty() ? 0.0f : m_keyframes.back().time;
+    }
+}
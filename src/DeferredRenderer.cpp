@@ -10,6 +10,13 @@
 #include "DeferredRenderer.h"
 #include "Settings.h"
 #include "Scene.h"
+#include "UploadQueue.h"
+#include "DeletionQueue.h"
+#include "GeometryArena.h"
+#include "DescriptorAllocator.h"
+#include "Profiler.h"
+#include "MemoryTracker.h"
+#include "HostAllocator.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
@@ -87,51 +94,58 @@ namespace vv
 	void DeferredRenderer::create(GLFWWindow *window)
 	{
         m_window = window;
+        m_headless = (window == nullptr);
 
         createVulkanInstance();
-        m_window->createSurface(m_instance);
+        if (!m_headless)
+            m_window->createSurface(m_instance);
 
-        DeferredRenderer::createDebugReportCallbackEXT(m_instance, vulkanDebugCallback, nullptr);
+        DeferredRenderer::createDebugReportCallbackEXT(m_instance, vulkanDebugCallback, HostAllocator::inst()->callbacks(HostObjectType::DebugCallback));
         createVulkanDevices();
 
-        m_swap_chain.create(&m_physical_device, m_window);
-
-        m_render_pass.addAttachment
-        (
-              m_swap_chain.format
-            , VK_SAMPLE_COUNT_1_BIT
-            , VK_ATTACHMENT_LOAD_OP_CLEAR
-            , VK_ATTACHMENT_STORE_OP_STORE
-            , VK_ATTACHMENT_LOAD_OP_DONT_CARE
-            , VK_ATTACHMENT_STORE_OP_DONT_CARE
-            , VK_IMAGE_LAYOUT_UNDEFINED
-            , VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
-        );
-
-        m_render_pass.addAttachment
-        (
-              m_swap_chain.depth_image->format
-            , VK_SAMPLE_COUNT_1_BIT
-            , VK_ATTACHMENT_LOAD_OP_CLEAR
-            , VK_ATTACHMENT_STORE_OP_DONT_CARE
-            , VK_ATTACHMENT_LOAD_OP_DONT_CARE
-            , VK_ATTACHMENT_STORE_OP_DONT_CARE
-            , VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
-            , VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
-        );
-
-        m_render_pass.create(&m_physical_device, VK_PIPELINE_BIND_POINT_GRAPHICS);
-
-        for (std::size_t i = 0; i < m_swap_chain.color_image_views.size(); ++i)
+        if (m_headless)
         {
-            std::vector<VkImageView> attachments = { m_swap_chain.color_image_views[i]->image_view, m_swap_chain.depth_image_view->image_view };
-            m_frame_buffers.push_back(m_render_pass.createFramebuffer(attachments, m_swap_chain.extent));
+            createOffscreenTargets();
         }
+        else
+        {
+            m_swap_chain.create(&m_physical_device, m_window);
+            m_extent = m_swap_chain.extent;
+        }
+
+        createRenderGraph();
+
+        // one zone per draw bucket, generously sized so large scenes don't run out
+        m_gpu_profiler.create(&m_physical_device, Settings::inst()->getMaxFramesInFlight(), 1024);
+
+        m_frames.resize(Settings::inst()->getMaxFramesInFlight());
+        for (auto &frame : m_frames)
+        {
+            frame.image_ready_semaphore = util::createVulkanSemaphore(m_physical_device.logical_device);
+            frame.rendering_complete_semaphore = util::createVulkanSemaphore(m_physical_device.logical_device);
+            frame.in_flight_fence = util::createVulkanFence(m_physical_device.logical_device, true);
+
+            // everything recorded into these pools is thrown away once the frame has retired
+            VkCommandPoolCreateInfo command_pool_create_info = {};
+            command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            command_pool_create_info.queueFamilyIndex = static_cast<uint32_t>(m_physical_device.graphics_family_index);
+            VV_CHECK_SUCCESS(vkCreateCommandPool(m_physical_device.logical_device, &command_pool_create_info, HostAllocator::inst()->callbacks(HostObjectType::CommandPool), &frame.command_pool));
+
+            VkCommandBufferAllocateInfo command_buffer_allocate_info = {};
+            command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            command_buffer_allocate_info.commandPool = frame.command_pool;
+            command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            command_buffer_allocate_info.commandBufferCount = 1;
+            VV_CHECK_SUCCESS(vkAllocateCommandBuffers(m_physical_device.logical_device, &command_buffer_allocate_info, &frame.command_buffer));
+        }
+
+        m_recording_threads.create(Settings::inst()->getRecordingThreadCount());
+        m_frame_arena.create(Settings::inst()->getFrameArenaSize());
 
-        m_image_ready_semaphore = util::createVulkanSemaphore(this->m_physical_device.logical_device);
-        m_rendering_complete_semaphore = util::createVulkanSemaphore(this->m_physical_device.logical_device);
+        m_images_in_flight.resize(m_headless ? m_offscreen_color_images.size() : m_swap_chain.color_images.size(), VK_NULL_HANDLE);
 
-        m_scene.create(&m_physical_device, &m_render_pass);
+        m_scene.create(&m_physical_device, m_render_graph.getRenderPass(m_scene_pass));
 	}
 
 
@@ -139,113 +153,333 @@ namespace vv
 	{
         // accounts for the issue of a logical device that might be executing commands when a terminating command is issued.
         vkDeviceWaitIdle(m_physical_device.logical_device);
+        m_physical_device.deletion_queue->flush();
+        m_recording_threads.shutDown();
+        m_frame_arena.shutDown();
+        Profiler::inst()->flush();
 
-        vkDestroySemaphore(m_physical_device.logical_device, m_image_ready_semaphore, nullptr);
-        vkDestroySemaphore(m_physical_device.logical_device, m_rendering_complete_semaphore, nullptr);
+        for (auto &frame : m_frames)
+        {
+            util::destroyVulkanSemaphore(m_physical_device.logical_device, frame.image_ready_semaphore);
+            util::destroyVulkanSemaphore(m_physical_device.logical_device, frame.rendering_complete_semaphore);
+            util::destroyVulkanFence(m_physical_device.logical_device, frame.in_flight_fence);
 
-        m_scene.shutDown();
+            // destroying the pool frees every command buffer allocated from it
+            vkDestroyCommandPool(m_physical_device.logical_device, frame.command_pool, HostAllocator::inst()->callbacks(HostObjectType::CommandPool));
+        }
+
+        for (auto &cache : m_bucket_caches)
+            vkDestroyCommandPool(m_physical_device.logical_device, cache.second.command_pool, HostAllocator::inst()->callbacks(HostObjectType::CommandPool));
+        m_bucket_caches.clear();
+        m_gpu_profiler.shutDown();
 
-        m_render_pass.shutDown();
+        m_frames.clear();
+        m_images_in_flight.clear();
 
-        for (std::size_t j = 0; j < m_frame_buffers.size(); ++j)
-            vkDestroyFramebuffer(m_physical_device.logical_device, m_frame_buffers[j], nullptr);
+        m_scene.shutDown();
 
-        m_swap_chain.shutDown(&m_physical_device);
+        m_render_graph.shutDown();
+
+        if (m_headless)
+        {
+            for (std::size_t i = 0; i < m_offscreen_color_images.size(); ++i)
+            {
+                m_offscreen_color_image_views[i]->shutDown(); delete m_offscreen_color_image_views[i];
+                m_offscreen_color_images[i]->shutDown(); delete m_offscreen_color_images[i];
+            }
+            m_offscreen_color_image_views.clear();
+            m_offscreen_color_images.clear();
+        }
+        else
+        {
+            m_swap_chain.shutDown(&m_physical_device);
+        }
 
         m_physical_device.shutDown();
 
-        m_window->shutDown(m_instance);
-        DeferredRenderer::destroyDebugReportCallbackEXT(m_instance, nullptr);
-        vkDestroyInstance(m_instance, nullptr);
+        if (!m_headless)
+            m_window->shutDown(m_instance);
+        DeferredRenderer::destroyDebugReportCallbackEXT(m_instance, HostAllocator::inst()->callbacks(HostObjectType::DebugCallback));
+        vkDestroyInstance(m_instance, HostAllocator::inst()->callbacks(HostObjectType::Instance));
 	}
 
 
 	void DeferredRenderer::run(float delta_time)
 	{
-        m_scene.updateUniformData(m_swap_chain.extent, delta_time);
+        Profiler::inst()->beginFrame(m_frame_number);
+        HostAllocator::inst()->beginFrame(m_frame_number);
+        VV_PROFILE_FUNCTION();
+        m_frame_arena.reset();
+
+        FrameData &frame = m_frames[m_current_frame];
+
+        // wait until the GPU has finished with this frame's resources before touching them again
+        {
+            VV_PROFILE_SCOPE("WaitForFrameFence");
+            VV_CHECK_SUCCESS(vkWaitForFences(m_physical_device.logical_device, 1, &frame.in_flight_fence, VK_TRUE, UINT64_MAX));
+        }
+        m_physical_device.deletion_queue->beginFrame(m_frame_number);
+        m_physical_device.descriptor_allocator->beginFrame(m_current_frame);
+        m_scene.allocateFrameDescriptorSets(m_current_frame);
+
+        // right after deferred frees have run, and before recording, so draw buckets pick up moved geometry this frame
+        m_physical_device.geometry_arena->compactIfFragmented();
+        m_scene.updateResidency(m_frame_number);
+
+        // the fence guarantees the queries of this frame's previous submission are available, so reading them doesn't stall
+        m_gpu_profiler.collect(m_current_frame);
 
         // Draw Frame
-        /// Acquire an image from the swap chain
-        uint32_t image_index = 0;
-        m_swap_chain.acquireNextImage(&m_physical_device, m_image_ready_semaphore, image_index);
+        /// Acquire an image from the swap chain. Offscreen targets are owned by their frame in flight, so there is nothing to wait on.
+        uint32_t image_index = m_current_frame;
+        if (!m_headless)
+            m_swap_chain.acquireNextImage(&m_physical_device, frame.image_ready_semaphore, image_index);
+
+        /// the swap chain can hand back an image that an older frame in flight is still rendering into
+        if (m_images_in_flight[image_index] != VK_NULL_HANDLE && m_images_in_flight[image_index] != frame.in_flight_fence)
+            VV_CHECK_SUCCESS(vkWaitForFences(m_physical_device.logical_device, 1, &m_images_in_flight[image_index], VK_TRUE, UINT64_MAX));
+        m_images_in_flight[image_index] = frame.in_flight_fence;
+
+        recordFrame(frame, image_index);
+        m_scene.updateUniformData(m_extent, delta_time, m_current_frame);
 
         VkSubmitInfo submit_info = {};
         submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
         /// tell the queue to wait until a command buffer successfully attaches a swap chain image as a color attachment (wait until its ready to begin rendering).
         std::array<VkPipelineStageFlags, 1> wait_stages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submit_info.waitSemaphoreCount = 1;
-        submit_info.pWaitSemaphores = &m_image_ready_semaphore;
+        submit_info.waitSemaphoreCount = m_headless ? 0 : 1;
+        submit_info.pWaitSemaphores = &frame.image_ready_semaphore;
         submit_info.pWaitDstStageMask = wait_stages.data();
 
         /// Set the command buffer that will be used to rendering to be the one we waited for.
         submit_info.commandBufferCount = 1;
-        submit_info.pCommandBuffers = &m_command_buffers[image_index];
+        submit_info.pCommandBuffers = &frame.command_buffer;
 
         /// Detail the semaphore that marks when rendering is complete.
-        std::array<VkSemaphore, 1> signal_semaphores = { m_rendering_complete_semaphore };
-        submit_info.signalSemaphoreCount = 1;
+        std::array<VkSemaphore, 1> signal_semaphores = { frame.rendering_complete_semaphore };
+        submit_info.signalSemaphoreCount = m_headless ? 0 : 1;
         submit_info.pSignalSemaphores = signal_semaphores.data();
 
-        VV_CHECK_SUCCESS(vkQueueSubmit(m_physical_device.graphics_queue, 1, &submit_info, VK_NULL_HANDLE));
-        m_swap_chain.present(m_physical_device.graphics_queue, image_index, m_rendering_complete_semaphore);
+        VV_CHECK_SUCCESS(vkResetFences(m_physical_device.logical_device, 1, &frame.in_flight_fence));
+        {
+            VV_PROFILE_SCOPE("vkQueueSubmit");
+            VV_CHECK_SUCCESS(vkQueueSubmit(m_physical_device.graphics_queue, 1, &submit_info, frame.in_flight_fence));
+        }
+        if (!m_headless)
+            m_swap_chain.present(m_physical_device.graphics_queue, image_index, frame.rendering_complete_semaphore);
+        m_last_image_index = image_index;
+
+        m_current_frame = (m_current_frame + 1) % static_cast<uint32_t>(m_frames.size());
+        ++m_frame_number;
 	}
 
 
     void DeferredRenderer::recordCommandBuffers()
     {
-        m_command_buffers.resize(m_frame_buffers.size());
+        // scene loading only records uploads. everything referenced by the command buffers has to be resident before the first frame.
+        m_physical_device.upload_queue->waitIdle();
 
-        VkCommandBufferAllocateInfo command_buffer_allocate_info = {};
-        command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        command_buffer_allocate_info.commandPool = m_physical_device.command_pools["graphics"];
+        m_scene.allocateSceneDescriptorSets();
+    }
 
-        // primary can be sent to pool for execution, but cant be called from other buffers. secondary cant be sent to pool, but can be called from other buffers.
-        command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; 
-        command_buffer_allocate_info.commandBufferCount = static_cast<uint32_t>(m_command_buffers.size());
 
-        VV_CHECK_SUCCESS(vkAllocateCommandBuffers(m_physical_device.logical_device, &command_buffer_allocate_info, m_command_buffers.data()));
+    Scene* DeferredRenderer::getScene() const
+    {
+        return (Scene*)&m_scene;
+    }
 
-        std::vector<VkClearValue> clear_values;
-        VkClearValue color_value, depth_value;
-        color_value.color = { 0.3f, 0.5f, 0.5f, 1.0f };
-        depth_value.depthStencil = {1.0f, 0};
-        clear_values.push_back(color_value);
-        clear_values.push_back(depth_value);
 
-        m_scene.allocateSceneDescriptorSets();
+	bool DeferredRenderer::shouldStop()
+	{
+        if (m_headless)
+            return m_frame_number >= Settings::inst()->getFrameCount();
+
+        return m_window->shouldClose();
+	}
+
+
+    RecordingStats DeferredRenderer::getRecordingStats() const
+    {
+        return m_recording_stats;
+    }
+
+
+    RenderGraphStats DeferredRenderer::getRenderGraphStats() const
+    {
+        return m_render_graph.getStats();
+    }
+
+
+    DescriptorAllocatorStats DeferredRenderer::getDescriptorAllocatorStats() const
+    {
+        return m_physical_device.descriptor_allocator->getStats();
+    }
+
+
+    double DeferredRenderer::getLastGPUFrameTime() const
+    {
+        return m_gpu_profiler.getFrameTime();
+    }
+
+
+    const std::vector<GpuZoneResult>& DeferredRenderer::getGPUZoneResults() const
+    {
+        return m_gpu_profiler.getResults();
+    }
+
+
+    MemoryTracker* DeferredRenderer::getMemoryTracker() const
+    {
+        return m_physical_device.memory_tracker;
+    }
+
+
+    void DeferredRenderer::readbackFrame(std::vector<unsigned char> &pixels)
+    {
+        VV_ASSERT(m_headless, "Frames can only be read back when rendering headless");
+
+        VV_CHECK_SUCCESS(vkQueueWaitIdle(m_physical_device.graphics_queue));
+        m_offscreen_color_images[m_last_image_index]->readback(pixels, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Private
+    void DeferredRenderer::recordFrame(FrameData &frame, uint32_t image_index)
+    {
+        VV_PROFILE_FUNCTION();
+
+        // the frame's fence has been waited on, so nothing recorded from its pool is still pending
+        VV_CHECK_SUCCESS(vkResetCommandPool(m_physical_device.logical_device, frame.command_pool, 0));
+
+        const std::vector<DrawBucket> &buckets = m_scene.updateDrawBuckets();
+        const uint32_t frame_index = m_current_frame;
+
+        // buckets are replayed across swap chain images, so the framebuffer is left unspecified
+        VkCommandBufferInheritanceInfo inheritance_info = {};
+        inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance_info.renderPass = m_render_graph.getRenderPass(m_scene_pass)->render_pass;
+        inheritance_info.subpass = 0;
+        inheritance_info.framebuffer = VK_NULL_HANDLE;
+
+        m_bucket_command_buffers = m_frame_arena.allocateArray<VkCommandBuffer>(buckets.size());
+        m_bucket_command_buffer_count = static_cast<uint32_t>(buckets.size());
 
-        for (std::size_t i = 0; i < m_command_buffers.size(); ++i)
+        for (std::size_t i = 0; i < buckets.size(); ++i)
         {
-            VkCommandBufferBeginInfo command_buffer_begin_info = {};
-            command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT; // <- tells how long this buffer will be executed
-            command_buffer_begin_info.pInheritanceInfo = nullptr; // for if this is a secondary buffer
-            VV_CHECK_SUCCESS(vkBeginCommandBuffer(m_command_buffers[i], &command_buffer_begin_info));
+            const DrawBucket *bucket = &buckets[i];
+            BucketCommandCache *cache = &getBucketCache(bucket->key);
+            cache->last_used_frame = m_frame_number;
+            m_bucket_command_buffers[i] = cache->command_buffers[frame_index];
 
-            m_render_pass.beginRenderPass(m_command_buffers[i], VK_SUBPASS_CONTENTS_INLINE, m_frame_buffers[i], m_swap_chain.extent, clear_values);
+            m_gpu_profiler.useZone(frame_index, cache->gpu_zone, cache->gpu_zone_name);
 
-            m_scene.render(m_command_buffers[i]);
+            if (cache->recorded_versions[frame_index] == bucket->version)
+            {
+                ++m_recording_stats.bucket_hits;
+                continue;
+            }
+
+            ++m_recording_stats.bucket_misses;
+            cache->recorded_versions[frame_index] = bucket->version;
+
+            // each bucket has its own pool, so buckets can be recorded concurrently without further synchronization
+            m_recording_threads.submit([this, bucket, cache, frame_index, &inheritance_info](uint32_t)
+            {
+                VkCommandBuffer command_buffer = cache->command_buffers[frame_index];
+
+                VkCommandBufferBeginInfo command_buffer_begin_info = {};
+                command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+                command_buffer_begin_info.pInheritanceInfo = &inheritance_info;
+
+                // beginning implicitly resets the command buffer since its pool allows individual resets
+                VV_CHECK_SUCCESS(vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info));
+                m_gpu_profiler.beginZone(command_buffer, frame_index, cache->gpu_zone);
+                m_scene.recordBucket(command_buffer, frame_index, *bucket);
+                m_gpu_profiler.endZone(command_buffer, frame_index, cache->gpu_zone);
+                VV_CHECK_SUCCESS(vkEndCommandBuffer(command_buffer));
+            });
+        }
 
-            m_render_pass.endRenderPass(m_command_buffers[i]);
-            VV_CHECK_SUCCESS(vkEndCommandBuffer(m_command_buffers[i]));
+        {
+            VV_PROFILE_SCOPE("WaitForBucketRecording");
+            m_recording_threads.wait();
         }
+        evictUnusedBucketCaches();
+
+        VkCommandBufferBeginInfo command_buffer_begin_info = {};
+        command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VV_CHECK_SUCCESS(vkBeginCommandBuffer(frame.command_buffer, &command_buffer_begin_info));
+
+        m_gpu_profiler.beginFrame(frame.command_buffer, frame_index);
+
+        m_render_graph.execute(frame.command_buffer, image_index);
+
+        m_gpu_profiler.endFrame(frame.command_buffer, frame_index);
+
+        VV_CHECK_SUCCESS(vkEndCommandBuffer(frame.command_buffer));
     }
 
 
-    Scene* DeferredRenderer::getScene() const
+    BucketCommandCache& DeferredRenderer::getBucketCache(const std::string &key)
     {
-        return (Scene*)&m_scene;
+        auto found = m_bucket_caches.find(key);
+        if (found != m_bucket_caches.end())
+            return found->second;
+
+        BucketCommandCache &cache = m_bucket_caches[key];
+
+        VkCommandPoolCreateInfo command_pool_create_info = {};
+        command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        command_pool_create_info.queueFamilyIndex = static_cast<uint32_t>(m_physical_device.graphics_family_index);
+        VV_CHECK_SUCCESS(vkCreateCommandPool(m_physical_device.logical_device, &command_pool_create_info, HostAllocator::inst()->callbacks(HostObjectType::CommandPool), &cache.command_pool));
+
+        cache.gpu_zone = m_gpu_profiler.allocateZone();
+
+        // chunks of the same material template are reported as a single pass
+        cache.gpu_zone_name = (key == "skybox") ? "SkyBox" : key.substr(0, key.find('/'));
+        cache.command_buffers.resize(m_frames.size());
+        cache.recorded_versions.resize(m_frames.size(), 0);
+
+        VkCommandBufferAllocateInfo command_buffer_allocate_info = {};
+        command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        command_buffer_allocate_info.commandPool = cache.command_pool;
+        command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        command_buffer_allocate_info.commandBufferCount = static_cast<uint32_t>(cache.command_buffers.size());
+        VV_CHECK_SUCCESS(vkAllocateCommandBuffers(m_physical_device.logical_device, &command_buffer_allocate_info, cache.command_buffers.data()));
+
+        return cache;
     }
 
 
-	bool DeferredRenderer::shouldStop()
-	{
-        return m_window->shouldClose();
-	}
+    void DeferredRenderer::evictUnusedBucketCaches()
+    {
+        for (auto it = m_bucket_caches.begin(); it != m_bucket_caches.end();)
+        {
+            if (it->second.last_used_frame == m_frame_number)
+            {
+                ++it;
+                continue;
+            }
+
+            // older frames in flight may still execute these command buffers
+            VkDevice logical_device = m_physical_device.logical_device;
+            VkCommandPool command_pool = it->second.command_pool;
+            uint32_t gpu_zone = it->second.gpu_zone;
+            GpuProfiler *gpu_profiler = &m_gpu_profiler;
+            m_physical_device.deletion_queue->push([=]()
+            {
+                vkDestroyCommandPool(logical_device, command_pool, HostAllocator::inst()->callbacks(HostObjectType::CommandPool));
+                gpu_profiler->releaseZone(gpu_zone);
+            });
+            it = m_bucket_caches.erase(it);
+        }
+    }
 
 
-	///////////////////////////////////////////////////////////////////////////////////////////// Private
 	void DeferredRenderer::createVulkanInstance()
 	{
         VV_ASSERT(checkValidationLayerSupport(), "Validation layers requested are not available on this system.");
@@ -270,6 +504,11 @@ namespace vv
         instance_create_info.pApplicationInfo = &app_info;
 
         auto required_extensions = getRequiredExtensions();
+#ifdef VK_KHR_get_physical_device_properties2
+        m_has_physical_device_properties2 = isInstanceExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+        if (m_has_physical_device_properties2)
+            required_extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+#endif
         instance_create_info.enabledExtensionCount = static_cast<uint32_t>(required_extensions.size());
         instance_create_info.ppEnabledExtensionNames = required_extensions.data();
 
@@ -280,7 +519,7 @@ namespace vv
         instance_create_info.enabledLayerCount = 0;
 #endif
 
-        VV_CHECK_SUCCESS(vkCreateInstance(&instance_create_info, nullptr, &m_instance));
+        VV_CHECK_SUCCESS(vkCreateInstance(&instance_create_info, HostAllocator::inst()->callbacks(HostObjectType::Instance), &m_instance));
 	}
 
 
@@ -288,9 +527,10 @@ namespace vv
 	{
         std::vector<const char*> extensions;
 
-        // GLFW specific
-        for (uint32_t i = 0; i < m_window->glfw_extension_count; i++)
-            extensions.push_back(m_window->glfw_extensions[i]);
+        // GLFW specific. nothing is presented when headless, so no surface extensions are needed.
+        if (!m_headless)
+            for (uint32_t i = 0; i < m_window->glfw_extension_count; i++)
+                extensions.push_back(m_window->glfw_extensions[i]);
 
         // System wide required (hardcoded)
         for (auto extension : m_used_instance_extensions)
@@ -327,6 +567,35 @@ namespace vv
 	}
 
 
+    bool DeferredRenderer::isInstanceExtensionAvailable(const char *extension)
+    {
+        uint32_t extension_count = 0;
+        VV_CHECK_SUCCESS(vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr));
+        std::vector<VkExtensionProperties> available_extensions(extension_count);
+        VV_CHECK_SUCCESS(vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, available_extensions.data()));
+
+        for (const auto& found_extension : available_extensions)
+            if (strcmp(extension, found_extension.extensionName) == 0)
+                return true;
+
+        return false;
+    }
+
+
+    void DeferredRenderer::enableMemoryBudgetQueries()
+    {
+#ifdef VK_EXT_memory_budget
+        if (!m_has_physical_device_properties2 || !m_physical_device.memory_budget_supported)
+            return;
+
+        auto get_memory_properties = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(
+            vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceMemoryProperties2KHR"));
+        if (get_memory_properties)
+            m_physical_device.memory_tracker->setBudgetQuery(m_physical_device.physical_device, get_memory_properties);
+#endif
+    }
+
+
 	bool DeferredRenderer::checkValidationLayerSupport()
 	{
         uint32_t layer_count = 0;
@@ -354,10 +623,59 @@ namespace vv
 
     bool DeferredRenderer::isVulkanDeviceSuitable(VulkanDevice &device)
     {
+        if (m_headless)
+            return device.hasGraphicsQueue();
+
         return device.hasGraphicsQueue() && device.querySwapChainSupport(m_window->surface).is_supported;
     }
 
 
+    void DeferredRenderer::createOffscreenTargets()
+    {
+        m_extent.width = static_cast<uint32_t>(Settings::inst()->getWindowWidth());
+        m_extent.height = static_cast<uint32_t>(Settings::inst()->getWindowHeight());
+
+        for (uint32_t i = 0; i < Settings::inst()->getMaxFramesInFlight(); ++i)
+        {
+            VulkanImage *color_image = new VulkanImage();
+            color_image->createColorAttachment(&m_physical_device, m_extent, VK_FORMAT_R8G8B8A8_UNORM);
+            VulkanImageView *color_image_view = new VulkanImageView();
+            color_image_view->create(&m_physical_device, color_image, VK_IMAGE_VIEW_TYPE_2D, 0);
+
+            m_offscreen_color_images.push_back(color_image);
+            m_offscreen_color_image_views.push_back(color_image_view);
+        }
+
+    }
+
+
+    void DeferredRenderer::createRenderGraph()
+    {
+        m_render_graph.create(&m_physical_device, m_extent);
+
+        // offscreen frames stay in a layout they can be copied out of
+        if (m_headless)
+            m_color_target = m_render_graph.importImages("offscreen color", m_offscreen_color_images, m_offscreen_color_image_views, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        else
+            m_color_target = m_render_graph.importImages("swap chain", m_swap_chain.color_images, m_swap_chain.color_image_views, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+        VkFormat depth_format = m_physical_device.findSupportedFormat({ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+                                                                      VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+        m_depth_target = m_render_graph.createAttachment("depth", depth_format);
+
+        // every draw bucket is replayed from its secondary command buffer
+        m_scene_pass = m_render_graph.addPass("scene", [this](VkCommandBuffer command_buffer)
+        {
+            if (m_bucket_command_buffer_count > 0)
+                vkCmdExecuteCommands(command_buffer, m_bucket_command_buffer_count, m_bucket_command_buffers);
+        }, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        m_render_graph.addColorOutput(m_scene_pass, m_color_target, VK_ATTACHMENT_LOAD_OP_CLEAR, { 0.3f, 0.5f, 0.5f, 1.0f });
+        m_render_graph.addDepthOutput(m_scene_pass, m_depth_target, VK_ATTACHMENT_LOAD_OP_CLEAR, { 1.0f, 0 });
+        m_render_graph.compile();
+    }
+
+
     void DeferredRenderer::createVulkanDevices()
     {
         uint32_t _physical_device_count = 0;
@@ -377,11 +695,12 @@ namespace vv
             if (isVulkanDeviceSuitable(m_physical_device))
             {
                 if (m_physical_device.hasTransferQueue())
-                    m_physical_device.createLogicalDevice(true, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_TRANSFER_BIT);
+                    m_physical_device.createLogicalDevice(!m_headless, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_TRANSFER_BIT);
                 else
-                    m_physical_device.createLogicalDevice(true, VK_QUEUE_GRAPHICS_BIT);
+                    m_physical_device.createLogicalDevice(!m_headless, VK_QUEUE_GRAPHICS_BIT);
 
-                m_window->surface_settings[&m_physical_device] = m_physical_device.querySwapChainSupport(m_window->surface);
+                if (!m_headless)
+                    m_window->surface_settings[&m_physical_device] = m_physical_device.querySwapChainSupport(m_window->surface);
                 found = true;
                 break;
             }
@@ -392,5 +711,7 @@ namespace vv
         }
 
         VV_ASSERT(found, "Vulkan Error: no gpu with Vulkan support found");
+
+        enableMemoryBudgetQueries();
     }
 }
\ No newline at end of file
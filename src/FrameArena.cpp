@@ -0,0 +1,101 @@
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "FrameArena.h"
+
+namespace vv
+{
+	///////////////////////////////////////////////////////////////////////////////////////////// Public
+    void FrameArena::create(std::size_t block_size)
+    {
+        addBlock(block_size);
+        m_current_block = 0;
+        m_offset = 0;
+        m_used = 0;
+        m_peak_used = 0;
+    }
+
+
+    void FrameArena::shutDown()
+    {
+        for (auto &block : m_blocks)
+            std::free(block.memory);
+
+        m_blocks.clear();
+        m_current_block = 0;
+        m_offset = 0;
+        m_used = 0;
+    }
+
+
+    void* FrameArena::allocate(std::size_t size, std::size_t alignment)
+    {
+        Block *block = &m_blocks[m_current_block];
+        uintptr_t base = reinterpret_cast<uintptr_t>(block->memory);
+        std::size_t offset = ((base + m_offset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1)) - base;
+
+        if (offset + size > block->size)
+        {
+            // overflow blocks are merged into one on the next reset, so they're sized generously
+            addBlock(std::max(size + alignment, block->size));
+            block = &m_blocks[m_current_block];
+            base = reinterpret_cast<uintptr_t>(block->memory);
+            offset = ((base + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1)) - base;
+        }
+
+        m_used += (offset - m_offset) + size;
+        m_offset = offset + size;
+        return block->memory + offset;
+    }
+
+
+    void FrameArena::reset()
+    {
+        m_peak_used = std::max(m_peak_used, m_used);
+
+        if (m_blocks.size() > 1)
+        {
+            std::size_t capacity = 0;
+            for (auto &block : m_blocks)
+            {
+                capacity += block.size;
+                std::free(block.memory);
+            }
+            m_blocks.clear();
+            addBlock(capacity);
+        }
+
+        m_current_block = 0;
+        m_offset = 0;
+        m_used = 0;
+    }
+
+
+    FrameArenaStats FrameArena::getStats() const
+    {
+        FrameArenaStats stats;
+        for (const auto &block : m_blocks)
+            stats.capacity += block.size;
+        stats.used = m_used;
+        stats.peak_used = std::max(m_peak_used, m_used);
+        stats.block_count = static_cast<uint32_t>(m_blocks.size());
+        return stats;
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Private
+    void FrameArena::addBlock(std::size_t size)
+    {
+        Block block;
+        block.size = size;
+        block.memory = static_cast<unsigned char*>(std::malloc(size));
+        if (!block.memory)
+            throw std::runtime_error("Out of memory allocating a frame arena block of " + std::to_string(size) + " bytes");
+
+        m_blocks.push_back(block);
+        m_current_block = m_blocks.size() - 1;
+        m_offset = 0;
+    }
+}
@@ -5,6 +5,7 @@
 #include "InputManager.h"
 #include "Settings.h"
 #include "Utils.h"
+#include "HostAllocator.h"
 
 namespace vv
 {
@@ -27,7 +28,7 @@ namespace vv
 
 	void GLFWWindow::createSurface(VkInstance instance)
 	{
-		VV_CHECK_SUCCESS(glfwCreateWindowSurface(instance, window, nullptr, &surface));
+		VV_CHECK_SUCCESS(glfwCreateWindowSurface(instance, window, HostAllocator::inst()->callbacks(HostObjectType::Surface), &surface));
 	}
 
 
@@ -36,7 +37,7 @@ namespace vv
         surface_settings.clear();
 
 		if (surface != VK_NULL_HANDLE)
-			vkDestroySurfaceKHR(instance, surface, nullptr);
+			vkDestroySurfaceKHR(instance, surface, HostAllocator::inst()->callbacks(HostObjectType::Surface));
 
 		glfwDestroyWindow(window);
 		glfwTerminate();
@@ -0,0 +1,375 @@
+#include <cstring>
+#include <cctype>
+
+#include "GltfAsset.h"
+#include "Profiler.h"
+
+namespace vv
+{
+    namespace
+    {
+        const uint32_t glb_magic        = 0x46546C67; // "glTF"
+        const uint32_t glb_chunk_json   = 0x4E4F534A; // "JSON"
+        const uint32_t glb_chunk_binary = 0x004E4942; // "BIN\0"
+        const std::size_t glb_header_size = 12;
+        const std::size_t glb_chunk_header_size = 8;
+
+        // larger sizes can only come from a broken file
+        const double max_size = static_cast<double>(1ull << 40);
+
+
+        uint32_t readUint32(const unsigned char *data)
+        {
+            uint32_t value;
+            memcpy(&value, data, sizeof(value));
+            return value;
+        }
+
+
+        std::size_t getComponentSize(int component_type)
+        {
+            switch (component_type)
+            {
+            case GLTF_BYTE:
+            case GLTF_UNSIGNED_BYTE:
+                return 1;
+            case GLTF_SHORT:
+            case GLTF_UNSIGNED_SHORT:
+                return 2;
+            case GLTF_UNSIGNED_INT:
+            case GLTF_FLOAT:
+                return 4;
+            default:
+                return 0;
+            }
+        }
+
+
+        int getComponentCount(const std::string &type)
+        {
+            if (type == "SCALAR") return 1;
+            if (type == "VEC2")   return 2;
+            if (type == "VEC3")   return 3;
+            if (type == "VEC4")   return 4;
+            if (type == "MAT2")   return 4;
+            if (type == "MAT3")   return 9;
+            if (type == "MAT4")   return 16;
+            return 0;
+        }
+
+
+        int base64Digit(char c)
+        {
+            if (c >= 'A' && c <= 'Z')
+                return c - 'A';
+            if (c >= 'a' && c <= 'z')
+                return c - 'a' + 26;
+            if (c >= '0' && c <= '9')
+                return c - '0' + 52;
+            if (c == '+')
+                return 62;
+            if (c == '/')
+                return 63;
+            return -1;
+        }
+
+
+        /*
+         * Size field of a JSON object as a byte count, rejecting negative, fractional and absurdly large values.
+         */
+        bool getSize(const JsonValue &value, std::size_t &size)
+        {
+            const double number = value.asNumber(-1.0);
+            if (number < 0.0 || number > max_size ||
+                number != static_cast<double>(static_cast<std::size_t>(number)))
+                return false;
+            size = static_cast<std::size_t>(number);
+            return true;
+        }
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Public
+	bool GltfAsset::create(const std::string &path, std::string &err)
+	{
+        VV_PROFILE_FUNCTION();
+        if (!m_file.create(path))
+        {
+            err = "Cannot open file " + path;
+            return false;
+        }
+
+        const char *json_begin = reinterpret_cast<const char *>(m_file.getData());
+        const char *json_end = json_begin + m_file.getSize();
+        Buffer binary_chunk;
+
+        const bool binary = m_file.getSize() >= 4 && readUint32(m_file.getData()) == glb_magic;
+        if (binary && !readGLB(m_file.getData(), m_file.getSize(), json_begin, json_end, binary_chunk, err))
+        {
+            shutDown();
+            return false;
+        }
+
+        std::string json_err;
+        if (!JsonValue::parse(json_begin, json_end, m_json, json_err))
+        {
+            err = "Invalid JSON in " + path + ": " + json_err;
+            shutDown();
+            return false;
+        }
+
+        const std::string &version = m_json["asset"]["version"].asString();
+        if (version.compare(0, 2, "2.") != 0)
+        {
+            err = path + " is not a glTF 2.0 asset";
+            shutDown();
+            return false;
+        }
+
+        const std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+        const JsonValue &buffers = m_json["buffers"];
+        m_buffer_files.resize(buffers.size());
+        m_decoded_buffers.resize(buffers.size());
+        m_buffers.resize(buffers.size());
+
+        for (std::size_t i = 0; i < buffers.size(); ++i)
+        {
+            const JsonValue &buffer = buffers[i];
+            const std::string &uri = buffer["uri"].asString();
+            Buffer &resolved = m_buffers[i];
+
+            if (uri.empty())
+            {
+                // the first buffer of a .glb without a uri is its binary chunk
+                if (!binary || i != 0 || !binary_chunk.data)
+                {
+                    err = "Buffer " + std::to_string(i) + " of " + path + " has no data";
+                    shutDown();
+                    return false;
+                }
+                resolved = binary_chunk;
+            }
+            else if (uri.compare(0, 5, "data:") == 0)
+            {
+                if (!decodeDataURI(uri, m_decoded_buffers[i]))
+                {
+                    err = "Buffer " + std::to_string(i) + " of " + path + " has an unsupported data uri";
+                    shutDown();
+                    return false;
+                }
+                resolved.data = m_decoded_buffers[i].data();
+                resolved.size = m_decoded_buffers[i].size();
+            }
+            else
+            {
+                if (!m_buffer_files[i].create(directory + decodeURI(uri)))
+                {
+                    err = "Cannot open buffer " + directory + uri;
+                    shutDown();
+                    return false;
+                }
+                resolved.data = m_buffer_files[i].getData();
+                resolved.size = m_buffer_files[i].getSize();
+            }
+
+            // the chunk and files may be padded, but never shorter than declared
+            std::size_t byte_length = 0;
+            if (!getSize(buffer["byteLength"], byte_length) || byte_length > resolved.size)
+            {
+                err = "Buffer " + std::to_string(i) + " of " + path + " is shorter than its byteLength";
+                shutDown();
+                return false;
+            }
+            resolved.size = byte_length;
+        }
+
+        return true;
+	}
+
+
+	void GltfAsset::shutDown()
+	{
+        for (auto &file : m_buffer_files)
+            file.shutDown();
+        m_buffer_files.clear();
+        m_decoded_buffers.clear();
+        m_buffers.clear();
+        m_json = JsonValue();
+        m_file.shutDown();
+	}
+
+
+    bool GltfAsset::getAccessor(int index, GltfAccessor &accessor, std::string &err) const
+    {
+        const JsonValue &json = m_json["accessors"][static_cast<std::size_t>(index)];
+        if (index < 0 || !json.isObject())
+        {
+            err = "Invalid accessor " + std::to_string(index);
+            return false;
+        }
+
+        if (json.has("sparse") || !json.has("bufferView"))
+        {
+            err = "Accessor " + std::to_string(index) + " is sparse or has no buffer view, neither is supported";
+            return false;
+        }
+
+        accessor = GltfAccessor();
+        accessor.component_type = json["componentType"].asInt();
+        accessor.component_count = getComponentCount(json["type"].asString());
+        accessor.normalized = json["normalized"].asBool();
+
+        std::size_t offset = 0;
+        const std::size_t element_size = getComponentSize(accessor.component_type) * accessor.component_count;
+        if (element_size == 0 || !getSize(json["count"], accessor.count) || (json.has("byteOffset") && !getSize(json["byteOffset"], offset)))
+        {
+            err = "Accessor " + std::to_string(index) + " has an invalid type, count or offset";
+            return false;
+        }
+
+        const unsigned char *view_data = nullptr;
+        std::size_t view_size = 0;
+        if (!getBufferView(json["bufferView"].asInt(-1), view_data, view_size, err))
+            return false;
+
+        const JsonValue &view = m_json["bufferViews"][static_cast<std::size_t>(json["bufferView"].asInt())];
+        accessor.stride = element_size;
+        if (view.has("byteStride") && !getSize(view["byteStride"], accessor.stride))
+            accessor.stride = 0;
+
+        // every element, the last one included, has to lie within the view
+        bool in_view = accessor.stride >= element_size;
+        if (in_view && accessor.count > 0)
+            in_view = offset <= view_size && view_size - offset >= element_size &&
+                      accessor.count - 1 <= (view_size - offset - element_size) / accessor.stride;
+
+        if (!in_view)
+        {
+            err = "Accessor " + std::to_string(index) + " reaches past its buffer view";
+            return false;
+        }
+
+        accessor.data = view_data + offset;
+        return true;
+    }
+
+
+    bool GltfAsset::getBufferView(int index, const unsigned char *&data, std::size_t &size, std::string &err) const
+    {
+        const JsonValue &json = m_json["bufferViews"][static_cast<std::size_t>(index)];
+        const int buffer = json["buffer"].asInt(-1);
+        if (index < 0 || !json.isObject() || buffer < 0 || static_cast<std::size_t>(buffer) >= m_buffers.size())
+        {
+            err = "Invalid buffer view " + std::to_string(index);
+            return false;
+        }
+
+        std::size_t offset = 0;
+        const Buffer &resolved = m_buffers[buffer];
+        if ((json.has("byteOffset") && !getSize(json["byteOffset"], offset)) || !getSize(json["byteLength"], size) ||
+            offset > resolved.size || size > resolved.size - offset)
+        {
+            err = "Buffer view " + std::to_string(index) + " reaches past its buffer";
+            return false;
+        }
+
+        data = resolved.data + offset;
+        return true;
+    }
+
+
+    bool GltfAsset::decodeDataURI(const std::string &uri, std::vector<unsigned char> &data)
+    {
+        const std::size_t separator = uri.find(',');
+        if (uri.compare(0, 5, "data:") != 0 || separator == std::string::npos || separator < 7 ||
+            uri.compare(separator - 7, 7, ";base64") != 0)
+            return false;
+
+        data.clear();
+        data.reserve((uri.size() - separator) / 4 * 3);
+
+        uint32_t bits = 0;
+        int bit_count = 0;
+        for (std::size_t i = separator + 1; i < uri.size() && uri[i] != '='; ++i)
+        {
+            int digit = base64Digit(uri[i]);
+            if (digit < 0)
+                return false;
+
+            bits = (bits << 6) | static_cast<uint32_t>(digit);
+            bit_count += 6;
+            if (bit_count >= 8)
+            {
+                bit_count -= 8;
+                data.push_back(static_cast<unsigned char>(bits >> bit_count));
+            }
+        }
+        return true;
+    }
+
+
+    std::string GltfAsset::decodeURI(const std::string &uri)
+    {
+        std::string decoded;
+        decoded.reserve(uri.size());
+        for (std::size_t i = 0; i < uri.size(); ++i)
+        {
+            if (uri[i] == '%' && i + 2 < uri.size() && isxdigit(static_cast<unsigned char>(uri[i + 1])) &&
+                isxdigit(static_cast<unsigned char>(uri[i + 2])))
+            {
+                decoded += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+                i += 2;
+            }
+            else
+                decoded += uri[i];
+        }
+        return decoded;
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Private
+    bool GltfAsset::readGLB(const unsigned char *data, std::size_t size, const char *&json_begin, const char *&json_end,
+                            Buffer &binary_chunk, std::string &err) const
+    {
+        if (size < glb_header_size + glb_chunk_header_size || readUint32(data + 4) != 2 || readUint32(data + 8) > size)
+        {
+            err = "Invalid or unsupported glb header";
+            return false;
+        }
+
+        // chunks follow the header back to back, the JSON chunk first and an optional binary chunk after it
+        const std::size_t length = readUint32(data + 8);
+        std::size_t offset = glb_header_size;
+        bool has_json = false;
+        while (offset + glb_chunk_header_size <= length)
+        {
+            const std::size_t chunk_size = readUint32(data + offset);
+            const uint32_t chunk_type = readUint32(data + offset + 4);
+            const unsigned char *chunk_data = data + offset + glb_chunk_header_size;
+            if (chunk_size > length - offset - glb_chunk_header_size)
+            {
+                err = "glb chunk reaches past the end of the file";
+                return false;
+            }
+
+            if (chunk_type == glb_chunk_json && !has_json)
+            {
+                json_begin = reinterpret_cast<const char *>(chunk_data);
+                json_end = json_begin + chunk_size;
+                has_json = true;
+            }
+            else if (chunk_type == glb_chunk_binary && has_json && !binary_chunk.data)
+            {
+                binary_chunk.data = chunk_data;
+                binary_chunk.size = chunk_size;
+            }
+
+            // chunks are 4 byte aligned
+            offset += glb_chunk_header_size + ((chunk_size + 3) & ~static_cast<std::size_t>(3));
+        }
+
+        if (!has_json)
+            err = "glb has no JSON chunk";
+        return has_json;
+    }
+}
@@ -0,0 +1,95 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "HeapAllocationCounter.h"
+
+#ifdef VV_COUNT_HEAP_ALLOCATIONS
+namespace
+{
+    // constant initialized, so it's valid for allocations made during static initialization
+    std::atomic<uint64_t> g_heap_allocation_count(0);
+
+    void* countedAllocate(std::size_t size)
+    {
+        g_heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+        // operator new has to return a unique pointer for size 0 as well
+        void *memory = std::malloc(size > 0 ? size : 1);
+        if (!memory)
+            throw std::bad_alloc();
+        return memory;
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+
+void* operator new[](std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+
+void* operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    g_heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size > 0 ? size : 1);
+}
+
+
+void* operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    g_heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size > 0 ? size : 1);
+}
+
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+
+void operator delete[](void *memory) noexcept
+{
+    std::free(memory);
+}
+
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept
+{
+    std::free(memory);
+}
+
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept
+{
+    std::free(memory);
+}
+#endif
+
+namespace vv
+{
+    uint64_t getHeapAllocationCount()
+    {
+#ifdef VV_COUNT_HEAP_ALLOCATIONS
+        return g_heap_allocation_count.load(std::memory_order_relaxed);
+#else
+        return 0;
+#endif
+    }
+
+
+    bool isHeapAllocationCountingEnabled()
+    {
+#ifdef VV_COUNT_HEAP_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+}
@@ -0,0 +1,339 @@
+#include <cstring>
+
+#include "JsonParser.h"
+#include "NumberParser.h"
+
+namespace vv
+{
+    namespace
+    {
+        // nesting deeper than this is rejected instead of overflowing the stack
+        const int max_depth = 256;
+
+        const JsonValue null_value;
+
+
+        int hexDigit(char c)
+        {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            if (c >= 'a' && c <= 'f')
+                return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F')
+                return c - 'A' + 10;
+            return -1;
+        }
+
+
+        void appendUTF8(uint32_t code_point, std::string &out)
+        {
+            if (code_point < 0x80)
+                out += static_cast<char>(code_point);
+            else if (code_point < 0x800)
+            {
+                out += static_cast<char>(0xC0 | (code_point >> 6));
+                out += static_cast<char>(0x80 | (code_point & 0x3F));
+            }
+            else if (code_point < 0x10000)
+            {
+                out += static_cast<char>(0xE0 | (code_point >> 12));
+                out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code_point & 0x3F));
+            }
+            else
+            {
+                out += static_cast<char>(0xF0 | (code_point >> 18));
+                out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code_point & 0x3F));
+            }
+        }
+    }
+
+
+    /*
+     * Recursive descent over the document. Stops at the first error.
+     */
+    class JsonValue::Reader
+    {
+    public:
+        Reader(const char *begin, const char *end)
+            : m_begin(begin), m_cursor(begin), m_end(end)
+        {
+        }
+
+        bool readDocument(JsonValue &root, std::string &err)
+        {
+            skipSpace();
+            bool success = readValue(root, 0);
+            if (success)
+            {
+                skipSpace();
+                if (m_cursor != m_end)
+                    success = fail("unexpected data after the document");
+            }
+
+            if (!success)
+                err = m_error + " at byte " + std::to_string(m_cursor - m_begin);
+            return success;
+        }
+
+    private:
+        const char *m_begin;
+        const char *m_cursor;
+        const char *m_end;
+        std::string m_error;
+
+        bool fail(const std::string &error)
+        {
+            m_error = error;
+            return false;
+        }
+
+        void skipSpace()
+        {
+            while (m_cursor < m_end && (*m_cursor == ' ' || *m_cursor == '\t' || *m_cursor == '\n' || *m_cursor == '\r'))
+                ++m_cursor;
+        }
+
+        bool consume(const char *literal)
+        {
+            std::size_t length = strlen(literal);
+            if (static_cast<std::size_t>(m_end - m_cursor) < length || memcmp(m_cursor, literal, length) != 0)
+                return false;
+            m_cursor += length;
+            return true;
+        }
+
+        bool readValue(JsonValue &value, int depth)
+        {
+            if (m_cursor == m_end)
+                return fail("unexpected end of document");
+
+            switch (*m_cursor)
+            {
+            case '{':
+                return readObject(value, depth + 1);
+            case '[':
+                return readArray(value, depth + 1);
+            case '"':
+                value.m_type = Type::String;
+                return readString(value.m_string);
+            case 't':
+            case 'f':
+                value.m_type = Type::Bool;
+                value.m_bool = (*m_cursor == 't');
+                return consume(value.m_bool ? "true" : "false") || fail("invalid literal");
+            case 'n':
+                return consume("null") || fail("invalid literal");
+            default:
+                return readNumber(value);
+            }
+        }
+
+        bool readNumber(JsonValue &value)
+        {
+            const char *number_end = parseDouble(m_cursor, m_end, value.m_number);
+            if (number_end == m_cursor || *m_cursor == '+')
+                return fail("invalid value");
+
+            value.m_type = Type::Number;
+            m_cursor = number_end;
+            return true;
+        }
+
+        bool readString(std::string &out)
+        {
+            ++m_cursor; // opening quote
+            while (true)
+            {
+                // copy runs of plain characters at once
+                const char *run = m_cursor;
+                while (m_cursor < m_end && *m_cursor != '"' && *m_cursor != '\\')
+                    ++m_cursor;
+                out.append(run, m_cursor);
+
+                if (m_cursor == m_end)
+                    return fail("unterminated string");
+
+                if (*m_cursor++ == '"')
+                    return true;
+
+                if (m_cursor == m_end)
+                    return fail("unterminated string");
+
+                char escape = *m_cursor++;
+                switch (escape)
+                {
+                case '"':  out += '"';  break;
+                case '\\': out += '\\'; break;
+                case '/':  out += '/';  break;
+                case 'b':  out += '\b'; break;
+                case 'f':  out += '\f'; break;
+                case 'n':  out += '\n'; break;
+                case 'r':  out += '\r'; break;
+                case 't':  out += '\t'; break;
+                case 'u':
+                {
+                    uint32_t code_point = 0;
+                    if (!readCodeUnit(code_point))
+                        return false;
+
+                    // characters outside the basic plane are escaped as a surrogate pair
+                    if (code_point >= 0xD800 && code_point < 0xDC00)
+                    {
+                        uint32_t low = 0;
+                        if (!consume("\\u") || !readCodeUnit(low) || low < 0xDC00 || low >= 0xE000)
+                            return fail("invalid surrogate pair");
+                        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUTF8(code_point, out);
+                    break;
+                }
+                default:
+                    return fail("invalid escape sequence");
+                }
+            }
+        }
+
+        bool readCodeUnit(uint32_t &code_unit)
+        {
+            if (m_end - m_cursor < 4)
+                return fail("invalid unicode escape");
+
+            for (int i = 0; i < 4; ++i)
+            {
+                int digit = hexDigit(*m_cursor++);
+                if (digit < 0)
+                    return fail("invalid unicode escape");
+                code_unit = (code_unit << 4) | static_cast<uint32_t>(digit);
+            }
+            return true;
+        }
+
+        bool readArray(JsonValue &value, int depth)
+        {
+            if (depth > max_depth)
+                return fail("nesting too deep");
+
+            value.m_type = Type::Array;
+            ++m_cursor;
+            skipSpace();
+            if (m_cursor < m_end && *m_cursor == ']')
+            {
+                ++m_cursor;
+                return true;
+            }
+
+            while (true)
+            {
+                value.m_values.push_back(JsonValue());
+                if (!readValue(value.m_values.back(), depth))
+                    return false;
+
+                skipSpace();
+                if (m_cursor == m_end)
+                    return fail("unterminated array");
+                if (*m_cursor == ']')
+                {
+                    ++m_cursor;
+                    return true;
+                }
+                if (*m_cursor++ != ',')
+                    return fail("expected ',' or ']'");
+                skipSpace();
+            }
+        }
+
+        bool readObject(JsonValue &value, int depth)
+        {
+            if (depth > max_depth)
+                return fail("nesting too deep");
+
+            value.m_type = Type::Object;
+            ++m_cursor;
+            skipSpace();
+            if (m_cursor < m_end && *m_cursor == '}')
+            {
+                ++m_cursor;
+                return true;
+            }
+
+            while (true)
+            {
+                if (m_cursor == m_end || *m_cursor != '"')
+                    return fail("expected member name");
+
+                value.m_keys.push_back(std::string());
+                if (!readString(value.m_keys.back()))
+                    return false;
+
+                skipSpace();
+                if (m_cursor == m_end || *m_cursor++ != ':')
+                    return fail("expected ':'");
+                skipSpace();
+
+                value.m_values.push_back(JsonValue());
+                if (!readValue(value.m_values.back(), depth))
+                    return false;
+
+                skipSpace();
+                if (m_cursor == m_end)
+                    return fail("unterminated object");
+                if (*m_cursor == '}')
+                {
+                    ++m_cursor;
+                    return true;
+                }
+                if (*m_cursor++ != ',')
+                    return fail("expected ',' or '}'");
+                skipSpace();
+            }
+        }
+    };
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Public
+    bool JsonValue::parse(const char *begin, const char *end, JsonValue &root, std::string &err)
+    {
+        root = JsonValue();
+        Reader reader(begin, end);
+        if (reader.readDocument(root, err))
+            return true;
+
+        root = JsonValue();
+        return false;
+    }
+
+
+    const JsonValue& JsonValue::operator[](std::size_t i) const
+    {
+        if (m_type != Type::Array || i >= m_values.size())
+            return null_value;
+        return m_values[i];
+    }
+
+
+    const JsonValue& JsonValue::operator[](const std::string &key) const
+    {
+        if (m_type == Type::Object)
+        {
+            for (std::size_t i = 0; i < m_keys.size(); ++i)
+                if (m_keys[i] == key)
+                    return m_values[i];
+        }
+        return null_value;
+    }
+
+
+    bool JsonValue::has(const std::string &key) const
+    {
+        if (m_type == Type::Object)
+        {
+            for (const auto &k : m_keys)
+                if (k == key)
+                    return true;
+        }
+        return false;
+    }
+}
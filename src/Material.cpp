@@ -1,5 +1,6 @@
 
 #include "Material.h"
+#include "DeletionQueue.h"
 
 namespace vv
 {
@@ -14,22 +15,14 @@ namespace vv
     }
 
 
-    void Material::create(VulkanDevice *device, MaterialTemplate *material_template, VkDescriptorPool descriptor_pool)
+    void Material::create(VulkanDevice *device, MaterialTemplate *material_template)
     {
         this->material_template = material_template;
         m_device = device;
 
         // certain material templates don't take descriptor sets
         if (material_template->material_descriptor_set_layout)
-        {
-            VkDescriptorSetAllocateInfo alloc_info = {};
-            alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-            alloc_info.descriptorPool = descriptor_pool;
-            alloc_info.descriptorSetCount = 1;
-            alloc_info.pSetLayouts = &material_template->material_descriptor_set_layout;
-
-            VV_CHECK_SUCCESS(vkAllocateDescriptorSets(device->logical_device, &alloc_info, &m_descriptor_set));
-        }
+            m_descriptor_set = m_device->descriptor_allocator->allocate(material_template->material_descriptor_set_layout);
     }
 
 
@@ -42,6 +35,35 @@ namespace vv
             delete ubo;
         }
 
+        m_device->descriptor_allocator->free(m_descriptor_set);
+        m_descriptor_set = DescriptorAllocation();
+
+        m_uniform_buffers.clear();
+        m_textures.clear();
+        m_write_sets.clear();
+    }
+
+
+    void Material::shutDownDeferred()
+    {
+        for (auto &ubo : m_uniform_buffers)
+        {
+            ubo->buffer->shutDownDeferred();
+            delete ubo->buffer;
+            delete ubo;
+        }
+
+        if (m_descriptor_set.set != VK_NULL_HANDLE)
+        {
+            DescriptorAllocator *descriptor_allocator = m_device->descriptor_allocator;
+            DescriptorAllocation descriptor_set = m_descriptor_set;
+            m_device->deletion_queue->push([=]() { descriptor_allocator->free(descriptor_set); });
+            m_descriptor_set = DescriptorAllocation();
+        }
+
+        for (auto &texture : m_textures)
+            delete texture;
+
         m_uniform_buffers.clear();
         m_textures.clear();
         m_write_sets.clear();
@@ -65,7 +87,7 @@ namespace vv
         VkWriteDescriptorSet write_set = {};
 
         write_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    	write_set.dstSet = m_descriptor_set;
+    	write_set.dstSet = m_descriptor_set.set;
     	write_set.dstBinding = binding;
     	write_set.dstArrayElement = 0;
     	write_set.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
@@ -92,7 +114,7 @@ namespace vv
 
         VkWriteDescriptorSet write_set = {};
         write_set.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    	write_set.dstSet          = m_descriptor_set;
+    	write_set.dstSet          = m_descriptor_set.set;
     	write_set.dstBinding      = binding;
     	write_set.dstArrayElement = 0;
     	write_set.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -114,10 +136,45 @@ namespace vv
         if (material_template->material_descriptor_set_layout)
         {
             vkCmdBindDescriptorSets(command_buffer, pipeline_bind_point, material_template->pipeline_layout, 1,
-                1, &m_descriptor_set, 0, nullptr);
+                1, &m_descriptor_set.set, 0, nullptr);
         }
     }
 
 
+    void Material::markTexturesUsed(uint64_t frame) const
+    {
+        for (auto &texture : m_textures)
+            texture->texture->last_used_frame = frame;
+    }
+
+
+    bool Material::refreshTextureDescriptors()
+    {
+        bool changed = false;
+        for (auto &texture : m_textures)
+        {
+            if (texture->info.imageView != texture->texture->image_view->image_view)
+            {
+                texture->info.imageView = texture->texture->image_view->image_view;
+                changed = true;
+            }
+        }
+
+        if (!changed || m_descriptor_set.set == VK_NULL_HANDLE)
+            return changed;
+
+        DescriptorAllocator *descriptor_allocator = m_device->descriptor_allocator;
+        DescriptorAllocation old_descriptor_set = m_descriptor_set;
+        m_device->deletion_queue->push([=]() { descriptor_allocator->free(old_descriptor_set); });
+
+        m_descriptor_set = descriptor_allocator->allocate(material_template->material_descriptor_set_layout);
+        for (auto &write_set : m_write_sets)
+            write_set.dstSet = m_descriptor_set.set;
+        updateDescriptorSets();
+
+        return true;
+    }
+
+
     ///////////////////////////////////////////////////////////////////////////////////////////// Private
 }
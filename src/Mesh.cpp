@@ -1,5 +1,9 @@
 
+#include <limits>
+#include <utility>
+
 #include "Mesh.h"
+#include "MemoryTracker.h"
 
 namespace vv
 {
@@ -14,43 +18,168 @@ namespace vv
 	}
 
 
-	void Mesh::create(VulkanDevice *device, std::string name, std::vector<Vertex> vertices, std::vector<uint32_t> indices, int material_id)
+	void Mesh::create(VulkanDevice *device, std::string name, std::vector<Vertex> vertices, std::vector<uint32_t> indices, int material_id,
+                      CPUResidency residency, GeometrySource source)
 	{
-        m_vertices = vertices;
-        m_indices = indices;
+        VV_ASSERT(residency == CPUResidency::Keep || source, "Mesh " + name + " can't release its CPU copy without a source to re-read it from");
+
+        m_vertices = std::move(vertices);
+        m_indices = std::move(indices);
         m_name = name;
         this->material_id = material_id;
+        m_source = source;
+
+        bounds_min = glm::vec3(std::numeric_limits<float>::max());
+        bounds_max = glm::vec3(-std::numeric_limits<float>::max());
+        for (const auto &vertex : m_vertices)
+        {
+            bounds_min = glm::min(bounds_min, vertex.position);
+            bounds_max = glm::max(bounds_max, vertex.position);
+        }
+
+        m_device = device;
+        m_geometry = m_device->geometry_arena->allocate(m_vertices, m_indices);
+
+        m_cpu_data_resident = true;
+        m_release_pending = (residency == CPUResidency::ReleaseAfterUpload) && m_source;
+        m_device->memory_tracker->addCPUCopy(MemoryCategory::Geometry, getCPUDataSize());
+	}
 
-        m_vertex_buffer.create(device, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(m_vertices[0]) * m_vertices.size());
-		m_vertex_buffer.updateAndTransfer(m_vertices.data());
 
-		m_index_buffer.create(device, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, sizeof(m_indices[0]) * m_indices.size());
-		m_index_buffer.updateAndTransfer(m_indices.data());
-	}
+    void Mesh::create(VulkanDevice *device, std::string name, const Vertex *vertices, uint32_t vertex_count, const uint32_t *indices,
+                      uint32_t index_count, int material_id, const glm::vec3 &bounds_min, const glm::vec3 &bounds_max,
+                      CPUResidency residency, GeometrySource source)
+    {
+        VV_ASSERT(residency == CPUResidency::Keep || source, "Mesh " + name + " can't release its CPU copy without a source to re-read it from");
+
+        m_name = name;
+        this->material_id = material_id;
+        this->bounds_min = bounds_min;
+        this->bounds_max = bounds_max;
+        m_source = source;
+
+        m_device = device;
+        m_geometry = m_device->geometry_arena->allocate(vertices, vertex_count, indices, index_count);
+
+        // the staging memory already holds its own copy, so a released mesh never needs one
+        m_release_pending = false;
+        m_cpu_data_resident = (residency == CPUResidency::Keep) || !m_source;
+        if (m_cpu_data_resident)
+        {
+            m_vertices.assign(vertices, vertices + vertex_count);
+            m_indices.assign(indices, indices + index_count);
+            m_device->memory_tracker->addCPUCopy(MemoryCategory::Geometry, getCPUDataSize());
+        }
+    }
 
 
 	void Mesh::shutDown()
 	{
-        m_vertex_buffer.shutDown();
-        m_index_buffer.shutDown();
-        m_vertices.clear();
-        m_indices.clear();
+        if (m_geometry != GeometryArena::invalid_handle)
+            m_device->geometry_arena->free(m_geometry);
+        m_geometry = GeometryArena::invalid_handle;
+        freeCPUData(false);
 	}
 
 
-    void Mesh::bindBuffers(VkCommandBuffer command_buffer)
+    void Mesh::shutDownDeferred()
+    {
+        if (m_geometry != GeometryArena::invalid_handle)
+            m_device->geometry_arena->freeDeferred(m_geometry);
+        m_geometry = GeometryArena::invalid_handle;
+        freeCPUData(false);
+    }
+
+
+    void Mesh::bindBuffers(VkCommandBuffer command_buffer) const
+    {
+        m_device->geometry_arena->bindPage(command_buffer, getGeometryPage());
+    }
+
+
+    uint32_t Mesh::getGeometryPage() const
+    {
+        return m_device->geometry_arena->get(m_geometry).page;
+    }
+
+
+    void Mesh::render(VkCommandBuffer command_buffer) const
+    {
+        const GeometryRange &range = m_device->geometry_arena->get(m_geometry);
+        vkCmdDrawIndexed(command_buffer, range.index_count, 1, range.first_index, range.vertex_offset, 0);
+    }
+
+
+    bool Mesh::updateResidency()
+    {
+        if (!m_release_pending)
+            return true;
+
+        if (!m_device->geometry_arena->isUploaded(m_geometry))
+            return false;
+
+        freeCPUData(true);
+        return true;
+    }
+
+
+    const std::vector<Vertex>& Mesh::getVertices()
+    {
+        makeCPUDataResident();
+        return m_vertices;
+    }
+
+
+    const std::vector<uint32_t>& Mesh::getIndices()
+    {
+        makeCPUDataResident();
+        return m_indices;
+    }
+
+
+    void Mesh::releaseCPUData()
     {
-        std::array<VkDeviceSize, 1> offsets = { 0 };
-        vkCmdBindVertexBuffers(command_buffer, 0, 1, &m_vertex_buffer.buffer, offsets.data());
-        vkCmdBindIndexBuffer(command_buffer, m_index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+        VV_ASSERT(m_source, "Mesh " + m_name + " has no source to re-read its geometry from");
+        if (m_source)
+            freeCPUData(true);
     }
 
 
-    void Mesh::render(VkCommandBuffer command_buffer)
+    bool Mesh::isCPUDataResident() const
     {
-        vkCmdDrawIndexed(command_buffer, (uint32_t)m_indices.size(), 1, 0, 0, 0);
+        return m_cpu_data_resident;
     }
 
 
 	///////////////////////////////////////////////////////////////////////////////////////////// Private
+    void Mesh::makeCPUDataResident()
+    {
+        if (m_cpu_data_resident)
+            return;
+
+        m_source(m_vertices, m_indices);
+        m_cpu_data_resident = true;
+        m_device->memory_tracker->addCPUCopy(MemoryCategory::Geometry, getCPUDataSize());
+    }
+
+
+    void Mesh::freeCPUData(bool released)
+    {
+        m_release_pending = false;
+        if (!m_cpu_data_resident)
+            return;
+
+        m_device->memory_tracker->removeCPUCopy(MemoryCategory::Geometry, getCPUDataSize(), released);
+        m_cpu_data_resident = false;
+
+        // clear() keeps the capacity around
+        std::vector<Vertex>().swap(m_vertices);
+        std::vector<uint32_t>().swap(m_indices);
+    }
+
+
+    VkDeviceSize Mesh::getCPUDataSize() const
+    {
+        return m_vertices.size() * sizeof(Vertex) + m_indices.size() * sizeof(uint32_t);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,431 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #include <direct.h>
+#endif
+
+#include "MeshCache.h"
+#include "Settings.h"
+#include "Profiler.h"
+
+namespace vv
+{
+    namespace
+    {
+        const uint32_t cache_magic = 0x534D5656; // "VVMS"
+        const uint32_t cache_format_version = 2;
+
+        // identifies the version of a file a cache was written from. seconds are as precise as mtime gets everywhere.
+        struct FileStamp
+        {
+            uint64_t size     = 0;
+            int64_t modified  = 0;
+        };
+
+        struct CacheStatsRecord
+        {
+            uint64_t misses         = 0;
+            uint64_t triangle_count = 0;
+            uint64_t vertex_count   = 0;
+        };
+
+        struct FileHeader
+        {
+            uint32_t magic            = 0;
+            uint32_t format_version   = 0;
+            uint32_t importer_version = 0;
+            uint32_t vertex_size      = 0;  // guards against changes to the Vertex layout
+            uint64_t file_size        = 0;
+            FileStamp source;
+            uint32_t path_offset      = 0;  // source path in the string table, to rule out hash collisions
+            uint32_t path_length      = 0;
+            uint32_t submesh_count    = 0;
+            uint32_t library_count    = 0;
+            uint64_t submesh_offset   = 0;
+            uint64_t library_offset   = 0;
+            uint64_t string_offset    = 0;
+            uint64_t string_size      = 0;
+            uint64_t vertex_offset    = 0;
+            uint64_t vertex_count     = 0;
+            uint64_t index_offset     = 0;
+            uint64_t index_count      = 0;
+            uint32_t optimized_meshes = 0;  // vertex cache stats of the import, so warm loads can report them
+            uint32_t padding          = 0;
+            CacheStatsRecord cache_before;
+            CacheStatsRecord cache_after;
+        };
+
+        struct SubmeshRecord
+        {
+            uint32_t name_offset  = 0;
+            uint32_t name_length  = 0;
+            int32_t material_id   = 0;
+            uint32_t vertex_count = 0;
+            uint64_t first_vertex = 0;
+            uint64_t first_index  = 0;
+            uint32_t index_count  = 0;
+            uint32_t padding      = 0;
+            float bounds_min[3];
+            float bounds_max[3];
+        };
+
+        struct LibraryRecord
+        {
+            uint32_t name_offset = 0;
+            uint32_t name_length = 0;
+            FileStamp stamp;
+        };
+
+        // vertex data is aligned for whatever the staging copy prefers. mappings start on a page boundary.
+        const uint64_t data_alignment = 16;
+
+
+        uint64_t alignOffset(uint64_t offset, uint64_t alignment)
+        {
+            return (offset + alignment - 1) / alignment * alignment;
+        }
+
+
+        bool getFileStamp(const std::string &path, FileStamp &stamp)
+        {
+#ifdef _WIN32
+            struct __stat64 file_stat;
+            if (_stat64(path.c_str(), &file_stat) != 0)
+                return false;
+#else
+            struct stat file_stat;
+            if (stat(path.c_str(), &file_stat) != 0)
+                return false;
+#endif
+            stamp.size = static_cast<uint64_t>(file_stat.st_size);
+            stamp.modified = static_cast<int64_t>(file_stat.st_mtime);
+            return true;
+        }
+
+
+        bool sameStamp(const FileStamp &a, const FileStamp &b)
+        {
+            return a.size == b.size && a.modified == b.modified;
+        }
+
+
+        /*
+         * FNV-1a. Only used to name cache files, the full path is compared on load.
+         */
+        uint64_t hashPath(const std::string &path)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            for (unsigned char c : path)
+            {
+                hash ^= c;
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
+
+        std::string getDirectory(const std::string &path)
+        {
+            auto separator = path.find_last_of("/\\");
+            return (separator == std::string::npos) ? std::string() : path.substr(0, separator + 1);
+        }
+
+
+        void makeDirectory(const std::string &path)
+        {
+            // an existing directory is fine, anything else shows up when the file is opened
+#ifdef _WIN32
+            _mkdir(path.c_str());
+#else
+            mkdir(path.c_str(), 0755);
+#endif
+        }
+
+
+        /*
+         * Appends str to the string table and returns its location.
+         */
+        void addString(std::string &table, const std::string &str, uint32_t &offset, uint32_t &length)
+        {
+            offset = static_cast<uint32_t>(table.size());
+            length = static_cast<uint32_t>(str.size());
+            table += str;
+        }
+
+
+        CacheStatsRecord toRecord(const VertexCacheStats &stats)
+        {
+            CacheStatsRecord record;
+            record.misses = stats.misses;
+            record.triangle_count = stats.triangle_count;
+            record.vertex_count = stats.vertex_count;
+            return record;
+        }
+
+
+        VertexCacheStats fromRecord(const CacheStatsRecord &record)
+        {
+            VertexCacheStats stats;
+            stats.misses = record.misses;
+            stats.triangle_count = record.triangle_count;
+            stats.vertex_count = record.vertex_count;
+            return stats;
+        }
+
+
+        bool inFile(uint64_t offset, uint64_t size, uint64_t file_size)
+        {
+            return offset <= file_size && size <= file_size - offset;
+        }
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Public
+	bool MeshCache::create(const std::string &source_path, uint32_t importer_version)
+	{
+        VV_PROFILE_FUNCTION();
+        std::string cache_path = getCachePath(source_path);
+        if (cache_path.empty() || !m_file.create(cache_path))
+            return false;
+
+        if (!readMappedFile(source_path, importer_version))
+        {
+            shutDown();
+            return false;
+        }
+
+        return true;
+	}
+
+
+	void MeshCache::shutDown()
+	{
+        m_file.shutDown();
+        m_submeshes.clear();
+        m_material_libraries.clear();
+        m_optimization_stats = MeshOptimizationStats();
+	}
+
+
+    void MeshCache::write(const std::string &source_path, uint32_t importer_version, const std::vector<MeshCacheSubmesh> &submeshes,
+                          const std::vector<std::string> &material_libraries, const MeshOptimizationStats &optimization_stats)
+    {
+        VV_PROFILE_FUNCTION();
+        std::string cache_path = getCachePath(source_path);
+        if (cache_path.empty())
+            return;
+
+        FileHeader header;
+        header.magic = cache_magic;
+        header.format_version = cache_format_version;
+        header.importer_version = importer_version;
+        header.vertex_size = sizeof(Vertex);
+        header.submesh_count = static_cast<uint32_t>(submeshes.size());
+        header.library_count = static_cast<uint32_t>(material_libraries.size());
+        header.optimized_meshes = optimization_stats.mesh_count;
+        header.cache_before = toRecord(optimization_stats.before);
+        header.cache_after = toRecord(optimization_stats.after);
+        if (!getFileStamp(source_path, header.source))
+            return;
+
+        std::string strings;
+        addString(strings, source_path, header.path_offset, header.path_length);
+
+        std::vector<SubmeshRecord> submesh_records(submeshes.size());
+        for (std::size_t i = 0; i < submeshes.size(); ++i)
+        {
+            const MeshCacheSubmesh &submesh = submeshes[i];
+            SubmeshRecord &record = submesh_records[i];
+            addString(strings, submesh.name, record.name_offset, record.name_length);
+            record.material_id = submesh.material_id;
+            record.vertex_count = submesh.vertex_count;
+            record.first_vertex = header.vertex_count;
+            record.index_count = submesh.index_count;
+            record.first_index = header.index_count;
+            memcpy(record.bounds_min, &submesh.bounds_min[0], sizeof(record.bounds_min));
+            memcpy(record.bounds_max, &submesh.bounds_max[0], sizeof(record.bounds_max));
+
+            header.vertex_count += submesh.vertex_count;
+            header.index_count += submesh.index_count;
+        }
+
+        // libraries are stamped too, material ids index into the materials in the order they declare them
+        std::string source_directory = getDirectory(source_path);
+        std::vector<LibraryRecord> library_records(material_libraries.size());
+        for (std::size_t i = 0; i < material_libraries.size(); ++i)
+        {
+            addString(strings, material_libraries[i], library_records[i].name_offset, library_records[i].name_length);
+            getFileStamp(source_directory + material_libraries[i], library_records[i].stamp);
+        }
+
+        header.submesh_offset = alignOffset(sizeof(FileHeader), 8);
+        header.library_offset = alignOffset(header.submesh_offset + sizeof(SubmeshRecord) * submesh_records.size(), 8);
+        header.string_offset = header.library_offset + sizeof(LibraryRecord) * library_records.size();
+        header.string_size = strings.size();
+        header.vertex_offset = alignOffset(header.string_offset + header.string_size, data_alignment);
+        header.index_offset = alignOffset(header.vertex_offset + sizeof(Vertex) * header.vertex_count, data_alignment);
+        header.file_size = header.index_offset + sizeof(uint32_t) * header.index_count;
+
+        makeDirectory(Settings::inst()->getMeshCacheDirectory());
+
+        // written under a temporary name so an interrupted write never leaves a cache that looks valid
+        std::string temp_path = cache_path + ".tmp";
+        {
+            std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                std::cout << "Could not open mesh cache " << temp_path << " for writing" << std::endl;
+                return;
+            }
+
+            auto pad_to = [&file](uint64_t offset)
+            {
+                static const char zeros[data_alignment] = {};
+                uint64_t position = static_cast<uint64_t>(file.tellp());
+                if (offset > position)
+                    file.write(zeros, static_cast<std::streamsize>(offset - position));
+            };
+
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            pad_to(header.submesh_offset);
+            file.write(reinterpret_cast<const char *>(submesh_records.data()), sizeof(SubmeshRecord) * submesh_records.size());
+            pad_to(header.library_offset);
+            file.write(reinterpret_cast<const char *>(library_records.data()), sizeof(LibraryRecord) * library_records.size());
+            file.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+
+            pad_to(header.vertex_offset);
+            for (const auto &submesh : submeshes)
+                file.write(reinterpret_cast<const char *>(submesh.vertices), sizeof(Vertex) * submesh.vertex_count);
+
+            pad_to(header.index_offset);
+            for (const auto &submesh : submeshes)
+                file.write(reinterpret_cast<const char *>(submesh.indices), sizeof(uint32_t) * submesh.index_count);
+
+            if (!file.good())
+            {
+                file.close();
+                std::remove(temp_path.c_str());
+                std::cout << "Could not write mesh cache " << temp_path << std::endl;
+                return;
+            }
+        }
+
+        // rename doesn't replace existing files on windows
+        std::remove(cache_path.c_str());
+        if (std::rename(temp_path.c_str(), cache_path.c_str()) != 0)
+        {
+            std::remove(temp_path.c_str());
+            std::cout << "Could not move mesh cache into place at " << cache_path << std::endl;
+        }
+    }
+
+
+    std::string MeshCache::getCachePath(const std::string &source_path)
+    {
+        std::string directory = Settings::inst()->getMeshCacheDirectory();
+        if (directory.empty())
+            return std::string();
+
+        // the file name keeps the source's name for humans, the hash tells sources with the same name apart
+        std::string name = source_path.substr(getDirectory(source_path).size());
+        std::ostringstream stream;
+        stream << directory << name << "." << std::hex << std::setw(16) << std::setfill('0') << hashPath(source_path) << ".vvmesh";
+        return stream.str();
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Private
+    bool MeshCache::readMappedFile(const std::string &source_path, uint32_t importer_version)
+    {
+        const unsigned char *data = m_file.getData();
+        const uint64_t file_size = m_file.getSize();
+        if (file_size < sizeof(FileHeader))
+            return false;
+
+        FileHeader header;
+        memcpy(&header, data, sizeof(header));
+        if (header.magic != cache_magic || header.format_version != cache_format_version || header.importer_version != importer_version ||
+            header.vertex_size != sizeof(Vertex) || header.file_size != file_size)
+            return false;
+
+        FileStamp source_stamp;
+        if (!getFileStamp(source_path, source_stamp) || !sameStamp(source_stamp, header.source))
+            return false;
+
+        if (!inFile(header.submesh_offset, sizeof(SubmeshRecord) * static_cast<uint64_t>(header.submesh_count), file_size) ||
+            !inFile(header.library_offset, sizeof(LibraryRecord) * static_cast<uint64_t>(header.library_count), file_size) ||
+            !inFile(header.string_offset, header.string_size, file_size) ||
+            !inFile(header.vertex_offset, sizeof(Vertex) * header.vertex_count, file_size) ||
+            !inFile(header.index_offset, sizeof(uint32_t) * header.index_count, file_size) ||
+            header.vertex_offset % data_alignment != 0 || header.index_offset % data_alignment != 0)
+            return false;
+
+        const char *strings = reinterpret_cast<const char *>(data + header.string_offset);
+        auto get_string = [&header, strings](uint32_t offset, uint32_t length, std::string &str)
+        {
+            if (static_cast<uint64_t>(offset) + length > header.string_size)
+                return false;
+            str.assign(strings + offset, length);
+            return true;
+        };
+
+        std::string cached_path;
+        if (!get_string(header.path_offset, header.path_length, cached_path) || cached_path != source_path)
+            return false;
+
+        std::string source_directory = getDirectory(source_path);
+        const unsigned char *library_data = data + header.library_offset;
+        for (uint32_t i = 0; i < header.library_count; ++i)
+        {
+            LibraryRecord record;
+            memcpy(&record, library_data + sizeof(LibraryRecord) * i, sizeof(record));
+
+            std::string library;
+            FileStamp library_stamp;
+            if (!get_string(record.name_offset, record.name_length, library))
+                return false;
+            getFileStamp(source_directory + library, library_stamp);
+            if (!sameStamp(library_stamp, record.stamp))
+                return false;
+
+            m_material_libraries.push_back(library);
+        }
+
+        m_optimization_stats.mesh_count = header.optimized_meshes;
+        m_optimization_stats.before = fromRecord(header.cache_before);
+        m_optimization_stats.after = fromRecord(header.cache_after);
+        m_optimization_stats.cached = true;
+
+        const Vertex *vertices = reinterpret_cast<const Vertex *>(data + header.vertex_offset);
+        const uint32_t *indices = reinterpret_cast<const uint32_t *>(data + header.index_offset);
+        const unsigned char *submesh_data = data + header.submesh_offset;
+        m_submeshes.resize(header.submesh_count);
+        for (uint32_t i = 0; i < header.submesh_count; ++i)
+        {
+            SubmeshRecord record;
+            memcpy(&record, submesh_data + sizeof(SubmeshRecord) * i, sizeof(record));
+
+            if (record.first_vertex + record.vertex_count > header.vertex_count || record.first_index + record.index_count > header.index_count)
+                return false;
+
+            MeshCacheSubmesh &submesh = m_submeshes[i];
+            if (!get_string(record.name_offset, record.name_length, submesh.name))
+                return false;
+            submesh.material_id = record.material_id;
+            submesh.vertices = vertices + record.first_vertex;
+            submesh.vertex_count = record.vertex_count;
+            submesh.indices = indices + record.first_index;
+            submesh.index_count = record.index_count;
+            submesh.bounds_min = glm::vec3(record.bounds_min[0], record.bounds_min[1], record.bounds_min[2]);
+            submesh.bounds_max = glm::vec3(record.bounds_max[0], record.bounds_max[1], record.bounds_max[2]);
+        }
+
+        return true;
+    }
+}
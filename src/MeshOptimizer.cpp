@@ -0,0 +1,316 @@
+#include <algorithm>
+
+#include "MeshOptimizer.h"
+#include "Profiler.h"
+
+namespace vv
+{
+    namespace
+    {
+        const uint32_t no_vertex = ~0u;
+
+
+        /*
+         * Triangles around every vertex, as one array indexed through per vertex offsets.
+         */
+        struct TriangleAdjacency
+        {
+            std::vector<uint32_t> offsets;   // vertex_count + 1 entries
+            std::vector<uint32_t> triangles;
+
+            void create(const std::vector<uint32_t> &indices, std::size_t vertex_count)
+            {
+                offsets.assign(vertex_count + 1, 0);
+                for (uint32_t index : indices)
+                    ++offsets[index + 1];
+                for (std::size_t v = 0; v < vertex_count; ++v)
+                    offsets[v + 1] += offsets[v];
+
+                std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+                triangles.resize(indices.size());
+                for (std::size_t i = 0; i < indices.size(); ++i)
+                    triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        };
+
+
+        /*
+         * Next vertex to fan from once the candidates are exhausted: the most recently used vertex that still has
+         * triangles left, or failing that the next one in input order.
+         */
+        uint32_t skipDeadEnd(std::vector<uint32_t> &dead_end, const std::vector<uint32_t> &live, uint32_t &cursor)
+        {
+            while (!dead_end.empty())
+            {
+                uint32_t v = dead_end.back();
+                dead_end.pop_back();
+                if (live[v] > 0)
+                    return v;
+            }
+
+            for (; cursor < live.size(); ++cursor)
+                if (live[cursor] > 0)
+                    return cursor;
+            return no_vertex;
+        }
+
+
+        /*
+         * Vertex of the last emitted fan to continue from. Prefers the oldest vertex that stays in the cache while all
+         * of its remaining triangles are emitted, so vertices are used up before they are evicted.
+         */
+        uint32_t getNextVertex(const std::vector<uint32_t> &candidates, const std::vector<uint32_t> &live,
+                               const std::vector<uint32_t> &cache_time, uint32_t time)
+        {
+            uint32_t best = no_vertex;
+            int best_priority = -1;
+            for (uint32_t v : candidates)
+            {
+                if (live[v] == 0)
+                    continue;
+
+                int priority = 0;
+                if (time - cache_time[v] + 2 * live[v] <= vertex_cache_size)
+                    priority = static_cast<int>(time - cache_time[v]);
+                if (priority > best_priority)
+                {
+                    best_priority = priority;
+                    best = v;
+                }
+            }
+            return best;
+        }
+    }
+
+
+    VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, std::size_t vertex_count)
+    {
+        VertexCacheStats stats;
+        stats.triangle_count = indices.size() / 3;
+
+        // a vertex is cached while fewer than vertex_cache_size misses happened since its own
+        std::vector<uint32_t> cache_time(vertex_count, 0);
+        std::vector<bool> referenced(vertex_count, false);
+        uint32_t time = vertex_cache_size + 1;
+        for (uint32_t index : indices)
+        {
+            if (time - cache_time[index] > vertex_cache_size)
+            {
+                cache_time[index] = time++;
+                ++stats.misses;
+            }
+            if (!referenced[index])
+            {
+                referenced[index] = true;
+                ++stats.vertex_count;
+            }
+        }
+        return stats;
+    }
+
+
+    void optimizeVertexCache(std::vector<uint32_t> &indices, std::size_t vertex_count, std::vector<std::size_t> *clusters)
+    {
+        VV_PROFILE_FUNCTION();
+        if (clusters)
+            clusters->clear();
+
+        const std::size_t triangle_count = indices.size() / 3;
+        if (triangle_count == 0)
+            return;
+
+        TriangleAdjacency adjacency;
+        adjacency.create(indices, vertex_count);
+
+        std::vector<uint32_t> live(vertex_count);
+        for (std::size_t v = 0; v < vertex_count; ++v)
+            live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+        std::vector<uint32_t> cache_time(vertex_count, 0);
+        std::vector<bool> emitted(triangle_count, false);
+        std::vector<uint32_t> dead_end;
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+
+        uint32_t time = vertex_cache_size + 1;
+        uint32_t cursor = 0;
+        uint32_t fan = skipDeadEnd(dead_end, live, cursor);
+        bool cold = true;
+
+        while (fan != no_vertex)
+        {
+            if (cold && clusters)
+                clusters->push_back(output.size());
+
+            // emit every remaining triangle around the fanning vertex
+            candidates.clear();
+            for (uint32_t a = adjacency.offsets[fan]; a < adjacency.offsets[fan + 1]; ++a)
+            {
+                const uint32_t t = adjacency.triangles[a];
+                if (emitted[t])
+                    continue;
+                emitted[t] = true;
+
+                for (int c = 0; c < 3; ++c)
+                {
+                    const uint32_t v = indices[3 * t + c];
+                    output.push_back(v);
+                    dead_end.push_back(v);
+                    candidates.push_back(v);
+                    --live[v];
+                    if (time - cache_time[v] > vertex_cache_size)
+                        cache_time[v] = time++;
+                }
+            }
+
+            fan = getNextVertex(candidates, live, cache_time, time);
+            cold = (fan == no_vertex);
+            if (cold)
+                fan = skipDeadEnd(dead_end, live, cursor);
+        }
+
+        indices.swap(output);
+    }
+
+
+    void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices, const std::vector<std::size_t> &clusters,
+                          float threshold)
+    {
+        VV_PROFILE_FUNCTION();
+        const std::size_t triangle_count = indices.size() / 3;
+        if (triangle_count == 0 || clusters.empty())
+            return;
+
+        const double max_acmr = threshold * analyzeVertexCache(indices, vertices.size()).getACMR();
+
+        // split every cluster wherever the triangles so far would be as cache friendly on their own, starting cold
+        std::vector<std::size_t> starts;
+        std::vector<uint32_t> cache_time(vertices.size(), 0);
+        uint32_t time = vertex_cache_size + 1;
+        for (std::size_t c = 0; c < clusters.size(); ++c)
+        {
+            const std::size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : indices.size();
+            std::size_t start = clusters[c];
+            uint64_t misses = 0;
+            starts.push_back(start);
+
+            for (std::size_t i = start; i < end; i += 3)
+            {
+                for (std::size_t k = i; k < i + 3; ++k)
+                {
+                    if (time - cache_time[indices[k]] > vertex_cache_size)
+                    {
+                        cache_time[indices[k]] = time++;
+                        ++misses;
+                    }
+                }
+
+                const std::size_t next = i + 3;
+                if (next < end && misses <= max_acmr * ((next - start) / 3))
+                {
+                    start = next;
+                    misses = 0;
+                    starts.push_back(start);
+                    time += vertex_cache_size + 1; // flush
+                }
+            }
+            time += vertex_cache_size + 1;
+        }
+
+        // area weighted centroids and normals of the clusters and the whole mesh
+        struct Cluster
+        {
+            std::size_t begin;
+            std::size_t end;
+            float sort_key;
+        };
+
+        std::vector<Cluster> sorted(starts.size());
+        std::vector<glm::vec3> centroids(starts.size());
+        std::vector<glm::vec3> normals(starts.size());
+        glm::vec3 mesh_centroid(0.0f);
+        float mesh_area = 0.0f;
+
+        for (std::size_t c = 0; c < starts.size(); ++c)
+        {
+            sorted[c].begin = starts[c];
+            sorted[c].end = (c + 1 < starts.size()) ? starts[c + 1] : indices.size();
+
+            glm::vec3 centroid(0.0f);
+            glm::vec3 normal(0.0f);
+            float area = 0.0f;
+            for (std::size_t i = sorted[c].begin; i < sorted[c].end; i += 3)
+            {
+                const glm::vec3 &p0 = vertices[indices[i + 0]].position;
+                const glm::vec3 &p1 = vertices[indices[i + 1]].position;
+                const glm::vec3 &p2 = vertices[indices[i + 2]].position;
+                const glm::vec3 weighted_normal = glm::cross(p1 - p0, p2 - p0);
+                const float triangle_area = glm::length(weighted_normal);
+
+                centroid += (p0 + p1 + p2) * (triangle_area / 3.0f);
+                normal += weighted_normal;
+                area += triangle_area;
+            }
+
+            mesh_centroid += centroid;
+            mesh_area += area;
+            centroids[c] = (area > 0.0f) ? centroid / area : vertices[indices[sorted[c].begin]].position;
+            normals[c] = normal;
+        }
+
+        if (mesh_area > 0.0f)
+            mesh_centroid /= mesh_area;
+
+        // clusters far out along their own normal face away from the rest of the mesh, so they are likely to occlude it
+        for (std::size_t c = 0; c < sorted.size(); ++c)
+        {
+            const float length = glm::length(normals[c]);
+            sorted[c].sort_key = (length > 0.0f) ? glm::dot(centroids[c] - mesh_centroid, normals[c] / length) : 0.0f;
+        }
+
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &a, const Cluster &b)
+        {
+            return a.sort_key > b.sort_key;
+        });
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+        for (const auto &cluster : sorted)
+            output.insert(output.end(), indices.begin() + cluster.begin, indices.begin() + cluster.end);
+        indices.swap(output);
+    }
+
+
+    void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+    {
+        VV_PROFILE_FUNCTION();
+        std::vector<uint32_t> remap(vertices.size(), no_vertex);
+        std::vector<Vertex> output;
+        output.reserve(vertices.size());
+
+        for (auto &index : indices)
+        {
+            if (remap[index] == no_vertex)
+            {
+                remap[index] = static_cast<uint32_t>(output.size());
+                output.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(output);
+    }
+
+
+    void optimizeMesh(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+    {
+        VV_PROFILE_FUNCTION();
+        if (indices.size() < 3 || indices.size() % 3 != 0)
+            return;
+
+        std::vector<std::size_t> clusters;
+        optimizeVertexCache(indices, vertices.size(), &clusters);
+        optimizeOverdraw(indices, vertices, clusters);
+        optimizeVertexFetch(vertices, indices);
+    }
+}
@@ -27,22 +27,31 @@ namespace vv
         m_material_id_set = material_id_set;
 
         m_model_ubo = { glm::mat4(), glm::mat4() };
-        m_model_uniform_buffer = new VulkanBuffer();
-        m_model_uniform_buffer->create(device, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(ModelUBO));
 	}
 
 
 	void Model::shutDown()
 	{
-        m_model_uniform_buffer->shutDown();
-        delete m_model_uniform_buffer;
 	}
 
 
     void Model::updateModelUBO()
     {
         m_model_ubo = { m_pose, glm::transpose(glm::inverse(m_pose)) };
-        m_model_uniform_buffer->updateAndTransfer(&m_model_ubo);
+    }
+
+
+    void Model::setVisible(bool visible)
+    {
+        if (m_visible != visible)
+            m_draws_dirty = true;
+        m_visible = visible;
+    }
+
+
+    bool Model::isVisible() const
+    {
+        return m_visible;
     }
 
 
@@ -3,11 +3,613 @@
 #include "tiny_obj_loader.h"
 
 #include <cstring>
+#include <chrono>
+#include <limits>
+#include <fstream>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+#include <cstddef>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include "ModelManager.h"
+#include "MeshCache.h"
+#include "ObjParser.h"
+#include "VertexWelder.h"
+#include "MeshOptimizer.h"
+#include "GltfAsset.h"
+#include "Profiler.h"
 
 namespace vv
 {
+    namespace
+    {
+        // bump whenever the geometry built from an obj file changes, which invalidates every cached import
+        // 2: ObjParser rounds floats exactly, tinyobj was off in the last bit at times
+        const uint32_t obj_importer_version = 2;
+
+        /*
+         * Version the mesh cache of an obj file is keyed by. Optimized and unoptimized imports are different geometry, so
+         * toggling the optimization re-imports instead of loading the other variant.
+         */
+        uint32_t getOBJCacheVersion()
+        {
+            return (obj_importer_version << 1) | (Settings::inst()->isMeshOptimizationEnabled() ? 1u : 0u);
+        }
+
+
+        /*
+         * Reads material libraries like tinyobj's own reader and remembers their names, so warm loads from the mesh cache
+         * can read the same libraries without parsing the obj file.
+         */
+        class MaterialLibraryRecorder : public tinyobj::MaterialReader
+        {
+        public:
+            std::vector<std::string> libraries;
+
+            explicit MaterialLibraryRecorder(const std::string &base_directory)
+                : m_reader(base_directory)
+            {
+            }
+
+            virtual bool operator()(const std::string &library, std::vector<tinyobj::material_t> *materials,
+                                    std::map<std::string, int> *material_map, std::string *err)
+            {
+                libraries.push_back(library);
+                return m_reader(library, materials, material_map, err);
+            }
+
+        private:
+            tinyobj::MaterialFileReader m_reader;
+        };
+
+
+        /*
+         * Builds the deduplicated vertices and indices of one shape of a loaded obj file.
+         */
+        void buildOBJGeometry(const tinyobj::attrib_t &attrib, const tinyobj::shape_t &shape, std::vector<Vertex> &vertices,
+                              std::vector<uint32_t> &indices)
+        {
+            if (attrib.normals.empty())
+                VV_ALERT("Model does not have normals.");
+            if (attrib.texcoords.empty())
+                VV_ALERT("Model does not have UV coordinates.");
+
+            // a quarter of the corners is typical for smooth meshes, the welder grows for anything flatter
+            VertexWelder welder;
+            welder.create(&vertices, shape.mesh.indices.size() / 4);
+            indices.reserve(indices.size() + shape.mesh.indices.size());
+
+            for (const auto& index : shape.mesh.indices)
+            {
+                Vertex vertex = {};
+
+                // Vertices
+                vertex.position = glm::vec3(
+                    attrib.vertices[3 * index.vertex_index + 0],
+                    attrib.vertices[3 * index.vertex_index + 1],
+                    attrib.vertices[3 * index.vertex_index + 2]
+                );
+
+                // Normals
+                if (!attrib.normals.empty())
+                    vertex.normal = glm::vec3(
+                        attrib.normals[3 * index.normal_index + 0],
+                        attrib.normals[3 * index.normal_index + 1],
+                        attrib.normals[3 * index.normal_index + 2]
+                    );
+                else
+                    vertex.normal = glm::vec3(0.0, 0.0, 1.0);
+
+                // UVs
+                if (!attrib.texcoords.empty())
+                    vertex.texCoord = glm::vec2(
+                        attrib.texcoords[2 * index.texcoord_index + 0],
+                        1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+                    );
+                else
+                    vertex.texCoord = glm::vec2(0.0f, 0.0f);
+
+                indices.push_back(welder.weld(vertex));
+            }
+
+            welder.shutDown();
+        }
+
+
+        /*
+         * Parses the obj file at full_path along with the material libraries it references, which are looked up in path.
+         */
+        bool readOBJ(ObjParser &parser, const std::string &full_path, const std::string &path, tinyobj::attrib_t &attrib,
+                     std::vector<tinyobj::shape_t> &shapes, std::vector<tinyobj::material_t> &materials,
+                     std::vector<std::string> &material_libraries, std::string &err)
+        {
+            MaterialLibraryRecorder reader(path);
+            bool success = parser.load(full_path, attrib, shapes, materials, err, &reader);
+            material_libraries = reader.libraries;
+            return success;
+        }
+
+
+        /*
+         * Reads the materials of an obj file's libraries the same way parsing the obj file would have.
+         */
+        void readMaterialLibraries(const std::string &path, const std::vector<std::string> &material_libraries,
+                                   std::vector<tinyobj::material_t> &materials)
+        {
+            std::map<std::string, int> material_map;
+            tinyobj::MaterialFileReader reader(path);
+            std::string err;
+            for (const auto &library : material_libraries)
+                reader(library, &materials, &material_map, &err);
+        }
+
+
+        /*
+         * Re-reads shape s of an obj file, from its mesh cache if that is still current.
+         */
+        void rereadOBJShape(const std::string &full_path, const std::string &path, std::size_t s, std::vector<Vertex> &vertices,
+                            std::vector<uint32_t> &indices)
+        {
+            MeshCache cache;
+            if (cache.create(full_path, getOBJCacheVersion()))
+            {
+                bool cached = s < cache.getSubmeshes().size();
+                if (cached)
+                {
+                    const MeshCacheSubmesh &submesh = cache.getSubmeshes()[s];
+                    vertices.assign(submesh.vertices, submesh.vertices + submesh.vertex_count);
+                    indices.assign(submesh.indices, submesh.indices + submesh.index_count);
+                }
+                cache.shutDown();
+                if (cached)
+                    return;
+            }
+
+            // may run on any thread, so it doesn't share the manager's workers
+            ThreadPool threads;
+            threads.create(Settings::inst()->getImportThreadCount());
+            ObjParser parser;
+            parser.create(&threads);
+
+            tinyobj::attrib_t attrib;
+            std::vector<tinyobj::shape_t> shapes;
+            std::vector<tinyobj::material_t> materials;
+            std::string err;
+            bool success = parser.load(full_path, attrib, shapes, materials, err);
+            parser.shutDown();
+            threads.shutDown();
+            if (!success || s >= shapes.size())
+                throw std::runtime_error("Could not re-read geometry of " + full_path + "\n\n" + err);
+            buildOBJGeometry(attrib, shapes[s], vertices, indices);
+            if (Settings::inst()->isMeshOptimizationEnabled())
+                optimizeMesh(vertices, indices);
+        }
+
+
+        void computeBounds(const Vertex *vertices, std::size_t vertex_count, glm::vec3 &bounds_min, glm::vec3 &bounds_max)
+        {
+            bounds_min = glm::vec3(std::numeric_limits<float>::max());
+            bounds_max = glm::vec3(-std::numeric_limits<float>::max());
+            for (std::size_t i = 0; i < vertex_count; ++i)
+            {
+                bounds_min = glm::min(bounds_min, vertices[i].position);
+                bounds_max = glm::max(bounds_max, vertices[i].position);
+            }
+        }
+
+
+        /*
+         * A triangle primitive of a glTF mesh as instanced by a node of the default scene.
+         */
+        struct GltfDrawable
+        {
+            std::string name;
+            glm::mat4 transform; // node to model space
+            int mesh;
+            int primitive;
+        };
+
+        /*
+         * Geometry of a GltfDrawable as handed to the GeometryArena. vertices and indices point either into the asset's
+         * buffers, if those already hold exactly what the arena expects, or into the storage below.
+         */
+        struct GltfGeometry
+        {
+            const Vertex *vertices   = nullptr;
+            uint32_t vertex_count    = 0;
+            const uint32_t *indices  = nullptr;
+            uint32_t index_count     = 0;
+            glm::vec3 bounds_min;
+            glm::vec3 bounds_max;
+
+            std::vector<Vertex> vertex_storage;
+            std::vector<uint32_t> index_storage;
+        };
+
+
+        glm::mat4 getNodeTransform(const JsonValue &node)
+        {
+            const JsonValue &matrix = node["matrix"];
+            if (matrix.size() == 16)
+            {
+                // column major, like glm
+                glm::mat4 transform;
+                for (int column = 0; column < 4; ++column)
+                    for (int row = 0; row < 4; ++row)
+                        transform[column][row] = static_cast<float>(matrix[column * 4 + row].asNumber());
+                return transform;
+            }
+
+            const JsonValue &t = node["translation"];
+            const JsonValue &r = node["rotation"];
+            const JsonValue &s = node["scale"];
+            glm::vec3 translation(t[0].asNumber(0.0), t[1].asNumber(0.0), t[2].asNumber(0.0));
+            glm::quat rotation(static_cast<float>(r[3].asNumber(1.0)), static_cast<float>(r[0].asNumber(0.0)),
+                               static_cast<float>(r[1].asNumber(0.0)), static_cast<float>(r[2].asNumber(0.0)));
+            glm::vec3 scale(s[0].asNumber(1.0), s[1].asNumber(1.0), s[2].asNumber(1.0));
+            return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+        }
+
+
+        /*
+         * Walks the node hierarchy of the default scene, or of every root node if the asset has no scenes, and lists the
+         * triangle primitives it instances in a fixed order.
+         */
+        void collectGLTFDrawables(const JsonValue &json, std::vector<GltfDrawable> &drawables)
+        {
+            const JsonValue &nodes = json["nodes"];
+            std::vector<std::pair<int, glm::mat4> > stack;
+
+            const JsonValue &scene = json["scenes"][static_cast<std::size_t>(json["scene"].asInt(0))];
+            if (scene.isObject())
+            {
+                for (std::size_t i = scene["nodes"].size(); i-- > 0;)
+                    stack.push_back(std::make_pair(scene["nodes"][i].asInt(-1), glm::mat4(1.0f)));
+            }
+            else
+            {
+                std::vector<bool> is_child(nodes.size(), false);
+                for (std::size_t n = 0; n < nodes.size(); ++n)
+                    for (std::size_t c = 0; c < nodes[n]["children"].size(); ++c)
+                    {
+                        int child = nodes[n]["children"][c].asInt(-1);
+                        if (child >= 0 && static_cast<std::size_t>(child) < nodes.size())
+                            is_child[child] = true;
+                    }
+
+                for (std::size_t n = nodes.size(); n-- > 0;)
+                    if (!is_child[n])
+                        stack.push_back(std::make_pair(static_cast<int>(n), glm::mat4(1.0f)));
+            }
+
+            // nodes form a tree, visiting one twice means the file is broken
+            std::vector<bool> visited(nodes.size(), false);
+            while (!stack.empty())
+            {
+                const int n = stack.back().first;
+                const glm::mat4 parent_transform = stack.back().second;
+                stack.pop_back();
+                if (n < 0 || static_cast<std::size_t>(n) >= nodes.size() || visited[n])
+                    continue;
+                visited[n] = true;
+
+                const JsonValue &node = nodes[n];
+                const glm::mat4 transform = parent_transform * getNodeTransform(node);
+
+                const int m = node["mesh"].asInt(-1);
+                const JsonValue &mesh = json["meshes"][static_cast<std::size_t>(m)];
+                const JsonValue &primitives = mesh["primitives"];
+                for (std::size_t p = 0; m >= 0 && p < primitives.size(); ++p)
+                {
+                    if (primitives[p]["mode"].asInt(4) != 4)
+                    {
+                        VV_ALERT("Only triangle lists are supported, skipping a primitive of mesh " + std::to_string(m));
+                        continue;
+                    }
+
+                    GltfDrawable drawable;
+                    drawable.name = mesh["name"].asString().empty() ? "mesh_" + std::to_string(m) : mesh["name"].asString();
+                    if (primitives.size() > 1)
+                        drawable.name += "_" + std::to_string(p);
+                    drawable.transform = transform;
+                    drawable.mesh = m;
+                    drawable.primitive = static_cast<int>(p);
+                    drawables.push_back(drawable);
+                }
+
+                const JsonValue &children = node["children"];
+                for (std::size_t c = children.size(); c-- > 0;)
+                    stack.push_back(std::make_pair(children[c].asInt(-1), transform));
+            }
+        }
+
+
+        float readComponent(const unsigned char *data, int component_type, bool normalized)
+        {
+            switch (component_type)
+            {
+            case GLTF_FLOAT:
+            {
+                float value;
+                memcpy(&value, data, sizeof(value));
+                return value;
+            }
+            case GLTF_UNSIGNED_BYTE:
+                return normalized ? data[0] / 255.0f : data[0];
+            case GLTF_UNSIGNED_SHORT:
+            {
+                uint16_t value;
+                memcpy(&value, data, sizeof(value));
+                return normalized ? value / 65535.0f : value;
+            }
+            default:
+                return 0.0f;
+            }
+        }
+
+
+        uint32_t readIndex(const unsigned char *data, int component_type)
+        {
+            switch (component_type)
+            {
+            case GLTF_UNSIGNED_BYTE:
+                return data[0];
+            case GLTF_UNSIGNED_SHORT:
+            {
+                uint16_t value;
+                memcpy(&value, data, sizeof(value));
+                return value;
+            }
+            default:
+            {
+                uint32_t value;
+                memcpy(&value, data, sizeof(value));
+                return value;
+            }
+            }
+        }
+
+
+        bool isAligned(const void *data, std::size_t alignment)
+        {
+            return reinterpret_cast<uintptr_t>(data) % alignment == 0;
+        }
+
+
+        /*
+         * Reads the geometry of drawable in the engine's vertex layout. Vertex and index data is only copied if it has to
+         * be converted or transformed to the drawable's node.
+         */
+        bool buildGLTFGeometry(const GltfAsset &asset, const GltfDrawable &drawable, GltfGeometry &geometry, std::string &err)
+        {
+            const JsonValue &primitive = asset.getJson()["meshes"][static_cast<std::size_t>(drawable.mesh)]["primitives"]
+                                                       [static_cast<std::size_t>(drawable.primitive)];
+            const JsonValue &attributes = primitive["attributes"];
+
+            GltfAccessor position, normal, texcoord;
+            if (!asset.getAccessor(attributes["POSITION"].asInt(-1), position, err))
+                return false;
+            if (position.component_type != GLTF_FLOAT || position.component_count != 3 || position.count > UINT32_MAX)
+            {
+                err = "Unsupported POSITION format in " + drawable.name;
+                return false;
+            }
+
+            const bool has_normals = attributes.has("NORMAL");
+            if (has_normals && (!asset.getAccessor(attributes["NORMAL"].asInt(-1), normal, err) || normal.component_type != GLTF_FLOAT ||
+                                normal.component_count != 3 || normal.count != position.count))
+            {
+                err = "Unsupported NORMAL format in " + drawable.name + (err.empty() ? "" : ": " + err);
+                return false;
+            }
+
+            const bool has_texcoords = attributes.has("TEXCOORD_0");
+            if (has_texcoords && (!asset.getAccessor(attributes["TEXCOORD_0"].asInt(-1), texcoord, err) || texcoord.component_count != 2 ||
+                                  texcoord.count != position.count || (texcoord.component_type != GLTF_FLOAT && !texcoord.normalized)))
+            {
+                err = "Unsupported TEXCOORD_0 format in " + drawable.name + (err.empty() ? "" : ": " + err);
+                return false;
+            }
+
+            const glm::mat3 linear(drawable.transform);
+            const bool identity = (drawable.transform == glm::mat4(1.0f));
+            const bool flip_winding = glm::determinant(linear) < 0.0f;
+            geometry.vertex_count = static_cast<uint32_t>(position.count);
+
+            // an interleaved buffer of exactly our vertex layout goes to staging memory as is
+            const Vertex *mapped_vertices = reinterpret_cast<const Vertex *>(position.data);
+            if (identity && has_normals && has_texcoords && texcoord.component_type == GLTF_FLOAT && isAligned(position.data, alignof(Vertex)) &&
+                position.stride == sizeof(Vertex) && normal.stride == sizeof(Vertex) && texcoord.stride == sizeof(Vertex) &&
+                normal.data == position.data + offsetof(Vertex, normal) && texcoord.data == position.data + offsetof(Vertex, texCoord))
+            {
+                geometry.vertices = mapped_vertices;
+            }
+            else
+            {
+                const glm::mat3 normal_matrix = glm::inverseTranspose(linear);
+                geometry.vertex_storage.resize(position.count);
+                for (std::size_t i = 0; i < position.count; ++i)
+                {
+                    Vertex &vertex = geometry.vertex_storage[i];
+                    const unsigned char *p = position.data + i * position.stride;
+                    memcpy(&vertex.position, p, sizeof(vertex.position));
+                    if (!identity)
+                        vertex.position = glm::vec3(drawable.transform * glm::vec4(vertex.position, 1.0f));
+
+                    if (has_normals)
+                    {
+                        memcpy(&vertex.normal, normal.data + i * normal.stride, sizeof(vertex.normal));
+                        if (!identity)
+                            vertex.normal = glm::normalize(normal_matrix * vertex.normal);
+                    }
+                    else
+                        vertex.normal = glm::vec3(0.0f);
+
+                    if (has_texcoords)
+                    {
+                        const unsigned char *t = texcoord.data + i * texcoord.stride;
+                        const std::size_t component_size = (texcoord.component_type == GLTF_FLOAT) ? 4 : (texcoord.component_type == GLTF_UNSIGNED_SHORT) ? 2 : 1;
+                        vertex.texCoord = glm::vec2(readComponent(t, texcoord.component_type, texcoord.normalized),
+                                                    readComponent(t + component_size, texcoord.component_type, texcoord.normalized));
+                    }
+                    else
+                        vertex.texCoord = glm::vec2(0.0f);
+                }
+                geometry.vertices = geometry.vertex_storage.data();
+            }
+
+            if (primitive.has("indices"))
+            {
+                GltfAccessor indices;
+                if (!asset.getAccessor(primitive["indices"].asInt(-1), indices, err))
+                    return false;
+                if (indices.component_count != 1 || (indices.component_type != GLTF_UNSIGNED_BYTE && indices.component_type != GLTF_UNSIGNED_SHORT &&
+                                                     indices.component_type != GLTF_UNSIGNED_INT) || indices.count > UINT32_MAX)
+                {
+                    err = "Unsupported index format in " + drawable.name;
+                    return false;
+                }
+
+                // a trailing partial triangle isn't drawn
+                geometry.index_count = static_cast<uint32_t>(indices.count - indices.count % 3);
+                if (indices.component_type == GLTF_UNSIGNED_INT && indices.stride == sizeof(uint32_t) && !flip_winding &&
+                    isAligned(indices.data, alignof(uint32_t)))
+                {
+                    geometry.indices = reinterpret_cast<const uint32_t *>(indices.data);
+                }
+                else
+                {
+                    geometry.index_storage.resize(geometry.index_count);
+                    for (uint32_t i = 0; i < geometry.index_count; ++i)
+                        geometry.index_storage[i] = readIndex(indices.data + i * indices.stride, indices.component_type);
+                    geometry.indices = geometry.index_storage.data();
+                }
+            }
+            else
+            {
+                geometry.index_count = geometry.vertex_count - geometry.vertex_count % 3;
+                geometry.index_storage.resize(geometry.index_count);
+                for (uint32_t i = 0; i < geometry.index_count; ++i)
+                    geometry.index_storage[i] = i;
+                geometry.indices = geometry.index_storage.data();
+            }
+
+            // indices go to the device as they are, one past the vertices would read out of bounds there
+            for (uint32_t i = 0; i < geometry.index_count; ++i)
+                if (geometry.indices[i] >= geometry.vertex_count)
+                {
+                    err = "Index out of range in " + drawable.name;
+                    return false;
+                }
+
+            // mirroring transforms turn front faces into back faces
+            if (flip_winding)
+                for (uint32_t i = 0; i < geometry.index_count; i += 3)
+                    std::swap(geometry.index_storage[i + 1], geometry.index_storage[i + 2]);
+
+            // without normals the spec asks for flat shading, smooth normals from the area weighted faces come close enough
+            if (!has_normals)
+            {
+                for (uint32_t i = 0; i < geometry.index_count; i += 3)
+                {
+                    Vertex &a = geometry.vertex_storage[geometry.indices[i]];
+                    Vertex &b = geometry.vertex_storage[geometry.indices[i + 1]];
+                    Vertex &c = geometry.vertex_storage[geometry.indices[i + 2]];
+                    const glm::vec3 face_normal = glm::cross(b.position - a.position, c.position - a.position);
+                    a.normal += face_normal;
+                    b.normal += face_normal;
+                    c.normal += face_normal;
+                }
+
+                for (auto &vertex : geometry.vertex_storage)
+                {
+                    const float length = glm::length(vertex.normal);
+                    vertex.normal = (length > 0.0f) ? vertex.normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+                }
+            }
+
+            // accessors of positions have to declare their bounds, but only in node space
+            const JsonValue &min = asset.getJson()["accessors"][static_cast<std::size_t>(attributes["POSITION"].asInt())]["min"];
+            const JsonValue &max = asset.getJson()["accessors"][static_cast<std::size_t>(attributes["POSITION"].asInt())]["max"];
+            if (identity && min.size() == 3 && max.size() == 3)
+            {
+                geometry.bounds_min = glm::vec3(min[0].asNumber(), min[1].asNumber(), min[2].asNumber());
+                geometry.bounds_max = glm::vec3(max[0].asNumber(), max[1].asNumber(), max[2].asNumber());
+            }
+            else
+                computeBounds(geometry.vertices, geometry.vertex_count, geometry.bounds_min, geometry.bounds_max);
+
+            return true;
+        }
+
+
+        /*
+         * Optimizes the geometry of a drawable like an obj shape if buildGLTFGeometry() had to copy it anyway. Converted
+         * vertices are reordered along with the triangles, while vertices mapped from the asset keep their order and only
+         * the copied indices are reordered for the vertex cache. Geometry mapped from the asset as a whole is left alone,
+         * optimizing it would cost the copy it saved. Returns whether anything was optimized.
+         */
+        bool optimizeGLTFGeometry(GltfGeometry &geometry, VertexCacheStats *before = nullptr, VertexCacheStats *after = nullptr)
+        {
+            const bool vertices_copied = !geometry.vertex_storage.empty();
+            const bool indices_copied = !geometry.index_storage.empty();
+            if (!vertices_copied && !indices_copied)
+                return false;
+
+            if (!indices_copied)
+                geometry.index_storage.assign(geometry.indices, geometry.indices + geometry.index_count);
+            if (before)
+                *before = analyzeVertexCache(geometry.index_storage, geometry.vertex_count);
+
+            if (vertices_copied)
+            {
+                // drops unreferenced vertices, the bounds still enclose the rest
+                optimizeMesh(geometry.vertex_storage, geometry.index_storage);
+                geometry.vertices = geometry.vertex_storage.data();
+                geometry.vertex_count = static_cast<uint32_t>(geometry.vertex_storage.size());
+            }
+            else
+                optimizeVertexCache(geometry.index_storage, geometry.vertex_count);
+            geometry.indices = geometry.index_storage.data();
+
+            if (after)
+                *after = analyzeVertexCache(geometry.index_storage, geometry.vertex_count);
+            return true;
+        }
+
+
+        /*
+         * Re-reads the geometry of drawable d of a glTF asset.
+         */
+        void rereadGLTFDrawable(const std::string &full_path, std::size_t d, std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+        {
+            GltfAsset asset;
+            std::string err;
+            std::vector<GltfDrawable> drawables;
+            GltfGeometry geometry;
+
+            bool success = asset.create(full_path, err);
+            if (success)
+                collectGLTFDrawables(asset.getJson(), drawables);
+            success = success && d < drawables.size() && buildGLTFGeometry(asset, drawables[d], geometry, err);
+            if (success)
+            {
+                if (Settings::inst()->isMeshOptimizationEnabled())
+                    optimizeGLTFGeometry(geometry);
+                vertices.assign(geometry.vertices, geometry.vertices + geometry.vertex_count);
+                indices.assign(geometry.indices, geometry.indices + geometry.index_count);
+            }
+            asset.shutDown();
+
+            if (!success)
+                throw std::runtime_error("Could not re-read geometry of " + full_path + "\n\n" + err);
+        }
+    }
+
+
 	///////////////////////////////////////////////////////////////////////////////////////////// Public
 	ModelManager::ModelManager()
 	{
@@ -19,11 +621,12 @@ namespace vv
 	}
 
 
-	void ModelManager::create(VulkanDevice *device, TextureManager *texture_manager, VkDescriptorPool descriptor_pool)
+	void ModelManager::create(VulkanDevice *device, TextureManager *texture_manager)
 	{
 		m_device = device;
         m_texture_manager = texture_manager;
-        m_descriptor_pool = descriptor_pool;
+        m_import_threads.create(Settings::inst()->getImportThreadCount());
+        m_obj_parser.create(&m_import_threads);
 
         // load primitive mesh to cache
         Model *temp_model = new Model();
@@ -51,6 +654,10 @@ namespace vv
 
         m_loaded_meshes.clear();
         m_loaded_materials.clear();
+        m_residency_pending.clear();
+
+        m_obj_parser.shutDown();
+        m_import_threads.shutDown();
 	}
 
 
@@ -77,8 +684,8 @@ namespace vv
         if (file_type == "obj")
             return loadOBJ(path, name, material_template, model);
 
-        else if (file_type == "gltf")
-            return loadGLTF();
+        else if (file_type == "gltf" || file_type == "glb")
+            return loadGLTF(path, name, material_template, model);
 
         else
         {
@@ -88,87 +695,154 @@ namespace vv
     }
 
 
+    void ModelManager::updateResidency()
+    {
+        m_residency_pending.erase(std::remove_if(m_residency_pending.begin(), m_residency_pending.end(),
+                                                 [](Mesh *mesh) { return mesh->updateResidency(); }),
+                                  m_residency_pending.end());
+    }
+
+
     Mesh* ModelManager::getSphereMesh() const
     {
         return m_loaded_meshes.at(Settings::inst()->getModelDirectory() + "primitives/sphere.obj")[0];
     }
 
 
+    const std::map<std::string, MeshOptimizationStats>& ModelManager::getOptimizationStats() const
+    {
+        return m_optimization_stats;
+    }
+
+
     ///////////////////////////////////////////////////////////////////////////////////////////// Private
     bool ModelManager::loadOBJ(std::string path, std::string name, MaterialTemplate *material_template, Model *model)
     {
+        VV_PROFILE_FUNCTION();
         bool success = true;
         std::string full_path(path + name);
-    	tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> tiny_shapes;
 		std::vector<tinyobj::material_t> tiny_materials;
-		std::string err;
 
         std::vector<Mesh *> meshes;
         std::vector<Material *> materials;
 
-		VV_ASSERT(tinyobj::LoadObj(&attrib, &tiny_shapes, &tiny_materials, &err,
-                  full_path.c_str(), path.c_str()),
-                  "Model, " + name + ", not loaded correctly\n\n" + err);
+        // released copies are re-read on demand, only the requested shape is kept
+        const CPUResidency residency = Settings::inst()->getCPUResidency(full_path);
+        auto geometry_source = [full_path, path](std::size_t s) -> Mesh::GeometrySource
+        {
+            return [full_path, path, s](std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+            {
+                rereadOBJShape(full_path, path, s, vertices, indices);
+            };
+        };
 
-        // parse through all loaded geometry and create internal abstractions.
-		for (const auto& shape : tiny_shapes)
-		{
-		    std::vector<Vertex> vertices;
-		    std::vector<uint32_t> indices;
-		    std::unordered_map<Vertex, int> vertex_map;
+        auto create_meshes = [&](const std::vector<MeshCacheSubmesh> &submeshes)
+        {
+            for (std::size_t s = 0; s < submeshes.size(); ++s)
+            {
+                const MeshCacheSubmesh &submesh = submeshes[s];
+                Mesh *mesh = new Mesh();
+                mesh->create(m_device, submesh.name, submesh.vertices, submesh.vertex_count, submesh.indices, submesh.index_count,
+                             submesh.material_id, submesh.bounds_min, submesh.bounds_max, residency, geometry_source(s));
+                meshes.push_back(mesh);
+                m_residency_pending.push_back(mesh);
+            }
+        };
 
-			for (const auto& index : shape.mesh.indices)
-			{
-				Vertex vertex = {};
+        MeshCache cache;
+        if (cache.create(full_path, getOBJCacheVersion()))
+        {
+            // warm load: geometry goes from the mapped cache straight into staging memory, only materials are parsed
+            readMaterialLibraries(path, cache.getMaterialLibraries(), tiny_materials);
+            create_meshes(cache.getSubmeshes());
+            if (cache.getOptimizationStats().mesh_count > 0)
+                m_optimization_stats[full_path] = cache.getOptimizationStats();
+            cache.shutDown();
+        }
+        else
+        {
+            tinyobj::attrib_t attrib;
+            std::vector<tinyobj::shape_t> tiny_shapes;
+            std::vector<std::string> material_libraries;
+            std::string err;
 
-                // Vertices
-				vertex.position = glm::vec3(
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				);
+            VV_ASSERT(readOBJ(m_obj_parser, full_path, path, attrib, tiny_shapes, tiny_materials, material_libraries, err),
+                      "Model, " + name + ", not loaded correctly\n\n" + err);
 
-                // Normals
-                if (!attrib.normals.empty())
-                    vertex.normal = glm::vec3(
-                        attrib.normals[3 * index.normal_index + 0],
-                        attrib.normals[3 * index.normal_index + 1],
-                        attrib.normals[3 * index.normal_index + 2]
-                    );
-                else
+            // parse through all loaded geometry and create internal abstractions.
+            std::vector<std::vector<Vertex> > shape_vertices(tiny_shapes.size());
+            std::vector<std::vector<uint32_t> > shape_indices(tiny_shapes.size());
+            std::vector<MeshCacheSubmesh> submeshes(tiny_shapes.size());
+
+            // shapes are welded independently of each other, in parallel. the largest go first so a big one doesn't end
+            // up running alone at the end.
+            std::vector<std::size_t> weld_order(tiny_shapes.size());
+            for (std::size_t s = 0; s < weld_order.size(); ++s)
+                weld_order[s] = s;
+            std::sort(weld_order.begin(), weld_order.end(), [&tiny_shapes](std::size_t a, std::size_t b)
+            {
+                return tiny_shapes[a].mesh.indices.size() > tiny_shapes[b].mesh.indices.size();
+            });
+
+            // optimizing a shape right after welding it keeps it warm in the cache of the same worker
+            const bool optimize = Settings::inst()->isMeshOptimizationEnabled();
+            std::vector<VertexCacheStats> stats_before(tiny_shapes.size());
+            std::vector<VertexCacheStats> stats_after(tiny_shapes.size());
+            auto optimize_start = std::chrono::high_resolution_clock::now();
+
+            for (std::size_t s : weld_order)
+            {
+                const tinyobj::shape_t *shape = &tiny_shapes[s];
+                std::vector<Vertex> *vertices = &shape_vertices[s];
+                std::vector<uint32_t> *indices = &shape_indices[s];
+                VertexCacheStats *before = &stats_before[s];
+                VertexCacheStats *after = &stats_after[s];
+                const tinyobj::attrib_t *attrib_ptr = &attrib;
+                m_import_threads.submit([attrib_ptr, shape, vertices, indices, optimize, before, after](uint32_t)
                 {
-				    vertex.normal = glm::vec3(0.0, 0.0, 1.0);
-                    VV_ALERT("Model does not have normals.");
-                }
+                    buildOBJGeometry(*attrib_ptr, *shape, *vertices, *indices);
+                    if (optimize)
+                    {
+                        *before = analyzeVertexCache(*indices, vertices->size());
+                        optimizeMesh(*vertices, *indices);
+                        *after = analyzeVertexCache(*indices, vertices->size());
+                    }
+                });
+            }
+            m_import_threads.wait();
 
-                // UVs
-                if (!attrib.texcoords.empty())
-                    vertex.texCoord = glm::vec2(
-                        attrib.texcoords[2 * index.texcoord_index + 0],
-                        1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-                    );
-                else
+            // stored with the cache, so warm loads can still report how much the import gained
+            MeshOptimizationStats optimization_stats;
+            if (optimize)
+            {
+                for (std::size_t s = 0; s < tiny_shapes.size(); ++s)
                 {
-                    vertex.texCoord = glm::vec2(0.0f, 0.0f);
-                    VV_ALERT("Model does not have UV coordinates.");
+                    optimization_stats.before += stats_before[s];
+                    optimization_stats.after += stats_after[s];
                 }
+                optimization_stats.mesh_count = static_cast<uint32_t>(tiny_shapes.size());
+                optimization_stats.import_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - optimize_start).count();
+                m_optimization_stats[full_path] = optimization_stats;
+            }
 
-				if (vertex_map.count(vertex) == 0)
-				{
-					vertex_map[vertex] = (int)vertices.size();
-					vertices.push_back(vertex);
-				}
-
-				indices.push_back(vertex_map[vertex]);
-			}
+            for (std::size_t s = 0; s < tiny_shapes.size(); ++s)
+            {
+                const auto &shape = tiny_shapes[s];
+                int curr_material_id = shape.mesh.material_ids[0];
 
-            int curr_material_id = shape.mesh.material_ids[0];
+                MeshCacheSubmesh &submesh = submeshes[s];
+                submesh.name = shape.name;
+                submesh.material_id = (curr_material_id < 0) ? 0 : curr_material_id;
+                submesh.vertices = shape_vertices[s].data();
+                submesh.vertex_count = static_cast<uint32_t>(shape_vertices[s].size());
+                submesh.indices = shape_indices[s].data();
+                submesh.index_count = static_cast<uint32_t>(shape_indices[s].size());
+                computeBounds(shape_vertices[s].data(), shape_vertices[s].size(), submesh.bounds_min, submesh.bounds_max);
+            }
 
-            Mesh *mesh = new Mesh();
-            mesh->create(m_device, shape.name, vertices, indices, ((curr_material_id < 0) ? 0 : curr_material_id));
-            meshes.push_back(mesh);
-		}
+            MeshCache::write(full_path, getOBJCacheVersion(), submeshes, material_libraries, optimization_stats);
+            create_meshes(submeshes);
+        }
 
         m_loaded_meshes[path + name] = meshes;
 
@@ -178,7 +852,7 @@ namespace vv
             for (const auto &m : tiny_materials)
             {
                 Material *material = new Material();
-                material->create(m_device, material_template, m_descriptor_pool);
+                material->create(m_device, material_template);
 
                 // store required descriptor set data in correct binding order
                 auto orderings = material_template->shader_modules[1].material_descriptor_orderings;
@@ -193,7 +867,7 @@ namespace vv
                         MaterialProperties properties = { amb, dif, spec, static_cast<int>(m.shininess) };
 
                         VulkanBuffer *buffer = new VulkanBuffer();
-                        buffer->create(m_device, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(properties));
+                        buffer->create(m_device, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(properties), MemoryTag(MemoryCategory::Uniform, full_path + ":" + m.name));
                         buffer->updateAndTransfer(&properties);
 
                         material->addUniformBuffer(buffer, o.binding);
@@ -236,7 +910,7 @@ namespace vv
             if (tiny_materials.empty())
             {
                 Material *material = new Material();
-                material->create(m_device, material_template, m_descriptor_pool);
+                material->create(m_device, material_template);
 
                 //VV_ALERT("MTL file not found. Assuming PBR textures present.");
                 
@@ -276,8 +950,217 @@ namespace vv
     }
 
 
-    bool ModelManager::loadGLTF()
+    bool ModelManager::loadGLTF(std::string path, std::string name, MaterialTemplate *material_template, Model *model)
+    {
+        VV_PROFILE_FUNCTION();
+        bool success = true;
+        std::string full_path(path + name);
+
+        GltfAsset asset;
+        std::string err;
+        if (!asset.create(full_path, err))
+        {
+            VV_ASSERT(false, "Model, " + name + ", not loaded correctly\n\n" + err);
+            return false;
+        }
+
+        const JsonValue &json = asset.getJson();
+        std::vector<GltfDrawable> drawables;
+        collectGLTFDrawables(json, drawables);
+
+        // primitives without a material get the default one, appended after the asset's own
+        const int default_material = static_cast<int>(json["materials"].size());
+        bool uses_default_material = (default_material == 0);
+
+        std::vector<Mesh *> meshes;
+        std::vector<Material *> materials;
+        const CPUResidency residency = Settings::inst()->getCPUResidency(full_path);
+        const bool optimize = Settings::inst()->isMeshOptimizationEnabled();
+        MeshOptimizationStats optimization_stats;
+        for (std::size_t d = 0; d < drawables.size(); ++d)
+        {
+            auto build_start = std::chrono::high_resolution_clock::now();
+            GltfGeometry geometry;
+            if (!buildGLTFGeometry(asset, drawables[d], geometry, err))
+            {
+                VV_ALERT("Skipping " + drawables[d].name + " of " + name + ": " + err);
+                success = false;
+                continue;
+            }
+
+            VertexCacheStats before, after;
+            if (optimize && optimizeGLTFGeometry(geometry, &before, &after))
+            {
+                ++optimization_stats.mesh_count;
+                optimization_stats.before += before;
+                optimization_stats.after += after;
+                optimization_stats.import_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - build_start).count();
+            }
+
+            const JsonValue &primitive = json["meshes"][static_cast<std::size_t>(drawables[d].mesh)]["primitives"]
+                                             [static_cast<std::size_t>(drawables[d].primitive)];
+            int material_id = primitive["material"].asInt(-1);
+            if (material_id < 0 || material_id >= default_material)
+            {
+                material_id = default_material;
+                uses_default_material = true;
+            }
+
+            Mesh *mesh = new Mesh();
+            mesh->create(m_device, drawables[d].name, geometry.vertices, geometry.vertex_count, geometry.indices, geometry.index_count,
+                         material_id, geometry.bounds_min, geometry.bounds_max, residency,
+                         [full_path, d](std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+                         {
+                             rereadGLTFDrawable(full_path, d, vertices, indices);
+                         });
+            meshes.push_back(mesh);
+            m_residency_pending.push_back(mesh);
+        }
+
+        m_loaded_meshes[full_path] = meshes;
+        if (optimization_stats.mesh_count > 0)
+            m_optimization_stats[full_path] = optimization_stats;
+
+        if (material_template)
+        {
+            for (std::size_t m = 0; m < json["materials"].size(); ++m)
+                materials.push_back(createGLTFMaterial(asset, path, full_path, json["materials"][m], material_template, success));
+            if (uses_default_material)
+                materials.push_back(createGLTFMaterial(asset, path, full_path, JsonValue(), material_template, success));
+
+            m_loaded_materials[full_path][material_template->name] = materials;
+            model->create(m_device, name, full_path, material_template->name, material_template);
+        }
+
+        asset.shutDown();
+        return success;
+    }
+
+
+    Material* ModelManager::createGLTFMaterial(const GltfAsset &asset, const std::string &path, const std::string &full_path,
+                                               const JsonValue &json, MaterialTemplate *material_template, bool &success)
+    {
+        // defaults of the spec for everything the material leaves out
+        const JsonValue &pbr = json["pbrMetallicRoughness"];
+        const JsonValue &base_color = pbr["baseColorFactor"];
+        const JsonValue &emissive = json["emissiveFactor"];
+        const glm::vec4 base_color_factor(base_color[0].asNumber(1.0), base_color[1].asNumber(1.0), base_color[2].asNumber(1.0),
+                                          base_color[3].asNumber(1.0));
+        const glm::vec4 emissive_factor(emissive[0].asNumber(0.0), emissive[1].asNumber(0.0), emissive[2].asNumber(0.0), 1.0f);
+        const float metallic_factor = static_cast<float>(pbr["metallicFactor"].asNumber(1.0));
+        const float roughness_factor = static_cast<float>(pbr["roughnessFactor"].asNumber(1.0));
+
+        Material *material = new Material();
+        material->create(m_device, material_template);
+
+        // store required descriptor set data in correct binding order
+        auto orderings = material_template->shader_modules[1].material_descriptor_orderings;
+        for (size_t i = 0; i < orderings.size(); ++i)
+        {
+            auto o = orderings[i];
+            if (o.name == "properties")
+            {
+                // blinn-phong approximation for non-PBR templates
+                const glm::vec3 specular = glm::mix(glm::vec3(0.04f), glm::vec3(base_color_factor), metallic_factor);
+                const float alpha = std::max(roughness_factor * roughness_factor, 0.01f);
+                MaterialProperties properties = { glm::vec4(0.0f), glm::vec4(glm::vec3(base_color_factor), 0.0f), glm::vec4(specular, 0.0f),
+                                                  static_cast<int>(std::min(2.0f / (alpha * alpha) - 2.0f, 1024.0f)) };
+
+                VulkanBuffer *buffer = new VulkanBuffer();
+                buffer->create(m_device, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(properties),
+                               MemoryTag(MemoryCategory::Uniform, full_path + ":" + json["name"].asString()));
+                buffer->updateAndTransfer(&properties);
+
+                material->addUniformBuffer(buffer, o.binding);
+            }
+            else if (o.name.find("map") != std::string::npos)
+            {
+                SampledTexture *texture = nullptr;
+                if (o.name == "albedo_map" || o.name == "diffuse_map")
+                {
+                    texture = loadGLTFTexture(asset, path, full_path, pbr["baseColorTexture"]);
+                    if (!texture)
+                        texture = m_texture_manager->loadConstantImage(base_color_factor);
+                }
+                else if (o.name == "roughness_map" || o.name == "metalness_map")
+                {
+                    // roughness in green and metalness in blue, which is also where the shaders read them from
+                    texture = loadGLTFTexture(asset, path, full_path, pbr["metallicRoughnessTexture"]);
+                    if (!texture)
+                        texture = m_texture_manager->loadConstantImage(glm::vec4(0.0f, roughness_factor, metallic_factor, 1.0f));
+                }
+                else if (o.name == "normal_map")
+                {
+                    texture = loadGLTFTexture(asset, path, full_path, json["normalTexture"]);
+                    if (!texture)
+                        texture = m_texture_manager->loadConstantImage(glm::vec4(0.5f, 0.5f, 1.0f, 1.0f));
+                }
+                else if (o.name == "emissiveness_map")
+                {
+                    texture = loadGLTFTexture(asset, path, full_path, json["emissiveTexture"]);
+                    if (!texture)
+                        texture = m_texture_manager->loadConstantImage(emissive_factor);
+                }
+                else if (o.name == "ambient_occlusion_map")
+                {
+                    texture = loadGLTFTexture(asset, path, full_path, json["occlusionTexture"]);
+                    if (!texture)
+                        texture = m_texture_manager->loadConstantImage(glm::vec4(1.0f));
+                }
+                else
+                    texture = m_texture_manager->load2DImage(path, "");
+
+                material->addTexture(texture, o.binding);
+            }
+            else // descriptor type not populated
+            {
+                VV_ALERT("WARNING: Descriptor Type not populated for material: " + json["name"].asString() + ". Using dummy material.");
+                success = false;
+                break;
+            }
+        }
+
+        material->updateDescriptorSets();
+        return material;
+    }
+
+
+    SampledTexture* ModelManager::loadGLTFTexture(const GltfAsset &asset, const std::string &path, const std::string &full_path,
+                                                  const JsonValue &texture_info)
     {
-        return false;
+        const JsonValue &json = asset.getJson();
+        const JsonValue &texture = json["textures"][static_cast<std::size_t>(texture_info["index"].asInt(-1))];
+        const int source = texture["source"].asInt(-1);
+        const JsonValue &image = json["images"][static_cast<std::size_t>(source)];
+        if (!texture_info.isObject() || !image.isObject())
+            return nullptr;
+
+        // images embedded in the asset are keyed by the asset and their index
+        const std::string &uri = image["uri"].asString();
+        const std::string embedded_name = full_path + "#image" + std::to_string(source);
+        if (image.has("bufferView"))
+        {
+            const unsigned char *data = nullptr;
+            std::size_t size = 0;
+            std::string err;
+            if (!asset.getBufferView(image["bufferView"].asInt(-1), data, size, err))
+            {
+                VV_ALERT("Image " + std::to_string(source) + " not loaded: " + err);
+                return nullptr;
+            }
+            return m_texture_manager->load2DImage(embedded_name, data, size);
+        }
+        else if (uri.compare(0, 5, "data:") == 0)
+        {
+            std::vector<unsigned char> data;
+            if (!GltfAsset::decodeDataURI(uri, data))
+            {
+                VV_ALERT("Image " + std::to_string(source) + " has an unsupported data uri");
+                return nullptr;
+            }
+            return m_texture_manager->load2DImage(embedded_name, data.data(), data.size());
+        }
+
+        return m_texture_manager->load2DImage(path, GltfAsset::decodeURI(uri), VK_FORMAT_R8G8B8A8_UNORM, false);
     }
 }
@@ -0,0 +1,250 @@
+#include <cstring>
+#include <cfloat>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <string>
+
+#include "NumberParser.h"
+
+namespace vv
+{
+    namespace
+    {
+        /*
+         * A decimal number split into its significant digits and a power of ten.
+         */
+        struct Decimal
+        {
+            uint64_t mantissa = 0;
+            int32_t exponent  = 0;
+            bool negative     = false;
+            bool truncated    = false; // non-zero digits beyond what fits into mantissa were dropped
+        };
+
+        const int max_significant_digits = 19;
+        const int32_t max_exponent = 100000;  // far beyond any representable value, keeps the arithmetic from overflowing
+
+        const double exact_powers_of_ten[] =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        const float exact_powers_of_ten_f[] =
+        {
+            1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+        };
+
+
+        bool isDigit(char c)
+        {
+            return static_cast<unsigned char>(c - '0') < 10;
+        }
+
+
+        /*
+         * Returns a pointer past the number, or begin if there is none.
+         */
+        const char* scanDecimal(const char *begin, const char *end, Decimal &decimal)
+        {
+            const char *cursor = begin;
+            if (cursor < end && (*cursor == '+' || *cursor == '-'))
+            {
+                decimal.negative = (*cursor == '-');
+                ++cursor;
+            }
+
+            int significant_digits = 0;
+            bool has_digits = false;
+
+            for (; cursor < end && isDigit(*cursor); ++cursor)
+            {
+                has_digits = true;
+                if (significant_digits < max_significant_digits)
+                {
+                    decimal.mantissa = decimal.mantissa * 10 + static_cast<uint64_t>(*cursor - '0');
+                    if (decimal.mantissa > 0)
+                        ++significant_digits;
+                }
+                else
+                {
+                    ++decimal.exponent;
+                    decimal.truncated |= (*cursor != '0');
+                }
+            }
+
+            if (cursor < end && *cursor == '.')
+            {
+                ++cursor;
+                for (; cursor < end && isDigit(*cursor); ++cursor)
+                {
+                    has_digits = true;
+                    if (significant_digits < max_significant_digits)
+                    {
+                        decimal.mantissa = decimal.mantissa * 10 + static_cast<uint64_t>(*cursor - '0');
+                        --decimal.exponent;
+                        if (decimal.mantissa > 0)
+                            ++significant_digits;
+                    }
+                    else
+                        decimal.truncated |= (*cursor != '0');
+                }
+            }
+
+            if (!has_digits)
+                return begin;
+
+            // an exponent marker without digits isn't part of the number
+            if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+            {
+                const char *exponent_cursor = cursor + 1;
+                bool negative_exponent = false;
+                if (exponent_cursor < end && (*exponent_cursor == '+' || *exponent_cursor == '-'))
+                {
+                    negative_exponent = (*exponent_cursor == '-');
+                    ++exponent_cursor;
+                }
+
+                if (exponent_cursor < end && isDigit(*exponent_cursor))
+                {
+                    int32_t exponent = 0;
+                    for (; exponent_cursor < end && isDigit(*exponent_cursor); ++exponent_cursor)
+                        if (exponent < max_exponent)
+                            exponent = exponent * 10 + (*exponent_cursor - '0');
+
+                    decimal.exponent += negative_exponent ? -exponent : exponent;
+                    cursor = exponent_cursor;
+                }
+            }
+
+            return cursor;
+        }
+
+
+        /*
+         * Clinger's fast path: both operands are exactly representable, so the single rounding of the multiplication or
+         * division is the correct rounding of the decimal.
+         */
+        bool fastDouble(const Decimal &decimal, double &value)
+        {
+            if (decimal.truncated || decimal.mantissa > (1ull << 53) || decimal.exponent < -22 || decimal.exponent > 22)
+                return false;
+
+            value = static_cast<double>(decimal.mantissa);
+            if (decimal.exponent < 0)
+                value /= exact_powers_of_ten[-decimal.exponent];
+            else
+                value *= exact_powers_of_ten[decimal.exponent];
+            if (decimal.negative)
+                value = -value;
+            return true;
+        }
+
+
+        bool fastFloat(const Decimal &decimal, float &value)
+        {
+            if (!decimal.truncated && decimal.mantissa <= (1u << 24) && decimal.exponent >= -10 && decimal.exponent <= 10)
+            {
+                value = static_cast<float>(decimal.mantissa);
+                if (decimal.exponent < 0)
+                    value /= exact_powers_of_ten_f[-decimal.exponent];
+                else
+                    value *= exact_powers_of_ten_f[decimal.exponent];
+                if (decimal.negative)
+                    value = -value;
+                return true;
+            }
+
+            // rounding the exact double to float is only wrong if it landed exactly halfway between two floats
+            double exact = 0.0;
+            if (!fastDouble(decimal, exact))
+                return false;
+
+            double magnitude = exact < 0.0 ? -exact : exact;
+            if (magnitude < FLT_MIN || magnitude > FLT_MAX)
+                return false;
+
+            uint64_t bits = 0;
+            memcpy(&bits, &exact, sizeof(bits));
+            const uint64_t dropped_bits = bits & ((1ull << 29) - 1);
+            if (dropped_bits == (1ull << 28))
+                return false;
+
+            value = static_cast<float>(exact);
+            return true;
+        }
+
+
+        /*
+         * Correct but slow fallback through the standard library, with the C locale regardless of the global one.
+         */
+        template<typename T>
+        void slowParse(const char *begin, const char *end, T &value)
+        {
+            std::istringstream stream(std::string(begin, end));
+            stream.imbue(std::locale::classic());
+            stream >> value;
+
+            // out of range values come back as the largest finite value
+            if (stream.fail() && (value == std::numeric_limits<T>::max() || value == -std::numeric_limits<T>::max()))
+                value = (value < 0) ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+        }
+    }
+
+
+    const char* parseFloat(const char *begin, const char *end, float &value)
+    {
+        Decimal decimal;
+        const char *number_end = scanDecimal(begin, end, decimal);
+        if (number_end == begin)
+            return begin;
+
+        if (decimal.mantissa == 0 && !decimal.truncated)
+            value = decimal.negative ? -0.0f : 0.0f;
+        else if (!fastFloat(decimal, value))
+            slowParse(begin, number_end, value);
+        return number_end;
+    }
+
+
+    const char* parseDouble(const char *begin, const char *end, double &value)
+    {
+        Decimal decimal;
+        const char *number_end = scanDecimal(begin, end, decimal);
+        if (number_end == begin)
+            return begin;
+
+        if (decimal.mantissa == 0 && !decimal.truncated)
+            value = decimal.negative ? -0.0 : 0.0;
+        else if (!fastDouble(decimal, value))
+            slowParse(begin, number_end, value);
+        return number_end;
+    }
+
+
+    const char* parseInt(const char *begin, const char *end, int64_t &value)
+    {
+        const char *cursor = begin;
+        bool negative = false;
+        if (cursor < end && (*cursor == '+' || *cursor == '-'))
+        {
+            negative = (*cursor == '-');
+            ++cursor;
+        }
+
+        if (cursor == end || !isDigit(*cursor))
+            return begin;
+
+        const uint64_t limit = static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+        uint64_t magnitude = 0;
+        for (; cursor < end && isDigit(*cursor); ++cursor)
+        {
+            uint64_t digit = static_cast<uint64_t>(*cursor - '0');
+            magnitude = (magnitude > (limit - digit) / 10) ? limit : magnitude * 10 + digit;
+        }
+
+        value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+        return cursor;
+    }
+}
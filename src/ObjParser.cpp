@@ -0,0 +1,506 @@
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <algorithm>
+
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "NumberParser.h"
+#include "Profiler.h"
+
+namespace vv
+{
+    namespace
+    {
+        // below this, splitting a file costs more in merging than parallel tokenizing gains
+        const std::size_t min_chunk_size = 256 * 1024;
+
+        // chunks per worker. lines differ in cost, e.g. faces against vertices, so a few more chunks balance the load.
+        const std::size_t chunks_per_thread = 4;
+
+        /*
+         * Face vertex as parsed. Components flagged in relative were negative in the file and are still relative to the
+         * attribute counts of the chunk.
+         */
+        struct FaceVertex
+        {
+            tinyobj::index_t index;
+            unsigned char relative;
+        };
+
+        const unsigned char relative_vertex   = 1;
+        const unsigned char relative_normal   = 2;
+        const unsigned char relative_texcoord = 4;
+
+
+        bool isSpace(char c)
+        {
+            return c == ' ' || c == '\t';
+        }
+
+
+        const char* skipSpace(const char *cursor, const char *end)
+        {
+            while (cursor < end && isSpace(*cursor))
+                ++cursor;
+            return cursor;
+        }
+
+
+        const char* findSpace(const char *cursor, const char *end)
+        {
+            while (cursor < end && !isSpace(*cursor))
+                ++cursor;
+            return cursor;
+        }
+
+
+        bool startsWithKeyword(const char *cursor, const char *end, const char *keyword, std::size_t length)
+        {
+            return static_cast<std::size_t>(end - cursor) > length && memcmp(cursor, keyword, length) == 0 && isSpace(cursor[length]);
+        }
+
+
+        /*
+         * Reads the next whitespace separated float. Like tinyobj, anything that doesn't start with a number yields
+         * default_value and is skipped.
+         */
+        float readFloat(const char *&cursor, const char *end, float default_value)
+        {
+            cursor = skipSpace(cursor, end);
+            const char *token_end = findSpace(cursor, end);
+            float value = default_value;
+            parseFloat(cursor, token_end, value);
+            cursor = token_end;
+            return value;
+        }
+
+
+        /*
+         * Reads the next whitespace separated word.
+         */
+        std::string readName(const char *cursor, const char *end)
+        {
+            cursor = skipSpace(cursor, end);
+            return std::string(cursor, findSpace(cursor, end));
+        }
+
+
+        /*
+         * Reads one component of a face vertex and makes it zero based. Negative indices count back from attribute_count,
+         * the number of attributes read so far.
+         */
+        int readIndex(const char *&cursor, const char *end, std::size_t attribute_count, bool &relative)
+        {
+            int64_t raw = 0;
+            parseInt(cursor, end, raw);
+            while (cursor < end && *cursor != '/' && !isSpace(*cursor))
+                ++cursor;
+
+            relative = (raw < 0);
+            if (raw > 0)
+                return static_cast<int>(raw - 1);
+            if (raw < 0)
+                return static_cast<int>(static_cast<int64_t>(attribute_count) + raw);
+            return 0;
+        }
+
+
+        /*
+         * Parses i, i/j, i//k or i/j/k.
+         */
+        FaceVertex readFaceVertex(const char *&cursor, const char *end, std::size_t vertex_count, std::size_t normal_count,
+                                  std::size_t texcoord_count)
+        {
+            FaceVertex vertex;
+            vertex.index.vertex_index = -1;
+            vertex.index.normal_index = -1;
+            vertex.index.texcoord_index = -1;
+            vertex.relative = 0;
+
+            bool relative = false;
+            vertex.index.vertex_index = readIndex(cursor, end, vertex_count, relative);
+            vertex.relative |= relative ? relative_vertex : 0;
+            if (cursor == end || *cursor != '/')
+                return vertex;
+
+            ++cursor;
+            if (cursor < end && *cursor == '/')
+            {
+                ++cursor;
+                vertex.index.normal_index = readIndex(cursor, end, normal_count, relative);
+                vertex.relative |= relative ? relative_normal : 0;
+                return vertex;
+            }
+
+            vertex.index.texcoord_index = readIndex(cursor, end, texcoord_count, relative);
+            vertex.relative |= relative ? relative_texcoord : 0;
+            if (cursor == end || *cursor != '/')
+                return vertex;
+
+            ++cursor;
+            vertex.index.normal_index = readIndex(cursor, end, normal_count, relative);
+            vertex.relative |= relative ? relative_normal : 0;
+            return vertex;
+        }
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Public
+	void ObjParser::create(ThreadPool *threads)
+	{
+        m_threads = threads;
+	}
+
+
+	void ObjParser::shutDown()
+	{
+        m_threads = nullptr;
+	}
+
+
+    bool ObjParser::load(const std::string &path, tinyobj::attrib_t &attrib, std::vector<tinyobj::shape_t> &shapes,
+                         std::vector<tinyobj::material_t> &materials, std::string &err, tinyobj::MaterialReader *material_reader,
+                         bool triangulate)
+    {
+        VV_PROFILE_FUNCTION();
+        m_stats = ObjParseStats();
+        attrib = tinyobj::attrib_t();
+        shapes.clear();
+
+        MappedFile file;
+        if (!file.create(path))
+        {
+            err = "Cannot open file " + path;
+            return false;
+        }
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+        const char *data = reinterpret_cast<const char *>(file.getData());
+
+        std::vector<Chunk> chunks;
+        splitChunks(data, data + file.getSize(), chunks);
+
+        for (auto &chunk : chunks)
+        {
+            Chunk *chunk_ptr = &chunk;
+            m_threads->submit([chunk_ptr, triangulate](uint32_t)
+            {
+                parseChunk(*chunk_ptr, triangulate);
+            });
+        }
+        m_threads->wait();
+
+        auto parse_time = std::chrono::high_resolution_clock::now();
+
+        // prefix sums give every chunk the place of its attributes in the merged arrays
+        std::size_t vertex_count = 0;
+        std::size_t normal_count = 0;
+        std::size_t texcoord_count = 0;
+        for (auto &chunk : chunks)
+        {
+            chunk.first_vertex = vertex_count;
+            chunk.first_normal = normal_count;
+            chunk.first_texcoord = texcoord_count;
+            vertex_count += chunk.vertices.size() / 3;
+            normal_count += chunk.normals.size() / 3;
+            texcoord_count += chunk.texcoords.size() / 2;
+        }
+
+        attrib.vertices.resize(vertex_count * 3);
+        attrib.normals.resize(normal_count * 3);
+        attrib.texcoords.resize(texcoord_count * 2);
+
+        for (auto &chunk : chunks)
+        {
+            Chunk *chunk_ptr = &chunk;
+            tinyobj::attrib_t *attrib_ptr = &attrib;
+            m_threads->submit([chunk_ptr, attrib_ptr](uint32_t)
+            {
+                mergeAttributes(*chunk_ptr, *attrib_ptr);
+            });
+        }
+        m_threads->wait();
+
+        bool success = buildShapes(chunks, shapes, materials, err, material_reader);
+        m_stats.file_size = file.getSize();
+        file.shutDown();
+
+        auto end_time = std::chrono::high_resolution_clock::now();
+        m_stats.chunk_count = static_cast<uint32_t>(chunks.size());
+        m_stats.parse_ms = std::chrono::duration<double, std::milli>(parse_time - start_time).count();
+        m_stats.merge_ms = std::chrono::duration<double, std::milli>(end_time - parse_time).count();
+        return success;
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Private
+    void ObjParser::splitChunks(const char *begin, const char *end, std::vector<Chunk> &chunks) const
+    {
+        const std::size_t size = static_cast<std::size_t>(end - begin);
+        const std::size_t chunk_size = std::max(min_chunk_size, size / (m_threads->getThreadCount() * chunks_per_thread) + 1);
+
+        const char *cursor = begin;
+        while (cursor < end)
+        {
+            const char *chunk_end = cursor + std::min(chunk_size, static_cast<std::size_t>(end - cursor));
+
+            // extend to the end of the line the split landed in
+            if (chunk_end < end)
+            {
+                const char *newline = static_cast<const char *>(memchr(chunk_end, '\n', static_cast<std::size_t>(end - chunk_end)));
+                chunk_end = newline ? newline + 1 : end;
+            }
+
+            chunks.push_back(Chunk());
+            chunks.back().begin = cursor;
+            chunks.back().end = chunk_end;
+            cursor = chunk_end;
+        }
+    }
+
+
+    void ObjParser::parseChunk(Chunk &chunk, bool triangulate)
+    {
+        VV_PROFILE_FUNCTION();
+        std::vector<FaceVertex> face;
+
+        // emits a face vertex and remembers which of its components still need the preceding chunks' counts
+        auto add_index = [&chunk](const FaceVertex &vertex)
+        {
+            const std::size_t slot = chunk.indices.size();
+            chunk.indices.push_back(vertex.index);
+            if (vertex.relative & relative_vertex)
+                chunk.relative_vertices.push_back(slot);
+            if (vertex.relative & relative_normal)
+                chunk.relative_normals.push_back(slot);
+            if (vertex.relative & relative_texcoord)
+                chunk.relative_texcoords.push_back(slot);
+        };
+
+        auto add_statement = [&chunk](Statement::Type type, std::string name)
+        {
+            Statement statement;
+            statement.type = type;
+            statement.name = std::move(name);
+            statement.face_count = chunk.num_face_vertices.size();
+            statement.index_count = chunk.indices.size();
+            chunk.statements.push_back(std::move(statement));
+        };
+
+        const char *cursor = chunk.begin;
+        while (cursor < chunk.end)
+        {
+            const char *line_end = static_cast<const char *>(memchr(cursor, '\n', static_cast<std::size_t>(chunk.end - cursor)));
+            if (!line_end)
+                line_end = chunk.end;
+
+            const char *token = skipSpace(cursor, line_end);
+            const char *end = line_end;
+            if (end > token && end[-1] == '\r')
+                --end;
+            cursor = (line_end < chunk.end) ? line_end + 1 : chunk.end;
+
+            if (token == end || *token == '#')
+                continue;
+
+            const std::size_t length = static_cast<std::size_t>(end - token);
+            if (token[0] == 'v' && length > 1 && isSpace(token[1]))
+            {
+                token += 2;
+                float x = readFloat(token, end, 0.0f);
+                float y = readFloat(token, end, 0.0f);
+                float z = readFloat(token, end, 0.0f);
+                chunk.vertices.push_back(x);
+                chunk.vertices.push_back(y);
+                chunk.vertices.push_back(z);
+            }
+            else if (token[0] == 'v' && length > 2 && token[1] == 'n' && isSpace(token[2]))
+            {
+                token += 3;
+                float x = readFloat(token, end, 0.0f);
+                float y = readFloat(token, end, 0.0f);
+                float z = readFloat(token, end, 0.0f);
+                chunk.normals.push_back(x);
+                chunk.normals.push_back(y);
+                chunk.normals.push_back(z);
+            }
+            else if (token[0] == 'v' && length > 2 && token[1] == 't' && isSpace(token[2]))
+            {
+                token += 3;
+                float u = readFloat(token, end, 0.0f);
+                float v = readFloat(token, end, 0.0f);
+                chunk.texcoords.push_back(u);
+                chunk.texcoords.push_back(v);
+            }
+            else if (token[0] == 'f' && length > 1 && isSpace(token[1]))
+            {
+                face.clear();
+                token = skipSpace(token + 2, end);
+                while (token < end)
+                {
+                    face.push_back(readFaceVertex(token, end, chunk.vertices.size() / 3, chunk.normals.size() / 3, chunk.texcoords.size() / 2));
+                    token = skipSpace(token, end);
+                }
+
+                if (triangulate)
+                {
+                    // fan around the first vertex, as tinyobj does. degenerate faces produce nothing.
+                    for (std::size_t k = 2; k < face.size(); ++k)
+                    {
+                        add_index(face[0]);
+                        add_index(face[k - 1]);
+                        add_index(face[k]);
+                        chunk.num_face_vertices.push_back(3);
+                    }
+                }
+                else if (!face.empty())
+                {
+                    for (const auto &vertex : face)
+                        add_index(vertex);
+                    chunk.num_face_vertices.push_back(static_cast<unsigned char>(face.size()));
+                }
+            }
+            else if (startsWithKeyword(token, end, "usemtl", 6))
+                add_statement(Statement::UseMaterial, readName(token + 7, end));
+            else if (startsWithKeyword(token, end, "mtllib", 6))
+                add_statement(Statement::MaterialLibrary, readName(token + 7, end));
+            else if (token[0] == 'g' && length > 1 && isSpace(token[1]))
+                add_statement(Statement::Group, readName(token + 2, end));
+            else if (token[0] == 'o' && length > 1 && isSpace(token[1]))
+                add_statement(Statement::Object, readName(token + 2, end));
+
+            // anything else, like smoothing groups or subdivision tags, is ignored
+        }
+    }
+
+
+    void ObjParser::mergeAttributes(Chunk &chunk, tinyobj::attrib_t &attrib)
+    {
+        if (!chunk.vertices.empty())
+            memcpy(attrib.vertices.data() + chunk.first_vertex * 3, chunk.vertices.data(), chunk.vertices.size() * sizeof(float));
+        if (!chunk.normals.empty())
+            memcpy(attrib.normals.data() + chunk.first_normal * 3, chunk.normals.data(), chunk.normals.size() * sizeof(float));
+        if (!chunk.texcoords.empty())
+            memcpy(attrib.texcoords.data() + chunk.first_texcoord * 2, chunk.texcoords.data(), chunk.texcoords.size() * sizeof(float));
+
+        for (std::size_t slot : chunk.relative_vertices)
+            chunk.indices[slot].vertex_index += static_cast<int>(chunk.first_vertex);
+        for (std::size_t slot : chunk.relative_normals)
+            chunk.indices[slot].normal_index += static_cast<int>(chunk.first_normal);
+        for (std::size_t slot : chunk.relative_texcoords)
+            chunk.indices[slot].texcoord_index += static_cast<int>(chunk.first_texcoord);
+
+        // the chunk's copies are no longer needed
+        std::vector<float>().swap(chunk.vertices);
+        std::vector<float>().swap(chunk.normals);
+        std::vector<float>().swap(chunk.texcoords);
+    }
+
+
+    bool ObjParser::buildShapes(const std::vector<Chunk> &chunks, std::vector<tinyobj::shape_t> &shapes, std::vector<tinyobj::material_t> &materials,
+                                std::string &err, tinyobj::MaterialReader *material_reader)
+    {
+        VV_PROFILE_FUNCTION();
+
+        // faces seen since the last time they were assigned a material
+        struct FaceRange
+        {
+            const Chunk *chunk;
+            std::size_t first_face;
+            std::size_t face_count;
+            std::size_t first_index;
+            std::size_t index_count;
+        };
+
+        std::map<std::string, int> material_map;
+        std::vector<FaceRange> pending;
+        int material = -1;
+        std::string name;
+        tinyobj::shape_t shape;
+
+        auto add_pending = [&pending](const Chunk &chunk, std::size_t first_face, std::size_t face_end, std::size_t first_index, std::size_t index_end)
+        {
+            if (face_end > first_face)
+                pending.push_back({ &chunk, first_face, face_end - first_face, first_index, index_end - first_index });
+        };
+
+        auto export_pending = [&]()
+        {
+            if (pending.empty())
+                return false;
+
+            tinyobj::mesh_t &mesh = shape.mesh;
+            for (const auto &range : pending)
+            {
+                auto indices = range.chunk->indices.begin() + range.first_index;
+                mesh.indices.insert(mesh.indices.end(), indices, indices + range.index_count);
+                auto num_face_vertices = range.chunk->num_face_vertices.begin() + range.first_face;
+                mesh.num_face_vertices.insert(mesh.num_face_vertices.end(), num_face_vertices, num_face_vertices + range.face_count);
+                mesh.material_ids.insert(mesh.material_ids.end(), range.face_count, material);
+            }
+            shape.name = name;
+            pending.clear();
+            return true;
+        };
+
+        for (const auto &chunk : chunks)
+        {
+            std::size_t face_cursor = 0;
+            std::size_t index_cursor = 0;
+
+            for (const auto &statement : chunk.statements)
+            {
+                add_pending(chunk, face_cursor, statement.face_count, index_cursor, statement.index_count);
+                face_cursor = statement.face_count;
+                index_cursor = statement.index_count;
+
+                switch (statement.type)
+                {
+                    case Statement::UseMaterial:
+                    {
+                        auto it = material_map.find(statement.name);
+                        int new_material = (it != material_map.end()) ? it->second : -1;
+
+                        // faces so far keep the previous material, they stay in the current shape
+                        if (new_material != material)
+                        {
+                            export_pending();
+                            material = new_material;
+                        }
+                        break;
+                    }
+
+                    case Statement::MaterialLibrary:
+                    {
+                        if (!material_reader)
+                            break;
+
+                        std::string material_err;
+                        bool loaded = (*material_reader)(statement.name, &materials, &material_map, &material_err);
+                        err += material_err;
+                        if (!loaded)
+                            return false;
+                        break;
+                    }
+
+                    case Statement::Group:
+                    case Statement::Object:
+                    {
+                        if (export_pending() || !shape.mesh.indices.empty())
+                            shapes.push_back(std::move(shape));
+                        shape = tinyobj::shape_t();
+                        name = statement.name;
+                        break;
+                    }
+                }
+            }
+
+            add_pending(chunk, face_cursor, chunk.num_face_vertices.size(), index_cursor, chunk.indices.size());
+        }
+
+        if (export_pending() || !shape.mesh.indices.empty())
+            shapes.push_back(std::move(shape));
+        return true;
+    }
+}
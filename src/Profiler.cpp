@@ -0,0 +1,140 @@
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "Profiler.h"
+
+namespace vv
+{
+    Profiler* Profiler::m_instance = nullptr;
+
+    // set once per thread, buffers live until the process exits since worker threads may outlive a capture
+    static thread_local ProfileThreadBuffer *t_thread_buffer = nullptr;
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Public
+    Profiler* Profiler::inst()
+    {
+        if (!m_instance)
+            m_instance = new Profiler;
+        return m_instance;
+    }
+
+
+    void Profiler::setCapture(const std::string &file_name, uint64_t first_frame, uint64_t last_frame)
+    {
+        m_file_name = file_name;
+        m_first_frame = first_frame;
+        m_last_frame = last_frame;
+        m_capture_pending = true;
+
+        // loading happens before the first frame is marked
+        m_capturing.store(first_frame == 0, std::memory_order_relaxed);
+    }
+
+
+    void Profiler::beginFrame(uint64_t frame_number)
+    {
+        if (!m_capture_pending)
+            return;
+
+        if (frame_number > m_last_frame)
+        {
+            m_capturing.store(false, std::memory_order_relaxed);
+            writeTrace();
+            m_capture_pending = false;
+            return;
+        }
+
+        m_capturing.store(frame_number >= m_first_frame, std::memory_order_relaxed);
+    }
+
+
+    void Profiler::flush()
+    {
+        if (!m_capture_pending)
+            return;
+
+        m_capturing.store(false, std::memory_order_relaxed);
+        writeTrace();
+        m_capture_pending = false;
+    }
+
+
+    void Profiler::addEvent(const char *name, uint64_t start_ns, uint64_t end_ns)
+    {
+        getThreadBuffer()->events.push_back({ name, start_ns, end_ns - start_ns });
+    }
+
+
+    uint64_t Profiler::now()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Private
+    Profiler::Profiler()
+        : m_capturing(false)
+    {
+    }
+
+
+    ProfileThreadBuffer* Profiler::getThreadBuffer()
+    {
+        if (t_thread_buffer)
+            return t_thread_buffer;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        t_thread_buffer = new ProfileThreadBuffer;
+        t_thread_buffer->thread_index = static_cast<uint32_t>(m_thread_buffers.size());
+        t_thread_buffer->events.reserve(4096);
+        m_thread_buffers.push_back(t_thread_buffer);
+        return t_thread_buffer;
+    }
+
+
+    void Profiler::writeTrace()
+    {
+        std::ofstream file(m_file_name);
+        if (!file.is_open())
+            throw std::runtime_error("Could not open trace file " + m_file_name + " for writing");
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // chrome trace timestamps are in microseconds, fractions keep the nanosecond resolution
+        uint64_t base_ns = UINT64_MAX;
+        for (auto buffer : m_thread_buffers)
+            for (const auto &event : buffer->events)
+                base_ns = std::min(base_ns, event.start_ns);
+
+        file.precision(3);
+        file << std::fixed;
+        file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+        bool first = true;
+        std::size_t event_count = 0;
+        for (auto buffer : m_thread_buffers)
+        {
+            file << (first ? "" : ",") << std::endl;
+            file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->thread_index
+                 << ",\"args\":{\"name\":\"thread " << buffer->thread_index << "\"}}";
+            first = false;
+
+            for (const auto &event : buffer->events)
+            {
+                file << "," << std::endl;
+                file << "{\"name\":\"" << event.name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->thread_index
+                     << ",\"ts\":" << (event.start_ns - base_ns) / 1000.0 << ",\"dur\":" << event.duration_ns / 1000.0 << "}";
+            }
+
+            event_count += buffer->events.size();
+            buffer->events.clear();
+        }
+
+        file << std::endl << "]}" << std::endl;
+        std::cout << "Wrote " << event_count << " profiler zones to " << m_file_name << std::endl;
+    }
+}
@@ -0,0 +1,327 @@
+#include <algorithm>
+
+#include "RangeAllocator.h"
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+namespace vv
+{
+    namespace
+    {
+        uint32_t findMostSignificantBit(uint64_t value)
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanReverse64(&index, value);
+            return static_cast<uint32_t>(index);
+#else
+            return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+        }
+
+
+        uint32_t findLeastSignificantBit(uint64_t value)
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward64(&index, value);
+            return static_cast<uint32_t>(index);
+#else
+            return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+        }
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////// Public
+    void RangeAllocator::create(uint64_t size)
+    {
+        m_ranges.clear();
+        m_unused_ranges.clear();
+        m_fl_bitmap = 0;
+        for (uint32_t fl = 0; fl < m_fl_count; ++fl)
+        {
+            m_sl_bitmap[fl] = 0;
+            for (uint32_t sl = 0; sl < m_sl_count; ++sl)
+                m_free_heads[fl][sl] = invalid_handle;
+        }
+
+        m_size = size;
+        m_used_size = 0;
+        m_allocation_count = 0;
+
+        m_first_range = createRange(0, size);
+        insertFreeRange(m_first_range);
+    }
+
+
+    void RangeAllocator::shutDown()
+    {
+        m_ranges.clear();
+        m_unused_ranges.clear();
+        m_first_range = invalid_handle;
+        m_size = 0;
+        m_used_size = 0;
+        m_allocation_count = 0;
+    }
+
+
+    bool RangeAllocator::allocate(uint64_t size, uint64_t alignment, uint64_t &offset, Handle &handle)
+    {
+        if (size == 0)
+            size = 1;
+        alignment = std::max<uint64_t>(alignment, 1);
+
+        // any range this large fits the request no matter where it starts
+        Handle found = findFreeRange(size + alignment - 1);
+
+        // rounding up skips smaller ranges that may still fit, e.g. the only range of a block sized for one resource
+        if (found == invalid_handle)
+            found = findFittingRange(size, alignment);
+        if (found == invalid_handle)
+            return false;
+
+        removeFreeRange(found);
+
+        uint64_t aligned_offset = (m_ranges[found].offset + alignment - 1) & ~(alignment - 1);
+        uint64_t padding = aligned_offset - m_ranges[found].offset;
+
+        // neighbours of a free range are never free themselves, so the padding becomes a free range of its own
+        if (padding > 0)
+        {
+            splitTail(found, padding);
+            Handle aligned = m_ranges[found].next_physical;
+            removeFreeRange(aligned);
+            insertFreeRange(found);
+            found = aligned;
+        }
+
+        if (m_ranges[found].size > size)
+            splitTail(found, size);
+
+        m_ranges[found].is_free = false;
+        m_used_size += size;
+        ++m_allocation_count;
+
+        offset = m_ranges[found].offset;
+        handle = found;
+        return true;
+    }
+
+
+    void RangeAllocator::free(Handle handle)
+    {
+        Range *range = &m_ranges[handle];
+        m_used_size -= range->size;
+        --m_allocation_count;
+
+        // merge with the physical neighbours so fragmentation doesn't build up
+        Handle prev = range->prev_physical;
+        if (prev != invalid_handle && m_ranges[prev].is_free)
+        {
+            removeFreeRange(prev);
+            m_ranges[prev].size += m_ranges[handle].size;
+            m_ranges[prev].next_physical = m_ranges[handle].next_physical;
+            if (m_ranges[handle].next_physical != invalid_handle)
+                m_ranges[m_ranges[handle].next_physical].prev_physical = prev;
+            destroyRange(handle);
+            handle = prev;
+        }
+
+        Handle next = m_ranges[handle].next_physical;
+        if (next != invalid_handle && m_ranges[next].is_free)
+        {
+            removeFreeRange(next);
+            m_ranges[handle].size += m_ranges[next].size;
+            m_ranges[handle].next_physical = m_ranges[next].next_physical;
+            if (m_ranges[next].next_physical != invalid_handle)
+                m_ranges[m_ranges[next].next_physical].prev_physical = handle;
+            destroyRange(next);
+        }
+
+        insertFreeRange(handle);
+    }
+
+
+    uint32_t RangeAllocator::getFreeRangeCount() const
+    {
+        uint32_t count = 0;
+        for (Handle handle = m_first_range; handle != invalid_handle; handle = m_ranges[handle].next_physical)
+            if (m_ranges[handle].is_free)
+                ++count;
+        return count;
+    }
+
+
+    uint64_t RangeAllocator::getLargestFreeRange() const
+    {
+        uint64_t largest = 0;
+        for (Handle handle = m_first_range; handle != invalid_handle; handle = m_ranges[handle].next_physical)
+            if (m_ranges[handle].is_free)
+                largest = std::max(largest, m_ranges[handle].size);
+        return largest;
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////// Private
+    void RangeAllocator::mapping(uint64_t size, uint32_t &fl, uint32_t &sl)
+    {
+        // sizes below m_sl_count share the first level and are binned exactly
+        if (size < m_sl_count)
+        {
+            fl = 0;
+            sl = static_cast<uint32_t>(size);
+            return;
+        }
+
+        uint32_t msb = findMostSignificantBit(size);
+        fl = msb - m_sl_bits + 1;
+        sl = static_cast<uint32_t>(size >> (msb - m_sl_bits)) & (m_sl_count - 1);
+    }
+
+
+    RangeAllocator::Handle RangeAllocator::findFreeRange(uint64_t size) const
+    {
+        // round up to the next bin boundary so every range in the bin found is large enough
+        if (size >= m_sl_count)
+        {
+            uint64_t round = (1ull << (findMostSignificantBit(size) - m_sl_bits)) - 1;
+            if (size + round < size)
+                return invalid_handle;
+            size += round;
+        }
+
+        uint32_t fl, sl;
+        mapping(size, fl, sl);
+        if (fl >= m_fl_count)
+            return invalid_handle;
+
+        uint32_t sl_map = m_sl_bitmap[fl] & (~0u << sl);
+        if (sl_map == 0)
+        {
+            uint64_t fl_map = (fl + 1 < 64) ? m_fl_bitmap & (~0ull << (fl + 1)) : 0;
+            if (fl_map == 0)
+                return invalid_handle;
+
+            fl = findLeastSignificantBit(fl_map);
+            sl_map = m_sl_bitmap[fl];
+        }
+
+        sl = findLeastSignificantBit(sl_map);
+        return m_free_heads[fl][sl];
+    }
+
+
+    RangeAllocator::Handle RangeAllocator::findFittingRange(uint64_t size, uint64_t alignment) const
+    {
+        uint32_t fl, sl;
+        mapping(size, fl, sl);
+
+        // only reached when findFreeRange() failed, so just the few bins below its rounded up one hold any ranges
+        for (; fl < m_fl_count; ++fl, sl = 0)
+        {
+            for (uint32_t sl_map = m_sl_bitmap[fl] & (~0u << sl); sl_map != 0; sl_map &= sl_map - 1)
+            {
+                for (Handle handle = m_free_heads[fl][findLeastSignificantBit(sl_map)]; handle != invalid_handle; handle = m_ranges[handle].next_free)
+                {
+                    const Range &range = m_ranges[handle];
+                    uint64_t aligned_offset = (range.offset + alignment - 1) & ~(alignment - 1);
+                    if (aligned_offset + size <= range.offset + range.size)
+                        return handle;
+                }
+            }
+        }
+
+        return invalid_handle;
+    }
+
+
+    void RangeAllocator::insertFreeRange(Handle handle)
+    {
+        Range &range = m_ranges[handle];
+        uint32_t fl, sl;
+        mapping(range.size, fl, sl);
+
+        range.is_free = true;
+        range.prev_free = invalid_handle;
+        range.next_free = m_free_heads[fl][sl];
+        if (range.next_free != invalid_handle)
+            m_ranges[range.next_free].prev_free = handle;
+
+        m_free_heads[fl][sl] = handle;
+        m_fl_bitmap |= 1ull << fl;
+        m_sl_bitmap[fl] |= 1u << sl;
+    }
+
+
+    void RangeAllocator::removeFreeRange(Handle handle)
+    {
+        Range &range = m_ranges[handle];
+        uint32_t fl, sl;
+        mapping(range.size, fl, sl);
+
+        if (range.prev_free != invalid_handle)
+            m_ranges[range.prev_free].next_free = range.next_free;
+        else
+            m_free_heads[fl][sl] = range.next_free;
+
+        if (range.next_free != invalid_handle)
+            m_ranges[range.next_free].prev_free = range.prev_free;
+
+        if (m_free_heads[fl][sl] == invalid_handle)
+        {
+            m_sl_bitmap[fl] &= ~(1u << sl);
+            if (m_sl_bitmap[fl] == 0)
+                m_fl_bitmap &= ~(1ull << fl);
+        }
+
+        range.is_free = false;
+        range.prev_free = invalid_handle;
+        range.next_free = invalid_handle;
+    }
+
+
+    RangeAllocator::Handle RangeAllocator::createRange(uint64_t offset, uint64_t size)
+    {
+        Handle handle;
+        if (!m_unused_ranges.empty())
+        {
+            handle = m_unused_ranges.back();
+            m_unused_ranges.pop_back();
+            m_ranges[handle] = Range();
+        }
+        else
+        {
+            handle = static_cast<Handle>(m_ranges.size());
+            m_ranges.push_back(Range());
+        }
+
+        m_ranges[handle].offset = offset;
+        m_ranges[handle].size = size;
+        return handle;
+    }
+
+
+    void RangeAllocator::destroyRange(Handle handle)
+    {
+        m_unused_ranges.push_back(handle);
+    }
+
+
+    void RangeAllocator::splitTail(Handle handle, uint64_t size)
+    {
+        Handle tail = createRange(m_ranges[handle].offset + size, m_ranges[handle].size - size);
+
+        // createRange may have reallocated m_ranges, so no references are held across it
+        m_ranges[tail].prev_physical = handle;
+        m_ranges[tail].next_physical = m_ranges[handle].next_physical;
+        if (m_ranges[handle].next_physical != invalid_handle)
+            m_ranges[m_ranges[handle].next_physical].prev_physical = tail;
+
+        m_ranges[handle].next_physical = tail;
+        m_ranges[handle].size = size;
+        insertFreeRange(tail);
+    }
+}
@@ -4,8 +4,13 @@
 #include <string>
 #include <fstream>
 #include <chrono>
+#include <algorithm>
+#include <map>
 
 #include "Settings.h"
+#include "Profiler.h"
+#include "GeometryArena.h"
+#include "HostAllocator.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
@@ -16,7 +21,6 @@ namespace vv
         m_device = device;
         m_render_pass = render_pass;
 
-        createDescriptorPool();
         createSceneDescriptorSetLayout();
         createEnvironmentUniforms();
         createMaterialTemplates(); // Load material templates to prepare for model loading queries
@@ -25,7 +29,7 @@ namespace vv
         m_texture_manager->create(m_device);
 
         m_model_manager = new ModelManager();
-        m_model_manager->create(m_device, m_texture_manager, m_descriptor_pool);
+        m_model_manager->create(m_device, m_texture_manager);
 
         m_initialized = true;
     }
@@ -39,12 +43,12 @@ namespace vv
             //       layout not wanting to be destroyed... i'm still not sure what's wrong, but I get
             //       the feeling that it has something to do with me never actually using it to render any models
             if (temp.second.name != "dummy")
-                vkDestroyDescriptorSetLayout(m_device->logical_device, temp.second.material_descriptor_set_layout, nullptr);
+                vkDestroyDescriptorSetLayout(m_device->logical_device, temp.second.material_descriptor_set_layout, HostAllocator::inst()->callbacks(HostObjectType::DescriptorSetLayout));
 
             for (auto &shader : temp.second.shader_modules)
                 shader.shutDown();
 
-            vkDestroyPipelineLayout(m_device->logical_device, temp.second.pipeline_layout, nullptr);
+            vkDestroyPipelineLayout(m_device->logical_device, temp.second.pipeline_layout, HostAllocator::inst()->callbacks(HostObjectType::PipelineLayout));
             temp.second.pipeline->shutDown();
             delete temp.second.pipeline;
         }
@@ -61,17 +65,19 @@ namespace vv
         for (auto &s : m_skyboxes)
             s.shutDown();
 
-        m_scene_uniform_buffer->shutDown();
-        delete m_scene_uniform_buffer;
+        m_uniform_ring.shutDown();
 
-        m_lights_uniform_buffer->shutDown();
-        delete m_lights_uniform_buffer;
+        vkDestroyDescriptorSetLayout(m_device->logical_device, m_scene_descriptor_set_layout, HostAllocator::inst()->callbacks(HostObjectType::DescriptorSetLayout));
+        vkDestroyDescriptorSetLayout(m_device->logical_device, m_environment_descriptor_set_layout, HostAllocator::inst()->callbacks(HostObjectType::DescriptorSetLayout));
+        vkDestroyDescriptorSetLayout(m_device->logical_device, m_radiance_descriptor_set_layout, HostAllocator::inst()->callbacks(HostObjectType::DescriptorSetLayout));
 
-        vkDestroyDescriptorSetLayout(m_device->logical_device, m_scene_descriptor_set_layout, nullptr);
-        vkDestroyDescriptorSetLayout(m_device->logical_device, m_environment_descriptor_set_layout, nullptr);
-        vkDestroyDescriptorSetLayout(m_device->logical_device, m_radiance_descriptor_set_layout, nullptr);
-
-        vkDestroyDescriptorPool(m_device->logical_device, m_descriptor_pool, nullptr);
+        m_device->descriptor_allocator->free(m_scene_descriptor_set);
+        m_device->descriptor_allocator->free(m_environment_descriptor_set);
+        m_device->descriptor_allocator->free(m_radiance_descriptor_set);
+        m_scene_descriptor_set = DescriptorAllocation();
+        m_frame_scene_descriptor_sets.clear();
+        m_environment_descriptor_set = DescriptorAllocation();
+        m_radiance_descriptor_set = DescriptorAllocation();
 
         m_texture_manager->shutDown();
         delete m_texture_manager;
@@ -79,7 +85,7 @@ namespace vv
         m_model_manager->shutDown();
         delete m_model_manager;
 
-        m_scene_descriptor_sets.clear();
+        m_uniform_offsets.clear();
         m_lights.clear();
         m_models.clear();
         m_cameras.clear();
@@ -103,6 +109,7 @@ namespace vv
         VV_ASSERT(material_templates.find(material_template) != material_templates.end(), "ERROR: material_template does not exist");
         m_models.emplace_back(Model());
         m_model_manager->loadModel(path, name, &material_templates[material_template], &m_models[m_models.size() - 1]);
+        m_draw_buckets_dirty = true;
         return &m_models[m_models.size() - 1];
     }
 
@@ -128,9 +135,10 @@ namespace vv
         auto diffuse_map = m_texture_manager->loadCubeMap(path, diffuse_map_name, VK_FORMAT_R32G32B32A32_SFLOAT, true);
         auto specular_map = m_texture_manager->loadCubeMap(path, specular_map_name, VK_FORMAT_R32G32B32A32_SFLOAT, true);
         auto brdf_lut = m_texture_manager->load2DImage(path, brdf_lut_name, VK_FORMAT_R32G32_SFLOAT, false);
+        m_texture_manager->pin(brdf_lut); // bound through the skybox's sets, which never get refreshed
         auto sphere_mesh = m_model_manager->getSphereMesh();
 
-        m_skyboxes[m_skyboxes.size() - 1].create(m_device, m_radiance_descriptor_set, m_environment_descriptor_set, sphere_mesh, radiance_map, diffuse_map, specular_map, brdf_lut);
+        m_skyboxes[m_skyboxes.size() - 1].create(m_device, m_radiance_descriptor_set.set, m_environment_descriptor_set.set, sphere_mesh, radiance_map, diffuse_map, specular_map, brdf_lut);
         return &m_skyboxes[m_skyboxes.size() - 1];
     }
 
@@ -159,78 +167,262 @@ namespace vv
         m_has_active_skybox = true;
         skybox->updateDescriptorSet();
         m_active_skybox = skybox;
+        m_draw_buckets_dirty = true;
     }
 
 
-    void Scene::updateUniformData(VkExtent2D extent, float delta_time)
+    void Scene::updateUniformData(VkExtent2D extent, float delta_time, uint32_t frame_index)
     {
+        VV_PROFILE_FUNCTION();
         VV_ASSERT(m_active_camera != nullptr, "ERROR: main camera has not been initialized");
+        const FrameUniformOffsets &offsets = m_uniform_offsets[frame_index];
 
         for (auto i = 0; i < m_lights.size(); ++i)
         {
             m_lights_ubo.lights[i].position = glm::vec4(m_lights[i].getPosition(), 0.0f);
             m_lights_ubo.lights[i].irradiance = m_lights[i].irradiance;
         }
-        m_lights_uniform_buffer->updateAndTransfer(&m_lights_ubo);
+        m_uniform_ring.write(offsets.lights, &m_lights_ubo, sizeof(LightUBO));
 
         m_scene_ubo.view_mat = m_active_camera->getViewMatrix();
         m_scene_ubo.projection_mat = m_active_camera->getProjectionMatrix(extent.width / static_cast<float>(extent.height));
         m_scene_ubo.camera_position = glm::vec4(m_active_camera->getPosition(), 1.0);
-        m_scene_uniform_buffer->updateAndTransfer(&m_scene_ubo);
+        m_uniform_ring.write(offsets.scene, &m_scene_ubo, sizeof(SceneUBO));
 
-        for (auto &m : m_models)
-            m.updateModelUBO();
+        for (std::size_t i = 0; i < m_models.size(); ++i)
+        {
+            m_models[i].updateModelUBO();
+            m_uniform_ring.write(offsets.models[i], &m_models[i].m_model_ubo, sizeof(ModelUBO));
+        }
     }
 
 
-    void Scene::render(VkCommandBuffer command_buffer)
+    const std::vector<DrawBucket>& Scene::updateDrawBuckets()
     {
-        bool first_run = true;
-        MaterialTemplate *curr_template = nullptr;
+        VV_PROFILE_FUNCTION();
+        bool dirty = m_draw_buckets_dirty;
+
+        // compaction moved geometry, so every recorded draw points at stale offsets
+        bool geometry_moved = m_geometry_generation != m_device->geometry_arena->getGeneration();
+        if (geometry_moved)
+        {
+            m_geometry_generation = m_device->geometry_arena->getGeneration();
+            dirty = true;
+        }
+        for (auto &model : m_models)
+        {
+            if (model.m_draws_dirty || model.m_bucketed_template != model.material_template)
+            {
+                dirty = true;
+                model.m_draws_dirty = false;
+                model.m_bucketed_template = model.material_template;
+            }
+        }
+
+        if (!dirty)
+        {
+            // the skybox binds this frame's transient scene set, so it is recorded again every frame
+            if (!m_draw_buckets.empty() && m_draw_buckets.front().is_skybox)
+                m_draw_buckets.front().version = m_next_bucket_version++;
+            return m_draw_buckets;
+        }
+
+        m_draw_buckets_dirty = false;
+        reserveUniformSlots();
+
+        // group by template so each bucket needs a single pipeline bind. model order is kept within a template.
+        std::map<std::string, std::vector<DrawItem> > template_draws;
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_models.size()); ++i)
+        {
+            Model &model = m_models[i];
+            if (!model.m_visible)
+                continue;
+
+            for (auto &mesh : m_model_manager->m_loaded_meshes[model.m_data_handle])
+            {
+                DrawItem item = {};
+                item.material_template = model.material_template;
+                item.material = m_model_manager->m_loaded_materials[model.m_data_handle][model.m_material_id_set][mesh->material_id];
+                item.mesh = mesh;
+                item.model_index = i;
+                template_draws[model.material_template->name].push_back(item);
+            }
+        }
+
+        std::unordered_map<std::string, const DrawBucket *> previous_buckets;
+        for (auto &bucket : m_draw_buckets)
+            previous_buckets[bucket.key] = &bucket;
+
+        std::vector<DrawBucket> buckets;
 
+        // resolved here so recording threads never touch the template map
+        m_skybox_template = m_has_active_skybox ? &material_templates["skybox"] : nullptr;
         if (m_has_active_skybox)
         {
-            auto skybox_template = material_templates["skybox"];
-            skybox_template.pipeline->bind(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS);
-            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skybox_template.pipeline_layout, 0, 1, &m_scene_descriptor_sets[0], 0, nullptr);
+            DrawBucket bucket;
+            bucket.key = "skybox";
+            bucket.is_skybox = true;
+            bucket.version = m_next_bucket_version++;
+            buckets.push_back(bucket);
+        }
 
-            m_active_skybox->bindSkyBoxDescriptorSets(command_buffer, skybox_template.pipeline_layout);
-            m_active_skybox->render(command_buffer);
+        const std::size_t draws_per_chunk = std::max(1u, Settings::inst()->getDrawsPerChunk());
+        for (auto &entry : template_draws)
+        {
+            const std::vector<DrawItem> &draws = entry.second;
+            for (std::size_t first = 0; first < draws.size(); first += draws_per_chunk)
+            {
+                DrawBucket bucket;
+                bucket.key = entry.first + "/" + std::to_string(first / draws_per_chunk);
+                bucket.is_skybox = false;
+                bucket.draws.assign(draws.begin() + first, draws.begin() + std::min(first + draws_per_chunk, draws.size()));
+
+                // unchanged buckets keep their version so their recorded commands are reused
+                auto previous = previous_buckets.find(bucket.key);
+                if (!geometry_moved && previous != previous_buckets.end() && previous->second->draws == bucket.draws)
+                    bucket.version = previous->second->version;
+                else
+                    bucket.version = m_next_bucket_version++;
+
+                buckets.push_back(bucket);
+            }
         }
 
-        int i = 0;
-        for (auto &model : m_models)
+        m_draw_buckets.swap(buckets);
+        return m_draw_buckets;
+    }
+
+
+    void Scene::recordBucket(VkCommandBuffer command_buffer, uint32_t frame_index, const DrawBucket &bucket) const
+    {
+        VV_PROFILE_FUNCTION();
+        if (bucket.is_skybox)
+        {
+            recordSkyBox(command_buffer, frame_index);
+            return;
+        }
+
+        const FrameUniformOffsets &offsets = m_uniform_offsets[frame_index];
+        const MaterialTemplate *curr_template = nullptr;
+        uint32_t curr_model = UINT32_MAX;
+        uint32_t curr_geometry_page = UINT32_MAX;
+
+        for (const DrawItem &item : bucket.draws)
         {
+            bool template_changed = (curr_template == nullptr) || (curr_template->name != item.material_template->name);
+
             // reduce pipeline state switches as much as possible
-            if (first_run || (curr_template->name != model.material_template->name))
+            if (template_changed)
             {
-                first_run = false;
-                curr_template = model.material_template;
+                curr_template = item.material_template;
                 curr_template->pipeline->bind(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS);
             }
 
-            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, curr_template->pipeline_layout, 0, 1, &m_scene_descriptor_sets[i++], 0, nullptr);
+            if (template_changed || curr_model != item.model_index)
+            {
+                curr_model = item.model_index;
+
+                std::array<uint32_t, 3> model_offsets = { offsets.scene, offsets.models[curr_model], offsets.lights };
+                vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, curr_template->pipeline_layout, 0, 1, &m_scene_descriptor_set.set,
+                                        static_cast<uint32_t>(model_offsets.size()), model_offsets.data());
+
+                // Bind environment lighting descriptor sets
+                if (curr_template->uses_environment_lighting)
+                {
+                    m_active_skybox->bindIBLDescriptorSets(command_buffer, curr_template->pipeline_layout);
+                    m_active_skybox->submitMipLevelPushConstants(command_buffer, curr_template->pipeline_layout);
+                }
+            }
+
+            item.material->bindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS);
 
-            // Bind environment lighting descriptor sets
-            if (model.material_template->uses_environment_lighting)
+            // meshes share the arena's buffers, so geometry is only rebound when the draw lives in another page
+            uint32_t geometry_page = item.mesh->getGeometryPage();
+            if (geometry_page != curr_geometry_page)
             {
-                m_active_skybox->bindIBLDescriptorSets(command_buffer, curr_template->pipeline_layout);
-                m_active_skybox->submitMipLevelPushConstants(command_buffer, curr_template->pipeline_layout);
+                curr_geometry_page = geometry_page;
+                item.mesh->bindBuffers(command_buffer);
             }
+            item.mesh->render(command_buffer);
+        }
+    }
 
-            // Render all submeshes within this model
-            for (auto &mesh : m_model_manager->m_loaded_meshes[model.m_data_handle])
+
+    void Scene::updateResidency(uint64_t frame_number)
+    {
+        VV_PROFILE_FUNCTION();
+        m_model_manager->updateResidency();
+
+        for (auto &bucket : m_draw_buckets)
+        {
+            for (auto &draw : bucket.draws)
+                draw.material->markTexturesUsed(frame_number);
+        }
+        m_texture_manager->updateResidency(frame_number);
+
+        if (m_texture_generation == m_texture_manager->getGeneration())
+            return;
+        m_texture_generation = m_texture_manager->getGeneration();
+
+        m_refreshed_materials.clear();
+        for (auto &model_materials : m_model_manager->m_loaded_materials)
+        {
+            for (auto &material_set : model_materials.second)
             {
-                Material *material = m_model_manager->m_loaded_materials[model.m_data_handle][model.m_material_id_set][mesh->material_id];
-                material->bindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS);
-                mesh->bindBuffers(command_buffer);
-                mesh->render(command_buffer);
+                for (auto &material : material_set.second)
+                {
+                    if (material->refreshTextureDescriptors())
+                        m_refreshed_materials.push_back(material);
+                }
             }
         }
+
+        // the cached command buffers of these buckets bind descriptor sets that are about to be freed
+        for (auto &bucket : m_draw_buckets)
+        {
+            for (auto &draw : bucket.draws)
+            {
+                if (std::find(m_refreshed_materials.begin(), m_refreshed_materials.end(), draw.material) != m_refreshed_materials.end())
+                {
+                    bucket.version = m_next_bucket_version++;
+                    break;
+                }
+            }
+        }
+    }
+
+
+    TextureResidencyStats Scene::getTextureResidencyStats() const
+    {
+        return m_texture_manager->getResidencyStats();
+    }
+
+
+    const std::map<std::string, MeshOptimizationStats>& Scene::getMeshOptimizationStats() const
+    {
+        return m_model_manager->getOptimizationStats();
     }
 
 
     ///////////////////////////////////////////////////////////////////////////////////////////// Private
+    void Scene::recordSkyBox(VkCommandBuffer command_buffer, uint32_t frame_index) const
+    {
+        if (!m_has_active_skybox)
+            return;
+
+        const FrameUniformOffsets &offsets = m_uniform_offsets[frame_index];
+        m_skybox_template->pipeline->bind(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+        // dynamic offsets are consumed in binding order: scene, model, lights
+        std::array<uint32_t, 3> skybox_offsets = { offsets.scene, offsets.skybox_model, offsets.lights };
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_skybox_template->pipeline_layout, 0, 1, &m_frame_scene_descriptor_sets[frame_index],
+                                static_cast<uint32_t>(skybox_offsets.size()), skybox_offsets.data());
+
+        m_active_skybox->bindSkyBoxDescriptorSets(command_buffer, m_skybox_template->pipeline_layout);
+        m_active_skybox->render(command_buffer);
+    }
+
+
     void Scene::createMaterialTemplates()
     {
         std::string shader_file = Settings::inst()->getShaderDirectory() + "shader_info.txt";
@@ -290,7 +482,7 @@ namespace vv
             pipeline_layout_create_info.pPushConstantRanges     = material_template.shader_modules[1].push_constant_ranges.data();
             pipeline_layout_create_info.pushConstantRangeCount  = material_template.shader_modules[1].push_constant_ranges.size();
 
-            VV_CHECK_SUCCESS(vkCreatePipelineLayout(m_device->logical_device, &pipeline_layout_create_info, nullptr, &material_template.pipeline_layout));
+            VV_CHECK_SUCCESS(vkCreatePipelineLayout(m_device->logical_device, &pipeline_layout_create_info, HostAllocator::inst()->callbacks(HostObjectType::PipelineLayout), &material_template.pipeline_layout));
 
             VulkanPipeline *pipeline = new VulkanPipeline();
             pipeline->createGraphicsPipeline(m_device, material_template.pipeline_layout, m_render_pass);
@@ -320,107 +512,124 @@ namespace vv
     }
 
 
-    void Scene::createDescriptorPool()
-    {
-        std::array<VkDescriptorPoolSize, 2> pool_sizes = {};
-        pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        pool_sizes[0].descriptorCount = Settings::inst()->getMaxUniformBuffers();
-        pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        pool_sizes[1].descriptorCount = Settings::inst()->getMaxCombinedImageSamplers();
-
-        VkDescriptorPoolCreateInfo create_info = {};
-        create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        create_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
-        create_info.pPoolSizes = pool_sizes.data();
-        create_info.maxSets = Settings::inst()->getMaxDescriptorSets();
-        create_info.flags = 0; // can be: VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
-
-        // set up global descriptor pool
-        VV_CHECK_SUCCESS(vkCreateDescriptorPool(m_device->logical_device, &create_info, nullptr, &m_descriptor_pool));
-    }
-
-
     void Scene::createSceneDescriptorSetLayout()
     {
         // MVP matrix data
         m_scene_ubo = { glm::mat4(), glm::mat4(), glm::vec4() };
-        m_scene_uniform_buffer = new VulkanBuffer();
-        m_scene_uniform_buffer->create(m_device, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(SceneUBO));
 
         // Lights data
         for (auto i = 0; i < VV_MAX_LIGHTS; ++i)
             m_lights_ubo.lights[i] = { glm::vec4(), glm::vec4() };
 
-        m_lights_uniform_buffer = new VulkanBuffer();
-        m_lights_uniform_buffer->create(m_device, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(LightUBO));
+        // the GPU may still be reading a previous frame's uniforms, so every frame in flight gets its own ring region
+        m_uniform_ring.create(m_device, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, Settings::inst()->getUniformRingFrameSize(),
+                              Settings::inst()->getMaxFramesInFlight());
 
         /// Layout
         std::vector<VkDescriptorSetLayoutBinding> temp_bindings_buffer;
-        temp_bindings_buffer.push_back(createDescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT));
-        temp_bindings_buffer.push_back(createDescriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT));
-        temp_bindings_buffer.push_back(createDescriptorSetLayoutBinding(2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT));
+        temp_bindings_buffer.push_back(createDescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT));
+        temp_bindings_buffer.push_back(createDescriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT));
+        temp_bindings_buffer.push_back(createDescriptorSetLayoutBinding(2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_FRAGMENT_BIT));
         createVulkanDescriptorSetLayout(m_device->logical_device, temp_bindings_buffer, m_scene_descriptor_set_layout);
     }
 
 
     void Scene::allocateSceneDescriptorSets()
     {
-		VkDescriptorSetAllocateInfo scene_alloc_info = {};
-		scene_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		scene_alloc_info.descriptorPool = m_descriptor_pool;
-		scene_alloc_info.descriptorSetCount = 1;
-		scene_alloc_info.pSetLayouts = &m_scene_descriptor_set_layout;
+        m_scene_descriptor_set = m_device->descriptor_allocator->allocate(m_scene_descriptor_set_layout);
+        writeSceneDescriptorSet(m_scene_descriptor_set.set);
+
+        reserveUniformSlots();
+        m_frame_scene_descriptor_sets.assign(Settings::inst()->getMaxFramesInFlight(), VK_NULL_HANDLE);
+    }
 
-        m_scene_descriptor_sets.resize(m_models.size());
 
-        for (int i = 0; i < m_models.size(); ++i)
-        {
-		    VV_CHECK_SUCCESS(vkAllocateDescriptorSets(m_device->logical_device, &scene_alloc_info, &m_scene_descriptor_sets[i]));
-            std::array<VkWriteDescriptorSet, 3> write_sets;
-
-		    VkDescriptorBufferInfo scene_buffer_info = {};
-		    scene_buffer_info.buffer = m_scene_uniform_buffer->buffer;
-		    scene_buffer_info.offset = 0;
-		    scene_buffer_info.range = sizeof(SceneUBO);
-
-		    write_sets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		    write_sets[0].dstSet = m_scene_descriptor_sets[i];
-		    write_sets[0].dstBinding = 0;
-		    write_sets[0].dstArrayElement = 0;
-		    write_sets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		    write_sets[0].descriptorCount = 1; // how many elements to update
-		    write_sets[0].pBufferInfo = &scene_buffer_info;
-            write_sets[0].pNext = NULL;
-
-            VkDescriptorBufferInfo lights_buffer_info = {};
-		    lights_buffer_info.buffer = m_lights_uniform_buffer->buffer;
-		    lights_buffer_info.offset = 0;
-            lights_buffer_info.range = sizeof(LightUBO);
-
-		    write_sets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		    write_sets[1].dstSet = m_scene_descriptor_sets[i];
-		    write_sets[1].dstBinding = 2;
-		    write_sets[1].dstArrayElement = 0;
-		    write_sets[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		    write_sets[1].descriptorCount = 1;
-		    write_sets[1].pBufferInfo = &lights_buffer_info;
-            write_sets[1].pNext = NULL;
-
-            VkDescriptorBufferInfo model_buffer_info = {};
-		    model_buffer_info.buffer = m_models[i].m_model_uniform_buffer->buffer;
-		    model_buffer_info.offset = 0;
-		    model_buffer_info.range = sizeof(ModelUBO);
-
-            write_sets[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		    write_sets[2].dstSet = m_scene_descriptor_sets[i];
-		    write_sets[2].dstBinding = 1;
-		    write_sets[2].dstArrayElement = 0;
-		    write_sets[2].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		    write_sets[2].descriptorCount = 1;
-		    write_sets[2].pBufferInfo = &model_buffer_info;
-            write_sets[2].pNext = NULL;
+    void Scene::allocateFrameDescriptorSets(uint32_t frame_index)
+    {
+        if (!m_has_active_skybox)
+            return;
+
+        m_frame_scene_descriptor_sets[frame_index] = m_device->descriptor_allocator->allocateFrame(m_scene_descriptor_set_layout);
+        writeSceneDescriptorSet(m_frame_scene_descriptor_sets[frame_index]);
+    }
+
+
+    void Scene::writeSceneDescriptorSet(VkDescriptorSet set)
+    {
+        std::array<VkWriteDescriptorSet, 3> write_sets;
+
+		VkDescriptorBufferInfo scene_buffer_info = {};
+		scene_buffer_info.buffer = m_uniform_ring.buffer;
+		scene_buffer_info.offset = 0;
+		scene_buffer_info.range = sizeof(SceneUBO);
+
+		write_sets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write_sets[0].dstSet = set;
+		write_sets[0].dstBinding = 0;
+		write_sets[0].dstArrayElement = 0;
+		write_sets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		write_sets[0].descriptorCount = 1; // how many elements to update
+		write_sets[0].pBufferInfo = &scene_buffer_info;
+        write_sets[0].pNext = NULL;
+
+        VkDescriptorBufferInfo lights_buffer_info = {};
+		lights_buffer_info.buffer = m_uniform_ring.buffer;
+		lights_buffer_info.offset = 0;
+        lights_buffer_info.range = sizeof(LightUBO);
+
+		write_sets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write_sets[1].dstSet = set;
+		write_sets[1].dstBinding = 2;
+		write_sets[1].dstArrayElement = 0;
+		write_sets[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		write_sets[1].descriptorCount = 1;
+		write_sets[1].pBufferInfo = &lights_buffer_info;
+        write_sets[1].pNext = NULL;
+
+        VkDescriptorBufferInfo model_buffer_info = {};
+		model_buffer_info.buffer = m_uniform_ring.buffer;
+		model_buffer_info.offset = 0;
+		model_buffer_info.range = sizeof(ModelUBO);
+
+        write_sets[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write_sets[2].dstSet = set;
+		write_sets[2].dstBinding = 1;
+		write_sets[2].dstArrayElement = 0;
+		write_sets[2].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		write_sets[2].descriptorCount = 1;
+		write_sets[2].pBufferInfo = &model_buffer_info;
+        write_sets[2].pNext = NULL;
 		
-            vkUpdateDescriptorSets(m_device->logical_device, 3, write_sets.data(), 0, nullptr);
+        vkUpdateDescriptorSets(m_device->logical_device, 3, write_sets.data(), 0, nullptr);
+    }
+
+
+    void Scene::reserveUniformSlots()
+    {
+        bool first_reservation = m_uniform_offsets.empty();
+        if (!first_reservation && m_uniform_offsets[0].models.size() == m_models.size())
+            return;
+
+        // the same slot layout is replayed in every frame's region, so the offsets can be baked into cached command buffers.
+        // models are only ever appended, so replaying the allocation hands every existing model its previous offset.
+        m_uniform_offsets.resize(Settings::inst()->getMaxFramesInFlight());
+        for (uint32_t f = 0; f < static_cast<uint32_t>(m_uniform_offsets.size()); ++f)
+        {
+            m_uniform_ring.beginFrame(f);
+            m_uniform_offsets[f].scene = m_uniform_ring.allocate(sizeof(SceneUBO));
+            m_uniform_offsets[f].lights = m_uniform_ring.allocate(sizeof(LightUBO));
+            m_uniform_offsets[f].skybox_model = m_uniform_ring.allocate(sizeof(ModelUBO));
+
+            m_uniform_offsets[f].models.resize(m_models.size());
+            for (std::size_t i = 0; i < m_models.size(); ++i)
+                m_uniform_offsets[f].models[i] = m_uniform_ring.allocate(sizeof(ModelUBO));
+
+            // the skybox shader shares the scene layout but never moves
+            if (first_reservation)
+            {
+                ModelUBO identity = { glm::mat4(), glm::mat4() };
+                m_uniform_ring.write(m_uniform_offsets[f].skybox_model, &identity, sizeof(ModelUBO));
+            }
         }
     }
 
@@ -438,21 +647,8 @@ namespace vv
         createVulkanDescriptorSetLayout(m_device->logical_device, temp_bindings_buffer, m_radiance_descriptor_set_layout);
 
         /// Descriptor Sets
-		VkDescriptorSetAllocateInfo env_alloc_info = {};
-		env_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		env_alloc_info.descriptorPool = m_descriptor_pool;
-		env_alloc_info.descriptorSetCount = 1;
-		env_alloc_info.pSetLayouts = &m_environment_descriptor_set_layout;
-
-		VV_CHECK_SUCCESS(vkAllocateDescriptorSets(m_device->logical_device, &env_alloc_info, &m_environment_descriptor_set));
-
-        VkDescriptorSetAllocateInfo rad_alloc_info = {};
-		rad_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		rad_alloc_info.descriptorPool = m_descriptor_pool;
-		rad_alloc_info.descriptorSetCount = 1;
-		rad_alloc_info.pSetLayouts = &m_radiance_descriptor_set_layout;
-
-		VV_CHECK_SUCCESS(vkAllocateDescriptorSets(m_device->logical_device, &rad_alloc_info, &m_radiance_descriptor_set));
+        m_environment_descriptor_set = m_device->descriptor_allocator->allocate(m_environment_descriptor_set_layout);
+        m_radiance_descriptor_set = m_device->descriptor_allocator->allocate(m_radiance_descriptor_set_layout);
 	}
 
 
@@ -463,7 +659,10 @@ namespace vv
 	    layout_create_info.bindingCount = static_cast<uint32_t>(bindings.size());
 	    layout_create_info.pBindings = bindings.data();
 
-	    VV_CHECK_SUCCESS(vkCreateDescriptorSetLayout(device, &layout_create_info, nullptr, &layout));
+	    VV_CHECK_SUCCESS(vkCreateDescriptorSetLayout(device, &layout_create_info, HostAllocator::inst()->callbacks(HostObjectType::DescriptorSetLayout), &layout));
+
+        // sets of the layout are allocated from pools sized by its bindings
+        m_device->descriptor_allocator->registerLayout(layout, bindings);
     }
 
 
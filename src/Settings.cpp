@@ -1,4 +1,7 @@
 
+#include <thread>
+#include <algorithm>
+
 #include "Settings.h"
 
 namespace vv
@@ -28,12 +31,41 @@ namespace vv
         m_model_directory   = m_asset_directory + "models/";
         m_texture_directory = m_asset_directory + "textures/";
         m_shader_directory  = m_asset_directory + "shaders/";
+        m_mesh_cache_directory = m_asset_directory + "cache/";
+        m_mesh_optimization = true;
         
         m_compute_required  = false;
 
-        m_max_descriptor_sets = 100;
-        m_max_uniform_buffers = 100;
-        m_max_combined_image_samplers = 100;
+        m_max_frames_in_flight = 2;
+        m_uniform_ring_frame_size = 4 * 1024 * 1024;
+        m_upload_batch_size = 64 * 1024 * 1024;
+        m_staging_ring_size = 128 * 1024 * 1024;
+        m_memory_block_size = 64 * 1024 * 1024;
+        m_geometry_page_size = 32 * 1024 * 1024;
+        m_geometry_compaction_threshold = 64;
+        m_recording_thread_count = std::max(1u, std::thread::hardware_concurrency());
+        m_import_thread_count = std::max(1u, std::thread::hardware_concurrency());
+        m_draws_per_chunk = 256;
+        m_frame_arena_size = 1024 * 1024;
+        m_allocation_warmup_frames = 16;
+
+        m_headless = false;
+        m_frame_count = 300;
+        m_readback_path = "";
+        m_benchmark_path = "";
+        m_benchmark_report_path = "benchmark.json";
+        m_camera_record_path = "";
+        m_trace_path = "";
+        m_trace_first_frame = 0;
+        m_trace_last_frame = 100;
+        m_memory_report_path = "";
+        m_host_allocation_report_path = "";
+        m_parse_benchmark_path = "";
+        m_cpu_residency = CPUResidency::ReleaseAfterUpload;
+        m_texture_budget = 0;
+        m_texture_mip_tail_size = 64;
+
+        m_descriptor_sets_per_pool = 64;
     }
 
 
@@ -91,21 +123,33 @@ namespace vv
     }
 
 
-    uint32_t Settings::getMaxDescriptorSets() const
+    std::string Settings::getMeshCacheDirectory() const
+    {
+        return m_mesh_cache_directory;
+    }
+
+
+    bool Settings::isMeshOptimizationEnabled() const
+    {
+        return m_mesh_optimization;
+    }
+
+
+    uint64_t Settings::getTextureBudget() const
     {
-        return m_max_descriptor_sets;
+        return m_texture_budget;
     }
 
 
-    uint32_t Settings::getMaxUniformBuffers() const
+    uint32_t Settings::getTextureMipTailSize() const
     {
-        return m_max_uniform_buffers;
+        return m_texture_mip_tail_size;
     }
 
 
-    uint32_t Settings::getMaxCombinedImageSamplers() const
+    uint32_t Settings::getDescriptorSetsPerPool() const
     {
-        return m_max_combined_image_samplers;
+        return m_descriptor_sets_per_pool;
     }
 
 
@@ -115,6 +159,163 @@ namespace vv
     }
 
 
+    uint32_t Settings::getMaxFramesInFlight() const
+    {
+        return m_max_frames_in_flight;
+    }
+
+
+    uint32_t Settings::getUniformRingFrameSize() const
+    {
+        return m_uniform_ring_frame_size;
+    }
+
+
+    uint32_t Settings::getUploadBatchSize() const
+    {
+        return m_upload_batch_size;
+    }
+
+
+    uint64_t Settings::getStagingRingSize() const
+    {
+        return m_staging_ring_size;
+    }
+
+
+    uint64_t Settings::getMemoryBlockSize() const
+    {
+        return m_memory_block_size;
+    }
+
+
+    uint64_t Settings::getGeometryPageSize() const
+    {
+        return m_geometry_page_size;
+    }
+
+
+    uint32_t Settings::getGeometryCompactionThreshold() const
+    {
+        return m_geometry_compaction_threshold;
+    }
+
+
+    uint32_t Settings::getRecordingThreadCount() const
+    {
+        return m_recording_thread_count;
+    }
+
+
+    uint32_t Settings::getImportThreadCount() const
+    {
+        return m_import_thread_count;
+    }
+
+
+    uint32_t Settings::getDrawsPerChunk() const
+    {
+        return m_draws_per_chunk;
+    }
+
+
+    uint32_t Settings::getFrameArenaSize() const
+    {
+        return m_frame_arena_size;
+    }
+
+
+    uint32_t Settings::getAllocationWarmupFrames() const
+    {
+        return m_allocation_warmup_frames;
+    }
+
+
+    bool Settings::isHeadless() const
+    {
+        return m_headless;
+    }
+
+
+    uint32_t Settings::getFrameCount() const
+    {
+        return m_frame_count;
+    }
+
+
+    std::string Settings::getReadbackPath() const
+    {
+        return m_readback_path;
+    }
+
+
+    std::string Settings::getBenchmarkPath() const
+    {
+        return m_benchmark_path;
+    }
+
+
+    std::string Settings::getBenchmarkReportPath() const
+    {
+        return m_benchmark_report_path;
+    }
+
+
+    std::string Settings::getCameraRecordPath() const
+    {
+        return m_camera_record_path;
+    }
+
+
+    std::string Settings::getTracePath() const
+    {
+        return m_trace_path;
+    }
+
+
+    uint64_t Settings::getTraceFirstFrame() const
+    {
+        return m_trace_first_frame;
+    }
+
+
+    uint64_t Settings::getTraceLastFrame() const
+    {
+        return m_trace_last_frame;
+    }
+
+
+    std::string Settings::getMemoryReportPath() const
+    {
+        return m_memory_report_path;
+    }
+
+
+    const std::map<std::string, uint64_t>& Settings::getMemoryBudgets() const
+    {
+        return m_memory_budgets;
+    }
+
+
+    std::string Settings::getHostAllocationReportPath() const
+    {
+        return m_host_allocation_report_path;
+    }
+
+
+    std::string Settings::getParseBenchmarkPath() const
+    {
+        return m_parse_benchmark_path;
+    }
+
+
+    CPUResidency Settings::getCPUResidency(const std::string &path) const
+    {
+        auto it = m_asset_cpu_residency.find(path);
+        return (it != m_asset_cpu_residency.end()) ? it->second : m_cpu_residency;
+    }
+
+
     void Settings::setWindowWidth(int width)
     {
         m_window_width = width;
@@ -125,4 +326,123 @@ namespace vv
     {
         m_window_height = height;
     }
-}
\ No newline at end of file
+
+
+    void Settings::setMaxFramesInFlight(uint32_t frames)
+    {
+        // more than 3 frames only adds latency without improving CPU/GPU overlap
+        m_max_frames_in_flight = (frames < 1) ? 1 : ((frames > 3) ? 3 : frames);
+    }
+
+
+    void Settings::setRecordingThreadCount(uint32_t thread_count)
+    {
+        m_recording_thread_count = std::max(1u, thread_count);
+    }
+
+
+    void Settings::setHeadless(bool headless)
+    {
+        m_headless = headless;
+    }
+
+
+    void Settings::setFrameCount(uint32_t frame_count)
+    {
+        m_frame_count = frame_count;
+    }
+
+
+    void Settings::setReadbackPath(const std::string &path)
+    {
+        m_readback_path = path;
+    }
+
+
+    void Settings::setBenchmarkPath(const std::string &path)
+    {
+        m_benchmark_path = path;
+    }
+
+
+    void Settings::setBenchmarkReportPath(const std::string &path)
+    {
+        m_benchmark_report_path = path;
+    }
+
+
+    void Settings::setCameraRecordPath(const std::string &path)
+    {
+        m_camera_record_path = path;
+    }
+
+
+    void Settings::setTracePath(const std::string &path)
+    {
+        m_trace_path = path;
+    }
+
+
+    void Settings::setTraceFrames(uint64_t first_frame, uint64_t last_frame)
+    {
+        m_trace_first_frame = first_frame;
+        m_trace_last_frame = std::max(first_frame, last_frame);
+    }
+
+
+    void Settings::setMemoryReportPath(const std::string &path)
+    {
+        m_memory_report_path = path;
+    }
+
+
+    void Settings::setMemoryBudget(const std::string &category, uint64_t bytes)
+    {
+        m_memory_budgets[category] = bytes;
+    }
+
+
+    void Settings::setHostAllocationReportPath(const std::string &path)
+    {
+        m_host_allocation_report_path = path;
+    }
+
+
+    void Settings::setParseBenchmarkPath(const std::string &path)
+    {
+        m_parse_benchmark_path = path;
+    }
+
+
+    void Settings::setCPUResidency(CPUResidency residency)
+    {
+        m_cpu_residency = residency;
+    }
+
+
+    void Settings::setCPUResidency(const std::string &path, CPUResidency residency)
+    {
+        m_asset_cpu_residency[path] = residency;
+    }
+
+
+    void Settings::setTextureBudget(uint64_t bytes)
+    {
+        m_texture_budget = bytes;
+    }
+
+
+    void Settings::setMeshCacheDirectory(const std::string &directory)
+    {
+        // cache paths are built by appending file names
+        m_mesh_cache_directory = directory;
+        if (!m_mesh_cache_directory.empty() && m_mesh_cache_directory.back() != '/' && m_mesh_cache_directory.back() != '\\')
+            m_mesh_cache_directory += '/';
+    }
+
+
+    void Settings::setMeshOptimization(bool enabled)
+    {
+        m_mesh_optimization = enabled;
+    }
+}
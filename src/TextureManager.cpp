@@ -4,12 +4,73 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <cstdio>
 
 #include "Settings.h"
 #include "TextureManager.h"
+#include "Profiler.h"
+#include "MemoryTracker.h"
 
 namespace vv
 {
+    namespace
+    {
+        /*
+         * Box filters RGBA8 texels by halving them until neither dimension exceeds max_size. width and height are updated
+         * to the size of the result.
+         */
+        std::vector<unsigned char> downsampleRGBA8(const unsigned char *texels, uint32_t &width, uint32_t &height, uint32_t max_size)
+        {
+            std::vector<unsigned char> result, scratch;
+            const unsigned char *source = texels;
+
+            while (width > max_size || height > max_size)
+            {
+                uint32_t half_width = std::max(width / 2, 1u);
+                uint32_t half_height = std::max(height / 2, 1u);
+                scratch.resize(half_width * half_height * 4);
+
+                for (uint32_t y = 0; y < half_height; ++y)
+                {
+                    uint32_t y0 = std::min(y * 2, height - 1);
+                    uint32_t y1 = std::min(y * 2 + 1, height - 1);
+                    for (uint32_t x = 0; x < half_width; ++x)
+                    {
+                        uint32_t x0 = std::min(x * 2, width - 1);
+                        uint32_t x1 = std::min(x * 2 + 1, width - 1);
+                        for (uint32_t c = 0; c < 4; ++c)
+                        {
+                            uint32_t sum = source[(y0 * width + x0) * 4 + c] + source[(y0 * width + x1) * 4 + c] +
+                                           source[(y1 * width + x0) * 4 + c] + source[(y1 * width + x1) * 4 + c];
+                            scratch[(y * half_width + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                        }
+                    }
+                }
+
+                result.swap(scratch);
+                source = result.data();
+                width = half_width;
+                height = half_height;
+            }
+
+            if (source == texels)
+                result.assign(texels, texels + width * height * 4);
+            return result;
+        }
+
+
+        /*
+         * Writer for texels that were decoded into memory of their own and only have to be copied over.
+         */
+        TexelWriter copyTexels(const void *data, VkDeviceSize size)
+        {
+            return [data, size](void *texels) { memcpy(texels, data, static_cast<std::size_t>(size)); };
+        }
+    }
+
+
 	///////////////////////////////////////////////////////////////////////////////////////////// Public
 	TextureManager::TextureManager()
 	{
@@ -25,6 +86,19 @@ namespace vv
 	{
         m_device = device;
         m_texture_directory = Settings::inst()->getTextureDirectory();
+        m_loader_threads.create(1);
+
+        // by default leave a quarter of the device's memory to geometry, attachments and other applications
+        m_texture_budget = Settings::inst()->getTextureBudget();
+        if (m_texture_budget == 0)
+        {
+            const VkPhysicalDeviceMemoryProperties &properties = m_device->physical_device_memory_properties;
+            for (uint32_t i = 0; i < properties.memoryHeapCount; ++i)
+            {
+                if (properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+                    m_texture_budget = std::max(m_texture_budget, properties.memoryHeaps[i].size / 4 * 3);
+            }
+        }
 
         // load dummy texture
         SampledTexture *dummy_texture = load2DImage(m_texture_directory, "dummy.png", VK_FORMAT_R8G8B8A8_UNORM, false);
@@ -34,6 +108,21 @@ namespace vv
 
 	void TextureManager::shutDown()
 	{
+        // finishes any decode still pointing into m_resident_textures
+        m_loader_threads.shutDown();
+
+        for (auto &r : m_resident_textures)
+        {
+            if (r.second.pending_image)
+            {
+                r.second.pending_image->shutDown(); delete r.second.pending_image;
+                r.second.pending_image_view->shutDown(); delete r.second.pending_image_view;
+            }
+            stbi_image_free(r.second.reload_ldr_texels);
+            m_device->memory_tracker->removeCPUCopy(MemoryCategory::Texture, r.second.tail_texels.size(), false);
+        }
+        m_resident_textures.clear();
+
         for (auto &t : m_loaded_textures)
         {
             t.second->image->shutDown(); delete t.second->image;
@@ -42,12 +131,15 @@ namespace vv
         }
 
         for (auto &d : m_ldr_texture_array_data_cache)
-            stbi_image_free(d.second);
+            freeTexels(d.second, false);
+        m_ldr_texture_array_data_cache.clear();
+        m_residency_pending.clear();
 	}
 
 
     SampledTexture* TextureManager::load2DImage(std::string path, std::string name, VkFormat format, bool create_mip_levels)
     {
+        VV_PROFILE_FUNCTION();
         std::string file_type = name.substr(name.find_first_of('.') + 1);
 
         // check if geometry has already been loaded
@@ -57,7 +149,7 @@ namespace vv
         if (name == "")
             return m_loaded_textures[m_texture_directory + "dummy.png"];
 
-        if (file_type == "png" || file_type == "jpg")
+        if (file_type == "png" || file_type == "jpg" || file_type == "jpeg")
         {
 		    int stb_format = (format == VK_FORMAT_R8G8B8A8_UNORM) ? STBI_rgb_alpha : 0; // todo: figure out how other formats play with stb
             int width, height, depth, channels;
@@ -71,8 +163,6 @@ namespace vv
                 return m_loaded_textures[m_texture_directory + "dummy.png"];
             }
 
-            m_ldr_texture_array_data_cache[path + name] = texels;
-
             uint32_t size = width * height * 4;
             VkExtent3D extent = {};
             extent.width = static_cast<uint32_t>(width);
@@ -80,13 +170,33 @@ namespace vv
             extent.depth = 1;
             uint32_t mip_levels = (create_mip_levels) ? std::floor(std::log2(std::max(extent.width, extent.height))) + 1 : 1;
 
-            m_loaded_textures[path + name] = loadTexture(texels, size, extent, format, 0, 1, 1, VK_IMAGE_VIEW_TYPE_2D);
+            m_loaded_textures[path + name] = loadTexture(path + name, size, copyTexels(texels, size), extent, format, 0, 1, 1, VK_IMAGE_VIEW_TYPE_2D);
+
+            HostTexels &host_texels = m_ldr_texture_array_data_cache[path + name];
+            host_texels.data = texels;
+            host_texels.size = size;
+            host_texels.stb_format = stb_format;
+            host_texels.release_pending = (Settings::inst()->getCPUResidency(path + name) == CPUResidency::ReleaseAfterUpload);
+            host_texels.texture = m_loaded_textures[path + name];
+            m_device->memory_tracker->addCPUCopy(MemoryCategory::Texture, size);
+            if (host_texels.release_pending)
+                m_residency_pending.push_back(&host_texels);
+
+            // without a mip chain, evictions fall back to a downsampled copy
+            uint32_t tail_size = Settings::inst()->getTextureMipTailSize();
+            if (stb_format == STBI_rgb_alpha && name != "dummy.png" && std::max(extent.width, extent.height) > tail_size)
+            {
+                VkExtent3D tail_extent = extent;
+                std::vector<unsigned char> tail = downsampleRGBA8(texels, tail_extent.width, tail_extent.height, tail_size);
+                trackResidency(m_loaded_textures[path + name], path + name, true, format, extent, 1, tail_extent, 1,
+                               tail.data(), tail.size());
+            }
+
             return m_loaded_textures[path + name];
         }
         else if (file_type == "dds" || file_type == "ktx")
         {
             gli::texture_cube texels(gli::load((path + name).c_str()));
-            m_hdr_texture_array_data_cache[path + name] = static_cast<float *>(texels.data());
 
             // todo: should implement a fallback
             if (texels.empty())
@@ -100,9 +210,26 @@ namespace vv
             extent.depth = 1;
             uint32_t mip_levels = (create_mip_levels) ? static_cast<uint32_t>(texels.levels()) : 1;
 
-            m_loaded_textures[path + name] = loadTexture(texels.data(), texels.size(), extent, fmt,
+            m_loaded_textures[path + name] = loadTexture(path + name, texels.size(), copyTexels(texels.data(), texels.size()), extent, fmt,
                                             0, mip_levels, 1, VK_IMAGE_VIEW_TYPE_2D);
 
+            // evictions keep the levels from the first one no larger than the mip tail size
+            uint32_t tail_mip = 0;
+            while (tail_mip + 1 < mip_levels && std::max(extent.width >> tail_mip, extent.height >> tail_mip) > Settings::inst()->getTextureMipTailSize())
+                ++tail_mip;
+
+            if (tail_mip > 0 && texels.faces() == 1)
+            {
+                VkDeviceSize tail_offset = 0;
+                for (uint32_t level = 0; level < tail_mip; ++level)
+                    tail_offset += texels.size(level);
+
+                VkExtent3D tail_extent = { std::max(extent.width >> tail_mip, 1u), std::max(extent.height >> tail_mip, 1u), 1 };
+                trackResidency(m_loaded_textures[path + name], path + name, false, fmt, extent, mip_levels, tail_extent,
+                               mip_levels - tail_mip, static_cast<const unsigned char *>(texels.data()) + tail_offset,
+                               texels.size() - tail_offset);
+            }
+
             return m_loaded_textures[path + name];
         }
                 
@@ -111,6 +238,48 @@ namespace vv
     }
 
 
+    SampledTexture* TextureManager::load2DImage(const std::string &name, const unsigned char *data, std::size_t size, VkFormat format)
+    {
+        VV_PROFILE_FUNCTION();
+        if (m_loaded_textures.count(name) > 0)
+            return m_loaded_textures[name];
+
+        int stb_format = (format == VK_FORMAT_R8G8B8A8_UNORM) ? STBI_rgb_alpha : 0;
+        int width, height, channels;
+        unsigned char *texels = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, stb_format);
+        if (!texels)
+        {
+            VV_ALERT("Could not decode texture " + name + ". Using dummy texture.");
+            return m_loaded_textures[m_texture_directory + "dummy.png"];
+        }
+
+        VkExtent3D extent = {};
+        extent.width = static_cast<uint32_t>(width);
+        extent.height = static_cast<uint32_t>(height);
+        extent.depth = 1;
+
+        m_loaded_textures[name] = loadTexture(name, width * height * 4, copyTexels(texels, width * height * 4), extent, format, 0, 1, 1, VK_IMAGE_VIEW_TYPE_2D);
+        stbi_image_free(texels);
+        return m_loaded_textures[name];
+    }
+
+
+    SampledTexture* TextureManager::loadConstantImage(const glm::vec4 &color)
+    {
+        unsigned char texel[4];
+        char name[24];
+        for (int c = 0; c < 4; ++c)
+            texel[c] = static_cast<unsigned char>(std::round(glm::clamp(color[c], 0.0f, 1.0f) * 255.0f));
+        snprintf(name, sizeof(name), "constant_%02x%02x%02x%02x", texel[0], texel[1], texel[2], texel[3]);
+
+        // the single texel goes straight into staging memory
+        if (m_loaded_textures.count(name) == 0)
+            m_loaded_textures[name] = loadTexture(name, sizeof(texel), [&texel](void *texels) { memcpy(texels, texel, sizeof(texel)); },
+                                                  { 1, 1, 1 }, VK_FORMAT_R8G8B8A8_UNORM, 0, 1, 1, VK_IMAGE_VIEW_TYPE_2D);
+        return m_loaded_textures[name];
+    }
+
+
     SampledTexture* TextureManager::loadCubeMap(std::string path, std::string name, VkFormat format, bool create_mip_levels)
     {
         std::string file_type = name.substr(name.find_first_of('.') + 1);
@@ -135,7 +304,7 @@ namespace vv
             extent.depth = 1;
             uint32_t mip_levels = static_cast<uint32_t>(cube.levels());
 
-            m_loaded_textures[path + name] = loadTexture(cube.data(), cube.size(), extent, fmt,
+            m_loaded_textures[path + name] = loadTexture(path + name, cube.size(), copyTexels(cube.data(), cube.size()), extent, fmt,
                                             VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, mip_levels, 6, VK_IMAGE_VIEW_TYPE_CUBE);
 
             return m_loaded_textures[path + name];
@@ -145,20 +314,14 @@ namespace vv
     }
 
 
-    SampledTexture* TextureManager::loadTexture(void *data, VkDeviceSize size_in_bytes, VkExtent3D extent, VkFormat format,
-        VkImageCreateFlags flags, uint32_t mip_levels, uint32_t array_layers, VkImageViewType image_view_type)
+    SampledTexture* TextureManager::loadTexture(const std::string &owner, VkDeviceSize size_in_bytes, const TexelWriter &write_texels, VkExtent3D extent,
+        VkFormat format, VkImageCreateFlags flags, uint32_t mip_levels, uint32_t array_layers, VkImageViewType image_view_type)
     {
         SampledTexture *texture = new SampledTexture();
+        createImage(owner, size_in_bytes, write_texels, extent, format, flags, mip_levels, array_layers, image_view_type,
+                    texture->image, texture->image_view);
+        m_resident_bytes += texture->image->getMemorySize();
 
-        texture->image = new VulkanImage();
-        texture->image->create(m_device, extent, format, VK_IMAGE_TYPE_2D, flags, VK_IMAGE_ASPECT_COLOR_BIT, 
-                      mip_levels, array_layers, VK_IMAGE_LAYOUT_PREINITIALIZED, VK_SAMPLE_COUNT_1_BIT);
-        texture->image->updateAndTransfer(data, size_in_bytes);
-        
-        // create image views for each mip level
-        texture->image_view = new VulkanImageView();
-        texture->image_view->create(m_device, texture->image, image_view_type, 0);
-        
         // todo: fix sampler creation. I have it hardcoded atm.
         texture->sampler = new VulkanSampler();
         texture->sampler->create(m_device, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
@@ -169,5 +332,247 @@ namespace vv
     }
 
 
+    void TextureManager::createImage(const std::string &owner, VkDeviceSize size_in_bytes, const TexelWriter &write_texels, VkExtent3D extent, VkFormat format,
+        VkImageCreateFlags flags, uint32_t mip_levels, uint32_t array_layers, VkImageViewType image_view_type,
+        VulkanImage *&image, VulkanImageView *&image_view)
+    {
+        image = new VulkanImage();
+        image->create(m_device, extent, format, VK_IMAGE_TYPE_2D, flags, VK_IMAGE_ASPECT_COLOR_BIT,
+                      mip_levels, array_layers, VK_IMAGE_LAYOUT_PREINITIALIZED, VK_SAMPLE_COUNT_1_BIT, MemoryTag(MemoryCategory::Texture, owner));
+        write_texels(image->beginTransfer(size_in_bytes));
+        image->endTransfer();
+
+        // create image views for each mip level
+        image_view = new VulkanImageView();
+        image_view->create(m_device, image, image_view_type, 0);
+    }
+
+
+    void TextureManager::updateResidency(uint64_t frame)
+    {
+        VV_PROFILE_FUNCTION();
+        m_residency_pending.erase(std::remove_if(m_residency_pending.begin(), m_residency_pending.end(), [this](HostTexels *texels)
+        {
+            if (texels->release_pending && !texels->texture->image->isReady())
+                return false;
+
+            if (texels->release_pending)
+                freeTexels(*texels, true);
+            return true;
+        }), m_residency_pending.end());
+
+        for (auto &entry : m_resident_textures)
+        {
+            ResidentTexture &resident = entry.second;
+            if (resident.state == ResidencyState::Replacing && resident.pending_image->isReady())
+            {
+                swapPendingImage(resident);
+            }
+            else if (resident.state == ResidencyState::Loading && resident.reload_done.load(std::memory_order_acquire))
+            {
+                resident.state = ResidencyState::Resident;
+                if (!resident.reload_failed)
+                {
+                    void *texels = resident.ldr ? resident.reload_ldr_texels : resident.reload_texels.data();
+                    VkDeviceSize size = resident.ldr ? resident.extent.width * resident.extent.height * 4 : resident.reload_texels.size();
+                    createImage(resident.file, size, copyTexels(texels, size), resident.extent, resident.format, 0, resident.mip_levels, 1,
+                                VK_IMAGE_VIEW_TYPE_2D, resident.pending_image, resident.pending_image_view);
+                    m_resident_bytes += resident.pending_image->getMemorySize();
+                    m_resident_bytes -= resident.texture->image->getMemorySize();
+                    resident.state = ResidencyState::Replacing;
+                    resident.evicted = false;
+                    ++m_reload_count;
+                }
+                stbi_image_free(resident.reload_ldr_texels);
+                resident.reload_ldr_texels = nullptr;
+                resident.reload_texels = gli::texture_cube();
+            }
+        }
+
+        // textures that failed to reload stay at their tail instead of hitting the disk every frame
+        for (auto &entry : m_resident_textures)
+        {
+            ResidentTexture &resident = entry.second;
+            if (resident.evicted && resident.state == ResidencyState::Resident && !resident.reload_failed &&
+                resident.texture->last_used_frame + 1 >= frame &&
+                makeRoom(resident.full_size - resident.texture->image->getMemorySize(), frame))
+            {
+                reload(resident);
+            }
+        }
+
+        makeRoom(0, frame);
+    }
+
+
+    void TextureManager::pin(SampledTexture *texture)
+    {
+        auto it = m_resident_textures.find(texture);
+        if (it == m_resident_textures.end())
+            return;
+
+        it->second.pinned = true;
+        if (it->second.evicted && it->second.state == ResidencyState::Resident)
+            reload(it->second);
+    }
+
+
+    TextureResidencyStats TextureManager::getResidencyStats() const
+    {
+        TextureResidencyStats stats;
+        stats.resident_bytes = m_resident_bytes;
+        stats.budget = m_texture_budget;
+        stats.evictions = m_eviction_count;
+        stats.reloads = m_reload_count;
+
+        for (const auto &entry : m_resident_textures)
+        {
+            if (entry.second.evicted)
+                ++stats.evicted_count;
+            if (entry.second.state != ResidencyState::Resident)
+                ++stats.pending_count;
+        }
+
+        return stats;
+    }
+
+
+    const unsigned char* TextureManager::getTexels(const std::string &path, const std::string &name)
+    {
+        auto it = m_ldr_texture_array_data_cache.find(path + name);
+        if (it == m_ldr_texture_array_data_cache.end())
+            return nullptr;
+
+        HostTexels &texels = it->second;
+        if (!texels.data)
+        {
+            int width, height, channels;
+            texels.data = stbi_load((path + name).c_str(), &width, &height, &channels, texels.stb_format);
+            if (!texels.data)
+                throw std::runtime_error("Could not re-read texture " + path + name);
+
+            m_device->memory_tracker->addCPUCopy(MemoryCategory::Texture, texels.size);
+        }
+
+        return texels.data;
+    }
+
+
+    void TextureManager::releaseTexels(const std::string &path, const std::string &name)
+    {
+        auto it = m_ldr_texture_array_data_cache.find(path + name);
+        if (it != m_ldr_texture_array_data_cache.end())
+            freeTexels(it->second, true);
+    }
+
+
 	///////////////////////////////////////////////////////////////////////////////////////////// Private
+    void TextureManager::trackResidency(SampledTexture *texture, const std::string &file, bool ldr, VkFormat format, VkExtent3D extent,
+        uint32_t mip_levels, VkExtent3D tail_extent, uint32_t tail_levels, const unsigned char *tail_texels, VkDeviceSize tail_size)
+    {
+        ResidentTexture &resident = m_resident_textures[texture];
+        resident.texture = texture;
+        resident.file = file;
+        resident.ldr = ldr;
+        resident.format = format;
+        resident.extent = extent;
+        resident.mip_levels = mip_levels;
+        resident.full_size = texture->image->getMemorySize();
+        resident.tail_extent = tail_extent;
+        resident.tail_levels = tail_levels;
+        resident.tail_texels.assign(tail_texels, tail_texels + tail_size);
+        m_device->memory_tracker->addCPUCopy(MemoryCategory::Texture, tail_size);
+    }
+
+
+    void TextureManager::evict(ResidentTexture &resident)
+    {
+        createImage(resident.file, resident.tail_texels.size(), copyTexels(resident.tail_texels.data(), resident.tail_texels.size()), resident.tail_extent, resident.format,
+                    0, resident.tail_levels, 1, VK_IMAGE_VIEW_TYPE_2D, resident.pending_image, resident.pending_image_view);
+
+        // accounted right away, the full image is released as soon as the tail has been uploaded
+        m_resident_bytes += resident.pending_image->getMemorySize();
+        m_resident_bytes -= resident.texture->image->getMemorySize();
+        resident.state = ResidencyState::Replacing;
+        resident.evicted = true;
+        ++m_eviction_count;
+    }
+
+
+    void TextureManager::reload(ResidentTexture &resident)
+    {
+        resident.state = ResidencyState::Loading;
+        resident.reload_done.store(false, std::memory_order_relaxed);
+
+        ResidentTexture *target = &resident;
+        m_loader_threads.submit([target](uint32_t)
+        {
+            if (target->ldr)
+            {
+                int width, height, channels;
+                target->reload_ldr_texels = stbi_load(target->file.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+                target->reload_failed = !target->reload_ldr_texels || static_cast<uint32_t>(width) != target->extent.width ||
+                                        static_cast<uint32_t>(height) != target->extent.height;
+            }
+            else
+            {
+                target->reload_texels = gli::texture_cube(gli::load(target->file.c_str()));
+                target->reload_failed = target->reload_texels.empty() || target->reload_texels.levels() < target->mip_levels;
+            }
+
+            target->reload_done.store(true, std::memory_order_release);
+        });
+    }
+
+
+    bool TextureManager::makeRoom(VkDeviceSize required, uint64_t frame)
+    {
+        while (m_resident_bytes + required > m_texture_budget)
+        {
+            ResidentTexture *victim = nullptr;
+            for (auto &entry : m_resident_textures)
+            {
+                ResidentTexture &candidate = entry.second;
+                if (candidate.evicted || candidate.pinned || candidate.state != ResidencyState::Resident ||
+                    candidate.texture->last_used_frame + 1 >= frame)
+                    continue;
+
+                if (!victim || candidate.texture->last_used_frame < victim->texture->last_used_frame)
+                    victim = &candidate;
+            }
+
+            if (!victim)
+                return false;
+            evict(*victim);
+        }
+
+        return true;
+    }
+
+
+    void TextureManager::swapPendingImage(ResidentTexture &resident)
+    {
+        SampledTexture *texture = resident.texture;
+        texture->image->shutDownDeferred(); delete texture->image;
+        texture->image_view->shutDownDeferred(); delete texture->image_view;
+
+        texture->image = resident.pending_image;
+        texture->image_view = resident.pending_image_view;
+        resident.pending_image = nullptr;
+        resident.pending_image_view = nullptr;
+        resident.state = ResidencyState::Resident;
+        ++m_generation;
+    }
+
+
+    void TextureManager::freeTexels(HostTexels &texels, bool released)
+    {
+        texels.release_pending = false;
+        if (!texels.data)
+            return;
+
+        m_device->memory_tracker->removeCPUCopy(MemoryCategory::Texture, texels.size, released);
+        stbi_image_free(texels.data);
+        texels.data = nullptr;
+    }
 }
@@ -0,0 +1,94 @@
+#include <utility>
+
+#include "ThreadPool.h"
+
+namespace vv
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////// Public
+    void ThreadPool::create(uint32_t thread_count)
+    {
+        m_stopping = false;
+        for (uint32_t i = 0; i < thread_count; ++i)
+            m_workers.push_back(std::thread(&ThreadPool::work, this, i));
+    }
+
+
+    void ThreadPool::shutDown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_task_available.notify_all();
+
+        for (auto &worker : m_workers)
+            worker.join();
+
+        m_workers.clear();
+    }
+
+
+    void ThreadPool::submit(Task task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_task_available.notify_one();
+    }
+
+
+    void ThreadPool::wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_tasks_finished.wait(lock, [this]() { return m_tasks.empty() && m_active_tasks == 0; });
+
+        // the first exception a task threw since the last wait() resurfaces on the waiting thread
+        if (m_exception)
+        {
+            std::exception_ptr exception = m_exception;
+            m_exception = nullptr;
+            std::rethrow_exception(exception);
+        }
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////// Private
+    void ThreadPool::work(uint32_t thread_index)
+    {
+        while (true)
+        {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_task_available.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+                if (m_tasks.empty())
+                    return; // stopping and nothing left to do
+
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+                ++m_active_tasks;
+            }
+
+            std::exception_ptr exception;
+            try
+            {
+                task(thread_index);
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (exception && !m_exception)
+                    m_exception = exception;
+                --m_active_tasks;
+                if (m_tasks.empty() && m_active_tasks == 0)
+                    m_tasks_finished.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#include <cstring>
+
+#include "VertexWelder.h"
+
+namespace vv
+{
+    namespace
+    {
+        const std::size_t min_capacity = 64;
+
+
+        uint32_t floatBits(float value)
+        {
+            // -0.0 == 0.0, so both have to land in the same slot
+            value += 0.0f;
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+
+        uint64_t mix(uint64_t hash, uint32_t a, uint32_t b)
+        {
+            return (hash ^ ((static_cast<uint64_t>(a) << 32) | b)) * 0x9e3779b97f4a7c15ull;
+        }
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Public
+	void VertexWelder::create(std::vector<Vertex> *vertices, std::size_t expected_count)
+	{
+        m_vertices = vertices;
+        m_count = 0;
+
+        std::size_t capacity = min_capacity;
+        while (capacity < expected_count * 2)
+            capacity *= 2;
+
+        m_slots.assign(capacity, Slot());
+        m_mask = capacity - 1;
+	}
+
+
+	void VertexWelder::shutDown()
+	{
+        m_vertices = nullptr;
+        std::vector<Slot>().swap(m_slots);
+        m_mask = 0;
+        m_count = 0;
+	}
+
+
+    uint32_t VertexWelder::weld(const Vertex &vertex)
+    {
+        const uint32_t vertex_hash = hash(vertex);
+        std::size_t i = vertex_hash & m_mask;
+        while (m_slots[i].index != 0)
+        {
+            const Slot &slot = m_slots[i];
+            if (slot.hash == vertex_hash && (*m_vertices)[slot.index - 1] == vertex)
+                return slot.index - 1;
+            i = (i + 1) & m_mask;
+        }
+
+        const uint32_t index = static_cast<uint32_t>(m_vertices->size());
+        m_vertices->push_back(vertex);
+        m_slots[i].hash = vertex_hash;
+        m_slots[i].index = index + 1;
+
+        // kept at most half full, probe sequences stay short with linear probing
+        if (++m_count * 2 > m_slots.size())
+            grow();
+        return index;
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Private
+    void VertexWelder::grow()
+    {
+        std::vector<Slot> slots(m_slots.size() * 2, Slot());
+        const std::size_t mask = slots.size() - 1;
+        for (const auto &slot : m_slots)
+        {
+            if (slot.index == 0)
+                continue;
+
+            std::size_t i = slot.hash & mask;
+            while (slots[i].index != 0)
+                i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+
+        m_slots.swap(slots);
+        m_mask = mask;
+    }
+
+
+    uint32_t VertexWelder::hash(const Vertex &vertex)
+    {
+        uint64_t hash = 0;
+        hash = mix(hash, floatBits(vertex.position.x), floatBits(vertex.position.y));
+        hash = mix(hash, floatBits(vertex.position.z), floatBits(vertex.normal.x));
+        hash = mix(hash, floatBits(vertex.normal.y), floatBits(vertex.normal.z));
+        hash = mix(hash, floatBits(vertex.texCoord.x), floatBits(vertex.texCoord.y));
+
+        // fold the well mixed high bits into the low ones that pick the slot
+        hash ^= hash >> 32;
+        hash *= 0xbf58476d1ce4e5b9ull;
+        hash ^= hash >> 29;
+        return static_cast<uint32_t>(hash);
+    }
+}
@@ -1,10 +1,23 @@
 
 #include <stdexcept>
 #include <chrono>
+#include <limits>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
 
 #include "VirtualVistaEngine.h"
 #include "InputManager.h"
 #include "Settings.h"
+#include "CameraPath.h"
+#include "Benchmark.h"
+#include "Profiler.h"
+#include "MemoryTracker.h"
+#include "HostAllocator.h"
+#include "HeapAllocationCounter.h"
+#include "ObjParser.h"
 
 namespace vv
 {
@@ -13,19 +26,68 @@ namespace vv
         m_argc = argc;
         m_argv = argv;
 
-        m_window.create(m_window_width, m_window_height, m_application_name);
+        parseArguments();
+
+        if (!Settings::inst()->getParseBenchmarkPath().empty())
+        {
+            runParseBenchmark();
+            m_finished = true;
+            return;
+        }
+
+        if (!Settings::inst()->getTracePath().empty())
+        {
+#ifndef VV_ENABLE_PROFILER
+            std::cout << "Profiler zones are compiled out, reconfigure with -DVV_ENABLE_PROFILER=ON to capture a trace" << std::endl;
+#endif
+            // set up before anything is loaded so load times show up in captures starting at frame 0
+            Profiler::inst()->setCapture(Settings::inst()->getTracePath(), Settings::inst()->getTraceFirstFrame(), Settings::inst()->getTraceLastFrame());
+        }
+
+        // the callbacks have to be in place before the instance is created and stay for its whole lifetime
+        if (!Settings::inst()->getHostAllocationReportPath().empty())
+            HostAllocator::inst()->setEnabled(true);
+
+        if (!Settings::inst()->isHeadless())
+            m_window.create(m_window_width, m_window_height, m_application_name);
 
         // todo: does this need to be malloced?
     	m_renderer = new DeferredRenderer;
 
-    	m_renderer->create(&m_window);
+    	m_renderer->create(Settings::inst()->isHeadless() ? nullptr : &m_window);
         m_scene = m_renderer->getScene();
+
+        for (const auto &budget : Settings::inst()->getMemoryBudgets())
+        {
+            MemoryCategory category;
+            if (findMemoryCategory(budget.first, category))
+                m_renderer->getMemoryTracker()->setCategoryBudget(category, budget.second);
+            else
+                std::cout << "Ignoring budget for unknown memory category " << budget.first << std::endl;
+        }
     }
 
 
     void VirtualVistaEngine::shutDown()
     {
+        // written before anything is unloaded so the report reflects the scene at its largest
+        const MemoryTracker *memory_tracker = m_renderer->getMemoryTracker();
+        if (!Settings::inst()->getMemoryReportPath().empty())
+        {
+            memory_tracker->writeReport(Settings::inst()->getMemoryReportPath());
+            std::cout << "Memory report written to " << Settings::inst()->getMemoryReportPath() << std::endl;
+        }
+        for (const auto &violation : memory_tracker->checkBudgets())
+            std::cout << "Memory budget exceeded: " << violation << std::endl;
+
     	m_renderer->shutDown();
+
+        // after shut down, so anything still live in the report has leaked
+        if (!Settings::inst()->getHostAllocationReportPath().empty())
+        {
+            HostAllocator::inst()->writeReport(Settings::inst()->getHostAllocationReportPath());
+            std::cout << "Host allocation report written to " << Settings::inst()->getHostAllocationReportPath() << std::endl;
+        }
     }
 
 
@@ -66,7 +128,41 @@ namespace vv
     {
         m_renderer->recordCommandBuffers();
 
-        auto last_time = glfwGetTime();
+        if (!Settings::inst()->getBenchmarkPath().empty())
+        {
+            runBenchmark();
+            return;
+        }
+
+        if (Settings::inst()->isHeadless())
+        {
+            // no window means no input and no glfw timer. frames are rendered back to back until the frame count is reached.
+            auto start_time = std::chrono::high_resolution_clock::now();
+            auto last_time = start_time;
+
+            while (!m_renderer->shouldStop())
+            {
+                auto curr_time = std::chrono::high_resolution_clock::now();
+                float delta_time = std::chrono::duration<float>(curr_time - last_time).count();
+                last_time = curr_time;
+
+                m_renderer->run(delta_time);
+            }
+
+            float total_time = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start_time).count();
+            std::cout << "Rendered " << Settings::inst()->getFrameCount() << " headless frames in " << total_time << "s" << std::endl;
+
+            if (!Settings::inst()->getReadbackPath().empty())
+                writeReadback(Settings::inst()->getReadbackPath());
+
+            return;
+        }
+
+        CameraPath recorded_path;
+        const bool record_camera = !Settings::inst()->getCameraRecordPath().empty();
+
+        auto start_time = glfwGetTime();
+        auto last_time = start_time;
 
     	while (!m_renderer->shouldStop())
     	{
@@ -77,7 +173,302 @@ namespace vv
             m_window.run();
 
             handleInput(delta_time);
+            if (record_camera)
+                recorded_path.addKeyframe(static_cast<float>(curr_time - start_time), m_scene->getActiveCamera());
+
     		m_renderer->run(delta_time);
     	}
+
+        if (record_camera)
+        {
+            recorded_path.save(Settings::inst()->getCameraRecordPath());
+            std::cout << "Recorded camera path to " << Settings::inst()->getCameraRecordPath() << std::endl;
+        }
+    }
+
+
+    void VirtualVistaEngine::runBenchmark()
+    {
+        const std::string path_name = Settings::inst()->getBenchmarkPath();
+        const uint32_t frame_count = Settings::inst()->getFrameCount();
+        const bool headless = Settings::inst()->isHeadless();
+
+        CameraPath path;
+        path.load(path_name);
+
+        Benchmark benchmark;
+        benchmark.create(path_name, frame_count, Settings::inst()->getAllocationWarmupFrames());
+        const bool count_allocations = isHeapAllocationCountingEnabled();
+
+        // the whole path is spread evenly over the requested frames and every frame advances the scene by the same
+        // amount, so the same frames are rendered regardless of how fast the machine is
+        const float delta_time = 1.0f / 60.0f;
+        const float path_step = (frame_count > 1) ? path.getDuration() / (frame_count - 1) : 0.0f;
+        Camera *camera = m_scene->getActiveCamera();
+
+        auto last_time = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < frame_count; ++i)
+        {
+            const uint64_t allocations_before = getHeapAllocationCount();
+
+            if (!headless)
+            {
+                m_window.run();
+                if (m_window.shouldClose())
+                    break;
+            }
+
+            path.apply(i * path_step, camera);
+            m_renderer->run(delta_time);
+
+            // frame to frame time, which includes waiting on frames in flight when GPU bound
+            auto curr_time = std::chrono::high_resolution_clock::now();
+            double cpu_ms = std::chrono::duration<double, std::milli>(curr_time - last_time).count();
+            last_time = curr_time;
+
+            benchmark.addFrame(cpu_ms, m_renderer->getLastGPUFrameTime());
+            benchmark.addGPUZones(m_renderer->getGPUZoneResults());
+
+            if (count_allocations)
+                benchmark.addHeapAllocations(getHeapAllocationCount() - allocations_before);
+        }
+
+        // what the renderer's caches did over the run
+        const RecordingStats recording_stats = m_renderer->getRecordingStats();
+        benchmark.setCounter("draw_buckets", "reused", static_cast<double>(recording_stats.bucket_hits));
+        benchmark.setCounter("draw_buckets", "rerecorded", static_cast<double>(recording_stats.bucket_misses));
+
+        const TextureResidencyStats texture_stats = m_scene->getTextureResidencyStats();
+        benchmark.setCounter("texture_residency", "evictions", static_cast<double>(texture_stats.evictions));
+        benchmark.setCounter("texture_residency", "reloads", static_cast<double>(texture_stats.reloads));
+        benchmark.setCounter("texture_residency", "evicted_textures", texture_stats.evicted_count);
+        benchmark.setCounter("texture_residency", "pending_textures", texture_stats.pending_count);
+        benchmark.setCounter("texture_residency", "resident_bytes", static_cast<double>(texture_stats.resident_bytes));
+        benchmark.setCounter("texture_residency", "budget_bytes", static_cast<double>(texture_stats.budget));
+
+        const RenderGraphStats graph_stats = m_renderer->getRenderGraphStats();
+        benchmark.setCounter("render_graph", "passes", graph_stats.pass_count);
+        benchmark.setCounter("render_graph", "culled_passes", graph_stats.culled_pass_count);
+        benchmark.setCounter("render_graph", "barriers", graph_stats.barrier_count);
+        benchmark.setCounter("render_graph", "transient_attachments", graph_stats.transient_count);
+        benchmark.setCounter("render_graph", "transient_bytes", static_cast<double>(graph_stats.transient_size));
+        benchmark.setCounter("render_graph", "aliased_bytes", static_cast<double>(graph_stats.aliased_size));
+
+        for (const auto &asset : m_scene->getMeshOptimizationStats())
+        {
+            const MeshOptimizationStats &mesh_stats = asset.second;
+            std::map<std::string, double> values;
+            values["meshes"] = mesh_stats.mesh_count;
+            values["cached"] = mesh_stats.cached ? 1.0 : 0.0;
+            values["acmr_before"] = mesh_stats.before.getACMR();
+            values["acmr_after"] = mesh_stats.after.getACMR();
+            values["atvr_before"] = mesh_stats.before.getATVR();
+            values["atvr_after"] = mesh_stats.after.getATVR();
+            values["import_ms"] = mesh_stats.import_ms;
+            benchmark.addEntry("mesh_optimization", asset.first, values);
+        }
+
+        const DescriptorAllocatorStats descriptor_stats = m_renderer->getDescriptorAllocatorStats();
+        benchmark.setCounter("descriptors", "pools", descriptor_stats.pool_count);
+        benchmark.setCounter("descriptors", "pool_growths", descriptor_stats.pool_growths);
+        benchmark.setCounter("descriptors", "allocated_sets", descriptor_stats.allocated_sets);
+        benchmark.setCounter("descriptors", "set_capacity", descriptor_stats.set_capacity);
+        benchmark.setCounter("descriptors", "allocated_descriptors", static_cast<double>(descriptor_stats.allocated_descriptors));
+        benchmark.setCounter("descriptors", "descriptor_capacity", static_cast<double>(descriptor_stats.descriptor_capacity));
+        benchmark.setCounter("descriptors", "frame_pools", descriptor_stats.frame_pool_count);
+        benchmark.setCounter("descriptors", "peak_frame_sets", descriptor_stats.peak_frame_sets);
+
+        benchmark.writeReport(Settings::inst()->getBenchmarkReportPath());
+
+        if (headless && !Settings::inst()->getReadbackPath().empty())
+            writeReadback(Settings::inst()->getReadbackPath());
+
+        FrameTimeStats cpu_stats = benchmark.getCPUStats();
+        std::cout << "Benchmark " << path_name << ": " << cpu_stats.count << " frames, avg " << cpu_stats.average << "ms, p95 "
+                  << cpu_stats.p95 << "ms, p99 " << cpu_stats.p99 << "ms. Report written to " << Settings::inst()->getBenchmarkReportPath() << std::endl;
+
+        // once warmed up the frame loop is expected to run entirely on preallocated and frame arena memory
+        const uint64_t steady_state_allocations = benchmark.getSteadyStateHeapAllocations();
+        if (steady_state_allocations > 0)
+            throw std::runtime_error("Benchmark " + path_name + " made " + std::to_string(steady_state_allocations) +
+                                     " heap allocations after " + std::to_string(Settings::inst()->getAllocationWarmupFrames()) + " warmup frames");
+    }
+
+
+    void VirtualVistaEngine::runParseBenchmark()
+    {
+        // relative paths are tried from the working directory first, then from the model directory
+        std::string path = Settings::inst()->getParseBenchmarkPath();
+        if (!std::ifstream(path).good())
+            path = Settings::inst()->getModelDirectory() + path;
+        const std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+
+        // best of a few runs, which also takes reading the file into the page cache out of the picture
+        const int repetitions = 3;
+
+        tinyobj::attrib_t tinyobj_attrib;
+        std::vector<tinyobj::shape_t> tinyobj_shapes;
+        std::vector<tinyobj::material_t> tinyobj_materials;
+        double tinyobj_ms = std::numeric_limits<double>::max();
+        for (int i = 0; i < repetitions; ++i)
+        {
+            tinyobj_materials.clear();
+            std::string err;
+            auto start_time = std::chrono::high_resolution_clock::now();
+            if (!tinyobj::LoadObj(&tinyobj_attrib, &tinyobj_shapes, &tinyobj_materials, &err, path.c_str(), directory.c_str()))
+                throw std::runtime_error("tinyobj could not parse " + path + "\n\n" + err);
+            tinyobj_ms = std::min(tinyobj_ms, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start_time).count());
+        }
+
+        ThreadPool threads;
+        threads.create(Settings::inst()->getImportThreadCount());
+        ObjParser parser;
+        parser.create(&threads);
+
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        ObjParseStats stats;
+        double parser_ms = std::numeric_limits<double>::max();
+        for (int i = 0; i < repetitions; ++i)
+        {
+            materials.clear();
+            std::string err;
+            tinyobj::MaterialFileReader material_reader(directory);
+            auto start_time = std::chrono::high_resolution_clock::now();
+            if (!parser.load(path, attrib, shapes, materials, err, &material_reader))
+                throw std::runtime_error("ObjParser could not parse " + path + "\n\n" + err);
+
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start_time).count();
+            if (ms < parser_ms)
+            {
+                parser_ms = ms;
+                stats = parser.getStats();
+            }
+        }
+        parser.shutDown();
+        threads.shutDown();
+
+        const double megabytes = stats.file_size / (1024.0 * 1024.0);
+        std::cout << "Parsed " << path << " (" << megabytes << " MB): tinyobj " << tinyobj_ms << "ms, " << megabytes * 1000.0 / tinyobj_ms
+                  << " MB/s. ObjParser " << parser_ms << "ms, " << megabytes * 1000.0 / parser_ms << " MB/s on "
+                  << Settings::inst()->getImportThreadCount() << " threads over " << stats.chunk_count << " chunks (tokenize "
+                  << stats.parse_ms << "ms, merge " << stats.merge_ms << "ms)" << std::endl;
+
+        auto count_indices = [](const std::vector<tinyobj::shape_t> &shapes)
+        {
+            std::size_t count = 0;
+            for (const auto &shape : shapes)
+                count += shape.mesh.indices.size();
+            return count;
+        };
+
+        // values may differ in the last bit, tinyobj's float parsing isn't exact
+        if (attrib.vertices.size() != tinyobj_attrib.vertices.size() || attrib.normals.size() != tinyobj_attrib.normals.size() ||
+            attrib.texcoords.size() != tinyobj_attrib.texcoords.size() || count_indices(shapes) != count_indices(tinyobj_shapes) ||
+            materials.size() != tinyobj_materials.size())
+            std::cout << "ObjParser and tinyobj disagree on the contents of " << path << std::endl;
+    }
+
+
+    void VirtualVistaEngine::parseArguments()
+    {
+        for (int i = 1; i < m_argc; ++i)
+        {
+            if (strcmp(m_argv[i], "--headless") == 0)
+                Settings::inst()->setHeadless(true);
+            else if (strcmp(m_argv[i], "--frames") == 0 && i + 1 < m_argc)
+                Settings::inst()->setFrameCount(static_cast<uint32_t>(std::strtoul(m_argv[++i], nullptr, 10)));
+            else if (strcmp(m_argv[i], "--frames-in-flight") == 0 && i + 1 < m_argc)
+            {
+                // fewer frames serialize CPU and GPU, more only add latency
+                unsigned long frames = std::strtoul(m_argv[++i], nullptr, 10);
+                if (frames >= 2 && frames <= 3)
+                    Settings::inst()->setMaxFramesInFlight(static_cast<uint32_t>(frames));
+                else
+                    std::cout << "Ignoring --frames-in-flight " << m_argv[i] << ", expected 2 or 3" << std::endl;
+            }
+            else if (strcmp(m_argv[i], "--recording-threads") == 0 && i + 1 < m_argc)
+            {
+                unsigned long thread_count = std::strtoul(m_argv[++i], nullptr, 10);
+                if (thread_count >= 1 && thread_count <= 256)
+                    Settings::inst()->setRecordingThreadCount(static_cast<uint32_t>(thread_count));
+                else
+                    std::cout << "Ignoring --recording-threads " << m_argv[i] << ", expected 1 to 256" << std::endl;
+            }
+            else if (strcmp(m_argv[i], "--readback") == 0 && i + 1 < m_argc)
+                Settings::inst()->setReadbackPath(m_argv[++i]);
+            else if (strcmp(m_argv[i], "--benchmark") == 0 && i + 1 < m_argc)
+                Settings::inst()->setBenchmarkPath(m_argv[++i]);
+            else if (strcmp(m_argv[i], "--benchmark-report") == 0 && i + 1 < m_argc)
+                Settings::inst()->setBenchmarkReportPath(m_argv[++i]);
+            else if (strcmp(m_argv[i], "--record-camera") == 0 && i + 1 < m_argc)
+                Settings::inst()->setCameraRecordPath(m_argv[++i]);
+            else if (strcmp(m_argv[i], "--trace") == 0 && i + 1 < m_argc)
+                Settings::inst()->setTracePath(m_argv[++i]);
+            else if (strcmp(m_argv[i], "--memory-report") == 0 && i + 1 < m_argc)
+                Settings::inst()->setMemoryReportPath(m_argv[++i]);
+            else if (strcmp(m_argv[i], "--memory-budget") == 0 && i + 2 < m_argc)
+            {
+                // category name and megabytes, e.g. --memory-budget texture 512
+                std::string category = m_argv[++i];
+                uint64_t megabytes = std::strtoull(m_argv[++i], nullptr, 10);
+                Settings::inst()->setMemoryBudget(category, megabytes * 1024 * 1024);
+            }
+            else if (strcmp(m_argv[i], "--texture-budget") == 0 && i + 1 < m_argc)
+                Settings::inst()->setTextureBudget(std::strtoull(m_argv[++i], nullptr, 10) * 1024 * 1024);
+            else if (strcmp(m_argv[i], "--host-allocations") == 0 && i + 1 < m_argc)
+                Settings::inst()->setHostAllocationReportPath(m_argv[++i]);
+            else if (strcmp(m_argv[i], "--keep-cpu-copies") == 0)
+                Settings::inst()->setCPUResidency(CPUResidency::Keep);
+            else if (strcmp(m_argv[i], "--mesh-cache") == 0 && i + 1 < m_argc)
+                Settings::inst()->setMeshCacheDirectory(m_argv[++i]);
+            else if (strcmp(m_argv[i], "--no-mesh-cache") == 0)
+                Settings::inst()->setMeshCacheDirectory("");
+            else if (strcmp(m_argv[i], "--no-mesh-optimization") == 0)
+                Settings::inst()->setMeshOptimization(false);
+            else if (strcmp(m_argv[i], "--parse-benchmark") == 0 && i + 1 < m_argc)
+                Settings::inst()->setParseBenchmarkPath(m_argv[++i]);
+            else if (strcmp(m_argv[i], "--trace-frames") == 0 && i + 2 < m_argc)
+            {
+                uint64_t first_frame = std::strtoull(m_argv[++i], nullptr, 10);
+                uint64_t last_frame = std::strtoull(m_argv[++i], nullptr, 10);
+                Settings::inst()->setTraceFrames(first_frame, last_frame);
+            }
+            else
+                std::cout << "Ignoring unknown argument " << m_argv[i] << std::endl;
+        }
+    }
+
+
+    void VirtualVistaEngine::writeReadback(const std::string &path)
+    {
+        std::vector<unsigned char> pixels;
+        m_renderer->readbackFrame(pixels);
+
+        const int width = Settings::inst()->getWindowWidth();
+        const int height = Settings::inst()->getWindowHeight();
+
+        std::ofstream file(path, std::ios::out | std::ios::binary);
+        if (!file.is_open())
+            throw std::runtime_error("Could not open " + path + " for writing");
+
+        file << "P6\n" << width << " " << height << "\n255\n";
+
+        // offscreen targets are RGBA8, PPM stores RGB
+        std::vector<unsigned char> row(static_cast<std::size_t>(width) * 3);
+        for (int y = 0; y < height; ++y)
+        {
+            const unsigned char *src = pixels.data() + static_cast<std::size_t>(y) * width * 4;
+            for (int x = 0; x < width; ++x)
+            {
+                row[x * 3 + 0] = src[x * 4 + 0];
+                row[x * 3 + 1] = src[x * 4 + 1];
+                row[x * 3 + 2] = src[x * 4 + 2];
+            }
+            file.write(reinterpret_cast<const char*>(row.data()), row.size());
+        }
+
+        std::cout << "Wrote last frame to " << path << std::endl;
     }
-}
\ No newline at end of file
+}
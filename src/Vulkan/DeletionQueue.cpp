@@ -0,0 +1,47 @@
+#include "DeletionQueue.h"
+#include "Settings.h"
+
+namespace vv
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////// Public
+    void DeletionQueue::create()
+    {
+        m_frames_in_flight = Settings::inst()->getMaxFramesInFlight();
+        m_frame_number = 0;
+    }
+
+
+    void DeletionQueue::shutDown()
+    {
+        flush();
+    }
+
+
+    void DeletionQueue::push(std::function<void()> deleter)
+    {
+        m_entries.push_back({ m_frame_number, deleter });
+    }
+
+
+    void DeletionQueue::beginFrame(uint64_t frame_number)
+    {
+        m_frame_number = frame_number;
+
+        // the fence of frame (frame_number - frames in flight) was just waited on, so it and everything before it is retired
+        while (!m_entries.empty() && m_entries.front().frame_number + m_frames_in_flight <= m_frame_number)
+        {
+            m_entries.front().deleter();
+            m_entries.pop_front();
+        }
+    }
+
+
+    void DeletionQueue::flush()
+    {
+        while (!m_entries.empty())
+        {
+            m_entries.front().deleter();
+            m_entries.pop_front();
+        }
+    }
+}
@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "DescriptorAllocator.h"
+#include "VulkanDevice.h"
+#include "HostAllocator.h"
+
+namespace vv
+{
+    namespace
+    {
+        // later pools of a chain double in size up to this many times the first one
+        const uint32_t max_pool_growth_shift = 6;
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////// Public
+    void DescriptorAllocator::create(VulkanDevice *device, uint32_t sets_per_pool, uint32_t frame_count)
+    {
+        VV_ASSERT(device != VK_NULL_HANDLE, "VulkanDevice not present");
+        m_device = device;
+        m_sets_per_pool = std::max(sets_per_pool, 1u);
+        m_frame_pools.resize(frame_count);
+        m_current_frame = 0;
+        m_frame_sets = 0;
+        m_peak_frame_sets = 0;
+        m_type_demand.fill(0);
+        m_set_demand = 0;
+        m_pool_growths = 0;
+    }
+
+
+    void DescriptorAllocator::shutDown()
+    {
+        for (auto &pool : m_pools)
+            vkDestroyDescriptorPool(m_device->logical_device, pool.pool, HostAllocator::inst()->callbacks(HostObjectType::DescriptorPool));
+        for (auto &chain : m_frame_pools)
+            for (auto &pool : chain)
+                vkDestroyDescriptorPool(m_device->logical_device, pool.pool, HostAllocator::inst()->callbacks(HostObjectType::DescriptorPool));
+        m_pools.clear();
+        m_frame_pools.clear();
+        m_layouts.clear();
+    }
+
+
+    void DescriptorAllocator::registerLayout(VkDescriptorSetLayout layout, const std::vector<VkDescriptorSetLayoutBinding> &bindings)
+    {
+        DescriptorCounts counts;
+        counts.fill(0);
+        for (const auto &binding : bindings)
+        {
+            if (binding.descriptorType >= m_type_count)
+                throw std::runtime_error("Descriptor type " + std::to_string(binding.descriptorType) + " is not supported by the descriptor allocator");
+            counts[binding.descriptorType] += binding.descriptorCount;
+        }
+        m_layouts[layout] = counts;
+
+        // every layout weighs in on the mix of types before its first set is allocated, so the first pool isn't sized
+        // for whichever layout happens to be allocated first
+        for (uint32_t type = 0; type < m_type_count; ++type)
+            m_type_demand[type] += counts[type];
+        ++m_set_demand;
+    }
+
+
+    void DescriptorAllocator::beginFrame(uint32_t frame_index)
+    {
+        for (auto &pool : m_frame_pools[frame_index])
+        {
+            VV_CHECK_SUCCESS(vkResetDescriptorPool(m_device->logical_device, pool.pool, 0));
+            pool.allocated_sets = 0;
+            pool.allocated.fill(0);
+            pool.fragmented = false;
+        }
+
+        m_current_frame = frame_index;
+        m_frame_sets = 0;
+    }
+
+
+    DescriptorAllocation DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+    {
+        DescriptorAllocation allocation;
+        allocation.layout = layout;
+        allocation.pool = allocateFromChain(m_pools, false, layout, allocation.set);
+        return allocation;
+    }
+
+
+    VkDescriptorSet DescriptorAllocator::allocateFrame(VkDescriptorSetLayout layout)
+    {
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        allocateFromChain(m_frame_pools[m_current_frame], true, layout, set);
+        m_peak_frame_sets = std::max(m_peak_frame_sets, ++m_frame_sets);
+        return set;
+    }
+
+
+    void DescriptorAllocator::free(const DescriptorAllocation &allocation)
+    {
+        if (allocation.set == VK_NULL_HANDLE)
+            return;
+
+        const DescriptorCounts &counts = getLayoutCounts(allocation.layout);
+        Pool &pool = m_pools[allocation.pool];
+        vkFreeDescriptorSets(m_device->logical_device, pool.pool, 1, &allocation.set);
+
+        --pool.allocated_sets;
+        for (uint32_t type = 0; type < m_type_count; ++type)
+            pool.allocated[type] -= counts[type];
+        pool.fragmented = false;
+    }
+
+
+    DescriptorAllocatorStats DescriptorAllocator::getStats() const
+    {
+        DescriptorAllocatorStats stats;
+        for (const auto &pool : m_pools)
+        {
+            ++stats.pool_count;
+            stats.set_capacity += pool.max_sets;
+            stats.allocated_sets += pool.allocated_sets;
+            for (uint32_t type = 0; type < m_type_count; ++type)
+            {
+                stats.descriptor_capacity += pool.capacity[type];
+                stats.allocated_descriptors += pool.allocated[type];
+            }
+        }
+        for (const auto &chain : m_frame_pools)
+            stats.frame_pool_count += static_cast<uint32_t>(chain.size());
+        stats.pool_growths = m_pool_growths;
+        stats.peak_frame_sets = m_peak_frame_sets;
+        return stats;
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////// Private
+    const DescriptorAllocator::DescriptorCounts& DescriptorAllocator::getLayoutCounts(VkDescriptorSetLayout layout) const
+    {
+        auto counts = m_layouts.find(layout);
+        if (counts == m_layouts.end())
+            throw std::runtime_error("Descriptor set layout was not registered with the descriptor allocator");
+        return counts->second;
+    }
+
+
+    uint32_t DescriptorAllocator::allocateFromChain(std::vector<Pool> &chain, bool frame_chain, VkDescriptorSetLayout layout, VkDescriptorSet &set)
+    {
+        const DescriptorCounts &counts = getLayoutCounts(layout);
+        for (uint32_t type = 0; type < m_type_count; ++type)
+            m_type_demand[type] += counts[type];
+        ++m_set_demand;
+
+        // the newest pool is the most likely to have room
+        for (std::size_t i = chain.size(); i-- > 0;)
+        {
+            if (tryAllocate(chain[i], layout, counts, set))
+                return static_cast<uint32_t>(i);
+        }
+
+        if (!chain.empty())
+            ++m_pool_growths;
+        chain.push_back(createPool(chain.size(), counts, frame_chain ? 0 : VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT));
+        if (!tryAllocate(chain.back(), layout, counts, set))
+            throw std::runtime_error("Could not allocate a descriptor set from an empty pool sized for it");
+
+        return static_cast<uint32_t>(chain.size() - 1);
+    }
+
+
+    DescriptorAllocator::Pool DescriptorAllocator::createPool(std::size_t existing_pools, const DescriptorCounts &counts, VkDescriptorPoolCreateFlags flags)
+    {
+        Pool pool;
+        pool.max_sets = m_sets_per_pool << std::min<std::size_t>(existing_pools, max_pool_growth_shift);
+        pool.allocated.fill(0);
+
+        std::vector<VkDescriptorPoolSize> pool_sizes;
+        for (uint32_t type = 0; type < m_type_count; ++type)
+        {
+            // the average set's share of this type, rounded up
+            const uint64_t average = (m_type_demand[type] * pool.max_sets + m_set_demand - 1) / std::max<uint64_t>(m_set_demand, 1);
+            pool.capacity[type] = static_cast<uint32_t>(std::max<uint64_t>(average, counts[type]));
+            if (pool.capacity[type] > 0)
+                pool_sizes.push_back({ static_cast<VkDescriptorType>(type), pool.capacity[type] });
+        }
+
+        // sets of a layout without bindings need no descriptors, but a pool can't be empty
+        if (pool_sizes.empty())
+            pool_sizes.push_back({ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 });
+
+        VkDescriptorPoolCreateInfo create_info = {};
+        create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        create_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+        create_info.pPoolSizes = pool_sizes.data();
+        create_info.maxSets = pool.max_sets;
+        create_info.flags = flags;
+
+        VV_CHECK_SUCCESS(vkCreateDescriptorPool(m_device->logical_device, &create_info, HostAllocator::inst()->callbacks(HostObjectType::DescriptorPool), &pool.pool));
+        return pool;
+    }
+
+
+    bool DescriptorAllocator::tryAllocate(Pool &pool, VkDescriptorSetLayout layout, const DescriptorCounts &counts, VkDescriptorSet &set)
+    {
+        // checked up front, exhausting a pool is invalid usage on Vulkan 1.0 without VK_KHR_maintenance1
+        if (pool.fragmented || pool.allocated_sets >= pool.max_sets)
+            return false;
+        for (uint32_t type = 0; type < m_type_count; ++type)
+        {
+            if (counts[type] > pool.capacity[type] - pool.allocated[type])
+                return false;
+        }
+
+        VkDescriptorSetAllocateInfo alloc_info = {};
+        alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.descriptorPool = pool.pool;
+        alloc_info.descriptorSetCount = 1;
+        alloc_info.pSetLayouts = &layout;
+
+        VkResult result = vkAllocateDescriptorSets(m_device->logical_device, &alloc_info, &set);
+        if (result == VK_SUCCESS)
+        {
+            ++pool.allocated_sets;
+            for (uint32_t type = 0; type < m_type_count; ++type)
+                pool.allocated[type] += counts[type];
+            return true;
+        }
+
+        // the descriptors are there, but freed sets left them scattered
+        if (result == VK_ERROR_FRAGMENTED_POOL || result == VK_ERROR_OUT_OF_POOL_MEMORY)
+        {
+            pool.fragmented = true;
+            return false;
+        }
+
+        throw std::runtime_error("Out of memory allocating a descriptor set");
+    }
+}
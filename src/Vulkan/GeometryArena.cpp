@@ -0,0 +1,423 @@
+#include <array>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+#include "GeometryArena.h"
+#include "VulkanDevice.h"
+#include "UploadQueue.h"
+#include "DeletionQueue.h"
+#include "Profiler.h"
+#include "HostAllocator.h"
+#include "Settings.h"
+
+namespace vv
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////// Public
+    void GeometryArena::create(VulkanDevice *device, VkDeviceSize page_size)
+    {
+        VV_ASSERT(device != VK_NULL_HANDLE, "VulkanDevice not present");
+        m_device = device;
+        m_page_size = page_size;
+        m_generation = 0;
+        m_frees_since_compaction = 0;
+    }
+
+
+    void GeometryArena::shutDown()
+    {
+        // staging copies into the pages might still be pending
+        m_device->upload_queue->waitIdle();
+
+        for (auto page : m_pages)
+            if (page)
+                destroyPage(page);
+
+        uint32_t live = 0;
+        for (auto &entry : m_entries)
+            if (entry.live)
+                ++live;
+        if (live > 0)
+            VV_ALERT("Geometry arena shut down with " + std::to_string(live) + " meshes still allocated");
+
+        m_pages.clear();
+        m_entries.clear();
+        m_free_entries.clear();
+    }
+
+
+    GeometryArena::Handle GeometryArena::allocate(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices)
+    {
+        return allocate(vertices.data(), static_cast<uint32_t>(vertices.size()), indices.data(), static_cast<uint32_t>(indices.size()));
+    }
+
+
+    GeometryArena::Handle GeometryArena::allocate(const Vertex *vertices, uint32_t vertex_count, const uint32_t *indices, uint32_t index_count)
+    {
+        VV_PROFILE_FUNCTION();
+        VV_ASSERT(vertex_count > 0 && index_count > 0, "Empty geometry can't be placed in the arena");
+
+        Handle handle;
+        if (!m_free_entries.empty())
+        {
+            handle = m_free_entries.back();
+            m_free_entries.pop_back();
+        }
+        else
+        {
+            handle = static_cast<Handle>(m_entries.size());
+            m_entries.push_back(Entry());
+        }
+
+        Entry &entry = m_entries[handle];
+        entry = Entry();
+
+        // first fit over the existing pages. there are only ever a few of them.
+        bool placed = false;
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_pages.size()) && !placed; ++i)
+            placed = m_pages[i] && allocateRanges(i, vertex_count, index_count, entry);
+
+        if (!placed)
+        {
+            uint32_t page_index = createPage(vertex_count, index_count);
+            placed = allocateRanges(page_index, vertex_count, index_count, entry);
+            VV_ASSERT(placed, "A new geometry page has to fit the geometry it was created for");
+        }
+
+        entry.live = true;
+
+        Page *page = m_pages[entry.range.page];
+        upload(page->vertex_buffer, static_cast<VkDeviceSize>(entry.range.vertex_offset) * sizeof(Vertex), vertices, sizeof(Vertex) * vertex_count);
+        entry.upload_id = upload(page->index_buffer, static_cast<VkDeviceSize>(entry.range.first_index) * sizeof(uint32_t), indices, sizeof(uint32_t) * index_count);
+
+        return handle;
+    }
+
+
+    void GeometryArena::free(Handle handle)
+    {
+        VV_ASSERT(handle < m_entries.size() && m_entries[handle].live, "Invalid geometry handle");
+        releaseEntry(handle);
+    }
+
+
+    void GeometryArena::freeDeferred(Handle handle)
+    {
+        VV_ASSERT(handle < m_entries.size() && m_entries[handle].live, "Invalid geometry handle");
+
+        // the entry stays live until the deleter runs, so compaction keeps moving it along with everything else
+        GeometryArena *arena = this;
+        m_device->deletion_queue->push([arena, handle]()
+        {
+            arena->releaseEntry(handle);
+        });
+    }
+
+
+    const GeometryRange& GeometryArena::get(Handle handle) const
+    {
+        VV_ASSERT(handle < m_entries.size() && m_entries[handle].live, "Invalid geometry handle");
+        return m_entries[handle].range;
+    }
+
+
+    bool GeometryArena::isUploaded(Handle handle) const
+    {
+        VV_ASSERT(handle < m_entries.size() && m_entries[handle].live, "Invalid geometry handle");
+        return m_device->upload_queue->isComplete(m_entries[handle].upload_id);
+    }
+
+
+    void GeometryArena::bindPage(VkCommandBuffer command_buffer, uint32_t page) const
+    {
+        VV_ASSERT(page < m_pages.size() && m_pages[page], "Invalid geometry page");
+
+        std::array<VkDeviceSize, 1> offsets = { 0 };
+        vkCmdBindVertexBuffers(command_buffer, 0, 1, &m_pages[page]->vertex_buffer, offsets.data());
+        vkCmdBindIndexBuffer(command_buffer, m_pages[page]->index_buffer, 0, VK_INDEX_TYPE_UINT32);
+    }
+
+
+    void GeometryArena::compact()
+    {
+        VV_PROFILE_FUNCTION();
+        bool moved = false;
+        m_frees_since_compaction = 0;
+
+        const uint32_t page_count = static_cast<uint32_t>(m_pages.size());
+        for (uint32_t old_index = 0; old_index < page_count; ++old_index)
+        {
+            Page *old_page = m_pages[old_index];
+            if (!old_page)
+                continue;
+
+            // a page whose free space is a single trailing range can't get any tighter
+            bool fragmented = old_page->vertices.getFreeRangeCount() > 1 || old_page->indices.getFreeRangeCount() > 1;
+            bool empty = old_page->allocation_count == 0;
+            if (!fragmented && !(empty && page_count > 1))
+                continue;
+
+            std::vector<Handle> live_entries;
+            uint64_t vertex_count = 0;
+            uint64_t index_count = 0;
+            for (Handle handle = 0; handle < static_cast<Handle>(m_entries.size()); ++handle)
+            {
+                const Entry &entry = m_entries[handle];
+                if (entry.live && entry.range.page == old_index)
+                {
+                    live_entries.push_back(handle);
+                    vertex_count += entry.range.vertex_count;
+                    index_count += entry.range.index_count;
+                }
+            }
+
+            // the old page stays alive for the frames still drawing from it
+            m_pages[old_index] = nullptr;
+            GeometryArena *arena = this;
+            m_device->deletion_queue->push([arena, old_page]()
+            {
+                arena->destroyPage(old_page);
+            });
+            moved = true;
+
+            if (live_entries.empty())
+                continue;
+
+            uint32_t new_index = createPage(vertex_count, index_count);
+            Page *new_page = m_pages[new_index];
+
+            std::vector<VkBufferCopy> vertex_copies;
+            std::vector<VkBufferCopy> index_copies;
+            for (Handle handle : live_entries)
+            {
+                Entry &entry = m_entries[handle];
+                const GeometryRange old_range = entry.range;
+
+                bool placed = allocateRanges(new_index, old_range.vertex_count, old_range.index_count, entry);
+                VV_ASSERT(placed, "A compacted page has to fit every range of the page it replaces");
+
+                VkBufferCopy vertex_copy = {};
+                vertex_copy.srcOffset = static_cast<VkDeviceSize>(old_range.vertex_offset) * sizeof(Vertex);
+                vertex_copy.dstOffset = static_cast<VkDeviceSize>(entry.range.vertex_offset) * sizeof(Vertex);
+                vertex_copy.size = static_cast<VkDeviceSize>(old_range.vertex_count) * sizeof(Vertex);
+                vertex_copies.push_back(vertex_copy);
+
+                VkBufferCopy index_copy = {};
+                index_copy.srcOffset = static_cast<VkDeviceSize>(old_range.first_index) * sizeof(uint32_t);
+                index_copy.dstOffset = static_cast<VkDeviceSize>(entry.range.first_index) * sizeof(uint32_t);
+                index_copy.size = static_cast<VkDeviceSize>(old_range.index_count) * sizeof(uint32_t);
+                index_copies.push_back(index_copy);
+            }
+
+            auto command_buffer = m_device->upload_queue->getCommandBuffer();
+
+            // staging copies into the old page may still be pending in this or an earlier batch on the same queue
+            std::array<VkBufferMemoryBarrier, 2> barriers = {};
+            for (auto &barrier : barriers)
+            {
+                barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.offset = 0;
+                barrier.size = VK_WHOLE_SIZE;
+            }
+            barriers[0].buffer = old_page->vertex_buffer;
+            barriers[1].buffer = old_page->index_buffer;
+            vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+                                 static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+
+            vkCmdCopyBuffer(command_buffer, old_page->vertex_buffer, new_page->vertex_buffer, static_cast<uint32_t>(vertex_copies.size()), vertex_copies.data());
+            vkCmdCopyBuffer(command_buffer, old_page->index_buffer, new_page->index_buffer, static_cast<uint32_t>(index_copies.size()), index_copies.data());
+            m_device->upload_queue->addRecordedBytes(vertex_count * sizeof(Vertex) + index_count * sizeof(uint32_t));
+        }
+
+        if (!moved)
+            return;
+
+        m_device->upload_queue->waitIdle();
+        ++m_generation;
+    }
+
+
+    void GeometryArena::compactIfFragmented()
+    {
+        if (m_frees_since_compaction >= Settings::inst()->getGeometryCompactionThreshold())
+            compact();
+    }
+
+
+    GeometryArenaStats GeometryArena::getStats() const
+    {
+        GeometryArenaStats stats;
+        for (auto page : m_pages)
+        {
+            if (!page)
+                continue;
+
+            ++stats.page_count;
+            stats.allocation_count += page->allocation_count;
+            stats.vertex_capacity += page->vertices.getSize();
+            stats.vertices_used += page->vertices.getUsedSize();
+            stats.index_capacity += page->indices.getSize();
+            stats.indices_used += page->indices.getUsedSize();
+            stats.free_range_count += page->vertices.getFreeRangeCount() + page->indices.getFreeRangeCount();
+        }
+        return stats;
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////// Private
+    uint32_t GeometryArena::createPage(uint64_t vertex_count, uint64_t index_count)
+    {
+        // oversized meshes get a page of their own
+        vertex_count = std::max<uint64_t>(vertex_count, m_page_size / sizeof(Vertex));
+        index_count = std::max<uint64_t>(index_count, m_page_size / sizeof(uint32_t));
+
+        if (vertex_count > static_cast<uint64_t>(INT32_MAX) || index_count > static_cast<uint64_t>(UINT32_MAX))
+            throw std::runtime_error("Geometry page exceeds the range addressable by indexed draws");
+
+        Page *page = new Page();
+        const VkBufferUsageFlags copy_usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        createBuffer(vertex_count * sizeof(Vertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | copy_usage,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryTag(MemoryCategory::Geometry, "geometry arena vertices"),
+                     page->vertex_buffer, page->vertex_memory);
+        createBuffer(index_count * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | copy_usage,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryTag(MemoryCategory::Geometry, "geometry arena indices"),
+                     page->index_buffer, page->index_memory);
+        page->vertices.create(vertex_count);
+        page->indices.create(index_count);
+
+        // reuse the slot of a page that was compacted away
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_pages.size()); ++i)
+        {
+            if (!m_pages[i])
+            {
+                m_pages[i] = page;
+                return i;
+            }
+        }
+
+        m_pages.push_back(page);
+        return static_cast<uint32_t>(m_pages.size() - 1);
+    }
+
+
+    void GeometryArena::destroyPage(Page *page)
+    {
+        vkDestroyBuffer(m_device->logical_device, page->vertex_buffer, HostAllocator::inst()->callbacks(HostObjectType::Buffer));
+        m_device->memory_allocator->free(page->vertex_memory);
+        vkDestroyBuffer(m_device->logical_device, page->index_buffer, HostAllocator::inst()->callbacks(HostObjectType::Buffer));
+        m_device->memory_allocator->free(page->index_memory);
+
+        page->vertices.shutDown();
+        page->indices.shutDown();
+        delete page;
+    }
+
+
+    bool GeometryArena::allocateRanges(uint32_t page_index, uint32_t vertex_count, uint32_t index_count, Entry &entry)
+    {
+        Page *page = m_pages[page_index];
+
+        uint64_t vertex_offset = 0;
+        RangeAllocator::Handle vertex_range = RangeAllocator::invalid_handle;
+        if (!page->vertices.allocate(vertex_count, 1, vertex_offset, vertex_range))
+            return false;
+
+        uint64_t first_index = 0;
+        RangeAllocator::Handle index_range = RangeAllocator::invalid_handle;
+        if (!page->indices.allocate(index_count, 1, first_index, index_range))
+        {
+            page->vertices.free(vertex_range);
+            return false;
+        }
+
+        // entries being moved by compaction still hold their ranges in the old page, which is discarded as a whole
+        entry.range.page = page_index;
+        entry.range.vertex_offset = static_cast<int32_t>(vertex_offset);
+        entry.range.vertex_count = vertex_count;
+        entry.range.first_index = static_cast<uint32_t>(first_index);
+        entry.range.index_count = index_count;
+        entry.vertex_range = vertex_range;
+        entry.index_range = index_range;
+        ++page->allocation_count;
+        return true;
+    }
+
+
+    void GeometryArena::releaseEntry(Handle handle)
+    {
+        Entry &entry = m_entries[handle];
+        Page *page = m_pages[entry.range.page];
+
+        page->vertices.free(entry.vertex_range);
+        page->indices.free(entry.index_range);
+        --page->allocation_count;
+
+        entry = Entry();
+        m_free_entries.push_back(handle);
+        ++m_frees_since_compaction;
+    }
+
+
+    void GeometryArena::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_properties, const MemoryTag &tag,
+                                     VkBuffer &buffer, MemoryAllocation &memory)
+    {
+        VkBufferCreateInfo buffer_create_info = {};
+        buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_create_info.size = size;
+        buffer_create_info.usage = usage;
+
+        // uploads and compaction copies run on the transfer queue if there is one
+        std::array<uint32_t, 2> queue_family_indices = {
+            static_cast<uint32_t>(m_device->graphics_family_index),
+            static_cast<uint32_t>(m_device->transfer_family_index)
+        };
+        if (m_device->transfer_family_index != -1)
+        {
+            buffer_create_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            buffer_create_info.queueFamilyIndexCount = 2;
+            buffer_create_info.pQueueFamilyIndices = queue_family_indices.data();
+        }
+        else
+        {
+            buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            buffer_create_info.queueFamilyIndexCount = 1;
+            buffer_create_info.pQueueFamilyIndices = queue_family_indices.data();
+        }
+
+        VV_CHECK_SUCCESS(vkCreateBuffer(m_device->logical_device, &buffer_create_info, HostAllocator::inst()->callbacks(HostObjectType::Buffer), &buffer));
+
+        VkMemoryRequirements memory_requirements = {};
+        vkGetBufferMemoryRequirements(m_device->logical_device, buffer, &memory_requirements);
+        auto memory_type = m_device->findMemoryTypeIndex(memory_requirements.memoryTypeBits, memory_properties);
+
+        memory = m_device->memory_allocator->allocate(memory_requirements, memory_type, true, tag);
+        VV_CHECK_SUCCESS(vkBindBufferMemory(m_device->logical_device, buffer, memory.memory, memory.offset));
+    }
+
+
+    UploadID GeometryArena::upload(VkBuffer dst_buffer, VkDeviceSize dst_offset, const void *data, VkDeviceSize size)
+    {
+        StagingRegion staging = m_device->upload_queue->allocateStaging(size);
+        memcpy(staging.data, data, static_cast<std::size_t>(size));
+
+        auto command_buffer = m_device->upload_queue->getCommandBuffer();
+
+        VkBufferCopy buffer_copy = {};
+        buffer_copy.srcOffset = staging.offset;
+        buffer_copy.dstOffset = dst_offset;
+        buffer_copy.size = size;
+        vkCmdCopyBuffer(command_buffer, staging.buffer, dst_buffer, 1, &buffer_copy);
+
+        // read before committing the staging memory, which may submit the batch and move on to the next id
+        UploadID upload_id = m_device->upload_queue->getCurrentID();
+
+        // the staging memory is recycled by the UploadQueue once the batch has executed
+        m_device->upload_queue->commitStaging(staging);
+        return upload_id;
+    }
+}
@@ -0,0 +1,288 @@
+#include <algorithm>
+
+#include "GpuProfiler.h"
+#include "HostAllocator.h"
+
+namespace vv
+{
+	///////////////////////////////////////////////////////////////////////////////////////////// Public
+    void GpuProfiler::create(VulkanDevice *device, uint32_t frames_in_flight, uint32_t max_zones)
+    {
+        VV_ASSERT(device != VK_NULL_HANDLE, "VulkanDevice not present");
+        m_device = device;
+        m_max_zones = max_zones;
+
+        uint32_t valid_bits = m_device->queue_family_properties[m_device->graphics_family_index].timestampValidBits;
+        m_supported = valid_bits > 0;
+        m_timestamp_mask = (valid_bits >= 64) ? ~0ull : ((1ull << valid_bits) - 1);
+        m_timestamp_period = m_device->physical_device_properties.limits.timestampPeriod;
+
+        // the device is created with every supported feature enabled
+        m_pipeline_statistics_supported = m_supported && m_device->physical_device_features.pipelineStatisticsQuery == VK_TRUE;
+
+        m_frames.resize(frames_in_flight);
+        m_zone_names.assign(max_zones, std::string());
+        for (auto &frame : m_frames)
+            frame.used_zones.reserve(max_zones);
+        if (!m_supported)
+            return;
+
+        m_timestamps.resize(4 * max_zones);
+        if (m_pipeline_statistics_supported)
+            m_statistics.resize(max_zones * (m_statistic_count + 1));
+
+        for (auto &frame : m_frames)
+        {
+            VkQueryPoolCreateInfo query_pool_create_info = {};
+            query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            query_pool_create_info.queryCount = 2 * max_zones;
+            VV_CHECK_SUCCESS(vkCreateQueryPool(m_device->logical_device, &query_pool_create_info, HostAllocator::inst()->callbacks(HostObjectType::QueryPool), &frame.timestamp_pool));
+
+            if (m_pipeline_statistics_supported)
+            {
+                query_pool_create_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+                query_pool_create_info.queryCount = max_zones;
+                query_pool_create_info.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+                                                            VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+                                                            VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+                                                            VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+                                                            VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+                                                            VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+                VV_CHECK_SUCCESS(vkCreateQueryPool(m_device->logical_device, &query_pool_create_info, HostAllocator::inst()->callbacks(HostObjectType::QueryPool), &frame.statistics_pool));
+            }
+        }
+
+        // zone 0 is the frame itself
+        for (uint32_t zone = max_zones - 1; zone > frame_zone; --zone)
+            m_free_zones.push_back(zone);
+    }
+
+
+    void GpuProfiler::shutDown()
+    {
+        for (auto &frame : m_frames)
+        {
+            if (frame.timestamp_pool != VK_NULL_HANDLE)
+                vkDestroyQueryPool(m_device->logical_device, frame.timestamp_pool, HostAllocator::inst()->callbacks(HostObjectType::QueryPool));
+            if (frame.statistics_pool != VK_NULL_HANDLE)
+                vkDestroyQueryPool(m_device->logical_device, frame.statistics_pool, HostAllocator::inst()->callbacks(HostObjectType::QueryPool));
+        }
+
+        m_frames.clear();
+        m_free_zones.clear();
+        m_zone_names.clear();
+        m_results.clear();
+        m_has_results = false;
+        m_timestamps.clear();
+        m_statistics.clear();
+    }
+
+
+    uint32_t GpuProfiler::allocateZone()
+    {
+        if (m_free_zones.empty())
+            return UINT32_MAX;
+
+        uint32_t zone = m_free_zones.back();
+        m_free_zones.pop_back();
+        return zone;
+    }
+
+
+    void GpuProfiler::releaseZone(uint32_t zone)
+    {
+        if (zone != UINT32_MAX)
+            m_free_zones.push_back(zone);
+    }
+
+
+    void GpuProfiler::collect(uint32_t frame_index)
+    {
+        FrameQueries &frame = m_frames[frame_index];
+        // results of an earlier frame would be reported again, so there are none until the next frame can be read
+        m_has_results = m_supported && frame.recorded && readResults(frame);
+
+        // zones of the next frame are declared while recording, before beginFrame()
+        frame.used_zones.clear();
+        frame.highest_zone = frame_zone;
+        frame.recorded = false;
+    }
+
+
+    void GpuProfiler::beginFrame(VkCommandBuffer command_buffer, uint32_t frame_index)
+    {
+        FrameQueries &frame = m_frames[frame_index];
+        frame.recorded = m_supported;
+
+        if (!m_supported)
+            return;
+
+        vkCmdResetQueryPool(command_buffer, frame.timestamp_pool, 0, 2 * m_max_zones);
+        if (m_pipeline_statistics_supported)
+            vkCmdResetQueryPool(command_buffer, frame.statistics_pool, 0, m_max_zones);
+
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestamp_pool, 2 * frame_zone);
+    }
+
+
+    void GpuProfiler::endFrame(VkCommandBuffer command_buffer, uint32_t frame_index)
+    {
+        if (!m_supported)
+            return;
+
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_frames[frame_index].timestamp_pool, 2 * frame_zone + 1);
+    }
+
+
+    void GpuProfiler::useZone(uint32_t frame_index, uint32_t zone, const std::string &name)
+    {
+        if (!m_supported || zone == UINT32_MAX)
+            return;
+
+        // only copied when a zone changes hands, so steady state frames don't allocate
+        if (m_zone_names[zone] != name)
+            m_zone_names[zone] = name;
+
+        FrameQueries &frame = m_frames[frame_index];
+        frame.used_zones.push_back(zone);
+        frame.highest_zone = std::max(frame.highest_zone, zone);
+    }
+
+
+    void GpuProfiler::beginZone(VkCommandBuffer command_buffer, uint32_t frame_index, uint32_t zone) const
+    {
+        if (!m_supported || zone == UINT32_MAX)
+            return;
+
+        const FrameQueries &frame = m_frames[frame_index];
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestamp_pool, 2 * zone);
+        if (m_pipeline_statistics_supported)
+            vkCmdBeginQuery(command_buffer, frame.statistics_pool, zone, 0);
+    }
+
+
+    void GpuProfiler::endZone(VkCommandBuffer command_buffer, uint32_t frame_index, uint32_t zone) const
+    {
+        if (!m_supported || zone == UINT32_MAX)
+            return;
+
+        const FrameQueries &frame = m_frames[frame_index];
+        if (m_pipeline_statistics_supported)
+            vkCmdEndQuery(command_buffer, frame.statistics_pool, zone);
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.timestamp_pool, 2 * zone + 1);
+    }
+
+
+    const std::vector<GpuZoneResult>& GpuProfiler::getResults() const
+    {
+        static const std::vector<GpuZoneResult> no_results;
+        return m_has_results ? m_results : no_results;
+    }
+
+
+    double GpuProfiler::getFrameTime() const
+    {
+        return m_has_results ? m_results.front().milliseconds : -1.0;
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Private
+    bool GpuProfiler::readResults(const FrameQueries &frame)
+    {
+        const uint32_t zone_count = frame.highest_zone + 1;
+
+        // every value is followed by its availability. zones that weren't executed are never written and stay unavailable.
+        std::fill(m_timestamps.begin(), m_timestamps.begin() + 4 * zone_count, 0);
+        VkResult result = vkGetQueryPoolResults(m_device->logical_device, frame.timestamp_pool, 0, 2 * zone_count,
+                                                4 * zone_count * sizeof(uint64_t), m_timestamps.data(), 2 * sizeof(uint64_t),
+                                                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (result != VK_SUCCESS && result != VK_NOT_READY)
+            return false;
+
+        const uint32_t stride = m_statistic_count + 1;
+        bool has_statistics = false;
+        if (m_pipeline_statistics_supported)
+        {
+            std::fill(m_statistics.begin(), m_statistics.begin() + zone_count * stride, 0);
+            result = vkGetQueryPoolResults(m_device->logical_device, frame.statistics_pool, 0, zone_count,
+                                           zone_count * stride * sizeof(uint64_t), m_statistics.data(), stride * sizeof(uint64_t),
+                                           VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+            has_statistics = (result == VK_SUCCESS || result == VK_NOT_READY);
+        }
+
+        auto zone_milliseconds = [&](uint32_t zone, double &milliseconds)
+        {
+            const uint64_t *begin = &m_timestamps[4 * zone];
+            const uint64_t *end = &m_timestamps[4 * zone + 2];
+            if (begin[1] == 0 || end[1] == 0)
+                return false;
+
+            uint64_t ticks = ((end[0] & m_timestamp_mask) - (begin[0] & m_timestamp_mask)) & m_timestamp_mask;
+            milliseconds = ticks * m_timestamp_period / 1000000.0;
+            return true;
+        };
+
+        double frame_milliseconds = 0.0;
+        if (!zone_milliseconds(frame_zone, frame_milliseconds))
+            return false;
+
+        static const std::string frame_name = "Frame";
+        std::size_t count = 0;
+        GpuZoneResult &frame_result = findResult(frame_name, count);
+        frame_result.milliseconds = frame_milliseconds;
+
+        // zones sharing a name, e.g. chunks of the same material template, are reported together
+        for (uint32_t zone : frame.used_zones)
+        {
+            double milliseconds = 0.0;
+            if (!zone_milliseconds(zone, milliseconds))
+                continue;
+
+            GpuZoneResult &zone_result = findResult(m_zone_names[zone], count);
+            zone_result.milliseconds += milliseconds;
+
+            if (!has_statistics || m_statistics[zone * stride + m_statistic_count] == 0)
+                continue;
+
+            const uint64_t *values = &m_statistics[zone * stride];
+            for (GpuZoneResult *target : { &zone_result, &m_results.front() })
+            {
+                target->input_assembly_vertices += values[0];
+                target->input_assembly_primitives += values[1];
+                target->vertex_invocations += values[2];
+                target->clipping_invocations += values[3];
+                target->clipping_primitives += values[4];
+                target->fragment_invocations += values[5];
+            }
+        }
+
+        // entries left over from frames with more passes. std::sort and resize only move strings around.
+        m_results.resize(count);
+        std::sort(m_results.begin() + 1, m_results.end(), [](const GpuZoneResult &a, const GpuZoneResult &b) { return a.name < b.name; });
+        return true;
+    }
+
+
+    GpuZoneResult& GpuProfiler::findResult(const std::string &name, std::size_t &count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            if (m_results[i].name == name)
+                return m_results[i];
+
+        if (count == m_results.size())
+            m_results.emplace_back();
+
+        // reset field by field so the name keeps its storage
+        GpuZoneResult &result = m_results[count++];
+        result.name.assign(name);
+        result.milliseconds = 0.0;
+        result.input_assembly_vertices = 0;
+        result.input_assembly_primitives = 0;
+        result.vertex_invocations = 0;
+        result.clipping_invocations = 0;
+        result.clipping_primitives = 0;
+        result.fragment_invocations = 0;
+        return result;
+    }
+}
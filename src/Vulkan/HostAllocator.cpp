@@ -0,0 +1,354 @@
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "HostAllocator.h"
+
+namespace vv
+{
+    HostAllocator* HostAllocator::m_instance = nullptr;
+
+    const char* getHostObjectTypeName(HostObjectType type)
+    {
+        switch (type)
+        {
+            case HostObjectType::Instance:            return "instance";
+            case HostObjectType::Device:              return "device";
+            case HostObjectType::Surface:             return "surface";
+            case HostObjectType::SwapChain:           return "swap_chain";
+            case HostObjectType::DebugCallback:       return "debug_callback";
+            case HostObjectType::DeviceMemory:        return "device_memory";
+            case HostObjectType::Buffer:              return "buffer";
+            case HostObjectType::Image:               return "image";
+            case HostObjectType::ImageView:           return "image_view";
+            case HostObjectType::Sampler:             return "sampler";
+            case HostObjectType::ShaderModule:        return "shader_module";
+            case HostObjectType::Pipeline:            return "pipeline";
+            case HostObjectType::PipelineLayout:      return "pipeline_layout";
+            case HostObjectType::RenderPass:          return "render_pass";
+            case HostObjectType::Framebuffer:         return "framebuffer";
+            case HostObjectType::DescriptorSetLayout: return "descriptor_set_layout";
+            case HostObjectType::DescriptorPool:      return "descriptor_pool";
+            case HostObjectType::CommandPool:         return "command_pool";
+            case HostObjectType::QueryPool:           return "query_pool";
+            case HostObjectType::Fence:               return "fence";
+            case HostObjectType::Semaphore:           return "semaphore";
+            default:                                  return "unknown";
+        }
+    }
+
+
+    static const char* getScopeName(uint32_t scope)
+    {
+        switch (scope)
+        {
+            case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND:  return "command";
+            case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT:   return "object";
+            case VK_SYSTEM_ALLOCATION_SCOPE_CACHE:    return "cache";
+            case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE:   return "device";
+            case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE: return "instance";
+            default:                                  return "unknown";
+        }
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Public
+    HostAllocator* HostAllocator::inst()
+    {
+        if (!m_instance)
+            m_instance = new HostAllocator;
+        return m_instance;
+    }
+
+
+    void HostAllocator::setEnabled(bool enabled)
+    {
+        if (!m_locked)
+            m_enabled = enabled;
+    }
+
+
+    const VkAllocationCallbacks* HostAllocator::callbacks(HostObjectType type)
+    {
+        // from here on creates and destroys have to agree on the allocator
+        m_locked = true;
+
+        if (!m_enabled)
+            return nullptr;
+        return &m_callbacks[static_cast<std::size_t>(type)];
+    }
+
+
+    void HostAllocator::beginFrame(uint64_t)
+    {
+        uint64_t total = m_total_allocations.load();
+
+        if (!m_in_frames)
+        {
+            m_loading_allocations = total;
+            m_in_frames = true;
+        }
+        else
+        {
+            uint64_t frame_allocations = total - m_frame_start_allocations;
+            m_max_frame_allocations = std::max(m_max_frame_allocations, frame_allocations);
+            m_frame_allocations_sum += frame_allocations;
+            ++m_frame_count;
+        }
+
+        m_frame_start_allocations = total;
+    }
+
+
+    HostAllocationStats HostAllocator::getTypeStats(HostObjectType type) const
+    {
+        const std::size_t t = static_cast<std::size_t>(type);
+        HostAllocationStats stats = readCounters(m_type_totals[t]);
+
+        for (std::size_t s = 0; s < scope_count; ++s)
+            stats.internal_bytes += m_counters[t][s].internal_bytes.load();
+
+        return stats;
+    }
+
+
+    HostAllocationStats HostAllocator::getScopeStats(VkSystemAllocationScope scope) const
+    {
+        const std::size_t s = static_cast<std::size_t>(scope);
+        HostAllocationStats stats = readCounters(m_scope_totals[s]);
+
+        for (std::size_t t = 0; t < type_count; ++t)
+            stats.internal_bytes += m_counters[t][s].internal_bytes.load();
+
+        return stats;
+    }
+
+
+    void HostAllocator::writeReport(const std::string &path) const
+    {
+        std::ofstream file(path);
+        if (!file.is_open())
+            throw std::runtime_error("Could not open host allocation report " + path + " for writing");
+
+        auto write_stats = [&file](const HostAllocationStats &stats)
+        {
+            file << "{ \"current_bytes\": " << stats.current_bytes
+                 << ", \"peak_bytes\": " << stats.peak_bytes
+                 << ", \"allocations\": " << stats.allocations
+                 << ", \"frees\": " << stats.frees
+                 << ", \"live\": " << stats.live
+                 << ", \"internal_bytes\": " << stats.internal_bytes << " }";
+        };
+
+        file << "{" << std::endl;
+        file << "  \"enabled\": " << (m_enabled ? "true" : "false") << "," << std::endl;
+        file << "  \"loading_allocations\": " << (m_in_frames ? m_loading_allocations : m_total_allocations.load()) << "," << std::endl;
+        file << "  \"frames\": " << m_frame_count << "," << std::endl;
+        file << "  \"allocations_per_frame\": { \"avg\": "
+             << (m_frame_count > 0 ? static_cast<double>(m_frame_allocations_sum) / m_frame_count : 0.0)
+             << ", \"max\": " << m_max_frame_allocations << " }," << std::endl;
+
+        file << "  \"scopes\": {";
+        for (uint32_t s = 0; s < scope_count; ++s)
+        {
+            file << (s == 0 ? "" : ",") << std::endl;
+            file << "    \"" << getScopeName(s) << "\": ";
+            write_stats(getScopeStats(static_cast<VkSystemAllocationScope>(s)));
+        }
+        file << std::endl << "  }," << std::endl;
+
+        // object types the driver never allocated for are left out
+        file << "  \"object_types\": {";
+        bool first = true;
+        for (std::size_t t = 0; t < type_count; ++t)
+        {
+            HostAllocationStats stats = getTypeStats(static_cast<HostObjectType>(t));
+            if (stats.allocations == 0 && stats.internal_bytes == 0)
+                continue;
+
+            file << (first ? "" : ",") << std::endl;
+            file << "    \"" << getHostObjectTypeName(static_cast<HostObjectType>(t)) << "\": ";
+            write_stats(stats);
+            first = false;
+        }
+        file << std::endl << "  }" << std::endl;
+        file << "}" << std::endl;
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Private
+    HostAllocator::HostAllocator()
+    {
+        for (std::size_t t = 0; t < type_count; ++t)
+        {
+            m_callback_data[t].allocator = this;
+            m_callback_data[t].type = static_cast<HostObjectType>(t);
+
+            VkAllocationCallbacks &callbacks = m_callbacks[t];
+            callbacks.pUserData = &m_callback_data[t];
+            callbacks.pfnAllocation = &HostAllocator::allocationCallback;
+            callbacks.pfnReallocation = &HostAllocator::reallocationCallback;
+            callbacks.pfnFree = &HostAllocator::freeCallback;
+            callbacks.pfnInternalAllocation = &HostAllocator::internalAllocationCallback;
+            callbacks.pfnInternalFree = &HostAllocator::internalFreeCallback;
+        }
+
+        // atomics aren't zero initialized
+        auto reset = [](Counters &counters)
+        {
+            counters.current_bytes = 0;
+            counters.peak_bytes = 0;
+            counters.allocations = 0;
+            counters.frees = 0;
+            counters.internal_bytes = 0;
+        };
+        for (auto &type_counters : m_counters)
+            for (auto &counters : type_counters)
+                reset(counters);
+        for (auto &counters : m_type_totals)
+            reset(counters);
+        for (auto &counters : m_scope_totals)
+            reset(counters);
+        m_total_allocations = 0;
+    }
+
+
+    void* HostAllocator::allocate(HostObjectType type, std::size_t size, std::size_t alignment, VkSystemAllocationScope scope)
+    {
+        // the header sits right in front of the returned pointer, so alignment has to cover it as well
+        alignment = std::max<std::size_t>(alignment, alignof(std::max_align_t));
+        const std::size_t header_size = (sizeof(Header) + alignment - 1) & ~(alignment - 1);
+
+        void *block = std::malloc(size + header_size + alignment);
+        if (!block)
+            return nullptr;
+
+        uintptr_t address = reinterpret_cast<uintptr_t>(block) + header_size;
+        address = (address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+
+        Header *header = reinterpret_cast<Header*>(address) - 1;
+        header->block = block;
+        header->size = size;
+        header->type = type;
+        header->scope = scope;
+
+        addAllocation(type, scope, size);
+        return reinterpret_cast<void*>(address);
+    }
+
+
+    void HostAllocator::free(void *memory)
+    {
+        if (!memory)
+            return;
+
+        Header *header = static_cast<Header*>(memory) - 1;
+        addFree(header->type, header->scope, header->size);
+        std::free(header->block);
+    }
+
+
+    void HostAllocator::addAllocation(HostObjectType type, VkSystemAllocationScope scope, std::size_t size)
+    {
+        addToCounters(m_counters[static_cast<std::size_t>(type)][scope], size);
+        addToCounters(m_type_totals[static_cast<std::size_t>(type)], size);
+        addToCounters(m_scope_totals[scope], size);
+        ++m_total_allocations;
+    }
+
+
+    void HostAllocator::addFree(HostObjectType type, VkSystemAllocationScope scope, std::size_t size)
+    {
+        removeFromCounters(m_counters[static_cast<std::size_t>(type)][scope], size);
+        removeFromCounters(m_type_totals[static_cast<std::size_t>(type)], size);
+        removeFromCounters(m_scope_totals[scope], size);
+    }
+
+
+    void HostAllocator::addToCounters(Counters &counters, std::size_t size)
+    {
+        uint64_t current = counters.current_bytes.fetch_add(size) + size;
+        uint64_t peak = counters.peak_bytes.load();
+        while (current > peak && !counters.peak_bytes.compare_exchange_weak(peak, current))
+        {
+        }
+        ++counters.allocations;
+    }
+
+
+    void HostAllocator::removeFromCounters(Counters &counters, std::size_t size)
+    {
+        counters.current_bytes -= size;
+        ++counters.frees;
+    }
+
+
+    HostAllocationStats HostAllocator::readCounters(const Counters &counters)
+    {
+        HostAllocationStats stats;
+        stats.current_bytes = counters.current_bytes.load();
+        stats.peak_bytes = counters.peak_bytes.load();
+        stats.allocations = counters.allocations.load();
+        stats.frees = counters.frees.load();
+        stats.live = stats.allocations - std::min(stats.allocations, stats.frees);
+        return stats;
+    }
+
+
+    void* VKAPI_PTR HostAllocator::allocationCallback(void *user_data, std::size_t size, std::size_t alignment, VkSystemAllocationScope scope)
+    {
+        CallbackData *data = static_cast<CallbackData*>(user_data);
+        return data->allocator->allocate(data->type, size, alignment, scope);
+    }
+
+
+    void* VKAPI_PTR HostAllocator::reallocationCallback(void *user_data, void *original, std::size_t size, std::size_t alignment,
+                                                        VkSystemAllocationScope scope)
+    {
+        CallbackData *data = static_cast<CallbackData*>(user_data);
+
+        if (!original)
+            return data->allocator->allocate(data->type, size, alignment, scope);
+
+        if (size == 0)
+        {
+            data->allocator->free(original);
+            return nullptr;
+        }
+
+        // counted as a new allocation followed by a free, which is what it costs
+        void *memory = data->allocator->allocate(data->type, size, alignment, scope);
+        if (!memory)
+            return nullptr;
+
+        const Header *header = static_cast<Header*>(original) - 1;
+        std::memcpy(memory, original, std::min(size, header->size));
+        data->allocator->free(original);
+        return memory;
+    }
+
+
+    void VKAPI_PTR HostAllocator::freeCallback(void *user_data, void *memory)
+    {
+        static_cast<CallbackData*>(user_data)->allocator->free(memory);
+    }
+
+
+    void VKAPI_PTR HostAllocator::internalAllocationCallback(void *user_data, std::size_t size, VkInternalAllocationType,
+                                                             VkSystemAllocationScope scope)
+    {
+        CallbackData *data = static_cast<CallbackData*>(user_data);
+        data->allocator->m_counters[static_cast<std::size_t>(data->type)][scope].internal_bytes += size;
+    }
+
+
+    void VKAPI_PTR HostAllocator::internalFreeCallback(void *user_data, std::size_t size, VkInternalAllocationType,
+                                                       VkSystemAllocationScope scope)
+    {
+        CallbackData *data = static_cast<CallbackData*>(user_data);
+        data->allocator->m_counters[static_cast<std::size_t>(data->type)][scope].internal_bytes -= size;
+    }
+}
@@ -0,0 +1,415 @@
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "MemoryTracker.h"
+
+namespace vv
+{
+    const char* getMemoryCategoryName(MemoryCategory category)
+    {
+        switch (category)
+        {
+            case MemoryCategory::Geometry:   return "geometry";
+            case MemoryCategory::Texture:    return "texture";
+            case MemoryCategory::Uniform:    return "uniform";
+            case MemoryCategory::Attachment: return "attachment";
+            case MemoryCategory::Staging:    return "staging";
+            default:                         return "other";
+        }
+    }
+
+
+    bool findMemoryCategory(const std::string &name, MemoryCategory &category)
+    {
+        for (uint32_t i = 0; i < static_cast<uint32_t>(MemoryCategory::Count); ++i)
+        {
+            if (name == getMemoryCategoryName(static_cast<MemoryCategory>(i)))
+            {
+                category = static_cast<MemoryCategory>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////// Public
+    void MemoryTracker::create(const VkPhysicalDeviceMemoryProperties &memory_properties)
+    {
+        m_memory_properties = memory_properties;
+        m_heap_usage.assign(m_memory_properties.memoryHeapCount, MemoryUsage());
+        m_category_usage.assign(m_memory_properties.memoryHeapCount, CategoryUsage());
+        m_total_category_usage = CategoryUsage();
+        m_category_budgets.fill(0);
+        m_cpu_copies.fill(CPUCopyUsage());
+        m_next_id = 1;
+    }
+
+
+    void MemoryTracker::shutDown()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_records.empty())
+            VV_ALERT("Memory tracker shut down with " + std::to_string(m_records.size()) + " allocations still alive");
+
+        m_records.clear();
+        m_heap_usage.clear();
+        m_category_usage.clear();
+        m_physical_device = VK_NULL_HANDLE;
+#ifdef VK_EXT_memory_budget
+        m_get_memory_properties = nullptr;
+#endif
+    }
+
+
+    MemoryTracker::TrackingID MemoryTracker::add(const MemoryTag &tag, uint32_t heap, VkDeviceSize size)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        VV_ASSERT(heap < m_heap_usage.size(), "Memory heap out of range");
+
+        MemoryRecord record;
+        record.tag = tag;
+        record.heap = heap;
+        record.size = size;
+
+        TrackingID id = m_next_id++;
+        m_records[id] = record;
+
+        const std::size_t category = static_cast<std::size_t>(tag.category);
+        addUsage(m_heap_usage[heap], size);
+        addUsage(m_category_usage[heap][category], size);
+        addUsage(m_total_category_usage[category], size);
+
+        return id;
+    }
+
+
+    void MemoryTracker::remove(TrackingID id)
+    {
+        if (id == invalid_id)
+            return;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_records.find(id);
+        VV_ASSERT(it != m_records.end(), "Unknown memory tracking id");
+        if (it == m_records.end())
+            return;
+
+        const MemoryRecord &record = it->second;
+        const std::size_t category = static_cast<std::size_t>(record.tag.category);
+        removeUsage(m_heap_usage[record.heap], record.size);
+        removeUsage(m_category_usage[record.heap][category], record.size);
+        removeUsage(m_total_category_usage[category], record.size);
+
+        m_records.erase(it);
+    }
+
+
+#ifdef VK_EXT_memory_budget
+    void MemoryTracker::setBudgetQuery(VkPhysicalDevice physical_device, PFN_vkGetPhysicalDeviceMemoryProperties2KHR get_memory_properties)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_physical_device = physical_device;
+        m_get_memory_properties = get_memory_properties;
+    }
+#endif
+
+
+    bool MemoryTracker::hasBudgetQuery() const
+    {
+#ifdef VK_EXT_memory_budget
+        return m_get_memory_properties != nullptr;
+#else
+        return false;
+#endif
+    }
+
+
+    void MemoryTracker::setCategoryBudget(MemoryCategory category, VkDeviceSize budget)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_category_budgets[static_cast<std::size_t>(category)] = budget;
+    }
+
+
+    std::vector<std::string> MemoryTracker::checkBudgets() const
+    {
+        std::vector<std::string> violations;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (std::size_t i = 0; i < m_category_budgets.size(); ++i)
+            {
+                if (m_category_budgets[i] > 0 && m_total_category_usage[i].current > m_category_budgets[i])
+                    violations.push_back(std::string(getMemoryCategoryName(static_cast<MemoryCategory>(i))) + " memory uses " +
+                                         std::to_string(m_total_category_usage[i].current) + " of its " +
+                                         std::to_string(m_category_budgets[i]) + " byte budget");
+            }
+        }
+
+        for (const auto &heap : getReport(0))
+            if (heap.has_budget && heap.usage > heap.budget)
+                violations.push_back("heap " + std::to_string(heap.heap) + " uses " + std::to_string(heap.usage) +
+                                     " of the " + std::to_string(heap.budget) + " bytes the driver budgets for it");
+
+        return violations;
+    }
+
+
+    std::vector<HeapMemoryReport> MemoryTracker::getReport(uint32_t largest_count) const
+    {
+        std::vector<HeapMemoryReport> reports;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            reports.resize(m_heap_usage.size());
+            for (uint32_t i = 0; i < reports.size(); ++i)
+            {
+                HeapMemoryReport &report = reports[i];
+                report.heap = i;
+                report.heap_size = m_memory_properties.memoryHeaps[i].size;
+                report.device_local = (m_memory_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+                report.total = m_heap_usage[i];
+                report.categories = m_category_usage[i];
+            }
+
+            if (largest_count > 0)
+            {
+                for (const auto &record : m_records)
+                    reports[record.second.heap].largest.push_back(record.second);
+
+                for (auto &report : reports)
+                {
+                    std::size_t count = std::min<std::size_t>(largest_count, report.largest.size());
+                    std::partial_sort(report.largest.begin(), report.largest.begin() + count, report.largest.end(),
+                                      [](const MemoryRecord &a, const MemoryRecord &b) { return a.size > b.size; });
+                    report.largest.resize(count);
+                }
+            }
+        }
+
+        queryBudgets(reports);
+        return reports;
+    }
+
+
+    MemoryUsage MemoryTracker::getCategoryUsage(MemoryCategory category) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_total_category_usage[static_cast<std::size_t>(category)];
+    }
+
+
+    void MemoryTracker::addCPUCopy(MemoryCategory category, VkDeviceSize size)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        addUsage(m_cpu_copies[static_cast<std::size_t>(category)].resident, size);
+    }
+
+
+    void MemoryTracker::removeCPUCopy(MemoryCategory category, VkDeviceSize size, bool released)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        CPUCopyUsage &usage = m_cpu_copies[static_cast<std::size_t>(category)];
+        removeUsage(usage.resident, size);
+        if (released)
+        {
+            usage.released += size;
+            ++usage.release_count;
+        }
+    }
+
+
+    CPUCopyUsage MemoryTracker::getCPUCopyUsage(MemoryCategory category) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_cpu_copies[static_cast<std::size_t>(category)];
+    }
+
+
+    void MemoryTracker::writeReport(const std::string &path, uint32_t largest_count) const
+    {
+        std::ofstream file(path);
+        if (!file.is_open())
+            throw std::runtime_error("Could not open memory report " + path + " for writing");
+
+        // owners are asset paths, escape what JSON requires
+        auto escape = [](const std::string &text)
+        {
+            std::string escaped;
+            for (char c : text)
+            {
+                if (c == '"' || c == '\\')
+                    escaped += '\\';
+                escaped += c;
+            }
+            return escaped;
+        };
+
+        auto write_usage = [&file](const MemoryUsage &usage, VkDeviceSize budget)
+        {
+            file << "{ \"current\": " << usage.current
+                 << ", \"peak\": " << usage.peak
+                 << ", \"allocations\": " << usage.allocation_count;
+            if (budget > 0)
+                file << ", \"budget\": " << budget;
+            file << " }";
+        };
+
+        std::vector<HeapMemoryReport> reports = getReport(largest_count);
+
+        // totals per owner across heaps and categories, the number to watch when an asset regresses
+        std::vector<std::pair<std::string, VkDeviceSize> > owners;
+        CategoryUsage category_usage;
+        std::array<VkDeviceSize, static_cast<std::size_t>(MemoryCategory::Count)> category_budgets;
+        std::array<CPUCopyUsage, static_cast<std::size_t>(MemoryCategory::Count)> cpu_copies;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::unordered_map<std::string, VkDeviceSize> owner_sizes;
+            for (const auto &record : m_records)
+                owner_sizes[record.second.tag.owner.empty() ? "unknown" : record.second.tag.owner] += record.second.size;
+            owners.assign(owner_sizes.begin(), owner_sizes.end());
+            category_usage = m_total_category_usage;
+            category_budgets = m_category_budgets;
+            cpu_copies = m_cpu_copies;
+        }
+        std::size_t owner_count = std::min<std::size_t>(largest_count, owners.size());
+        std::partial_sort(owners.begin(), owners.begin() + owner_count, owners.end(),
+                          [](const std::pair<std::string, VkDeviceSize> &a, const std::pair<std::string, VkDeviceSize> &b) { return a.second > b.second; });
+        owners.resize(owner_count);
+
+        file << "{" << std::endl;
+        file << "  \"unit\": \"bytes\"," << std::endl;
+        file << "  \"has_driver_budget\": " << (hasBudgetQuery() ? "true" : "false") << "," << std::endl;
+
+        file << "  \"categories\": {";
+        for (std::size_t i = 0; i < category_usage.size(); ++i)
+        {
+            file << (i == 0 ? "" : ",") << std::endl;
+            file << "    \"" << getMemoryCategoryName(static_cast<MemoryCategory>(i)) << "\": ";
+            write_usage(category_usage[i], category_budgets[i]);
+        }
+        file << std::endl << "  }," << std::endl;
+
+        file << "  \"heaps\": [";
+        for (std::size_t h = 0; h < reports.size(); ++h)
+        {
+            const HeapMemoryReport &report = reports[h];
+            file << (h == 0 ? "" : ",") << std::endl;
+            file << "    {" << std::endl;
+            file << "      \"heap\": " << report.heap << "," << std::endl;
+            file << "      \"size\": " << report.heap_size << "," << std::endl;
+            file << "      \"device_local\": " << (report.device_local ? "true" : "false") << "," << std::endl;
+            file << "      \"total\": ";
+            write_usage(report.total, 0);
+            file << "," << std::endl;
+
+            file << "      \"driver_budget\": ";
+            if (report.has_budget)
+                file << "{ \"budget\": " << report.budget << ", \"usage\": " << report.usage << " }";
+            else
+                file << "null";
+            file << "," << std::endl;
+
+            file << "      \"categories\": {";
+            bool first = true;
+            for (std::size_t i = 0; i < report.categories.size(); ++i)
+            {
+                // categories that never touched the heap only add noise
+                if (report.categories[i].peak == 0)
+                    continue;
+
+                file << (first ? "" : ",") << std::endl;
+                file << "        \"" << getMemoryCategoryName(static_cast<MemoryCategory>(i)) << "\": ";
+                write_usage(report.categories[i], 0);
+                first = false;
+            }
+            file << (first ? "" : "\n      ") << "}," << std::endl;
+
+            file << "      \"largest\": [";
+            for (std::size_t i = 0; i < report.largest.size(); ++i)
+            {
+                const MemoryRecord &record = report.largest[i];
+                file << (i == 0 ? "" : ",") << std::endl;
+                file << "        { \"size\": " << record.size
+                     << ", \"category\": \"" << getMemoryCategoryName(record.tag.category) << "\""
+                     << ", \"owner\": \"" << escape(record.tag.owner) << "\" }";
+            }
+            file << (report.largest.empty() ? "" : "\n      ") << "]" << std::endl;
+            file << "    }";
+        }
+        file << std::endl << "  ]," << std::endl;
+
+        file << "  \"cpu_copies\": {";
+        bool first_copy = true;
+        for (std::size_t i = 0; i < cpu_copies.size(); ++i)
+        {
+            if (cpu_copies[i].resident.peak == 0)
+                continue;
+
+            file << (first_copy ? "" : ",") << std::endl;
+            file << "    \"" << getMemoryCategoryName(static_cast<MemoryCategory>(i)) << "\": { \"current\": " << cpu_copies[i].resident.current
+                 << ", \"peak\": " << cpu_copies[i].resident.peak
+                 << ", \"copies\": " << cpu_copies[i].resident.allocation_count
+                 << ", \"released\": " << cpu_copies[i].released
+                 << ", \"releases\": " << cpu_copies[i].release_count << " }";
+            first_copy = false;
+        }
+        file << (first_copy ? "" : "\n  ") << "}," << std::endl;
+
+        file << "  \"owners\": [";
+        for (std::size_t i = 0; i < owners.size(); ++i)
+        {
+            file << (i == 0 ? "" : ",") << std::endl;
+            file << "    { \"owner\": \"" << escape(owners[i].first) << "\", \"size\": " << owners[i].second << " }";
+        }
+        file << (owners.empty() ? "" : "\n  ") << "]" << std::endl;
+        file << "}" << std::endl;
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////// Private
+    void MemoryTracker::queryBudgets(std::vector<HeapMemoryReport> &reports) const
+    {
+#ifdef VK_EXT_memory_budget
+        if (!m_get_memory_properties)
+            return;
+
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties = {};
+        budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+        VkPhysicalDeviceMemoryProperties2KHR memory_properties = {};
+        memory_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+        memory_properties.pNext = &budget_properties;
+        m_get_memory_properties(m_physical_device, &memory_properties);
+
+        for (auto &report : reports)
+        {
+            report.has_budget = true;
+            report.budget = budget_properties.heapBudget[report.heap];
+            report.usage = budget_properties.heapUsage[report.heap];
+        }
+#else
+        (void)reports;
+#endif
+    }
+
+
+    void MemoryTracker::addUsage(MemoryUsage &usage, VkDeviceSize size)
+    {
+        usage.current += size;
+        usage.peak = std::max(usage.peak, usage.current);
+        ++usage.allocation_count;
+    }
+
+
+    void MemoryTracker::removeUsage(MemoryUsage &usage, VkDeviceSize size)
+    {
+        usage.current -= size;
+        --usage.allocation_count;
+    }
+}
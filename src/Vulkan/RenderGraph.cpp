@@ -0,0 +1,670 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "RenderGraph.h"
+#include "HostAllocator.h"
+
+namespace vv
+{
+    namespace
+    {
+        struct AccessInfo
+        {
+            VkImageLayout layout;
+            VkPipelineStageFlags stages;
+            VkAccessFlags access;
+            VkImageUsageFlags usage;
+            bool write;
+        };
+
+        const VkAccessFlags write_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                                VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+                                                VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+        AccessInfo getAccessInfo(RenderAccess type)
+        {
+            switch (type)
+            {
+                case RenderAccess::ColorOutput:
+                    return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                             VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                             VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true };
+                case RenderAccess::DepthOutput:
+                    return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                             VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                             VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                             VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true };
+                case RenderAccess::TextureInput:
+                default:
+                    return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_USAGE_SAMPLED_BIT, false };
+            }
+        }
+
+
+        /*
+         * Whoever consumes an imported image after the frame, e.g. the presentation engine or a readback copy.
+         */
+        void getFinalLayoutAccess(VkImageLayout layout, VkPipelineStageFlags &stages, VkAccessFlags &access)
+        {
+            switch (layout)
+            {
+                case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+                    // presentation waits on a semaphore, which already makes the writes visible
+                    stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+                    access = 0;
+                    break;
+                case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+                    stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+                    access = VK_ACCESS_TRANSFER_READ_BIT;
+                    break;
+                case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+                    stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+                    access = VK_ACCESS_SHADER_READ_BIT;
+                    break;
+                default:
+                    stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+                    access = VK_ACCESS_MEMORY_READ_BIT;
+                    break;
+            }
+        }
+
+
+        VkImageAspectFlags getAspectFlags(VkFormat format)
+        {
+            switch (format)
+            {
+                case VK_FORMAT_D16_UNORM:
+                case VK_FORMAT_X8_D24_UNORM_PACK32:
+                case VK_FORMAT_D32_SFLOAT:
+                    return VK_IMAGE_ASPECT_DEPTH_BIT;
+                case VK_FORMAT_S8_UINT:
+                    return VK_IMAGE_ASPECT_STENCIL_BIT;
+                case VK_FORMAT_D16_UNORM_S8_UINT:
+                case VK_FORMAT_D24_UNORM_S8_UINT:
+                case VK_FORMAT_D32_SFLOAT_S8_UINT:
+                    return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+                default:
+                    return VK_IMAGE_ASPECT_COLOR_BIT;
+            }
+        }
+
+
+        bool lifetimesOverlap(uint32_t first_a, uint32_t last_a, uint32_t first_b, uint32_t last_b)
+        {
+            return first_a <= last_b && first_b <= last_a;
+        }
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Public
+    void RenderGraph::create(VulkanDevice *device, VkExtent2D extent)
+    {
+        VV_ASSERT(device != nullptr, "VulkanDevice not present");
+        m_device = device;
+        m_extent = extent;
+        m_compiled = false;
+    }
+
+
+    void RenderGraph::shutDown()
+    {
+        for (auto &pass : m_passes)
+        {
+            for (auto framebuffer : pass.framebuffers)
+                vkDestroyFramebuffer(m_device->logical_device, framebuffer, HostAllocator::inst()->callbacks(HostObjectType::Framebuffer));
+
+            if (pass.render_pass != nullptr)
+            {
+                pass.render_pass->shutDown();
+                delete pass.render_pass;
+            }
+        }
+
+        for (auto &resource : m_resources)
+        {
+            if (resource.imported)
+                continue;
+
+            for (auto image_view : resource.image_views)
+                vkDestroyImageView(m_device->logical_device, image_view, HostAllocator::inst()->callbacks(HostObjectType::ImageView));
+            for (auto image : resource.images)
+                vkDestroyImage(m_device->logical_device, image, HostAllocator::inst()->callbacks(HostObjectType::Image));
+        }
+
+        if (m_transient_memory.memory != VK_NULL_HANDLE)
+            m_device->memory_allocator->free(m_transient_memory);
+        m_transient_memory = MemoryAllocation();
+
+        m_passes.clear();
+        m_resources.clear();
+        m_final_barriers.clear();
+        m_final_barrier_resources.clear();
+        m_stats = RenderGraphStats();
+        m_compiled = false;
+    }
+
+
+    RenderResourceID RenderGraph::createAttachment(const std::string &name, VkFormat format, VkSampleCountFlagBits sample_count)
+    {
+        VV_ASSERT(!m_compiled, "Resources can't be added to a compiled render graph");
+
+        Resource resource;
+        resource.name = name;
+        resource.format = format;
+        resource.sample_count = sample_count;
+        resource.aspect_flags = getAspectFlags(format);
+        resource.imported = false;
+        resource.final_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        m_resources.push_back(resource);
+        return static_cast<RenderResourceID>(m_resources.size() - 1);
+    }
+
+
+    RenderResourceID RenderGraph::importImages(const std::string &name, const std::vector<VulkanImage*> &images,
+                                               const std::vector<VulkanImageView*> &image_views, VkImageLayout final_layout)
+    {
+        VV_ASSERT(!m_compiled, "Resources can't be added to a compiled render graph");
+        VV_ASSERT(!images.empty() && images.size() == image_views.size(), "Every imported image needs exactly one view");
+
+        Resource resource;
+        resource.name = name;
+        resource.format = images.front()->format;
+        resource.sample_count = VK_SAMPLE_COUNT_1_BIT;
+        resource.aspect_flags = images.front()->aspect_flags;
+        resource.imported = true;
+        resource.final_layout = final_layout;
+
+        for (std::size_t i = 0; i < images.size(); ++i)
+        {
+            resource.images.push_back(images[i]->image);
+            resource.image_views.push_back(image_views[i]->image_view);
+        }
+
+        m_resources.push_back(resource);
+        return static_cast<RenderResourceID>(m_resources.size() - 1);
+    }
+
+
+    uint32_t RenderGraph::addPass(const std::string &name, RecordFunction record, VkSubpassContents contents)
+    {
+        VV_ASSERT(!m_compiled, "Passes can't be added to a compiled render graph");
+
+        Pass pass;
+        pass.name = name;
+        pass.record = record;
+        pass.contents = contents;
+
+        m_passes.push_back(pass);
+        return static_cast<uint32_t>(m_passes.size() - 1);
+    }
+
+
+    void RenderGraph::addColorOutput(uint32_t pass, RenderResourceID resource, VkAttachmentLoadOp load_op, VkClearColorValue clear_value)
+    {
+        VV_ASSERT(pass < m_passes.size() && resource < m_resources.size(), "Unknown render graph pass or resource");
+
+        Access access;
+        access.resource = resource;
+        access.type = RenderAccess::ColorOutput;
+        access.load_op = load_op;
+        access.clear_value.color = clear_value;
+        m_passes[pass].accesses.push_back(access);
+    }
+
+
+    void RenderGraph::addDepthOutput(uint32_t pass, RenderResourceID resource, VkAttachmentLoadOp load_op, VkClearDepthStencilValue clear_value)
+    {
+        VV_ASSERT(pass < m_passes.size() && resource < m_resources.size(), "Unknown render graph pass or resource");
+
+        Access access;
+        access.resource = resource;
+        access.type = RenderAccess::DepthOutput;
+        access.load_op = load_op;
+        access.clear_value.depthStencil = clear_value;
+        m_passes[pass].accesses.push_back(access);
+    }
+
+
+    void RenderGraph::addTextureInput(uint32_t pass, RenderResourceID resource)
+    {
+        VV_ASSERT(pass < m_passes.size() && resource < m_resources.size(), "Unknown render graph pass or resource");
+
+        Access access;
+        access.resource = resource;
+        access.type = RenderAccess::TextureInput;
+        access.load_op = VK_ATTACHMENT_LOAD_OP_LOAD;
+        access.clear_value = {};
+        m_passes[pass].accesses.push_back(access);
+    }
+
+
+    void RenderGraph::compile()
+    {
+        VV_ASSERT(!m_compiled, "Render graph has already been compiled");
+
+        cullPasses();
+
+        // lifetimes and usage only count the passes that are actually executed
+        for (uint32_t i = 0; i < m_passes.size(); ++i)
+        {
+            if (m_passes[i].culled)
+                continue;
+
+            for (const auto &access : m_passes[i].accesses)
+            {
+                Resource &resource = m_resources[access.resource];
+                VV_ASSERT(resource.imported || resource.first_pass != UINT32_MAX || getAccessInfo(access.type).write,
+                          "Render graph resource is read before any pass writes it");
+                VV_ASSERT(resource.imported || resource.first_pass != UINT32_MAX || access.load_op != VK_ATTACHMENT_LOAD_OP_LOAD,
+                          "Transient attachments have no contents to load at their first use");
+
+                resource.first_pass = std::min(resource.first_pass, i);
+                resource.last_pass = std::max(resource.last_pass, i);
+                resource.usage |= getAccessInfo(access.type).usage;
+            }
+        }
+
+        allocateTransientAttachments();
+        createRenderPasses();
+        computeBarriers();
+
+        m_stats.pass_count = static_cast<uint32_t>(m_passes.size());
+        m_compiled = true;
+    }
+
+
+    void RenderGraph::execute(VkCommandBuffer command_buffer, uint32_t image_index)
+    {
+        VV_ASSERT(m_compiled, "Render graph has to be compiled before it can be executed");
+
+        for (auto &pass : m_passes)
+        {
+            if (pass.culled)
+                continue;
+
+            recordBarriers(command_buffer, pass.barriers, pass.barrier_resources, pass.src_stages, pass.dst_stages, image_index);
+
+            VkFramebuffer framebuffer = pass.framebuffers[(pass.framebuffers.size() > 1) ? image_index : 0];
+            pass.render_pass->beginRenderPass(command_buffer, pass.contents, framebuffer, m_extent, pass.clear_values);
+            pass.record(command_buffer);
+            pass.render_pass->endRenderPass(command_buffer);
+        }
+
+        recordBarriers(command_buffer, m_final_barriers, m_final_barrier_resources, m_final_src_stages, m_final_dst_stages, image_index);
+    }
+
+
+    VulkanRenderPass* RenderGraph::getRenderPass(uint32_t pass) const
+    {
+        VV_ASSERT(m_compiled, "Render passes are created when the render graph is compiled");
+        return m_passes[pass].render_pass;
+    }
+
+
+    VkImageView RenderGraph::getImageView(RenderResourceID resource, uint32_t image_index) const
+    {
+        const Resource &entry = m_resources[resource];
+        if (entry.image_views.empty())
+            return VK_NULL_HANDLE;
+
+        return entry.image_views[entry.imported ? image_index : 0];
+    }
+
+
+    RenderGraphStats RenderGraph::getStats() const
+    {
+        return m_stats;
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Private
+    void RenderGraph::cullPasses()
+    {
+        // walking backwards, a resource is needed if a later pass that survived reads it or it leaves the graph
+        std::vector<bool> needed(m_resources.size(), false);
+        for (std::size_t i = 0; i < m_resources.size(); ++i)
+            needed[i] = m_resources[i].imported;
+
+        m_stats.culled_pass_count = 0;
+        for (std::size_t i = m_passes.size(); i-- > 0;)
+        {
+            Pass &pass = m_passes[i];
+
+            pass.culled = true;
+            for (const auto &access : pass.accesses)
+                if (getAccessInfo(access.type).write && needed[access.resource])
+                    pass.culled = false;
+
+            if (pass.culled)
+            {
+                ++m_stats.culled_pass_count;
+                continue;
+            }
+
+            // a cleared attachment doesn't depend on earlier writers, loaded attachments and inputs do
+            for (const auto &access : pass.accesses)
+                if (getAccessInfo(access.type).write && access.load_op != VK_ATTACHMENT_LOAD_OP_LOAD)
+                    needed[access.resource] = false;
+            for (const auto &access : pass.accesses)
+                if (!getAccessInfo(access.type).write || access.load_op == VK_ATTACHMENT_LOAD_OP_LOAD)
+                    needed[access.resource] = true;
+        }
+    }
+
+
+    void RenderGraph::allocateTransientAttachments()
+    {
+        std::vector<RenderResourceID> transients;
+        for (RenderResourceID i = 0; i < m_resources.size(); ++i)
+        {
+            Resource &resource = m_resources[i];
+            if (resource.imported || resource.first_pass == UINT32_MAX)
+                continue;
+
+            VkImageCreateInfo image_create_info = {};
+            image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            image_create_info.imageType = VK_IMAGE_TYPE_2D;
+            image_create_info.format = resource.format;
+            image_create_info.extent = { m_extent.width, m_extent.height, 1 };
+            image_create_info.mipLevels = 1;
+            image_create_info.arrayLayers = 1;
+            image_create_info.samples = resource.sample_count;
+            image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+            image_create_info.usage = resource.usage;
+            image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            VkImage image;
+            VV_CHECK_SUCCESS(vkCreateImage(m_device->logical_device, &image_create_info, HostAllocator::inst()->callbacks(HostObjectType::Image), &image));
+            vkGetImageMemoryRequirements(m_device->logical_device, image, &resource.memory_requirements);
+            resource.images.push_back(image);
+
+            transients.push_back(i);
+        }
+
+        m_stats.transient_count = static_cast<uint32_t>(transients.size());
+        if (transients.empty())
+            return;
+
+        // largest first, each at the lowest offset not overlapping an attachment that is alive at the same time
+        std::sort(transients.begin(), transients.end(), [this](RenderResourceID a, RenderResourceID b)
+        {
+            return m_resources[a].memory_requirements.size > m_resources[b].memory_requirements.size;
+        });
+
+        VkMemoryRequirements requirements = {};
+        requirements.alignment = 1;
+        requirements.memoryTypeBits = UINT32_MAX;
+
+        for (std::size_t i = 0; i < transients.size(); ++i)
+        {
+            Resource &resource = m_resources[transients[i]];
+            const VkMemoryRequirements &own = resource.memory_requirements;
+
+            VkDeviceSize offset = 0;
+            bool moved = true;
+            while (moved)
+            {
+                moved = false;
+                for (std::size_t j = 0; j < i; ++j)
+                {
+                    const Resource &placed = m_resources[transients[j]];
+                    if (!lifetimesOverlap(resource.first_pass, resource.last_pass, placed.first_pass, placed.last_pass))
+                        continue;
+
+                    const VkDeviceSize placed_end = placed.memory_offset + placed.memory_requirements.size;
+                    if (offset < placed_end && placed.memory_offset < offset + own.size)
+                    {
+                        offset = (placed_end + own.alignment - 1) / own.alignment * own.alignment;
+                        moved = true;
+                    }
+                }
+            }
+
+            resource.memory_offset = offset;
+            requirements.size = std::max(requirements.size, offset + own.size);
+            requirements.alignment = std::max(requirements.alignment, own.alignment);
+            requirements.memoryTypeBits &= own.memoryTypeBits;
+            m_stats.transient_size += own.size;
+        }
+
+        if (requirements.memoryTypeBits == 0)
+            throw std::runtime_error("Transient attachments of the render graph have no memory type in common");
+
+        uint32_t memory_type = m_device->findMemoryTypeIndex(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        m_transient_memory = m_device->memory_allocator->allocate(requirements, memory_type, false,
+                                                                  MemoryTag(MemoryCategory::Attachment, "render graph"));
+        m_stats.aliased_size = requirements.size;
+
+        for (RenderResourceID id : transients)
+        {
+            Resource &resource = m_resources[id];
+            VV_CHECK_SUCCESS(vkBindImageMemory(m_device->logical_device, resource.images[0], m_transient_memory.memory,
+                                               m_transient_memory.offset + resource.memory_offset));
+
+            VkImageViewCreateInfo image_view_create_info = {};
+            image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            image_view_create_info.image = resource.images[0];
+            image_view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            image_view_create_info.format = resource.format;
+            image_view_create_info.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+                                                  VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+            image_view_create_info.subresourceRange = { resource.aspect_flags, 0, 1, 0, 1 };
+
+            VkImageView image_view;
+            VV_CHECK_SUCCESS(vkCreateImageView(m_device->logical_device, &image_view_create_info, HostAllocator::inst()->callbacks(HostObjectType::ImageView), &image_view));
+            resource.image_views.push_back(image_view);
+        }
+    }
+
+
+    void RenderGraph::createRenderPasses()
+    {
+        for (uint32_t i = 0; i < m_passes.size(); ++i)
+        {
+            Pass &pass = m_passes[i];
+            if (pass.culled)
+                continue;
+
+            pass.render_pass = new VulkanRenderPass();
+            std::vector<RenderResourceID> attachments;
+            std::size_t image_count = 1;
+
+            for (const auto &access : pass.accesses)
+            {
+                if (access.type == RenderAccess::TextureInput)
+                    continue;
+
+                const Resource &resource = m_resources[access.resource];
+                const AccessInfo info = getAccessInfo(access.type);
+
+                // contents nobody reads afterwards, e.g. depth, never have to leave tile memory
+                const VkAttachmentStoreOp store_op = (resource.imported || resource.last_pass > i) ? VK_ATTACHMENT_STORE_OP_STORE
+                                                                                                   : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                const bool has_stencil = (resource.aspect_flags & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+
+                // layouts are transitioned by the graph's barriers, the render pass itself never changes them
+                pass.render_pass->addAttachment
+                (
+                      resource.format
+                    , resource.sample_count
+                    , access.load_op
+                    , store_op
+                    , has_stencil ? access.load_op : VK_ATTACHMENT_LOAD_OP_DONT_CARE
+                    , has_stencil ? store_op : VK_ATTACHMENT_STORE_OP_DONT_CARE
+                    , info.layout
+                    , info.layout
+                );
+
+                pass.clear_values.push_back(access.clear_value);
+                attachments.push_back(access.resource);
+
+                if (resource.imported)
+                {
+                    VV_ASSERT(image_count == 1 || image_count == resource.images.size(), "Imported attachments of a pass differ in image count");
+                    image_count = resource.images.size();
+                }
+            }
+
+            VV_ASSERT(!attachments.empty(), "Render graph passes need at least one attachment");
+            pass.render_pass->create(m_device, VK_PIPELINE_BIND_POINT_GRAPHICS, false);
+
+            for (std::size_t image_index = 0; image_index < image_count; ++image_index)
+            {
+                std::vector<VkImageView> image_views;
+                for (RenderResourceID id : attachments)
+                    image_views.push_back(m_resources[id].image_views[m_resources[id].imported ? image_index : 0]);
+
+                pass.framebuffers.push_back(pass.render_pass->createFramebuffer(image_views, m_extent));
+            }
+        }
+    }
+
+
+    void RenderGraph::computeBarriers()
+    {
+        struct State
+        {
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkPipelineStageFlags stages = 0; // of every access since the last barrier
+            VkAccessFlags access = 0;
+        };
+
+        // the last use of every resource within a frame
+        std::vector<State> last_use(m_resources.size());
+        for (const auto &pass : m_passes)
+        {
+            if (pass.culled)
+                continue;
+
+            for (const auto &access : pass.accesses)
+            {
+                const AccessInfo info = getAccessInfo(access.type);
+                last_use[access.resource].stages = info.stages;
+                last_use[access.resource].access = info.access;
+            }
+        }
+
+        // a transient attachment starts every frame undefined, but has to wait for the last use of anything sharing its
+        // memory, including itself during the previous frame. imported images are synchronized by whoever hands them
+        // over, e.g. the swap chain's semaphore, so the first barrier only has to wait on its own stage.
+        std::vector<State> states(m_resources.size());
+        for (std::size_t i = 0; i < m_resources.size(); ++i)
+        {
+            const Resource &resource = m_resources[i];
+            if (resource.imported || resource.first_pass == UINT32_MAX)
+                continue;
+
+            for (std::size_t j = 0; j < m_resources.size(); ++j)
+            {
+                const Resource &other = m_resources[j];
+                if (other.imported || other.first_pass == UINT32_MAX)
+                    continue;
+
+                const bool memory_overlaps = other.memory_offset < resource.memory_offset + resource.memory_requirements.size &&
+                                             resource.memory_offset < other.memory_offset + other.memory_requirements.size;
+                if (!memory_overlaps)
+                    continue;
+
+                states[i].stages |= last_use[j].stages;
+                states[i].access |= last_use[j].access & write_access_mask;
+            }
+        }
+
+        m_stats.barrier_count = 0;
+        for (auto &pass : m_passes)
+        {
+            if (pass.culled)
+                continue;
+
+            for (const auto &access : pass.accesses)
+            {
+                const Resource &resource = m_resources[access.resource];
+                const AccessInfo info = getAccessInfo(access.type);
+                State &state = states[access.resource];
+
+                // reads in the same layout as the reads before them don't need to wait on each other
+                const bool hazard = info.write || (state.access & write_access_mask) != 0;
+                if (state.layout == info.layout && !hazard)
+                {
+                    state.stages |= info.stages;
+                    state.access |= info.access;
+                    continue;
+                }
+
+                VkImageMemoryBarrier barrier = {};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.srcAccessMask = state.access & write_access_mask;
+                barrier.dstAccessMask = info.access;
+
+                // previous contents are thrown away when the attachment gets cleared anyway
+                barrier.oldLayout = (info.write && access.load_op != VK_ATTACHMENT_LOAD_OP_LOAD) ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+                barrier.newLayout = info.layout;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = resource.imported ? VK_NULL_HANDLE : resource.images[0];
+                barrier.subresourceRange = { resource.aspect_flags, 0, 1, 0, 1 };
+
+                pass.barriers.push_back(barrier);
+                pass.barrier_resources.push_back(access.resource);
+                pass.src_stages |= (state.stages != 0) ? state.stages : info.stages;
+                pass.dst_stages |= info.stages;
+
+                state.layout = info.layout;
+                state.stages = info.stages;
+                state.access = info.access;
+            }
+
+            m_stats.barrier_count += static_cast<uint32_t>(pass.barriers.size());
+        }
+
+        for (RenderResourceID i = 0; i < m_resources.size(); ++i)
+        {
+            const Resource &resource = m_resources[i];
+            if (!resource.imported)
+                continue;
+
+            VkPipelineStageFlags dst_stages = 0;
+            VkAccessFlags dst_access = 0;
+            getFinalLayoutAccess(resource.final_layout, dst_stages, dst_access);
+
+            VkImageMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = states[i].access & write_access_mask;
+            barrier.dstAccessMask = dst_access;
+            barrier.oldLayout = states[i].layout;
+            barrier.newLayout = resource.final_layout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.subresourceRange = { resource.aspect_flags, 0, 1, 0, 1 };
+
+            m_final_barriers.push_back(barrier);
+            m_final_barrier_resources.push_back(i);
+            m_final_src_stages |= (states[i].stages != 0) ? states[i].stages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            m_final_dst_stages |= dst_stages;
+        }
+
+        m_stats.barrier_count += static_cast<uint32_t>(m_final_barriers.size());
+    }
+
+
+    void RenderGraph::recordBarriers(VkCommandBuffer command_buffer, std::vector<VkImageMemoryBarrier> &barriers,
+                                     const std::vector<RenderResourceID> &resources, VkPipelineStageFlags src_stages,
+                                     VkPipelineStageFlags dst_stages, uint32_t image_index)
+    {
+        if (barriers.empty())
+            return;
+
+        for (std::size_t i = 0; i < barriers.size(); ++i)
+        {
+            const Resource &resource = m_resources[resources[i]];
+            if (resource.imported)
+                barriers[i].image = resource.images[image_index];
+        }
+
+        vkCmdPipelineBarrier(command_buffer, src_stages, dst_stages, 0, 0, nullptr, 0, nullptr,
+                             static_cast<uint32_t>(barriers.size()), barriers.data());
+    }
+}
@@ -0,0 +1,80 @@
+#include <algorithm>
+
+#include "StagingRing.h"
+#include "VulkanDevice.h"
+#include "HostAllocator.h"
+
+namespace vv
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////// Public
+    void StagingRing::create(VulkanDevice *device, VkDeviceSize size)
+    {
+        VV_ASSERT(device != VK_NULL_HANDLE, "VulkanDevice not present");
+        m_device = device;
+        m_size = size;
+        m_head = 0;
+        m_tail = 0;
+
+        VkBufferCreateInfo buffer_create_info = {};
+        buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_create_info.size = m_size;
+        buffer_create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VV_CHECK_SUCCESS(vkCreateBuffer(m_device->logical_device, &buffer_create_info, HostAllocator::inst()->callbacks(HostObjectType::Buffer), &buffer));
+
+        VkMemoryRequirements memory_requirements = {};
+        vkGetBufferMemoryRequirements(m_device->logical_device, buffer, &memory_requirements);
+
+        // coherent memory means writes need no flush before the copies are submitted
+        auto memory_type = m_device->findMemoryTypeIndex(memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        m_memory = m_device->memory_allocator->allocate(memory_requirements, memory_type, true, MemoryTag(MemoryCategory::Staging, "staging ring"));
+        VV_CHECK_SUCCESS(vkBindBufferMemory(m_device->logical_device, buffer, m_memory.memory, m_memory.offset));
+    }
+
+
+    void StagingRing::shutDown()
+    {
+        vkDestroyBuffer(m_device->logical_device, buffer, HostAllocator::inst()->callbacks(HostObjectType::Buffer));
+        m_device->memory_allocator->free(m_memory);
+        buffer = VK_NULL_HANDLE;
+        m_head = 0;
+        m_tail = 0;
+    }
+
+
+    bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset)
+    {
+        VV_ASSERT(size <= m_size, "Allocation larger than the staging ring");
+        VkDeviceSize lap_start = m_head - m_head % m_size;
+        VkDeviceSize aligned_offset = (m_head % m_size + alignment - 1) / alignment * alignment;
+        VkDeviceSize position = lap_start + aligned_offset;
+
+        // allocations never wrap around the end of the buffer, they move on to the start of the next lap instead
+        if (aligned_offset + size > m_size)
+            position = lap_start + m_size;
+
+        // nothing is in use, so the allocation may start anywhere
+        if (m_tail == m_head)
+            m_tail = position;
+
+        if (position + size - m_tail > m_size)
+            return false;
+
+        m_head = position + size;
+        offset = position % m_size;
+        return true;
+    }
+
+
+    void StagingRing::release(VkDeviceSize head)
+    {
+        m_tail = std::max(m_tail, head);
+    }
+
+
+    void* StagingRing::getMappedData(VkDeviceSize offset) const
+    {
+        return static_cast<unsigned char *>(m_memory.mapped_data) + offset;
+    }
+}
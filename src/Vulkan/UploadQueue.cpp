@@ -0,0 +1,274 @@
+#include "UploadQueue.h"
+#include "VulkanDevice.h"
+#include "Settings.h"
+#include "HostAllocator.h"
+
+namespace vv
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////// Public
+    void UploadQueue::create(VulkanDevice *device)
+    {
+        VV_ASSERT(device != VK_NULL_HANDLE, "VulkanDevice not present");
+        m_device = device;
+
+        uint32_t family_index = static_cast<uint32_t>(m_device->graphics_family_index);
+        m_queue = m_device->graphics_queue;
+        m_transfer_only = false;
+
+        // prefer the dedicated transfer family so uploads don't compete with rendering
+        if (m_device->transfer_queue != VK_NULL_HANDLE)
+        {
+            family_index = static_cast<uint32_t>(m_device->transfer_family_index);
+            m_queue = m_device->transfer_queue;
+            m_transfer_only = true;
+        }
+
+        VkCommandPoolCreateInfo command_pool_create_info = {};
+        command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        command_pool_create_info.queueFamilyIndex = family_index;
+
+        VV_CHECK_SUCCESS(vkCreateCommandPool(m_device->logical_device, &command_pool_create_info, HostAllocator::inst()->callbacks(HostObjectType::CommandPool), &m_command_pool));
+
+        m_staging_ring.create(m_device, Settings::inst()->getStagingRingSize());
+    }
+
+
+    void UploadQueue::shutDown()
+    {
+        waitIdle();
+
+        for (auto &batch : m_free)
+        {
+            vkFreeCommandBuffers(m_device->logical_device, m_command_pool, 1, &batch.command_buffer);
+            util::destroyVulkanFence(m_device->logical_device, batch.fence);
+        }
+        m_free.clear();
+
+        vkDestroyCommandPool(m_device->logical_device, m_command_pool, HostAllocator::inst()->callbacks(HostObjectType::CommandPool));
+        m_command_pool = VK_NULL_HANDLE;
+
+        m_staging_ring.shutDown();
+    }
+
+
+    VkCommandBuffer UploadQueue::getCommandBuffer()
+    {
+        if (m_is_recording)
+            return m_recording.command_buffer;
+
+        collectCompleted();
+
+        if (!m_free.empty())
+        {
+            m_recording = m_free.back();
+            m_free.pop_back();
+            VV_CHECK_SUCCESS(vkResetCommandBuffer(m_recording.command_buffer, 0));
+            VV_CHECK_SUCCESS(vkResetFences(m_device->logical_device, 1, &m_recording.fence));
+        }
+        else
+        {
+            m_recording = Batch();
+
+            VkCommandBufferAllocateInfo allocate_info = {};
+            allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocate_info.commandPool = m_command_pool;
+            allocate_info.commandBufferCount = 1;
+            VV_CHECK_SUCCESS(vkAllocateCommandBuffers(m_device->logical_device, &allocate_info, &m_recording.command_buffer));
+
+            m_recording.fence = util::createVulkanFence(m_device->logical_device, false);
+        }
+
+        m_recording.id = m_next_id;
+        m_recording.recorded_bytes = 0;
+        m_recording.staging_head = m_staging_ring.getHead();
+
+        VkCommandBufferBeginInfo begin_info = {};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VV_CHECK_SUCCESS(vkBeginCommandBuffer(m_recording.command_buffer, &begin_info));
+
+        m_is_recording = true;
+        return m_recording.command_buffer;
+    }
+
+
+    UploadID UploadQueue::getCurrentID() const
+    {
+        // before the first command of a new batch is recorded the id it will receive is already known
+        return m_next_id;
+    }
+
+
+    StagingRegion UploadQueue::allocateStaging(VkDeviceSize size, VkDeviceSize alignment)
+    {
+        StagingRegion region;
+        region.size = size;
+
+        if (size > m_staging_ring.getSize())
+        {
+            VkBufferCreateInfo buffer_create_info = {};
+            buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            buffer_create_info.size = size;
+            buffer_create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            VV_CHECK_SUCCESS(vkCreateBuffer(m_device->logical_device, &buffer_create_info, HostAllocator::inst()->callbacks(HostObjectType::Buffer), &region.buffer));
+
+            VkMemoryRequirements memory_requirements = {};
+            vkGetBufferMemoryRequirements(m_device->logical_device, region.buffer, &memory_requirements);
+
+            auto memory_type = m_device->findMemoryTypeIndex(memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            region.dedicated_memory = m_device->memory_allocator->allocate(memory_requirements, memory_type, true, MemoryTag(MemoryCategory::Staging, "oversized upload"));
+            VV_CHECK_SUCCESS(vkBindBufferMemory(m_device->logical_device, region.buffer, region.dedicated_memory.memory, region.dedicated_memory.offset));
+            region.data = region.dedicated_memory.mapped_data;
+            return region;
+        }
+
+        while (!m_staging_ring.allocate(size, alignment, region.offset))
+            retireOldest();
+
+        // a batch started before this allocation has to hold on to it as well
+        if (m_is_recording)
+            m_recording.staging_head = m_staging_ring.getHead();
+
+        region.buffer = m_staging_ring.buffer;
+        region.data = m_staging_ring.getMappedData(region.offset);
+        return region;
+    }
+
+
+    void UploadQueue::commitStaging(const StagingRegion &region)
+    {
+        if (region.dedicated_memory.memory != VK_NULL_HANDLE)
+            releaseStagingBuffer(region.buffer, region.dedicated_memory, region.size);
+        else
+            addRecordedBytes(region.size);
+    }
+
+
+    void UploadQueue::releaseStagingBuffer(VkBuffer buffer, const MemoryAllocation &memory, VkDeviceSize size_in_bytes)
+    {
+        VV_ASSERT(m_is_recording, "Staging buffers can only be released into a batch that is being recorded");
+        m_recording.staging.push_back({ buffer, memory });
+        addRecordedBytes(size_in_bytes);
+    }
+
+
+    void UploadQueue::addRecordedBytes(VkDeviceSize size_in_bytes)
+    {
+        VV_ASSERT(m_is_recording, "Nothing is being recorded");
+        m_recording.recorded_bytes += size_in_bytes;
+
+        // keep staging memory bounded while large scenes load
+        if (m_recording.recorded_bytes >= Settings::inst()->getUploadBatchSize())
+            flush();
+    }
+
+
+    UploadID UploadQueue::flush()
+    {
+        if (!m_is_recording)
+            return m_next_id - 1;
+
+        VV_CHECK_SUCCESS(vkEndCommandBuffer(m_recording.command_buffer));
+
+        VkSubmitInfo submit_info = {};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &m_recording.command_buffer;
+        VV_CHECK_SUCCESS(vkQueueSubmit(m_queue, 1, &submit_info, m_recording.fence));
+
+        UploadID id = m_recording.id;
+        m_in_flight.push_back(m_recording);
+        m_recording = Batch();
+        m_is_recording = false;
+        ++m_next_id;
+
+        return id;
+    }
+
+
+    bool UploadQueue::isComplete(UploadID id)
+    {
+        if (id <= m_last_completed_id)
+            return true;
+
+        collectCompleted();
+        return id <= m_last_completed_id;
+    }
+
+
+    void UploadQueue::waitFor(UploadID id)
+    {
+        if (isComplete(id))
+            return;
+
+        if (m_is_recording && m_recording.id <= id)
+            flush();
+
+        while (!m_in_flight.empty() && m_in_flight.front().id <= id)
+        {
+            Batch &batch = m_in_flight.front();
+            VV_CHECK_SUCCESS(vkWaitForFences(m_device->logical_device, 1, &batch.fence, VK_TRUE, UINT64_MAX));
+            m_last_completed_id = batch.id;
+            recycle(batch);
+            m_in_flight.pop_front();
+        }
+    }
+
+
+    void UploadQueue::waitIdle()
+    {
+        flush();
+        waitFor(m_next_id - 1);
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////// Private
+    void UploadQueue::collectCompleted()
+    {
+        // batches are submitted to a single queue, so they complete in submission order
+        while (!m_in_flight.empty())
+        {
+            Batch &batch = m_in_flight.front();
+            if (vkGetFenceStatus(m_device->logical_device, batch.fence) != VK_SUCCESS)
+                break;
+
+            m_last_completed_id = batch.id;
+            recycle(batch);
+            m_in_flight.pop_front();
+        }
+    }
+
+
+    void UploadQueue::retireOldest()
+    {
+        if (m_in_flight.empty())
+            flush();
+
+        // nothing recorded reads from the ring anymore
+        if (m_in_flight.empty())
+        {
+            m_staging_ring.release(m_staging_ring.getHead());
+            return;
+        }
+
+        waitFor(m_in_flight.front().id);
+    }
+
+
+    void UploadQueue::recycle(Batch &batch)
+    {
+        for (auto &staging : batch.staging)
+        {
+            vkDestroyBuffer(m_device->logical_device, staging.buffer, HostAllocator::inst()->callbacks(HostObjectType::Buffer));
+            m_device->memory_allocator->free(staging.memory);
+        }
+        batch.staging.clear();
+        batch.recorded_bytes = 0;
+        m_staging_ring.release(batch.staging_head);
+
+        m_free.push_back(batch);
+    }
+}
@@ -1,5 +1,7 @@
 
 #include "VulkanBuffer.h"
+#include "DeletionQueue.h"
+#include "HostAllocator.h"
 
 namespace vv
 {
@@ -14,7 +16,7 @@ namespace vv
     }
 
 
-    void VulkanBuffer::create(VulkanDevice *device, VkBufferUsageFlags usage_flags, VkDeviceSize size)
+    void VulkanBuffer::create(VulkanDevice *device, VkBufferUsageFlags usage_flags, VkDeviceSize size, const MemoryTag &tag)
     {
         VV_ASSERT(device != VK_NULL_HANDLE, "VulkanDevice not present");
         m_device = device;
@@ -23,22 +25,54 @@ namespace vv
 
         // Create temporary transfer buffer on CPU 
         allocateMemory(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_staging_buffer, m_staging_memory);
+        				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryTag(MemoryCategory::Staging, tag.owner),
+                        m_staging_buffer, m_staging_memory);
 
         // Create storage buffer for GPU
-        allocateMemory(size, usage_flags | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, m_buffer_memory);	
+        allocateMemory(size, usage_flags | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tag, buffer, m_buffer_memory);
     }
 
 
     void VulkanBuffer::shutDown()
     {
+        // a pending copy might still be reading from the staging buffer
+        m_device->upload_queue->waitFor(m_upload_id);
+
         if (m_staging_buffer)
-        	vkDestroyBuffer(m_device->logical_device, m_staging_buffer, nullptr);
-        if (m_staging_memory)
-        	vkFreeMemory(m_device->logical_device, m_staging_memory, nullptr);
+        	vkDestroyBuffer(m_device->logical_device, m_staging_buffer, HostAllocator::inst()->callbacks(HostObjectType::Buffer));
+        m_device->memory_allocator->free(m_staging_memory);
 
-        vkDestroyBuffer(m_device->logical_device, buffer, nullptr);
-        vkFreeMemory(m_device->logical_device, m_buffer_memory, nullptr);
+        vkDestroyBuffer(m_device->logical_device, buffer, HostAllocator::inst()->callbacks(HostObjectType::Buffer));
+        m_device->memory_allocator->free(m_buffer_memory);
+    }
+
+
+    void VulkanBuffer::shutDownDeferred()
+    {
+        VulkanDevice *device = m_device;
+        UploadID upload_id = m_upload_id;
+        VkBuffer staging_buffer = m_staging_buffer;
+        MemoryAllocation staging_memory = m_staging_memory;
+        VkBuffer device_buffer = buffer;
+        MemoryAllocation buffer_memory = m_buffer_memory;
+
+        m_device->deletion_queue->push([=]() mutable
+        {
+            device->upload_queue->waitFor(upload_id);
+
+            if (staging_buffer)
+                vkDestroyBuffer(device->logical_device, staging_buffer, HostAllocator::inst()->callbacks(HostObjectType::Buffer));
+            device->memory_allocator->free(staging_memory);
+
+            vkDestroyBuffer(device->logical_device, device_buffer, HostAllocator::inst()->callbacks(HostObjectType::Buffer));
+            device->memory_allocator->free(buffer_memory);
+        });
+
+        m_staging_buffer = VK_NULL_HANDLE;
+        m_staging_memory = MemoryAllocation();
+        buffer = VK_NULL_HANDLE;
+        m_buffer_memory = MemoryAllocation();
+        m_upload_id = 0;
     }
 
 
@@ -51,11 +85,11 @@ namespace vv
 
     void VulkanBuffer::update(void *data)
     {
-        // Move raw data to staging Vulkan buffer.
-        void *mapped_data;
-        vkMapMemory(m_device->logical_device, m_staging_memory, 0, size, 0, &mapped_data);
-        memcpy(mapped_data, data, size);
-        vkUnmapMemory(m_device->logical_device, m_staging_memory);
+        // the staging buffer is reused, so an earlier copy out of it has to finish before it's overwritten
+        m_device->upload_queue->waitFor(m_upload_id);
+
+        // Move raw data to staging Vulkan buffer. Host visible blocks stay mapped.
+        memcpy(m_staging_memory.mapped_data, data, size);
     }
 
 
@@ -63,31 +97,26 @@ namespace vv
     {
         VV_ASSERT(m_staging_buffer && buffer, "Buffers not allocated correctly. Perhaps create() wasn't called.");
 
-        bool use_transfer = false;
-        auto command_pool_used = m_device->command_pools["graphics"];
-
-        // use transfer queue if available
-        if (m_device->command_pools.count("transfer") > 0)
-        {
-            command_pool_used = m_device->command_pools["transfer"];
-            use_transfer = true;
-        }
-
-        auto command_buffer = util::beginSingleUseCommand(m_device->logical_device, command_pool_used);
+        auto command_buffer = m_device->upload_queue->getCommandBuffer();
 
         VkBufferCopy buffer_copy = {};
         buffer_copy.size = size;
         vkCmdCopyBuffer(command_buffer, m_staging_buffer, buffer, 1, &buffer_copy);
 
-        if (use_transfer)
-            util::endSingleUseCommand(m_device->logical_device, command_pool_used, command_buffer, m_device->transfer_queue);
-        else
-            util::endSingleUseCommand(m_device->logical_device, command_pool_used, command_buffer, m_device->graphics_queue);
+        m_upload_id = m_device->upload_queue->getCurrentID();
+        m_device->upload_queue->addRecordedBytes(size);
+    }
+
+
+    bool VulkanBuffer::isReady() const
+    {
+        return m_device->upload_queue->isComplete(m_upload_id);
     }
 
 
     ///////////////////////////////////////////////////////////////////////////////////////////// Private
-    void VulkanBuffer::allocateMemory(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_properties, VkBuffer &buffer, VkDeviceMemory &buffer_memory)
+    void VulkanBuffer::allocateMemory(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_properties, const MemoryTag &tag,
+                                      VkBuffer &buffer, MemoryAllocation &buffer_memory)
     {
         // Create the Vulkan abstraction for a vertex buffer.
         VkBufferCreateInfo buffer_create_info = {};
@@ -115,20 +144,15 @@ namespace vv
             buffer_create_info.pQueueFamilyIndices = &queue_index;
         }
 
-        VV_CHECK_SUCCESS(vkCreateBuffer(m_device->logical_device, &buffer_create_info, nullptr, &buffer));
+        VV_CHECK_SUCCESS(vkCreateBuffer(m_device->logical_device, &buffer_create_info, HostAllocator::inst()->callbacks(HostObjectType::Buffer), &buffer));
 
         // Determine requirements for memory (where it's allocated, type of memory, etc.)
         VkMemoryRequirements memory_requirements = {};
         vkGetBufferMemoryRequirements(m_device->logical_device, buffer, &memory_requirements);
         auto memory_type = m_device->findMemoryTypeIndex(memory_requirements.memoryTypeBits, memory_properties);
 
-        // Allocate and bind buffer memory.
-        VkMemoryAllocateInfo memory_allocate_info = {};
-        memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        memory_allocate_info.allocationSize = memory_requirements.size;
-        memory_allocate_info.memoryTypeIndex = memory_type;
-
-        VV_CHECK_SUCCESS(vkAllocateMemory(m_device->logical_device, &memory_allocate_info, nullptr, &buffer_memory));
-        vkBindBufferMemory(m_device->logical_device, buffer, buffer_memory, 0);
+        // Sub-allocate and bind buffer memory.
+        buffer_memory = m_device->memory_allocator->allocate(memory_requirements, memory_type, true, tag);
+        VV_CHECK_SUCCESS(vkBindBufferMemory(m_device->logical_device, buffer, buffer_memory.memory, buffer_memory.offset));
     }
 }
\ No newline at end of file
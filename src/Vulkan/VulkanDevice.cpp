@@ -1,5 +1,12 @@
 
 #include "VulkanDevice.h"
+#include "UploadQueue.h"
+#include "DeletionQueue.h"
+#include "VulkanMemoryAllocator.h"
+#include "GeometryArena.h"
+#include "MemoryTracker.h"
+#include "DescriptorAllocator.h"
+#include "HostAllocator.h"
 
 namespace vv
 {
@@ -27,11 +34,57 @@ namespace vv
 	{
 		if (logical_device != VK_NULL_HANDLE)
 		{
+            // deferred deleters may still wait on pending uploads
+            if (deletion_queue)
+            {
+                deletion_queue->shutDown();
+                delete deletion_queue;
+                deletion_queue = nullptr;
+            }
+
+            // after the deletion queue, which may still return descriptor sets
+            if (descriptor_allocator)
+            {
+                descriptor_allocator->shutDown();
+                delete descriptor_allocator;
+                descriptor_allocator = nullptr;
+            }
+
+            // after the deletion queue, which may still hand pages and ranges back to the arena
+            if (geometry_arena)
+            {
+                geometry_arena->shutDown();
+                delete geometry_arena;
+                geometry_arena = nullptr;
+            }
+
+            if (upload_queue)
+            {
+                upload_queue->shutDown();
+                delete upload_queue;
+                upload_queue = nullptr;
+            }
+
+            // staging memory is released by the queues above
+            if (memory_allocator)
+            {
+                memory_allocator->shutDown();
+                delete memory_allocator;
+                memory_allocator = nullptr;
+            }
+
+            if (memory_tracker)
+            {
+                memory_tracker->shutDown();
+                delete memory_tracker;
+                memory_tracker = nullptr;
+            }
+
 			// Command Pool/Buffers
 			for (auto &pool : command_pools)
-				vkDestroyCommandPool(logical_device, pool.second, nullptr);
+				vkDestroyCommandPool(logical_device, pool.second, HostAllocator::inst()->callbacks(HostObjectType::CommandPool));
 
-			vkDestroyDevice(logical_device, nullptr);
+			vkDestroyDevice(logical_device, HostAllocator::inst()->callbacks(HostObjectType::Device));
 		}
 
 		graphics_family_index = -1;
@@ -42,6 +95,7 @@ namespace vv
         physical_device_properties = {};
         physical_device_features = {};
         physical_device_memory_properties = {};
+        memory_budget_supported = false;
         command_pools.clear();
         queue_family_properties.clear();
 	}
@@ -87,6 +141,13 @@ namespace vv
 		if (swap_chain_support && checkDeviceExtensionSupport(VK_KHR_SWAPCHAIN_EXTENSION_NAME))
 			device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
+#ifdef VK_EXT_memory_budget
+        // only queried for memory reports. the renderer also needs VK_KHR_get_physical_device_properties2 to use it.
+        memory_budget_supported = checkDeviceExtensionSupport(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        if (memory_budget_supported)
+            device_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+#endif
+
         VkDeviceCreateInfo device_create_info = {};
 		device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 		device_create_info.flags = 0;
@@ -102,7 +163,7 @@ namespace vv
 		else
 			device_create_info.enabledExtensionCount = 0;
 
-		VV_CHECK_SUCCESS(vkCreateDevice(physical_device, &device_create_info, nullptr, &logical_device));
+		VV_CHECK_SUCCESS(vkCreateDevice(physical_device, &device_create_info, HostAllocator::inst()->callbacks(HostObjectType::Device), &logical_device));
 
 		// Set up queue handles.
         vkGetDeviceQueue(logical_device, graphics_family_index, 0, &graphics_queue);
@@ -116,6 +177,24 @@ namespace vv
             vkGetDeviceQueue(logical_device, transfer_family_index, 0, &transfer_queue);
             createCommandPool("transfer", transfer_family_index, 0);
         }
+
+        memory_tracker = new MemoryTracker();
+        memory_tracker->create(physical_device_memory_properties);
+
+        memory_allocator = new VulkanMemoryAllocator();
+        memory_allocator->create(logical_device, physical_device_memory_properties, Settings::inst()->getMemoryBlockSize(), memory_tracker);
+
+        upload_queue = new UploadQueue();
+        upload_queue->create(this);
+
+        deletion_queue = new DeletionQueue();
+        deletion_queue->create();
+
+        descriptor_allocator = new DescriptorAllocator();
+        descriptor_allocator->create(this, Settings::inst()->getDescriptorSetsPerPool(), Settings::inst()->getMaxFramesInFlight());
+
+        geometry_arena = new GeometryArena();
+        geometry_arena->create(this, Settings::inst()->getGeometryPageSize());
 	}
 
 	
@@ -127,7 +206,7 @@ namespace vv
 		command_pool_create_info.queueFamilyIndex = queue_index;
 
 		VkCommandPool command_pool = VK_NULL_HANDLE;
-		VV_CHECK_SUCCESS(vkCreateCommandPool(logical_device, &command_pool_create_info, nullptr, &command_pool));
+		VV_CHECK_SUCCESS(vkCreateCommandPool(logical_device, &command_pool_create_info, HostAllocator::inst()->callbacks(HostObjectType::CommandPool), &command_pool));
 
 		command_pools[name] = command_pool;
 	}
@@ -147,6 +226,22 @@ namespace vv
 		return 0;
 	}
 
+
+    VkFormat VulkanDevice::findSupportedFormat(const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features) const
+    {
+        for (VkFormat format : candidates)
+        {
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(physical_device, format, &properties);
+
+            VkFormatFeatureFlags supported = (tiling == VK_IMAGE_TILING_LINEAR) ? properties.linearTilingFeatures : properties.optimalTilingFeatures;
+            if ((supported & features) == features)
+                return format;
+        }
+
+        return VK_FORMAT_UNDEFINED;
+    }
+
 	
 	VulkanSurfaceDetailsHandle VulkanDevice::querySwapChainSupport(VkSurfaceKHR surface)
 	{
@@ -1,6 +1,8 @@
 
 #include "VulkanImage.h"
 #include "Utils.h"
+#include "DeletionQueue.h"
+#include "HostAllocator.h"
 
 namespace vv
 {
@@ -17,7 +19,7 @@ namespace vv
 
     void VulkanImage::create(VulkanDevice *device, VkExtent3D extent, VkFormat format, VkImageType type, VkImageCreateFlags flags,
                              VkImageAspectFlags aspect_flags, uint32_t mip_levels, uint32_t array_layers,
-                             VkImageLayout initial_layout, VkSampleCountFlagBits sample_count)
+                             VkImageLayout initial_layout, VkSampleCountFlagBits sample_count, const MemoryTag &tag)
     {
 		VV_ASSERT(device != VK_NULL_HANDLE, "VulkanDevice not present");
 		m_device = device;
@@ -31,9 +33,10 @@ namespace vv
         this->array_layers = array_layers;
         this->sample_count = sample_count;
         this->initial_layout = initial_layout;
+        m_memory_owner = tag.owner;
 
         allocateMemory(VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-            flags, initial_layout, sample_count, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, m_image_memory);
+            flags, initial_layout, sample_count, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tag, image, m_image_memory);
     }
 
 
@@ -64,26 +67,12 @@ namespace vv
         this->array_layers = 1;
 
 		// check to see if physical device supports the particular image format required for depth operations.
-		std::vector<VkFormat> candidates = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT };
-		for (VkFormat &format : candidates)
-		{
-			VkFormatProperties properties;
-			vkGetPhysicalDeviceFormatProperties(device->physical_device, format, &properties);
-
-			if (tiling == VK_IMAGE_TILING_LINEAR && (properties.linearTilingFeatures & features) == features)
-			{
-				this->format = format;
-				break;
-			}
-			else if (tiling == VK_IMAGE_TILING_OPTIMAL && (properties.optimalTilingFeatures & features) == features)
-			{
-				this->format = format;
-				break;
-			}
-		}
+		this->format = device->findSupportedFormat({ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT }, tiling, features);
 
+        m_memory_owner = "depth attachment";
 		allocateMemory(VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED,
-                       VK_SAMPLE_COUNT_1_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, m_image_memory);
+                       VK_SAMPLE_COUNT_1_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryTag(MemoryCategory::Attachment, m_memory_owner),
+                       image, m_image_memory);
 
 		if (hasStencilComponent())
 			this->aspect_flags |= VK_IMAGE_ASPECT_STENCIL_BIT;
@@ -96,17 +85,79 @@ namespace vv
 	}
 
 
+	void VulkanImage::createColorAttachment(VulkanDevice *device, VkExtent2D extent, VkFormat format)
+	{
+		VV_ASSERT(device != VK_NULL_HANDLE, "VulkanDevice not present");
+		m_device = device;
+		this->format = format;
+		this->aspect_flags = VK_IMAGE_ASPECT_COLOR_BIT;
+        this->type = VK_IMAGE_TYPE_2D;
+		this->width = extent.width;
+		this->height = extent.height;
+		this->depth = 1;
+        this->mip_levels = 1;
+        this->array_layers = 1;
+        this->sample_count = VK_SAMPLE_COUNT_1_BIT;
+        this->initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        m_memory_owner = "color attachment";
+
+		allocateMemory(VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED,
+                       VK_SAMPLE_COUNT_1_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryTag(MemoryCategory::Attachment, m_memory_owner),
+                       image, m_image_memory);
+	}
+
+
 	void VulkanImage::shutDown()
 	{
-		vkDestroyImage(m_device->logical_device, image, nullptr);
-		vkFreeMemory(m_device->logical_device, m_image_memory, nullptr);
+        m_device->upload_queue->waitFor(m_upload_id);
+
+		vkDestroyImage(m_device->logical_device, image, HostAllocator::inst()->callbacks(HostObjectType::Image));
+		m_device->memory_allocator->free(m_image_memory);
 	}
 
+
+    void VulkanImage::shutDownDeferred()
+    {
+        VulkanDevice *device = m_device;
+        UploadID upload_id = m_upload_id;
+        VkImage device_image = image;
+        MemoryAllocation image_memory = m_image_memory;
+
+        m_device->deletion_queue->push([=]() mutable
+        {
+            device->upload_queue->waitFor(upload_id);
+            vkDestroyImage(device->logical_device, device_image, HostAllocator::inst()->callbacks(HostObjectType::Image));
+            device->memory_allocator->free(image_memory);
+        });
+
+        image = VK_NULL_HANDLE;
+        m_image_memory = MemoryAllocation();
+        m_upload_id = 0;
+    }
+
     
-    void VulkanImage::updateAndTransfer(void *data, VkDeviceSize size_in_bytes)
+    void VulkanImage::updateAndTransfer(const void *data, VkDeviceSize size_in_bytes)
     {
-        auto command_pool_used = m_device->command_pools["graphics"];
-        auto command_buffer = util::beginSingleUseCommand(m_device->logical_device, command_pool_used);
+        memcpy(beginTransfer(size_in_bytes), data, size_in_bytes);
+        endTransfer();
+    }
+
+
+    void* VulkanImage::beginTransfer(VkDeviceSize size_in_bytes)
+    {
+        // buffer offsets of image copies have to be multiples of both the texel block size and 4
+        VkDeviceSize alignment = m_format_info_table.at(format).block_size;
+        while (alignment % 4 != 0)
+            alignment += m_format_info_table.at(format).block_size;
+
+        m_upload_staging = m_device->upload_queue->allocateStaging(size_in_bytes, alignment);
+        return m_upload_staging.data;
+    }
+
+
+    void VulkanImage::endTransfer()
+    {
+        auto command_buffer = m_device->upload_queue->getCommandBuffer();
 
         VkImageSubresourceRange subresource_range = {};
         subresource_range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -116,14 +167,6 @@ namespace vv
 
         transformImageLayout(command_buffer, image, subresource_range, initial_layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
-        // move host data to transfer buffer
-        allocateTransferMemory(size_in_bytes);
-        void *mapped_data;
-        vkMapMemory(m_device->logical_device, m_staging_memory, 0, size_in_bytes, 0, &mapped_data);
-        memcpy(mapped_data, data, size_in_bytes);
-        vkUnmapMemory(m_device->logical_device, m_staging_memory);
-        mapped_data = nullptr;
-
         const auto &format_info = m_format_info_table.at(format);
 		const uint32_t block_size = format_info.block_size;
 		const uint32_t block_width = format_info.block_extent.width;
@@ -152,21 +195,99 @@ namespace vv
 				buffer_copy_region.imageExtent.width = image_width;
 				buffer_copy_region.imageExtent.height = image_height;
 				buffer_copy_region.imageExtent.depth = depth;
-				buffer_copy_region.bufferOffset = offset;
+				buffer_copy_region.bufferOffset = m_upload_staging.offset + offset;
 
 				buffer_copy_regions.push_back(buffer_copy_region);
 				offset += block_count_x * block_count_y * block_count_z * block_size;
 			}
 		}
 
-		vkCmdCopyBufferToImage(command_buffer, m_staging_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		vkCmdCopyBufferToImage(command_buffer, m_upload_staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                                static_cast<uint32_t>(buffer_copy_regions.size()), buffer_copy_regions.data());
 
-        transformImageLayout(command_buffer, image, subresource_range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        if (m_device->upload_queue->isTransferOnly())
+        {
+            // a transfer queue can't name shader stages. the batch fence orders the copy with later rendering instead.
+            VkImageMemoryBarrier memory_barrier = determineAccessMasks(image, subresource_range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            memory_barrier.dstAccessMask = 0;
+            vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+                                 1, &memory_barrier);
+        }
+        else
+            transformImageLayout(command_buffer, image, subresource_range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        // the queue owns the staging memory from here on
+        m_upload_id = m_device->upload_queue->getCurrentID();
+        m_device->upload_queue->commitStaging(m_upload_staging);
+        m_upload_staging = StagingRegion();
+    }
+
+
+    bool VulkanImage::isReady() const
+    {
+        return m_device->upload_queue->isComplete(m_upload_id);
+    }
+
+
+    VkDeviceSize VulkanImage::getMemorySize() const
+    {
+        return m_image_memory.size;
+    }
+
+
+    void VulkanImage::readback(std::vector<unsigned char> &data, VkImageLayout layout)
+    {
+        const auto &format_info = m_format_info_table.at(format);
+        VV_ASSERT(format_info.block_extent.width == 1 && format_info.block_extent.height == 1, "Readback of block compressed images is not supported");
+
+        VkDeviceSize size_in_bytes = static_cast<VkDeviceSize>(width) * height * format_info.block_size;
+        allocateTransferMemory(size_in_bytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+        auto command_pool_used = m_device->command_pools["graphics"];
+        auto command_buffer = util::beginSingleUseCommand(m_device->logical_device, command_pool_used);
+
+        VkImageSubresourceRange subresource_range = {};
+        subresource_range.aspectMask = aspect_flags;
+        subresource_range.levelCount = 1;
+        subresource_range.layerCount = 1;
+
+        if (layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+            transformImageLayout(command_buffer, image, subresource_range, layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+        VkBufferImageCopy buffer_copy_region = {};
+        buffer_copy_region.imageSubresource.aspectMask = aspect_flags;
+        buffer_copy_region.imageSubresource.mipLevel = 0;
+        buffer_copy_region.imageSubresource.baseArrayLayer = 0;
+        buffer_copy_region.imageSubresource.layerCount = 1;
+        buffer_copy_region.imageExtent.width = width;
+        buffer_copy_region.imageExtent.height = height;
+        buffer_copy_region.imageExtent.depth = 1;
+        vkCmdCopyImageToBuffer(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_staging_buffer, 1, &buffer_copy_region);
+
+        // make the copy visible to the host
+        VkBufferMemoryBarrier buffer_barrier = {};
+        buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        buffer_barrier.buffer = m_staging_buffer;
+        buffer_barrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &buffer_barrier, 0, nullptr);
+
+        if (layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+            transformImageLayout(command_buffer, image, subresource_range, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, layout);
+
         util::endSingleUseCommand(m_device->logical_device, command_pool_used, command_buffer, m_device->graphics_queue);
 
-        vkDestroyBuffer(m_device->logical_device, m_staging_buffer, nullptr);
-        vkFreeMemory(m_device->logical_device, m_staging_memory, nullptr);
+        data.resize(static_cast<std::size_t>(size_in_bytes));
+        memcpy(data.data(), m_staging_memory.mapped_data, static_cast<std::size_t>(size_in_bytes));
+
+        vkDestroyBuffer(m_device->logical_device, m_staging_buffer, HostAllocator::inst()->callbacks(HostObjectType::Buffer));
+        m_device->memory_allocator->free(m_staging_memory);
+        m_staging_buffer = VK_NULL_HANDLE;
     }
 
 
@@ -177,32 +298,29 @@ namespace vv
 
 
 	///////////////////////////////////////////////////////////////////////////////////////////// Private
-    void VulkanImage::allocateTransferMemory(VkDeviceSize size_in_bytes)
+    void VulkanImage::allocateTransferMemory(VkDeviceSize size_in_bytes, VkBufferUsageFlags usage)
     {
         VkBufferCreateInfo buffer_create_info = {};
         buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         buffer_create_info.flags = 0;
         buffer_create_info.size = size_in_bytes;
-		buffer_create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		buffer_create_info.usage = usage;
 		buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-		VV_CHECK_SUCCESS(vkCreateBuffer(m_device->logical_device, &buffer_create_info, nullptr, &m_staging_buffer));
+		VV_CHECK_SUCCESS(vkCreateBuffer(m_device->logical_device, &buffer_create_info, HostAllocator::inst()->callbacks(HostObjectType::Buffer), &m_staging_buffer));
 
 		VkMemoryRequirements memory_requirements = {};
 		vkGetBufferMemoryRequirements(m_device->logical_device, m_staging_buffer, &memory_requirements);
 
-        VkMemoryAllocateInfo memory_alloc_info = {};
-        memory_alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memory_alloc_info.allocationSize = memory_requirements.size;
-		memory_alloc_info.memoryTypeIndex = m_device->findMemoryTypeIndex(memory_requirements.memoryTypeBits,  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		VV_CHECK_SUCCESS(vkAllocateMemory(m_device->logical_device, &memory_alloc_info, nullptr, &m_staging_memory));
-		VV_CHECK_SUCCESS(vkBindBufferMemory(m_device->logical_device, m_staging_buffer, m_staging_memory, 0));
+        auto memory_type = m_device->findMemoryTypeIndex(memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        m_staging_memory = m_device->memory_allocator->allocate(memory_requirements, memory_type, true, MemoryTag(MemoryCategory::Staging, m_memory_owner));
+		VV_CHECK_SUCCESS(vkBindBufferMemory(m_device->logical_device, m_staging_buffer, m_staging_memory.memory, m_staging_memory.offset));
     }
 
 
     void VulkanImage::allocateMemory(VkImageTiling tiling, VkImageUsageFlags usage, VkImageCreateFlags flags, VkImageLayout initial_layout,
-                                     VkSampleCountFlagBits sample_count, VkMemoryPropertyFlags memory_properties, VkImage &image,
-                                     VkDeviceMemory &memory)
+                                     VkSampleCountFlagBits sample_count, VkMemoryPropertyFlags memory_properties, const MemoryTag &tag,
+                                     VkImage &image, MemoryAllocation &memory)
 	{
 		VkImageCreateInfo image_create_info = {};
 		image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -237,21 +355,16 @@ namespace vv
             image_create_info.pQueueFamilyIndices = &queue_index;
         }
 
-		VV_CHECK_SUCCESS(vkCreateImage(m_device->logical_device, &image_create_info, nullptr, &image));
+		VV_CHECK_SUCCESS(vkCreateImage(m_device->logical_device, &image_create_info, HostAllocator::inst()->callbacks(HostObjectType::Image), &image));
 
 		// Determine requirements for memory (where it's allocated, type of memory, etc.)
 		VkMemoryRequirements memory_requirements = {};
 		vkGetImageMemoryRequirements(m_device->logical_device, image, &memory_requirements);
 		auto memory_type = m_device->findMemoryTypeIndex(memory_requirements.memoryTypeBits, memory_properties);
 
-		// Allocate and bind buffer memory.
-		VkMemoryAllocateInfo memory_allocate_info = {};
-		memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memory_allocate_info.allocationSize = memory_requirements.size;
-		memory_allocate_info.memoryTypeIndex = memory_type;
-
-		VV_CHECK_SUCCESS(vkAllocateMemory(m_device->logical_device, &memory_allocate_info, nullptr, &memory));
-		VV_CHECK_SUCCESS(vkBindImageMemory(m_device->logical_device, image, memory, 0));
+		// Sub-allocate and bind image memory. Optimally tiled images live in blocks of their own.
+		memory = m_device->memory_allocator->allocate(memory_requirements, memory_type, tiling == VK_IMAGE_TILING_LINEAR, tag);
+		VV_CHECK_SUCCESS(vkBindImageMemory(m_device->logical_device, image, memory.memory, memory.offset));
 	}
 
 
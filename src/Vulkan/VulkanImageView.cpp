@@ -1,5 +1,7 @@
 
 #include "VulkanImageView.h"
+#include "DeletionQueue.h"
+#include "HostAllocator.h"
 
 namespace vv
 {
@@ -38,12 +40,21 @@ namespace vv
 		image_view_create_info.subresourceRange.baseArrayLayer = 0;
 		image_view_create_info.subresourceRange.layerCount = image->array_layers;
 
-		VV_CHECK_SUCCESS(vkCreateImageView(device->logical_device, &image_view_create_info, nullptr, &image_view));
+		VV_CHECK_SUCCESS(vkCreateImageView(device->logical_device, &image_view_create_info, HostAllocator::inst()->callbacks(HostObjectType::ImageView), &image_view));
 	}
 
 
 	void VulkanImageView::shutDown()
 	{
-        vkDestroyImageView(m_device->logical_device, image_view, nullptr);
+        vkDestroyImageView(m_device->logical_device, image_view, HostAllocator::inst()->callbacks(HostObjectType::ImageView));
 	}
+
+
+    void VulkanImageView::shutDownDeferred()
+    {
+        VkDevice logical_device = m_device->logical_device;
+        VkImageView view = image_view;
+        m_device->deletion_queue->push([=]() { vkDestroyImageView(logical_device, view, HostAllocator::inst()->callbacks(HostObjectType::ImageView)); });
+        image_view = VK_NULL_HANDLE;
+    }
 }
\ No newline at end of file
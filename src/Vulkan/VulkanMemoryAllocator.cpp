@@ -0,0 +1,218 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include "VulkanMemoryAllocator.h"
+#include "HostAllocator.h"
+
+namespace vv
+{
+	///////////////////////////////////////////////////////////////////////////////////////////// Public
+    void VulkanMemoryAllocator::create(VkDevice device, const VkPhysicalDeviceMemoryProperties &memory_properties, VkDeviceSize block_size,
+                                       MemoryTracker *tracker, const DeviceMemoryFunctions &functions)
+    {
+        m_device = device;
+        m_memory_properties = memory_properties;
+        m_functions = functions;
+        m_tracker = tracker;
+
+        // small heaps (e.g. 256MB device local host visible) shouldn't be eaten up by a few mostly empty blocks
+        m_block_sizes.resize(m_memory_properties.memoryTypeCount);
+        for (uint32_t i = 0; i < m_memory_properties.memoryTypeCount; ++i)
+        {
+            VkDeviceSize heap_size = m_memory_properties.memoryHeaps[m_memory_properties.memoryTypes[i].heapIndex].size;
+            m_block_sizes[i] = std::min(block_size, std::max<VkDeviceSize>(heap_size / 8, 1));
+        }
+    }
+
+
+    void VulkanMemoryAllocator::shutDown()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (uint32_t i = 0; i < m_blocks.size(); ++i)
+        {
+            if (!m_blocks[i])
+                continue;
+
+            if (!m_blocks[i]->ranges.isEmpty())
+                VV_ALERT("Device memory block freed with " + std::to_string(m_blocks[i]->ranges.getAllocationCount()) + " allocations still alive");
+            destroyBlock(i);
+        }
+
+        m_blocks.clear();
+        m_unused_blocks.clear();
+    }
+
+
+    MemoryAllocation VulkanMemoryAllocator::allocate(const VkMemoryRequirements &requirements, uint32_t memory_type, bool linear,
+                                                     const MemoryTag &tag)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        MemoryAllocation allocation;
+        allocation.memory_type = memory_type;
+        allocation.size = requirements.size;
+
+        // too large to share a block without wasting most of it
+        if (requirements.size > m_block_sizes[memory_type] / 2)
+        {
+            allocation.block = createBlock(memory_type, linear, true, requirements.size);
+            m_blocks[allocation.block]->ranges.allocate(requirements.size, 1, allocation.offset, allocation.range);
+        }
+        else
+        {
+            for (uint32_t i = 0; i < m_blocks.size(); ++i)
+            {
+                Block *block = m_blocks[i];
+                if (!block || block->dedicated || block->memory_type != memory_type || block->linear != linear)
+                    continue;
+
+                if (block->ranges.allocate(requirements.size, requirements.alignment, allocation.offset, allocation.range))
+                {
+                    allocation.block = i;
+                    break;
+                }
+            }
+
+            if (allocation.block == UINT32_MAX)
+            {
+                allocation.block = createBlock(memory_type, linear, false, m_block_sizes[memory_type]);
+                m_blocks[allocation.block]->ranges.allocate(requirements.size, requirements.alignment, allocation.offset, allocation.range);
+            }
+        }
+
+        const Block *block = m_blocks[allocation.block];
+        allocation.memory = block->memory;
+        if (block->mapped_data)
+            allocation.mapped_data = static_cast<unsigned char*>(block->mapped_data) + allocation.offset;
+
+        // accounted at the size the resource asked for. block slack shows up as the difference to the driver's usage.
+        if (m_tracker)
+            allocation.tracking_id = m_tracker->add(tag, m_memory_properties.memoryTypes[memory_type].heapIndex, requirements.size);
+
+        return allocation;
+    }
+
+
+    void VulkanMemoryAllocator::free(MemoryAllocation &allocation)
+    {
+        if (allocation.memory == VK_NULL_HANDLE)
+            return;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_tracker)
+            m_tracker->remove(allocation.tracking_id);
+
+        Block *block = m_blocks[allocation.block];
+        block->ranges.free(allocation.range);
+
+        if (block->ranges.isEmpty())
+        {
+            // keep one empty block per kind around so a free/allocate pattern doesn't hit vkAllocateMemory every time
+            bool is_last = !block->dedicated;
+            for (uint32_t i = 0; i < m_blocks.size() && is_last; ++i)
+            {
+                const Block *other = m_blocks[i];
+                if (i != allocation.block && other && !other->dedicated && other->memory_type == block->memory_type && other->linear == block->linear)
+                    is_last = false;
+            }
+
+            if (!is_last)
+                destroyBlock(allocation.block);
+        }
+
+        allocation = MemoryAllocation();
+    }
+
+
+    std::vector<MemoryBlockStats> VulkanMemoryAllocator::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::vector<MemoryBlockStats> stats;
+        for (const Block *block : m_blocks)
+        {
+            if (!block)
+                continue;
+
+            MemoryBlockStats block_stats;
+            block_stats.memory_type = block->memory_type;
+            block_stats.linear = block->linear;
+            block_stats.dedicated = block->dedicated;
+            block_stats.size = block->size;
+            block_stats.used = block->ranges.getUsedSize();
+            block_stats.allocation_count = block->ranges.getAllocationCount();
+            block_stats.free_range_count = block->ranges.getFreeRangeCount();
+            block_stats.largest_free_range = block->ranges.getLargestFreeRange();
+            stats.push_back(block_stats);
+        }
+
+        return stats;
+    }
+
+
+    uint32_t VulkanMemoryAllocator::getDeviceAllocationCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return static_cast<uint32_t>(m_blocks.size() - m_unused_blocks.size());
+    }
+
+
+	///////////////////////////////////////////////////////////////////////////////////////////// Private
+    uint32_t VulkanMemoryAllocator::createBlock(uint32_t memory_type, bool linear, bool dedicated, VkDeviceSize size)
+    {
+        Block *block = new Block;
+        block->memory_type = memory_type;
+        block->linear = linear;
+        block->dedicated = dedicated;
+        block->size = size;
+
+        VkMemoryAllocateInfo memory_allocate_info = {};
+        memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        memory_allocate_info.allocationSize = size;
+        memory_allocate_info.memoryTypeIndex = memory_type;
+
+        VkResult result = m_functions.allocate_memory(m_device, &memory_allocate_info, HostAllocator::inst()->callbacks(HostObjectType::DeviceMemory), &block->memory);
+        if (result != VK_SUCCESS)
+        {
+            delete block;
+            throw std::runtime_error("Out of device memory while allocating a " + std::to_string(size) + " byte block");
+        }
+
+        // mapping the whole block once lets every allocation in it be written without vkMapMemory calls
+        if (m_memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+            VV_CHECK_SUCCESS(m_functions.map_memory(m_device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped_data));
+
+        block->ranges.create(size);
+
+        uint32_t index;
+        if (!m_unused_blocks.empty())
+        {
+            index = m_unused_blocks.back();
+            m_unused_blocks.pop_back();
+            m_blocks[index] = block;
+        }
+        else
+        {
+            index = static_cast<uint32_t>(m_blocks.size());
+            m_blocks.push_back(block);
+        }
+
+        return index;
+    }
+
+
+    void VulkanMemoryAllocator::destroyBlock(uint32_t index)
+    {
+        Block *block = m_blocks[index];
+
+        if (block->mapped_data)
+            m_functions.unmap_memory(m_device, block->memory);
+        m_functions.free_memory(m_device, block->memory, HostAllocator::inst()->callbacks(HostObjectType::DeviceMemory));
+
+        delete block;
+        m_blocks[index] = nullptr;
+        m_unused_blocks.push_back(index);
+    }
+}
@@ -1,5 +1,6 @@
 
 #include "VulkanPipeline.h"
+#include "HostAllocator.h"
 
 namespace vv
 {
@@ -32,7 +33,7 @@ namespace vv
 
 	void VulkanPipeline::shutDown()
 	{
-        vkDestroyPipeline(m_device->logical_device, pipeline, nullptr);
+        vkDestroyPipeline(m_device->logical_device, pipeline, HostAllocator::inst()->callbacks(HostObjectType::Pipeline));
 	}
 
 
@@ -65,7 +66,7 @@ namespace vv
 	    graphics_pipeline_create_info.basePipelineHandle    = VK_NULL_HANDLE; // used for creating new pipeline from existing one.
 
 	    // info: the null handle here specifies a VkPipelineCache that can be used to store pipeline creation info after a pipeline's deletion.
-	    VV_CHECK_SUCCESS(vkCreateGraphicsPipelines(m_device->logical_device, VK_NULL_HANDLE, 1, &graphics_pipeline_create_info, nullptr, &pipeline));
+	    VV_CHECK_SUCCESS(vkCreateGraphicsPipelines(m_device->logical_device, VK_NULL_HANDLE, 1, &graphics_pipeline_create_info, HostAllocator::inst()->callbacks(HostObjectType::Pipeline), &pipeline));
     }
 
     void VulkanPipeline::commitComputePipeline()
@@ -79,7 +80,7 @@ namespace vv
         compute_pipeline_create_info.layout = pipeline_layout;
         compute_pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
 
-	    VV_CHECK_SUCCESS(vkCreateComputePipelines(m_device->logical_device, VK_NULL_HANDLE, 1, &compute_pipeline_create_info, nullptr, &pipeline));
+	    VV_CHECK_SUCCESS(vkCreateComputePipelines(m_device->logical_device, VK_NULL_HANDLE, 1, &compute_pipeline_create_info, HostAllocator::inst()->callbacks(HostObjectType::Pipeline), &pipeline));
     }
 
     bool VulkanPipeline::addShaderStage(VulkanShaderModule &shader_module)
@@ -1,5 +1,6 @@
 
 #include "VulkanRenderPass.h"
+#include "HostAllocator.h"
 
 namespace vv
 {
@@ -27,7 +28,7 @@ namespace vv
     }
 
 
-    void VulkanRenderPass::create(VulkanDevice *device, VkPipelineBindPoint bind_point)
+    void VulkanRenderPass::create(VulkanDevice *device, VkPipelineBindPoint bind_point, bool external_dependencies)
     {
         VV_ASSERT(device != nullptr, "Vulkan Device is NULL");
         m_device = device;
@@ -95,17 +96,17 @@ namespace vv
         render_pass_create_info.pAttachments    = m_attachment_descriptions.data();
         render_pass_create_info.subpassCount    = 1;
         render_pass_create_info.pSubpasses      = &subpass_description;
-        render_pass_create_info.dependencyCount = (uint32_t)subpass_dependencies.size();
-        render_pass_create_info.pDependencies   = subpass_dependencies.data();
+        render_pass_create_info.dependencyCount = external_dependencies ? (uint32_t)subpass_dependencies.size() : 0;
+        render_pass_create_info.pDependencies   = external_dependencies ? subpass_dependencies.data() : nullptr;
 
-        VV_CHECK_SUCCESS(vkCreateRenderPass(device->logical_device, &render_pass_create_info, nullptr, &render_pass));
+        VV_CHECK_SUCCESS(vkCreateRenderPass(device->logical_device, &render_pass_create_info, HostAllocator::inst()->callbacks(HostObjectType::RenderPass), &render_pass));
     }
 
 
     void VulkanRenderPass::shutDown()
     {
         if (render_pass != VK_NULL_HANDLE)
-            vkDestroyRenderPass(m_device->logical_device, render_pass, nullptr);
+            vkDestroyRenderPass(m_device->logical_device, render_pass, HostAllocator::inst()->callbacks(HostObjectType::RenderPass));
 
         m_attachment_descriptions.clear();
     }
@@ -126,7 +127,7 @@ namespace vv
         frame_buffer_create_info.layers          = 1;
 
         VkFramebuffer frame_buffer;
-        VV_CHECK_SUCCESS(vkCreateFramebuffer(m_device->logical_device, &frame_buffer_create_info, nullptr, &frame_buffer));
+        VV_CHECK_SUCCESS(vkCreateFramebuffer(m_device->logical_device, &frame_buffer_create_info, HostAllocator::inst()->callbacks(HostObjectType::Framebuffer), &frame_buffer));
         return frame_buffer;
     }
 
@@ -135,7 +136,7 @@ namespace vv
                                            VkSubpassContents subpass_contents,
                                            VkFramebuffer framebuffer,
     					                   VkExtent2D extent,
-                                           std::vector<VkClearValue> clear_values)
+                                           const std::vector<VkClearValue> &clear_values)
     {
         VkRenderPassBeginInfo render_pass_begin_info = {};
         render_pass_begin_info.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
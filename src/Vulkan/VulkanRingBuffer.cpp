@@ -0,0 +1,103 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "VulkanRingBuffer.h"
+#include "HostAllocator.h"
+
+namespace vv
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////// Public
+    void VulkanRingBuffer::create(VulkanDevice *device, VkBufferUsageFlags usage_flags, VkDeviceSize frame_size, uint32_t frame_count)
+    {
+        VV_ASSERT(device != VK_NULL_HANDLE, "VulkanDevice not present");
+        VV_ASSERT(frame_count > 0, "VulkanRingBuffer needs at least one frame region");
+        m_device = device;
+        m_frame_count = frame_count;
+
+        // dynamic offsets have to respect the device's uniform offset alignment. the limit is always a power of two.
+        m_alignment = m_device->physical_device_properties.limits.minUniformBufferOffsetAlignment;
+        if (m_alignment == 0)
+            m_alignment = 1;
+
+        this->frame_size = alignUp(frame_size);
+
+        VkBufferCreateInfo buffer_create_info = {};
+        buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_create_info.size = this->frame_size * m_frame_count;
+        buffer_create_info.usage = usage_flags;
+        buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VV_CHECK_SUCCESS(vkCreateBuffer(m_device->logical_device, &buffer_create_info, HostAllocator::inst()->callbacks(HostObjectType::Buffer), &buffer));
+
+        VkMemoryRequirements memory_requirements = {};
+        vkGetBufferMemoryRequirements(m_device->logical_device, buffer, &memory_requirements);
+
+        // coherent memory means no flushes are needed after writing
+        VkMemoryAllocateInfo memory_allocate_info = {};
+        memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        memory_allocate_info.allocationSize = memory_requirements.size;
+        memory_allocate_info.memoryTypeIndex = m_device->findMemoryTypeIndex(memory_requirements.memoryTypeBits,
+                                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        VV_CHECK_SUCCESS(vkAllocateMemory(m_device->logical_device, &memory_allocate_info, HostAllocator::inst()->callbacks(HostObjectType::DeviceMemory), &m_memory));
+        VV_CHECK_SUCCESS(vkBindBufferMemory(m_device->logical_device, buffer, m_memory, 0));
+
+        // allocated outside the VulkanMemoryAllocator, so it's reported to the tracker directly
+        uint32_t heap = m_device->physical_device_memory_properties.memoryTypes[memory_allocate_info.memoryTypeIndex].heapIndex;
+        m_tracking_id = m_device->memory_tracker->add(MemoryTag(MemoryCategory::Uniform, "uniform ring"), heap, memory_allocate_info.allocationSize);
+
+        void *mapped_data = nullptr;
+        VV_CHECK_SUCCESS(vkMapMemory(m_device->logical_device, m_memory, 0, VK_WHOLE_SIZE, 0, &mapped_data));
+        m_mapped_data = static_cast<unsigned char *>(mapped_data);
+
+        beginFrame(0);
+    }
+
+
+    void VulkanRingBuffer::shutDown()
+    {
+        if (m_mapped_data)
+            vkUnmapMemory(m_device->logical_device, m_memory);
+
+        vkDestroyBuffer(m_device->logical_device, buffer, HostAllocator::inst()->callbacks(HostObjectType::Buffer));
+        vkFreeMemory(m_device->logical_device, m_memory, HostAllocator::inst()->callbacks(HostObjectType::DeviceMemory));
+        m_device->memory_tracker->remove(m_tracking_id);
+        m_tracking_id = MemoryTracker::invalid_id;
+
+        m_mapped_data = nullptr;
+        buffer = VK_NULL_HANDLE;
+        m_memory = VK_NULL_HANDLE;
+    }
+
+
+    void VulkanRingBuffer::beginFrame(uint32_t frame_index)
+    {
+        VV_ASSERT(frame_index < m_frame_count, "Frame index outside of ring buffer");
+        m_current_frame = frame_index;
+        m_head = 0;
+    }
+
+
+    uint32_t VulkanRingBuffer::allocate(VkDeviceSize size)
+    {
+        VkDeviceSize aligned_size = alignUp(size);
+        if (m_head + aligned_size > frame_size)
+            throw std::runtime_error("VulkanRingBuffer frame region exhausted. Increase Settings::getUniformRingFrameSize().");
+
+        VkDeviceSize offset = m_current_frame * frame_size + m_head;
+        m_head += aligned_size;
+        return static_cast<uint32_t>(offset);
+    }
+
+
+    void VulkanRingBuffer::write(uint32_t offset, const void *data, VkDeviceSize size)
+    {
+        std::memcpy(m_mapped_data + offset, data, static_cast<size_t>(size));
+    }
+
+
+    void* VulkanRingBuffer::getMappedData(uint32_t offset) const
+    {
+        return m_mapped_data + offset;
+    }
+}
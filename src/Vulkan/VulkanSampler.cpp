@@ -1,5 +1,7 @@
 
 #include "VulkanSampler.h"
+#include "DeletionQueue.h"
+#include "HostAllocator.h"
 
 namespace vv
 {
@@ -65,15 +67,24 @@ namespace vv
 		sampler_create_info.minLod = min_lod;
 		sampler_create_info.maxLod = max_lod; // todo: figure out how lod works with these things
 
-		VV_CHECK_SUCCESS(vkCreateSampler(m_device->logical_device, &sampler_create_info, nullptr, &sampler));
+		VV_CHECK_SUCCESS(vkCreateSampler(m_device->logical_device, &sampler_create_info, HostAllocator::inst()->callbacks(HostObjectType::Sampler), &sampler));
     }
 
 
 	void VulkanSampler::shutDown()
 	{
-        vkDestroySampler(m_device->logical_device, sampler, nullptr);
+        vkDestroySampler(m_device->logical_device, sampler, HostAllocator::inst()->callbacks(HostObjectType::Sampler));
 	}
 
 
+    void VulkanSampler::shutDownDeferred()
+    {
+        VkDevice logical_device = m_device->logical_device;
+        VkSampler deferred_sampler = sampler;
+        m_device->deletion_queue->push([=]() { vkDestroySampler(logical_device, deferred_sampler, HostAllocator::inst()->callbacks(HostObjectType::Sampler)); });
+        sampler = VK_NULL_HANDLE;
+    }
+
+
 	///////////////////////////////////////////////////////////////////////////////////////////// Private
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 
 #include "VulkanShaderModule.h"
 #include "Utils.h"
+#include "HostAllocator.h"
 
 namespace vv
 {
@@ -51,14 +52,14 @@ namespace vv
 		shader_module_create_info.codeSize = m_binary_data.size();
 		shader_module_create_info.pCode = (uint32_t *)m_binary_data.data();
 
-		VV_CHECK_SUCCESS(vkCreateShaderModule(m_device->logical_device, &shader_module_create_info, nullptr, &shader_module));
+		VV_CHECK_SUCCESS(vkCreateShaderModule(m_device->logical_device, &shader_module_create_info, HostAllocator::inst()->callbacks(HostObjectType::ShaderModule), &shader_module));
 	}
 
 
 	void VulkanShaderModule::shutDown()
 	{
 		if (shader_module != VK_NULL_HANDLE)
-            vkDestroyShaderModule(m_device->logical_device, shader_module, nullptr);
+            vkDestroyShaderModule(m_device->logical_device, shader_module, HostAllocator::inst()->callbacks(HostObjectType::ShaderModule));
 	}
 
 	
@@ -1,5 +1,7 @@
 
 #include "VulkanSwapChain.h"
+#include "Profiler.h"
+#include "HostAllocator.h"
 
 namespace vv
 {
@@ -75,7 +77,7 @@ namespace vv
             shutDown(device);
 
         //vkPreCallValidateCreateSwapchainKHR(); // todo: this used to be required, but doesn't seem to be defined anymore
-        VV_CHECK_SUCCESS(vkCreateSwapchainKHR(device->logical_device, &swap_chain_create_info, nullptr, &swap_chain));
+        VV_CHECK_SUCCESS(vkCreateSwapchainKHR(device->logical_device, &swap_chain_create_info, HostAllocator::inst()->callbacks(HostObjectType::SwapChain), &swap_chain));
         createVulkanImageViews(device);
     }
 
@@ -90,20 +92,19 @@ namespace vv
                 delete color_image_views[i];
             }
 
-            depth_image->shutDown(); delete depth_image;
-            depth_image_view->shutDown(); delete depth_image_view;
-
-            vkDestroySwapchainKHR(device->logical_device, swap_chain, nullptr);
+            vkDestroySwapchainKHR(device->logical_device, swap_chain, HostAllocator::inst()->callbacks(HostObjectType::SwapChain));
         }
     }
 
     void VulkanSwapChain::acquireNextImage(VulkanDevice *device, VkSemaphore image_ready_semaphore, uint32_t &image_index)
     {
+        VV_PROFILE_FUNCTION();
         VV_CHECK_SUCCESS(vkAcquireNextImageKHR(device->logical_device, swap_chain, UINT64_MAX, image_ready_semaphore, VK_NULL_HANDLE, &image_index));
     }
 
     void VulkanSwapChain::present(VkQueue queue, uint32_t &image_index, VkSemaphore wait_semaphore)
     {
+        VV_PROFILE_FUNCTION();
         VkPresentInfoKHR present_info   = {};
         present_info.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         present_info.waitSemaphoreCount = 1;
@@ -139,12 +140,6 @@ namespace vv
     	    curr_image_view->create(device, curr_image, VK_IMAGE_VIEW_TYPE_2D, 0);
     	    color_image_views[i] = curr_image_view;
     	}
-
-        // todo: consider moving this? depth attachment really has nothing to do with the swap chain. only for a forward renderer's trip through the pipeline
-    	depth_image = new VulkanImage();
-        depth_image->createDepthAttachment(device, extent, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
-    	depth_image_view = new VulkanImageView();
-    	depth_image_view->create(device, depth_image, VK_IMAGE_VIEW_TYPE_2D, 0);
     }
 
     VkSurfaceFormatKHR VulkanSwapChain::chooseSurfaceFormat(VulkanDevice *device)
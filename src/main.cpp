@@ -1,6 +1,7 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <cstdlib>
 
 #include "VirtualVistaEngine.h"
 
@@ -10,6 +11,8 @@ int main(int argc, char **argv)
 {
     VirtualVistaEngine app;
     app.create(argc, argv);
+    if (app.isFinished())
+        return EXIT_SUCCESS;
 
     Scene *scene = app.getScene();
 
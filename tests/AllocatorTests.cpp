@@ -0,0 +1,370 @@
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <map>
+#include <vector>
+#include <stdexcept>
+
+#include "RangeAllocator.h"
+#include "VulkanMemoryAllocator.h"
+
+// Runs the range and device memory allocators without a device. Returns non-zero if any check failed.
+
+namespace
+{
+    int failed_checks = 0;
+
+    #define VV_TEST_CHECK(condition) \
+        do { if (!(condition)) { std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition "\n"; ++failed_checks; } } while (0)
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////// RangeAllocator
+    void testRangeCoalescing()
+    {
+        vv::RangeAllocator ranges;
+        ranges.create(1024);
+
+        uint64_t offsets[3];
+        vv::RangeAllocator::Handle handles[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            VV_TEST_CHECK(ranges.allocate(256, 1, offsets[i], handles[i]));
+            VV_TEST_CHECK(offsets[i] == 256 * static_cast<uint64_t>(i));
+        }
+        VV_TEST_CHECK(ranges.getUsedSize() == 768);
+        VV_TEST_CHECK(ranges.getFreeRangeCount() == 1);
+
+        // the middle range has no free neighbour
+        ranges.free(handles[1]);
+        VV_TEST_CHECK(ranges.getFreeRangeCount() == 2);
+        VV_TEST_CHECK(ranges.getLargestFreeRange() == 256);
+
+        // merges with the freed range after it
+        ranges.free(handles[0]);
+        VV_TEST_CHECK(ranges.getFreeRangeCount() == 2);
+        VV_TEST_CHECK(ranges.getLargestFreeRange() == 512);
+
+        // merges on both sides
+        ranges.free(handles[2]);
+        VV_TEST_CHECK(ranges.isEmpty());
+        VV_TEST_CHECK(ranges.getUsedSize() == 0);
+        VV_TEST_CHECK(ranges.getFreeRangeCount() == 1);
+        VV_TEST_CHECK(ranges.getLargestFreeRange() == 1024);
+
+        uint64_t offset;
+        vv::RangeAllocator::Handle handle;
+        VV_TEST_CHECK(ranges.allocate(1024, 1, offset, handle) && offset == 0);
+        VV_TEST_CHECK(!ranges.allocate(1, 1, offset, handle));
+    }
+
+
+    void testRangeAlignment()
+    {
+        vv::RangeAllocator ranges;
+        ranges.create(4096);
+
+        uint64_t offset;
+        vv::RangeAllocator::Handle small, aligned;
+        VV_TEST_CHECK(ranges.allocate(1, 1, offset, small) && offset == 0);
+        VV_TEST_CHECK(ranges.allocate(64, 256, offset, aligned) && offset == 256);
+
+        // the padding in front of the aligned range becomes a free range of its own
+        VV_TEST_CHECK(ranges.getFreeRangeCount() == 2);
+        VV_TEST_CHECK(ranges.getUsedSize() == 65);
+
+        ranges.free(small);
+        VV_TEST_CHECK(ranges.getFreeRangeCount() == 2);
+        VV_TEST_CHECK(ranges.getLargestFreeRange() == 4096 - 320);
+
+        ranges.free(aligned);
+        VV_TEST_CHECK(ranges.getFreeRangeCount() == 1);
+        VV_TEST_CHECK(ranges.getLargestFreeRange() == 4096);
+    }
+
+
+    void testRangeExactFit()
+    {
+        // sizes off a bin boundary, e.g. a dedicated device memory block holding a single resource
+        for (uint64_t size : { 17ull, 1000ull, 800000ull, 123456789ull })
+        {
+            vv::RangeAllocator ranges;
+            ranges.create(size);
+
+            uint64_t offset = 1;
+            vv::RangeAllocator::Handle handle;
+            VV_TEST_CHECK(ranges.allocate(size, 1, offset, handle) && offset == 0);
+            VV_TEST_CHECK(ranges.getUsedSize() == size);
+
+            ranges.free(handle);
+            VV_TEST_CHECK(ranges.allocate(size - 16, 16, offset, handle) && offset == 0);
+        }
+    }
+
+
+    void testRangeRandomized()
+    {
+        const uint64_t size = 1 << 20;
+        vv::RangeAllocator ranges;
+        ranges.create(size);
+
+        std::mt19937 generator(1234);
+        std::map<uint64_t, std::pair<uint64_t, vv::RangeAllocator::Handle> > live; // offset -> size, handle
+        uint64_t used = 0;
+
+        for (int i = 0; i < 20000; ++i)
+        {
+            if (!live.empty() && generator() % 3 == 0)
+            {
+                auto it = live.begin();
+                std::advance(it, generator() % live.size());
+                ranges.free(it->second.second);
+                used -= it->second.first;
+                live.erase(it);
+                continue;
+            }
+
+            const uint64_t request = 1 + generator() % 4096;
+            const uint64_t alignment = 1ull << (generator() % 9);
+            uint64_t offset;
+            vv::RangeAllocator::Handle handle;
+            if (!ranges.allocate(request, alignment, offset, handle))
+                continue;
+
+            VV_TEST_CHECK(offset % alignment == 0);
+            VV_TEST_CHECK(offset + request <= size);
+
+            // no overlap with the live ranges on either side
+            auto next = live.lower_bound(offset);
+            VV_TEST_CHECK(next == live.end() || offset + request <= next->first);
+            if (next != live.begin())
+            {
+                auto prev = std::prev(next);
+                VV_TEST_CHECK(prev->first + prev->second.first <= offset);
+            }
+
+            live[offset] = std::make_pair(request, handle);
+            used += request;
+        }
+
+        VV_TEST_CHECK(ranges.getUsedSize() == used);
+        VV_TEST_CHECK(ranges.getAllocationCount() == live.size());
+
+        for (auto &range : live)
+            ranges.free(range.second.second);
+        VV_TEST_CHECK(ranges.isEmpty());
+        VV_TEST_CHECK(ranges.getFreeRangeCount() == 1);
+        VV_TEST_CHECK(ranges.getLargestFreeRange() == size);
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////////////////////// VulkanMemoryAllocator
+    // stands in for the driver. every VkDeviceMemory is backed by host memory so mapped pointers can be checked.
+    struct MockDeviceMemory
+    {
+        std::map<VkDeviceMemory, std::vector<unsigned char> > allocations;
+        uint32_t allocate_calls = 0;
+        uint32_t map_calls      = 0;
+        uint32_t unmap_calls    = 0;
+        bool out_of_memory      = false;
+    } mock;
+
+
+    VKAPI_ATTR VkResult VKAPI_CALL mockAllocateMemory(VkDevice, const VkMemoryAllocateInfo *allocate_info, const VkAllocationCallbacks *,
+                                                      VkDeviceMemory *memory)
+    {
+        if (mock.out_of_memory)
+            return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+
+        std::vector<unsigned char> data(static_cast<std::size_t>(allocate_info->allocationSize));
+        *memory = reinterpret_cast<VkDeviceMemory>(static_cast<uintptr_t>(++mock.allocate_calls));
+        mock.allocations[*memory].swap(data);
+        return VK_SUCCESS;
+    }
+
+
+    VKAPI_ATTR void VKAPI_CALL mockFreeMemory(VkDevice, VkDeviceMemory memory, const VkAllocationCallbacks *)
+    {
+        VV_TEST_CHECK(mock.allocations.erase(memory) == 1);
+    }
+
+
+    VKAPI_ATTR VkResult VKAPI_CALL mockMapMemory(VkDevice, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize, VkMemoryMapFlags,
+                                                 void **data)
+    {
+        ++mock.map_calls;
+        *data = mock.allocations.at(memory).data() + offset;
+        return VK_SUCCESS;
+    }
+
+
+    VKAPI_ATTR void VKAPI_CALL mockUnmapMemory(VkDevice, VkDeviceMemory)
+    {
+        ++mock.unmap_calls;
+    }
+
+
+    const uint32_t device_local_type = 0;
+    const uint32_t host_visible_type = 1;
+    const VkDeviceSize block_size = 1 << 20;
+
+
+    void createMockedAllocator(vv::VulkanMemoryAllocator &allocator)
+    {
+        VkPhysicalDeviceMemoryProperties memory_properties = {};
+        memory_properties.memoryHeapCount = 2;
+        memory_properties.memoryHeaps[0].size = 1ull << 32;
+        memory_properties.memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+        memory_properties.memoryHeaps[1].size = 1ull << 32;
+        memory_properties.memoryTypeCount = 2;
+        memory_properties.memoryTypes[device_local_type].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        memory_properties.memoryTypes[device_local_type].heapIndex = 0;
+        memory_properties.memoryTypes[host_visible_type].propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        memory_properties.memoryTypes[host_visible_type].heapIndex = 1;
+
+        vv::DeviceMemoryFunctions functions;
+        functions.allocate_memory = &mockAllocateMemory;
+        functions.free_memory = &mockFreeMemory;
+        functions.map_memory = &mockMapMemory;
+        functions.unmap_memory = &mockUnmapMemory;
+
+        allocator.create(VK_NULL_HANDLE, memory_properties, block_size, nullptr, functions);
+    }
+
+
+    VkMemoryRequirements requirements(VkDeviceSize size, VkDeviceSize alignment)
+    {
+        VkMemoryRequirements memory_requirements = {};
+        memory_requirements.size = size;
+        memory_requirements.alignment = alignment;
+        memory_requirements.memoryTypeBits = ~0u;
+        return memory_requirements;
+    }
+
+
+    void testBlockSharing()
+    {
+        mock = MockDeviceMemory();
+        vv::VulkanMemoryAllocator allocator;
+        createMockedAllocator(allocator);
+
+        // buffers share a block
+        vv::MemoryAllocation first = allocator.allocate(requirements(1000, 256), device_local_type, true);
+        vv::MemoryAllocation second = allocator.allocate(requirements(1000, 256), device_local_type, true);
+        VV_TEST_CHECK(allocator.getDeviceAllocationCount() == 1);
+        VV_TEST_CHECK(first.memory == second.memory);
+        VV_TEST_CHECK(first.offset % 256 == 0 && second.offset % 256 == 0);
+        VV_TEST_CHECK(first.offset + 1000 <= second.offset || second.offset + 1000 <= first.offset);
+        VV_TEST_CHECK(first.mapped_data == nullptr);
+
+        // optimally tiled images never share a block with buffers
+        vv::MemoryAllocation image = allocator.allocate(requirements(4096, 4096), device_local_type, false);
+        VV_TEST_CHECK(allocator.getDeviceAllocationCount() == 2);
+        VV_TEST_CHECK(image.memory != first.memory);
+
+        // host visible blocks are mapped once, allocations point into the mapping
+        vv::MemoryAllocation staging = allocator.allocate(requirements(300, 4), host_visible_type, true);
+        vv::MemoryAllocation staging_next = allocator.allocate(requirements(300, 4), host_visible_type, true);
+        VV_TEST_CHECK(mock.map_calls == 1);
+        VV_TEST_CHECK(staging.mapped_data == mock.allocations.at(staging.memory).data() + staging.offset);
+        VV_TEST_CHECK(staging_next.mapped_data == mock.allocations.at(staging_next.memory).data() + staging_next.offset);
+
+        for (vv::MemoryAllocation *allocation : { &first, &second, &image, &staging, &staging_next })
+        {
+            allocator.free(*allocation);
+            VV_TEST_CHECK(allocation->memory == VK_NULL_HANDLE);
+        }
+
+        // the last empty block of every kind is kept for the next allocation
+        VV_TEST_CHECK(allocator.getDeviceAllocationCount() == 3);
+        VV_TEST_CHECK(mock.allocations.size() == 3);
+
+        allocator.shutDown();
+        VV_TEST_CHECK(mock.allocations.empty());
+        VV_TEST_CHECK(mock.unmap_calls == mock.map_calls);
+    }
+
+
+    void testBlockRelease()
+    {
+        mock = MockDeviceMemory();
+        vv::VulkanMemoryAllocator allocator;
+        createMockedAllocator(allocator);
+
+        // fills the first block, so the next allocation needs a block of its own
+        std::vector<vv::MemoryAllocation> allocations;
+        for (int i = 0; i < 5; ++i)
+            allocations.push_back(allocator.allocate(requirements(block_size / 4, 256), device_local_type, true));
+        VV_TEST_CHECK(allocator.getDeviceAllocationCount() == 2);
+        VV_TEST_CHECK(allocations[4].memory != allocations[0].memory);
+
+        // an empty block is released once another block of its kind remains
+        allocator.free(allocations[4]);
+        VV_TEST_CHECK(allocator.getDeviceAllocationCount() == 1);
+        VV_TEST_CHECK(mock.allocations.size() == 1);
+
+        // too large to share a block, released as soon as it's freed
+        vv::MemoryAllocation dedicated = allocator.allocate(requirements(800000, 256), device_local_type, true);
+        VV_TEST_CHECK(allocator.getDeviceAllocationCount() == 2);
+        VV_TEST_CHECK(dedicated.offset == 0);
+        VV_TEST_CHECK(mock.allocations.at(dedicated.memory).size() == 800000);
+
+        std::vector<vv::MemoryBlockStats> stats = allocator.getStats();
+        VV_TEST_CHECK(stats.size() == 2);
+        for (const auto &block : stats)
+            VV_TEST_CHECK(block.dedicated ? block.used == 800000 : block.allocation_count == 4);
+
+        allocator.free(dedicated);
+        VV_TEST_CHECK(allocator.getDeviceAllocationCount() == 1);
+
+        for (int i = 0; i < 4; ++i)
+            allocator.free(allocations[i]);
+        VV_TEST_CHECK(allocator.getDeviceAllocationCount() == 1);
+
+        allocator.shutDown();
+        VV_TEST_CHECK(mock.allocations.empty());
+    }
+
+
+    void testOutOfDeviceMemory()
+    {
+        mock = MockDeviceMemory();
+        vv::VulkanMemoryAllocator allocator;
+        createMockedAllocator(allocator);
+
+        mock.out_of_memory = true;
+        bool thrown = false;
+        try
+        {
+            allocator.allocate(requirements(1000, 256), device_local_type, true);
+        }
+        catch (const std::runtime_error &)
+        {
+            thrown = true;
+        }
+        VV_TEST_CHECK(thrown);
+        VV_TEST_CHECK(allocator.getDeviceAllocationCount() == 0);
+
+        allocator.shutDown();
+    }
+}
+
+
+int main()
+{
+    testRangeCoalescing();
+    testRangeAlignment();
+    testRangeExactFit();
+    testRangeRandomized();
+    testBlockSharing();
+    testBlockRelease();
+    testOutOfDeviceMemory();
+
+    if (failed_checks > 0)
+    {
+        std::cerr << failed_checks << " checks failed\n";
+        return 1;
+    }
+
+    std::cout << "All allocator tests passed\n";
+    return 0;
+}